@@ -1,8 +1,13 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
 #include <vector>
+#if defined(__ARM_FEATURE_SVE)
 #include <arm_sve.h>
+#endif
+#include "cpu/CodeArena.h"
 
 namespace PXS3C {
 
@@ -51,18 +56,21 @@ private:
     bool sve2_available_;
     uint32_t vector_length_; // SVE vector length in bits
     
-    // JIT code cache
+    // JIT code cache, allocated from the shared code arena
     struct CodeBlock {
         void* code;
         size_t size;
         uint32_t spu_pc;
     };
     std::vector<CodeBlock> code_cache_;
+    std::shared_ptr<pxs3c::CodeArena> arena_;
 
+#if defined(__ARM_FEATURE_SVE)
     // SVE2 optimization helpers
     void emitSPUVectorOp(uint32_t opcode, svfloat32_t* regs);
     void emitSPUShuffleOp(uint32_t opcode, svuint8_t* regs);
     void emitSPUArithmeticOp(uint32_t opcode, svint32_t* regs);
+#endif
 };
 
 } // namespace PXS3C
@@ -0,0 +1,65 @@
+#include "core/CycleScheduler.h"
+#include "cpu/PPUInterpreter.h"
+#include "cpu/SPUManager.h"
+#include <algorithm>
+#include <chrono>
+
+namespace pxs3c {
+
+static inline uint64_t nowNs() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Host time a slice should take: long enough that per-slice overhead is
+// noise, short enough to stop close to the frame deadline
+static constexpr uint64_t TARGET_SLICE_NS = 1000000;
+
+CycleScheduler::CycleScheduler()
+    : ppu_(nullptr), spus_(nullptr), sliceTicks_(MIN_SLICE_TICKS) {}
+
+void CycleScheduler::init(PPUInterpreter* ppu, SPUManager* spus) {
+    ppu_ = ppu;
+    spus_ = spus;
+    timebase_.reset();
+    sliceTicks_ = MIN_SLICE_TICKS;
+    stats_ = CycleSchedulerStats();
+}
+
+void CycleScheduler::runSlice(uint64_t ticks) {
+    uint64_t target = Timebase::ticksToCycles(timebase_.read() + ticks);
+    if (ppu_) ppu_->runUntil(target);
+    if (spus_) spus_->runUntil(target);
+    timebase_.advance(ticks);
+    stats_.slices++;
+}
+
+uint64_t CycleScheduler::runFrame(uint64_t guestTicks, uint64_t hostBudgetNs) {
+    uint64_t start = nowNs();
+    uint64_t ran = 0;
+    while (ran < guestTicks) {
+        uint64_t ticks = std::min(sliceTicks_, guestTicks - ran);
+        uint64_t sliceStart = nowNs();
+        runSlice(ticks);
+        ran += ticks;
+
+        uint64_t now = nowNs();
+        uint64_t elapsed = now - sliceStart;
+        if (ticks == sliceTicks_) {
+            if (elapsed < TARGET_SLICE_NS / 2 && sliceTicks_ < MAX_SLICE_TICKS) {
+                sliceTicks_ *= 2;
+            } else if (elapsed > TARGET_SLICE_NS * 2 && sliceTicks_ > MIN_SLICE_TICKS) {
+                sliceTicks_ /= 2;
+            }
+        }
+        if (now - start >= hostBudgetNs) {
+            break;
+        }
+    }
+    stats_.frames++;
+    stats_.guestTicks += ran;
+    stats_.lastFrameTicks = ran;
+    return ran;
+}
+
+} // namespace pxs3c
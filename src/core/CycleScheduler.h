@@ -0,0 +1,52 @@
+#pragma once
+
+#include "core/Timebase.h"
+#include <cstdint>
+
+namespace pxs3c {
+
+class PPUInterpreter;
+class SPUManager;
+
+struct CycleSchedulerStats {
+    uint64_t frames = 0;
+    uint64_t slices = 0;
+    uint64_t guestTicks = 0;      // guest time run, in timebase ticks
+    uint64_t lastFrameTicks = 0;  // guest time covered by the last frame
+};
+
+// Runs the PPU and SPUs against a shared guest clock. A frame asks for a
+// span of guest time; it is executed in slices, each giving every core the
+// cycles needed to reach the slice's end, after which the timebase
+// advances. Slices grow while the host finishes them quickly and shrink when
+// it does not, so fast hosts batch large slices and slow hosts still stop
+// near the frame's host-time deadline.
+class CycleScheduler {
+public:
+    static constexpr uint64_t MIN_SLICE_TICKS = 256;     // 10240 cycles
+    static constexpr uint64_t MAX_SLICE_TICKS = 1 << 20; // ~13ms of guest time
+
+    CycleScheduler();
+
+    void init(PPUInterpreter* ppu, SPUManager* spus);
+
+    // Run up to guestTicks of guest time, stopping early once hostBudgetNs
+    // of host time has passed. Returns the guest ticks actually run.
+    uint64_t runFrame(uint64_t guestTicks, uint64_t hostBudgetNs);
+
+    Timebase& getTimebase() { return timebase_; }
+    const Timebase& getTimebase() const { return timebase_; }
+    uint64_t getSliceTicks() const { return sliceTicks_; }
+    const CycleSchedulerStats& getStats() const { return stats_; }
+
+private:
+    PPUInterpreter* ppu_;
+    SPUManager* spus_;
+    Timebase timebase_;
+    uint64_t sliceTicks_;
+    CycleSchedulerStats stats_;
+
+    void runSlice(uint64_t ticks);
+};
+
+} // namespace pxs3c
@@ -1,19 +1,59 @@
 #include "core/Emulator.h"
+#include "core/CycleScheduler.h"
 #include "core/SyscallHandler.h"
 #include "rsx/VulkanRenderer.h"
 #include "rsx/RSXProcessor.h"
+#include "rsx/RSXFifo.h"
 #include "core/FramePacer.h"
 #include "cpu/engines/Rpcs3Bridge.h"
 #include "memory/MemoryManager.h"
 #include "loader/ElfLoader.h"
 #include "cpu/PPUInterpreter.h"
+#include "cpu/PPUJIT.h"
+#include "cpu/CodeHash.h"
 #include "cpu/SPUManager.h"
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <utility>
 
 namespace pxs3c {
 
+namespace {
+
+// Calls into the renderer while the RSX holds it go through its lock: the
+// RSX thread presents through it at the same time
+template <typename Func>
+void withRenderer(RSXProcessor* rsx, VulkanRenderer* renderer, Func&& func) {
+    if (rsx && rsx->withRenderer(func)) return;
+    if (renderer) func(*renderer);
+}
+
+} // namespace
+
+// Per-game PPU JIT object cache directory:
+// $PXS3C_CACHE_DIR, $XDG_CACHE_HOME/pxs3c or ~/.cache/pxs3c, then
+// ppu/<file stem>-<hash of the game path>. Empty if no root is known.
+static std::string jitCacheDirectory(const std::string& gamePath) {
+    std::string root;
+    if (const char* dir = std::getenv("PXS3C_CACHE_DIR"); dir && *dir) {
+        root = dir;
+    } else if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        root = std::string(xdg) + "/pxs3c";
+    } else if (const char* home = std::getenv("HOME"); home && *home) {
+        root = std::string(home) + "/.cache/pxs3c";
+    } else {
+        return std::string();
+    }
+
+    char suffix[24];
+    std::snprintf(suffix, sizeof(suffix), "-%016llx",
+                  static_cast<unsigned long long>(hashCode(gamePath.data(), gamePath.size())));
+    return root + "/ppu/" + std::filesystem::path(gamePath).stem().string() + suffix;
+}
+
 Emulator::Emulator() {
     statusText_ = "Idle";
 }
@@ -56,6 +96,10 @@ bool Emulator::init() {
         return false;
     }
     
+    // PPU and SPUs run in lockstep slices against the guest timebase
+    scheduler_ = std::make_unique<CycleScheduler>();
+    scheduler_->init(ppu_.get(), spuManager_.get());
+    
     // Initialize renderer
     renderer_ = std::make_unique<VulkanRenderer>();
     if (!renderer_->init()) {
@@ -72,6 +116,16 @@ bool Emulator::init() {
         return false;
     }
     
+    // The RSX executes its command FIFO on a thread of its own, in parallel
+    // with the PPU and SPUs
+    fifo_ = std::make_unique<RSXFifo>();
+    if (!fifo_->init(memory_.get()) || !rsx_->mapSemaphores(memory_.get()) ||
+        !rsx_->startFifoThread(fifo_.get())) {
+        std::cerr << "RSX FIFO init failed" << std::endl;
+        setStatusText("Init failed: RSX FIFO");
+        return false;
+    }
+    
     // Initialize frame pacer
     framePacer_ = std::make_unique<FramePacer>();
     framePacer_->setTargetFps(60);
@@ -105,6 +159,11 @@ bool Emulator::loadGame(const char* path) {
     bool isSelf = pathStr.size() > 5 && 
                   pathStr.substr(pathStr.size() - 5) == ".self";
     
+    // Compiled PPU code from previous runs of this game is reused
+    if (ppu_ && ppu_->getJIT()) {
+        ppu_->getJIT()->setCacheDirectory(jitCacheDirectory(pathStr));
+    }
+    
     if (isSelf) {
         // Try to load SELF file
         if (elfLoader_ && elfLoader_->loadSelf(path, memory_.get())) {
@@ -144,14 +203,12 @@ bool Emulator::loadGame(const char* path) {
 }
 
 void Emulator::runFrame() {
-    // Execute PPU instructions (1000 per frame for ~60fps)
-    if (ppu_) {
-        ppu_->executeBlock(1000);
-    }
-    
-    // Execute SPU instructions in parallel (6 cores)
-    if (spuManager_) {
-        spuManager_->executeAllSPUs(500);
+    // One frame of guest time (79.8M timebase ticks per second), cut short
+    // when it has used 3/4 of the host frame time, leaving room to render
+    if (scheduler_) {
+        int fps = framePacer_ ? framePacer_->getTargetFps() : 60;
+        if (fps <= 0) fps = 60;
+        scheduler_->runFrame(TIMEBASE_FREQUENCY / fps, 750000000ULL / fps);
     }
     
     // Fallback to engine if available
@@ -159,8 +216,25 @@ void Emulator::runFrame() {
         engine_->runFrame();
     }
     
-    // Render frame
-    renderer_->drawFrame();
+    presentFrame();
+}
+
+void Emulator::presentFrame() {
+    if (!rsx_ || !rsx_->isFifoThreadRunning()) {
+        withRenderer(rsx_.get(), renderer_.get(), [](VulkanRenderer& renderer) { renderer.drawFrame(); });
+        return;
+    }
+    
+    // The RSX thread presents the frame once it has executed everything
+    // queued before the flip. It may still be busy with the last frame
+    // while the CPUs run this one, but no further behind than that.
+    if (!rsx_->waitForFlips(framesQueued_, RSXFifo::WAIT_TIMEOUT_NS)) {
+        std::cerr << "RSX is more than a frame behind" << std::endl;
+    }
+    if (fifo_->push(GCM_FLIP_COMMAND, framesQueued_ & 1)) {
+        fifo_->flush();
+        framesQueued_++;
+    }
 }
 
 std::string Emulator::getStatusText() const {
@@ -174,6 +248,8 @@ void Emulator::setStatusText(const std::string& text) {
 }
 
 void Emulator::shutdown() {
+    // The RSX thread presents through the renderer: stop it first
+    if (rsx_) rsx_->shutdown();
     renderer_.reset();
     std::cout << "Emulator shutdown" << std::endl;
 }
@@ -186,8 +262,20 @@ bool Emulator::attachAndroidWindow(ANativeWindow* window) {
             std::cerr << "Renderer init failed" << std::endl;
             return false;
         }
+        // A new renderer: the RSX must not be presenting while it switches
+        if (rsx_) {
+            bool running = rsx_->isFifoThreadRunning();
+            rsx_->stopFifoThread();
+            rsx_->init(renderer_.get());
+            if (running && !rsx_->startFifoThread(fifo_.get())) {
+                std::cerr << "RSX FIFO restart failed" << std::endl;
+            }
+        }
     }
-    return renderer_->attachAndroidWindow(window);
+    bool attached = false;
+    withRenderer(rsx_.get(), renderer_.get(),
+                 [&](VulkanRenderer& renderer) { attached = renderer.attachAndroidWindow(window); });
+    return attached;
 }
 #endif
 
@@ -200,17 +288,18 @@ int Emulator::tickFrameAndGetDelayMs() {
     if (!pacer_) pacer_ = std::make_unique<FramePacer>();
     pacer_->beginFrame();
     if (engine_) engine_->runFrame();
-    renderer_->drawFrame();
+    presentFrame();
     return pacer_->endFrameAndSuggestDelayMs();
 }
 
 void Emulator::setClearColor(float r, float g, float b) {
-    if (renderer_) renderer_->setClearColor(r, g, b);
+    withRenderer(rsx_.get(), renderer_.get(), [&](VulkanRenderer& renderer) { renderer.setClearColor(r, g, b); });
 }
 
 void Emulator::setVsync(bool enabled) {
 #ifdef __ANDROID__
-    if (renderer_) renderer_->setPresentModeAndroid(enabled ? 0 : 1);
+    withRenderer(rsx_.get(), renderer_.get(),
+                 [&](VulkanRenderer& renderer) { renderer.setPresentModeAndroid(enabled ? 0 : 1); });
 #else
     (void)enabled;
 #endif
@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -18,6 +19,8 @@ class PPUInterpreter;
 class SPUManager;
 class SyscallHandler;
 class RSXProcessor;
+class RSXFifo;
+class CycleScheduler;
 
 class Emulator {
 public:
@@ -48,6 +51,8 @@ public:
     PPUInterpreter* getPPU() { return ppu_.get(); }
     SPUManager* getSPUs() { return spuManager_.get(); }
     RSXProcessor* getRSX() { return rsx_.get(); }
+    RSXFifo* getRSXFifo() { return fifo_.get(); }
+    CycleScheduler* getScheduler() { return scheduler_.get(); }
     
 private:
     void setStatusText(const std::string& text);
@@ -62,10 +67,14 @@ private:
     std::unique_ptr<PPUInterpreter> ppu_;
     std::unique_ptr<SPUManager> spuManager_;
     std::unique_ptr<SyscallHandler> syscallHandler_;
+    std::unique_ptr<RSXFifo> fifo_;
     std::unique_ptr<RSXProcessor> rsx_;
+    std::unique_ptr<CycleScheduler> scheduler_;
     std::unique_ptr<class FramePacer> pacer_;
     std::unique_ptr<Engine> engine_;
+    uint32_t framesQueued_ = 0;  // flips handed to the RSX thread
     bool initializeEngine();
+    void presentFrame();
 };
 
 } // namespace pxs3c
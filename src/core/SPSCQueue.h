@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#ifdef __linux__
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace pxs3c {
+
+// Sleep while word == expected, for at most timeoutNs. Returns early on a
+// wake, a changed value or spuriously; callers re-check their condition.
+inline void futexWait(std::atomic<uint32_t>& word, uint32_t expected, uint64_t timeoutNs) {
+#ifdef __linux__
+    timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeoutNs / 1000000000ULL);
+    ts.tv_nsec = static_cast<long>(timeoutNs % 1000000000ULL);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+#else
+    if (word.load(std::memory_order_acquire) == expected) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::min<uint64_t>(timeoutNs, 100000)));
+    }
+#endif
+}
+
+inline void futexWakeAll(std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+    (void)word;
+#endif
+}
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. head_ and tail_ are free-running counters and double as futex
+// words, so either side can sleep until the other moves; wakes are only
+// issued when someone is actually waiting.
+template <typename T, uint32_t Capacity>
+class SPSCQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    SPSCQueue() : head_(0), tail_(0), waiters_(0) {}
+
+    bool push(const T& value) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots_[tail & (Capacity - 1)] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        wakeWaiters(tail_);
+        return true;
+    }
+
+    bool pop(T& value) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots_[head & (Capacity - 1)];
+        head_.store(head + 1, std::memory_order_release);
+        wakeWaiters(head_);
+        return true;
+    }
+
+    uint32_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const { return size() == Capacity; }
+    static constexpr uint32_t capacity() { return Capacity; }
+
+    // Only while neither side is using the queue
+    void clear() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_release);
+    }
+
+    // Block until the queue has an entry (consumer) or a free slot
+    // (producer), or the timeout passes. Returns whether it does now.
+    bool waitNotEmpty(uint64_t timeoutNs) {
+        return waitFor(tail_, timeoutNs, [this] { return !empty(); });
+    }
+    bool waitNotFull(uint64_t timeoutNs) {
+        return waitFor(head_, timeoutNs, [this] { return !full(); });
+    }
+
+private:
+    alignas(64) std::atomic<uint32_t> head_;  // written by the consumer
+    alignas(64) std::atomic<uint32_t> tail_;  // written by the producer
+    alignas(64) std::atomic<uint32_t> waiters_;
+    std::array<T, Capacity> slots_{};
+
+    void wakeWaiters(std::atomic<uint32_t>& word) {
+        // Orders the release store of word before the waiters_ load; with
+        // the waiter's seq_cst increment one side always sees the other
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters_.load(std::memory_order_seq_cst) != 0) {
+            futexWakeAll(word);
+        }
+    }
+
+    template <typename Ready>
+    bool waitFor(std::atomic<uint32_t>& word, uint64_t timeoutNs, Ready ready) {
+        if (ready()) return true;
+        if (timeoutNs == 0) return false;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeoutNs);
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        for (;;) {
+            uint32_t seen = word.load(std::memory_order_seq_cst);
+            if (ready()) break;
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) break;
+            futexWait(word, seen,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+        }
+        waiters_.fetch_sub(1, std::memory_order_seq_cst);
+        return ready();
+    }
+};
+
+} // namespace pxs3c
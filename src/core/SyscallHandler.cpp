@@ -13,6 +13,8 @@ SyscallHandler::SyscallHandler()
     syscallNames_[6] = "process_getpid";
     syscallNames_[82] = "process_prx_load_module";
     syscallNames_[83] = "process_prx_start_module";
+    syscallNames_[145] = "sys_time_get_current_time";
+    syscallNames_[147] = "sys_time_get_timebase_frequency";
     syscallNames_[202] = "sys_memory_allocate";
     syscallNames_[203] = "sys_memory_free";
     syscallNames_[205] = "sys_memory_get_user_memory_size";
@@ -55,6 +57,8 @@ bool SyscallHandler::handleSyscall(uint64_t callNumber, SyscallContext& ctx) {
             case 6:     return lv2_process_getpid(ctx);
             case 82:    return lv2_process_prx_load_module(ctx);
             case 83:    return lv2_process_prx_start_module(ctx);
+            case 145:   return lv2_sys_time_get_current_time(ctx);
+            case 147:   return lv2_sys_time_get_timebase_frequency(ctx);
             case 202:   return lv2_sys_memory_allocate(ctx);
             case 203:   return lv2_sys_memory_free(ctx);
             case 205:   return lv2_sys_memory_get_user_memory_size(ctx);
@@ -107,6 +111,25 @@ bool SyscallHandler::lv2_process_prx_start_module(SyscallContext& ctx) {
     return true;
 }
 
+bool SyscallHandler::lv2_sys_time_get_current_time(SyscallContext& ctx) {
+    // r3 = sec ptr (s64)
+    // r4 = nsec ptr (s64)
+    // Guest time since boot, from the calling thread's timebase
+    uint64_t ticks = ppu_ ? ppu_->getTimebase() : 0;
+    uint64_t ns = Timebase::ticksToNanoseconds(ticks);
+    if (memory_) {
+        if (ctx.r3 != 0) memory_->write64(ctx.r3, ns / 1000000000ULL);
+        if (ctx.r4 != 0) memory_->write64(ctx.r4, ns % 1000000000ULL);
+    }
+    ctx.returnValue = 0;
+    return true;
+}
+
+bool SyscallHandler::lv2_sys_time_get_timebase_frequency(SyscallContext& ctx) {
+    ctx.returnValue = TIMEBASE_FREQUENCY;
+    return true;
+}
+
 bool SyscallHandler::lv2_sys_memory_allocate(SyscallContext& ctx) {
     // r3 = size
     // r4 = flags
@@ -36,6 +36,8 @@ public:
     bool lv2_process_prx_load_module(SyscallContext& ctx);
     bool lv2_process_prx_start_module(SyscallContext& ctx);
     bool lv2_sys_process_exit(SyscallContext& ctx);
+    bool lv2_sys_time_get_current_time(SyscallContext& ctx);
+    bool lv2_sys_time_get_timebase_frequency(SyscallContext& ctx);
     bool lv2_sys_memory_allocate(SyscallContext& ctx);
     bool lv2_sys_memory_free(SyscallContext& ctx);
     bool lv2_sys_memory_get_user_memory_size(SyscallContext& ctx);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace pxs3c {
+
+// The Cell timebase ticks at 79.8 MHz. The PPU and SPUs are clocked at
+// 3.192 GHz, exactly 40 core cycles per tick.
+constexpr uint64_t TIMEBASE_FREQUENCY = 79800000;
+constexpr uint64_t CELL_CLOCK_FREQUENCY = 3192000000ULL;
+constexpr uint64_t CYCLES_PER_TICK = CELL_CLOCK_FREQUENCY / TIMEBASE_FREQUENCY;
+
+// Guest time. Every core counts the cycles it has executed; the scheduler
+// runs them in slices up to a common cycle target and then advances the
+// timebase to match, so no core's clock drifts more than a slice from it.
+// A core reading the timebase itself (mftb) sees its own cycle count, which
+// keeps the value monotonic and exact within a slice.
+class Timebase {
+public:
+    Timebase() : ticks_(0) {}
+
+    uint64_t read() const { return ticks_.load(std::memory_order_acquire); }
+    void advance(uint64_t ticks) { ticks_.fetch_add(ticks, std::memory_order_acq_rel); }
+    void reset() { ticks_.store(0, std::memory_order_release); }
+
+    static uint64_t cyclesToTicks(uint64_t cycles) { return cycles / CYCLES_PER_TICK; }
+    static uint64_t ticksToCycles(uint64_t ticks) { return ticks * CYCLES_PER_TICK; }
+    static uint64_t ticksToNanoseconds(uint64_t ticks) {
+        // Split to avoid overflowing ticks * 10^9
+        return (ticks / TIMEBASE_FREQUENCY) * 1000000000ULL +
+               (ticks % TIMEBASE_FREQUENCY) * 1000000000ULL / TIMEBASE_FREQUENCY;
+    }
+
+private:
+    std::atomic<uint64_t> ticks_;
+};
+
+} // namespace pxs3c
@@ -0,0 +1,297 @@
+#include "cpu/CodeArena.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/memfd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace pxs3c {
+
+namespace {
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+size_t hostPageSize() {
+    static const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    return page;
+}
+
+// An unnamed file to map twice
+int createSharedMemory(size_t size) {
+#ifdef __linux__
+    int fd = static_cast<int>(syscall(SYS_memfd_create, "pxs3c-jit", MFD_CLOEXEC));
+#else
+    static std::atomic<uint32_t> counter{0};
+    std::string name = "/pxs3c-jit-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        shm_unlink(name.c_str());
+    }
+#endif
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+CodeArena::CodeArena(size_t regionSize)
+    : regionSize_(alignUp(std::max<size_t>(regionSize, 1), hostPageSize())),
+      dualMapped_(true), current_(nullptr) {}
+
+CodeArena::~CodeArena() {
+    for (auto& [base, region] : regions_) {
+        unmapRegion(*region);
+    }
+}
+
+std::shared_ptr<CodeArena> CodeArena::shared() {
+    static std::shared_ptr<CodeArena> arena = std::make_shared<CodeArena>();
+    return arena;
+}
+
+CodeArena::Region* CodeArena::mapRegion(size_t size) {
+    auto region = std::make_unique<Region>();
+    region->size = size;
+
+    if (dualMapped_) {
+        int fd = createSharedMemory(size);
+        if (fd >= 0) {
+            void* write = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            void* exec = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+            close(fd);
+            if (write != MAP_FAILED && exec != MAP_FAILED) {
+                region->write = static_cast<uint8_t*>(write);
+                region->exec = static_cast<uint8_t*>(exec);
+            } else {
+                if (write != MAP_FAILED) munmap(write, size);
+                if (exec != MAP_FAILED) munmap(exec, size);
+            }
+        }
+        if (!region->exec) {
+            std::cerr << "JIT code arena: dual mapping unavailable, using RWX regions" << std::endl;
+            dualMapped_ = false;
+        }
+    }
+    if (!region->exec) {
+        void* code = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (code == MAP_FAILED) {
+            std::cerr << "JIT code arena: failed to map " << size << " bytes" << std::endl;
+            return nullptr;
+        }
+        region->write = region->exec = static_cast<uint8_t*>(code);
+    }
+
+    Region* raw = region.get();
+    regions_[reinterpret_cast<uintptr_t>(raw->exec)] = std::move(region);
+    stats_.regionsMapped++;
+    return raw;
+}
+
+void CodeArena::unmapRegion(Region& region) {
+    if (region.write != region.exec) {
+        munmap(region.write, region.size);
+    }
+    munmap(region.exec, region.size);
+}
+
+CodeArena::Region* CodeArena::regionOf(const void* exec) {
+    auto it = regions_.upper_bound(reinterpret_cast<uintptr_t>(exec));
+    if (it == regions_.begin()) {
+        return nullptr;
+    }
+    --it;
+    Region* region = it->second.get();
+    uintptr_t offset = reinterpret_cast<uintptr_t>(exec) - it->first;
+    return offset < region->size ? region : nullptr;
+}
+
+CodeSpan CodeArena::spanAt(Region& region, size_t offset, size_t size) {
+    CodeSpan span;
+    span.write = region.write + offset;
+    span.exec = region.exec + offset;
+    span.size = size;
+    return span;
+}
+
+bool CodeArena::allocateFromFreeList(Region& region, size_t size, size_t alignment, size_t& offset) {
+    for (auto it = region.freeList.begin(); it != region.freeList.end(); ++it) {
+        size_t start = it->first;
+        size_t end = start + it->second;
+        size_t aligned = alignUp(start, alignment);
+        if (aligned + size > end) {
+            continue;
+        }
+        region.freeList.erase(it);
+        if (aligned > start) {
+            region.freeList[start] = aligned - start;
+        }
+        if (aligned + size < end) {
+            region.freeList[aligned + size] = end - (aligned + size);
+        }
+        offset = aligned;
+        return true;
+    }
+    return false;
+}
+
+CodeSpan CodeArena::allocate(size_t size, size_t alignment) {
+    if (size == 0) {
+        return CodeSpan();
+    }
+    alignment = std::max<size_t>(alignment, 16);
+    if (alignment & (alignment - 1)) {
+        return CodeSpan();
+    }
+    size = alignUp(size, 16);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    Region* region = nullptr;
+    size_t offset = 0;
+
+    // Freed space first, so code that is recompiled over and over does not
+    // keep growing the arena
+    for (auto& [base, candidate] : regions_) {
+        if (allocateFromFreeList(*candidate, size, alignment, offset)) {
+            region = candidate.get();
+            stats_.reused++;
+            break;
+        }
+    }
+
+    if (!region) {
+        if (current_ && alignUp(current_->top, alignment) + size > current_->size) {
+            // Retire the region; what is left of it is still free space
+            if (current_->top < current_->size) {
+                current_->freeList[current_->top] = current_->size - current_->top;
+                current_->top = current_->size;
+            }
+            current_ = nullptr;
+        }
+        if (!current_) {
+            current_ = mapRegion(std::max(regionSize_, alignUp(size, hostPageSize())));
+            if (!current_) {
+                return CodeSpan();
+            }
+        }
+        region = current_;
+        offset = alignUp(region->top, alignment);
+        if (offset > region->top) {
+            region->freeList[region->top] = offset - region->top;
+        }
+        region->top = offset + size;
+    }
+
+    region->allocations[offset] = size;
+    region->live += size;
+    stats_.allocations++;
+    stats_.bytesLive += size;
+    return spanAt(*region, offset, size);
+}
+
+void CodeArena::free(const void* exec) {
+    if (!exec) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    Region* region = regionOf(exec);
+    if (!region) {
+        return;
+    }
+    size_t offset = static_cast<const uint8_t*>(exec) - region->exec;
+    auto alloc = region->allocations.find(offset);
+    if (alloc == region->allocations.end()) {
+        std::cerr << "JIT code arena: free of unknown block " << exec << std::endl;
+        return;
+    }
+    size_t size = alloc->second;
+    region->allocations.erase(alloc);
+    region->live -= size;
+    stats_.frees++;
+    stats_.bytesLive -= size;
+
+    if (region->live == 0) {
+        region->freeList.clear();
+        region->top = 0;
+        // Give the pages back; the next allocation faults in zero pages
+#ifdef MADV_REMOVE
+        madvise(region->write, region->size, region->write != region->exec ? MADV_REMOVE : MADV_DONTNEED);
+#else
+        madvise(region->write, region->size, MADV_DONTNEED);
+#endif
+        releaseEmptyRegions();
+        return;
+    }
+
+    // Coalesce with the free neighbours, then give a trailing chunk back to
+    // the bump pointer
+    auto next = region->freeList.lower_bound(offset);
+    if (next != region->freeList.end() && offset + size == next->first) {
+        size += next->second;
+        next = region->freeList.erase(next);
+    }
+    if (next != region->freeList.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            region->freeList.erase(prev);
+        }
+    }
+    if (region == current_ && offset + size == region->top) {
+        region->top = offset;
+    } else {
+        region->freeList[offset] = size;
+    }
+}
+
+void CodeArena::compact() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    releaseEmptyRegions();
+}
+
+void CodeArena::releaseEmptyRegions() {
+    for (auto it = regions_.begin(); it != regions_.end();) {
+        if (it->second.get() != current_ && it->second->live == 0) {
+            unmapRegion(*it->second);
+            it = regions_.erase(it);
+            stats_.regionsReleased++;
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CodeArena::flush(const CodeSpan& span) {
+    if (span) {
+        __builtin___clear_cache(reinterpret_cast<char*>(span.exec),
+                                reinterpret_cast<char*>(span.exec + span.size));
+    }
+}
+
+CodeArenaStats CodeArena::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CodeArenaStats stats = stats_;
+    stats.regions = regions_.size();
+    stats.bytesMapped = 0;
+    for (const auto& [base, region] : regions_) {
+        stats.bytesMapped += region->size;
+    }
+    return stats;
+}
+
+} // namespace pxs3c
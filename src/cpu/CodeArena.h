@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pxs3c {
+
+// One block of JIT code: written through `write`, executed at `exec`.
+// Both views map the same memory, so no page is ever writable and
+// executable at once.
+struct CodeSpan {
+    uint8_t* write = nullptr;
+    uint8_t* exec = nullptr;
+    size_t size = 0;
+
+    explicit operator bool() const { return exec != nullptr; }
+};
+
+struct CodeArenaStats {
+    uint64_t regions = 0;          // regions currently mapped
+    uint64_t regionsMapped = 0;    // regions mapped over the arena's life
+    uint64_t regionsReleased = 0;  // empty regions unmapped by compact()
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t reused = 0;           // allocations served from freed space
+    uint64_t bytesLive = 0;
+    uint64_t bytesMapped = 0;
+};
+
+// Executable memory for all JIT backends. Code is bump-allocated from large
+// regions, each a memfd mapped twice: read-write for the emitter and
+// read-execute for the host. Freed blocks go to a per-region free list,
+// coalesced with their neighbours and reused first-fit; compact() unmaps
+// regions that no longer hold any code. Compiled code is not
+// position-independent, so live blocks are never moved.
+//
+// Where a shareable mapping cannot be created the arena falls back to
+// anonymous read-write-execute regions, with both views the same address.
+class CodeArena {
+public:
+    static constexpr size_t DEFAULT_REGION_SIZE = 16 * 1024 * 1024;
+
+    explicit CodeArena(size_t regionSize = DEFAULT_REGION_SIZE);
+    ~CodeArena();
+
+    CodeArena(const CodeArena&) = delete;
+    CodeArena& operator=(const CodeArena&) = delete;
+
+    // The arena the PPU and SPU JITs share. Holders keep it alive, so code
+    // can still be freed by objects destroyed during static destruction.
+    static std::shared_ptr<CodeArena> shared();
+
+    // Thread-safe. Returns an empty span if no memory could be mapped.
+    CodeSpan allocate(size_t size, size_t alignment = 16);
+    // Frees the block allocate() returned at exec
+    void free(const void* exec);
+    // Make code written through span.write visible to instruction fetch
+    static void flush(const CodeSpan& span);
+
+    // Unmap regions with no live code, keeping the one allocations bump
+    // from. Also run automatically when a free empties a region.
+    void compact();
+
+    bool isDualMapped() const { return dualMapped_; }
+    CodeArenaStats getStats() const;
+
+private:
+    struct Region {
+        uint8_t* write = nullptr;
+        uint8_t* exec = nullptr;
+        size_t size = 0;
+        size_t top = 0;   // bump pointer
+        size_t live = 0;  // bytes in live blocks
+        std::map<size_t, size_t> freeList;     // offset -> size
+        std::map<size_t, size_t> allocations;  // offset -> size
+    };
+
+    size_t regionSize_;
+    bool dualMapped_;
+    mutable std::mutex mutex_;
+    std::map<uintptr_t, std::unique_ptr<Region>> regions_;  // by exec base
+    Region* current_;
+    CodeArenaStats stats_;
+
+    Region* mapRegion(size_t size);
+    void unmapRegion(Region& region);
+    void releaseEmptyRegions();  // with mutex_ held
+    Region* regionOf(const void* exec);
+    static CodeSpan spanAt(Region& region, size_t offset, size_t size);
+    bool allocateFromFreeList(Region& region, size_t size, size_t alignment, size_t& offset);
+};
+
+} // namespace pxs3c
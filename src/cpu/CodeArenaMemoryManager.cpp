@@ -0,0 +1,99 @@
+#include "cpu/CodeArenaMemoryManager.h"
+#include <algorithm>
+
+namespace pxs3c {
+
+CodeArenaMemoryManager::CodeArenaMemoryManager(std::shared_ptr<CodeArena> arena)
+    : arena_(std::move(arena)) {}
+
+CodeArenaMemoryManager::~CodeArenaMemoryManager() {
+    deregisterEHFrames();
+    for (const void* block : live_) {
+        arena_->free(block);
+    }
+}
+
+uint8_t* CodeArenaMemoryManager::allocateSection(uintptr_t size, unsigned alignment, unsigned sectionID) {
+    CodeSpan span = arena_->allocate(std::max<uintptr_t>(size, 1), std::max(alignment, 1u));
+    if (!span) {
+        return nullptr;
+    }
+    pending_.blocks.push_back(span.exec);
+    live_.insert(span.exec);
+    unmapped_.emplace_back(sectionID, span);
+    unflushed_.push_back(span);
+    return span.write;
+}
+
+uint8_t* CodeArenaMemoryManager::allocateCodeSection(uintptr_t size, unsigned alignment,
+                                                     unsigned sectionID, llvm::StringRef) {
+    return allocateSection(size, alignment, sectionID);
+}
+
+uint8_t* CodeArenaMemoryManager::allocateDataSection(uintptr_t size, unsigned alignment,
+                                                     unsigned sectionID, llvm::StringRef, bool isReadOnly) {
+    if (isReadOnly) {
+        // Constant pools and unwind tables stay next to the code
+        return allocateSection(size, alignment, sectionID);
+    }
+    // The execute view is read-only, so writable data lives on the heap for
+    // the life of the engine
+    alignment = std::max(alignment, 16u);
+    writableData_.emplace_back(new uint8_t[size + alignment]());
+    uintptr_t base = reinterpret_cast<uintptr_t>(writableData_.back().get());
+    return reinterpret_cast<uint8_t*>((base + alignment - 1) & ~uintptr_t(alignment - 1));
+}
+
+void CodeArenaMemoryManager::notifyObjectLoaded(llvm::RuntimeDyld& dyld, const llvm::object::ObjectFile&) {
+    // Relocate against the addresses the code runs at
+    for (const auto& [sectionID, span] : unmapped_) {
+        dyld.reassignSectionAddress(sectionID, reinterpret_cast<uint64_t>(span.exec));
+    }
+    unmapped_.clear();
+}
+
+bool CodeArenaMemoryManager::finalizeMemory(std::string*) {
+    for (const CodeSpan& span : unflushed_) {
+        CodeArena::flush(span);
+    }
+    unflushed_.clear();
+    return false;
+}
+
+void CodeArenaMemoryManager::registerEHFrames(uint8_t*, uint64_t loadAddr, size_t size) {
+    // The unwinder reads the frames where they are mapped for execution
+    uint8_t* frame = reinterpret_cast<uint8_t*>(loadAddr);
+    registerEHFramesInProcess(frame, size);
+    frames_.emplace_back(frame, size);
+    pending_.frames.emplace_back(frame, size);
+}
+
+void CodeArenaMemoryManager::deregisterEHFrames() {
+    for (const auto& [frame, size] : frames_) {
+        deregisterEHFramesInProcess(frame, size);
+    }
+    frames_.clear();
+}
+
+CodeArenaMemoryManager::Allocation CodeArenaMemoryManager::takeAllocation() {
+    Allocation allocation = std::move(pending_);
+    pending_ = Allocation();
+    return allocation;
+}
+
+void CodeArenaMemoryManager::release(const Allocation& allocation) {
+    for (const auto& frame : allocation.frames) {
+        auto it = std::find(frames_.begin(), frames_.end(), frame);
+        if (it != frames_.end()) {
+            deregisterEHFramesInProcess(frame.first, frame.second);
+            frames_.erase(it);
+        }
+    }
+    for (const void* block : allocation.blocks) {
+        if (live_.erase(block)) {
+            arena_->free(block);
+        }
+    }
+}
+
+} // namespace pxs3c
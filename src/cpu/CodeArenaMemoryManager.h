@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+#ifdef LLVM_AVAILABLE
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/ExecutionEngine/RuntimeDyld.h"
+#endif
+
+#include "cpu/CodeArena.h"
+
+namespace pxs3c {
+
+#ifdef LLVM_AVAILABLE
+// MCJIT memory manager placing code and read-only data in a CodeArena.
+// Sections are written through the arena's read-write view and relocated
+// for its execute view, so the addresses MCJIT hands out are executable and
+// never writable.
+//
+// Everything allocated for one object file can be claimed as a group with
+// takeAllocation() once the function address is known, and released when
+// the compiled block is dropped. What is still held when the engine goes
+// away is freed with it.
+class CodeArenaMemoryManager : public llvm::RTDyldMemoryManager {
+public:
+    struct Allocation {
+        std::vector<const void*> blocks;                  // arena blocks, by exec address
+        std::vector<std::pair<uint8_t*, size_t>> frames;  // registered EH frames
+    };
+
+    explicit CodeArenaMemoryManager(std::shared_ptr<CodeArena> arena);
+    ~CodeArenaMemoryManager() override;
+
+    // Sections allocated since the last call
+    Allocation takeAllocation();
+    void release(const Allocation& allocation);
+
+    // llvm::RTDyldMemoryManager
+    uint8_t* allocateCodeSection(uintptr_t size, unsigned alignment, unsigned sectionID,
+                                 llvm::StringRef sectionName) override;
+    uint8_t* allocateDataSection(uintptr_t size, unsigned alignment, unsigned sectionID,
+                                 llvm::StringRef sectionName, bool isReadOnly) override;
+    void notifyObjectLoaded(llvm::RuntimeDyld& dyld, const llvm::object::ObjectFile& object) override;
+    bool finalizeMemory(std::string* errMsg = nullptr) override;
+    void registerEHFrames(uint8_t* addr, uint64_t loadAddr, size_t size) override;
+    void deregisterEHFrames() override;
+
+private:
+    std::shared_ptr<CodeArena> arena_;
+    Allocation pending_;
+    // Sections not yet relocated for their exec view, by section ID. Freed
+    // addresses are reused, so RuntimeDyld cannot find them by address.
+    std::vector<std::pair<unsigned, CodeSpan>> unmapped_;
+    std::vector<CodeSpan> unflushed_;  // written since the last finalizeMemory()
+    std::unordered_set<const void*> live_;
+    std::vector<std::pair<uint8_t*, size_t>> frames_;
+    std::vector<std::unique_ptr<uint8_t[]>> writableData_;  // never in the arena
+
+    uint8_t* allocateSection(uintptr_t size, unsigned alignment, unsigned sectionID);
+};
+#endif
+
+} // namespace pxs3c
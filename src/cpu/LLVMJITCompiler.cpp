@@ -1,15 +1,263 @@
 #include "cpu/LLVMJITCompiler.h"
+#include "cpu/CodeArenaMemoryManager.h"
+#include "cpu/CodeHash.h"
+#include "cpu/PPUCodeCache.h"
 #include "cpu/PPUInterpreter.h"
+#include "cpu/PPUJITObjectCache.h"
 #include "memory/MemoryManager.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Target/TargetMachine.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
 
 namespace pxs3c {
 
-LLVMJITCompiler::LLVMJITCompiler() : engine_(nullptr) {}
+namespace {
+
+#if LLVM_VERSION_MAJOR >= 18
+using JITOptLevel = llvm::CodeGenOptLevel;
+#else
+using JITOptLevel = llvm::CodeGenOpt::Level;
+#endif
+
+// Byte offsets into PPURegisters, the state compiled blocks operate on
+constexpr size_t GPR_OFFSET = offsetof(PPURegisters, gpr);
+constexpr size_t LR_OFFSET = offsetof(PPURegisters, lr);
+constexpr size_t CTR_OFFSET = offsetof(PPURegisters, ctr);
+constexpr size_t CR_OFFSET = offsetof(PPURegisters, cr);
+constexpr size_t XER_OFFSET = offsetof(PPURegisters, xer);
+
+// Byte offsets into the chaining state
+constexpr size_t CTX_BUDGET_OFFSET = offsetof(PPUJITContext, budget);
+constexpr size_t CTX_THRESHOLD_OFFSET = offsetof(PPUJITContext, optimizeThreshold);
+constexpr size_t CTX_EXIT_BLOCK_OFFSET = offsetof(PPUJITContext, exitBlock);
+constexpr size_t CTX_EXIT_SLOT_OFFSET = offsetof(PPUJITContext, exitSlot);
+constexpr size_t CTX_MEMORY_BASE_OFFSET = offsetof(PPUJITContext, memoryBase);
+constexpr size_t CTX_PAGE_FLAGS_OFFSET = offsetof(PPUJITContext, pageFlags);
+constexpr size_t CTX_MEMORY_OFFSET = offsetof(PPUJITContext, memory);
+constexpr size_t HDR_COMPILED_OFFSET = offsetof(JITBlockHeader, compiled);
+constexpr size_t HDR_COUNT_OFFSET = offsetof(JITBlockHeader, instructionCount);
+constexpr size_t HDR_CALLS_OFFSET = offsetof(JITBlockHeader, callCount);
+constexpr size_t HDR_TAKEN_OFFSET = offsetof(JITBlockHeader, takenCount);
+constexpr size_t HDR_FALLTHROUGH_OFFSET = offsetof(JITBlockHeader, fallthroughCount);
+constexpr size_t HDR_LINKS_OFFSET = offsetof(JITBlockHeader, links);
+
+// Exit slot for exits beyond PPU_JIT_EXIT_COUNT: plain return, never linked
+constexpr uint32_t EXIT_UNLINKED = PPU_JIT_EXIT_COUNT;
+
+llvm::Value* fieldPtr(llvm::IRBuilder<>& b, llvm::Value* regs, size_t offset, llvm::Type* ty) {
+    llvm::Value* p = b.CreateConstInBoundsGEP1_64(b.getInt8Ty(), regs, offset);
+    return b.CreatePointerCast(p, llvm::PointerType::get(ty, 0));
+}
+
+llvm::Value* loadField(llvm::IRBuilder<>& b, llvm::Value* regs, size_t offset, llvm::Type* ty) {
+    return b.CreateLoad(ty, fieldPtr(b, regs, offset, ty));
+}
+
+void storeField(llvm::IRBuilder<>& b, llvm::Value* regs, size_t offset, llvm::Value* value) {
+    b.CreateStore(value, fieldPtr(b, regs, offset, value->getType()));
+}
+
+llvm::Value* loadGPR(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n) {
+    return loadField(b, regs, GPR_OFFSET + n * sizeof(uint64_t), b.getInt64Ty());
+}
+
+void storeGPR(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n, llvm::Value* value) {
+    storeField(b, regs, GPR_OFFSET + n * sizeof(uint64_t), value);
+}
+
+// (rA|0) operand form: r0 reads as zero
+llvm::Value* loadGPROrZero(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n) {
+    return n == 0 ? b.getInt64(0) : loadGPR(b, regs, n);
+}
+
+// Mirrors PPUInterpreter::updateCR0
+void updateCR0(llvm::IRBuilder<>& b, llvm::Value* regs, llvm::Value* result) {
+    llvm::Value* lt = b.CreateICmpSLT(result, b.getInt64(0));
+    llvm::Value* gt = b.CreateICmpSGT(result, b.getInt64(0));
+    llvm::Value* cr0 = b.CreateSelect(lt, b.getInt32(0x8),
+                                      b.CreateSelect(gt, b.getInt32(0x4), b.getInt32(0x2)));
+    llvm::Value* xer = loadField(b, regs, XER_OFFSET, b.getInt32Ty());
+    cr0 = b.CreateOr(cr0, b.CreateLShr(xer, 31));
+    llvm::Value* cr = loadField(b, regs, CR_OFFSET, b.getInt32Ty());
+    cr = b.CreateOr(b.CreateAnd(cr, b.getInt32(0x0FFFFFFF)), b.CreateShl(cr0, 28));
+    storeField(b, regs, CR_OFFSET, cr);
+}
+
+// Mirrors PPUInterpreter::setCRField
+void setCRField(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t field, llvm::Value* value) {
+    llvm::Value* xer = loadField(b, regs, XER_OFFSET, b.getInt32Ty());
+    value = b.CreateOr(value, b.CreateLShr(xer, 31));
+    uint32_t shift = 28 - field * 4;
+    llvm::Value* cr = loadField(b, regs, CR_OFFSET, b.getInt32Ty());
+    cr = b.CreateOr(b.CreateAnd(cr, b.getInt32(~(0xFU << shift))), b.CreateShl(value, shift));
+    storeField(b, regs, CR_OFFSET, cr);
+}
+
+// LT/GT/EQ field value for a compare
+llvm::Value* compareResult(llvm::IRBuilder<>& b, llvm::Value* lt, llvm::Value* gt) {
+    return b.CreateSelect(lt, b.getInt32(0x8), b.CreateSelect(gt, b.getInt32(0x4), b.getInt32(0x2)));
+}
+
+llvm::Value* loadCA(llvm::IRBuilder<>& b, llvm::Value* regs) {
+    llvm::Value* xer = loadField(b, regs, XER_OFFSET, b.getInt32Ty());
+    return b.CreateZExt(b.CreateICmpNE(b.CreateAnd(xer, b.getInt32(XER_CA)), b.getInt32(0)),
+                        b.getInt64Ty());
+}
+
+// Mirrors PPUInterpreter::setCA
+void storeCA(llvm::IRBuilder<>& b, llvm::Value* regs, llvm::Value* carry) {
+    llvm::Value* xer = loadField(b, regs, XER_OFFSET, b.getInt32Ty());
+    xer = b.CreateOr(b.CreateAnd(xer, b.getInt32(~XER_CA)),
+                     b.CreateSelect(carry, b.getInt32(XER_CA), b.getInt32(0)));
+    storeField(b, regs, XER_OFFSET, xer);
+}
+
+// Mirrors PPUInterpreter::setOV
+void storeOV(llvm::IRBuilder<>& b, llvm::Value* regs, llvm::Value* overflow) {
+    llvm::Value* xer = loadField(b, regs, XER_OFFSET, b.getInt32Ty());
+    xer = b.CreateOr(b.CreateAnd(xer, b.getInt32(~XER_OV)),
+                     b.CreateSelect(overflow, b.getInt32(XER_OV | XER_SO), b.getInt32(0)));
+    storeField(b, regs, XER_OFFSET, xer);
+}
+
+struct CarryIR {
+    llvm::Value* value;
+    llvm::Value* carry;     // i1
+    llvm::Value* overflow;  // i1
+};
+
+// Mirrors addWithCarry
+CarryIR emitAddWithCarry(llvm::IRBuilder<>& b, llvm::Value* x, llvm::Value* y, llvm::Value* carryIn) {
+    llvm::Type* i128 = b.getIntNTy(128);
+    llvm::Value* sum = b.CreateAdd(b.CreateAdd(b.CreateZExt(x, i128), b.CreateZExt(y, i128)),
+                                   b.CreateZExt(carryIn, i128));
+    CarryIR r;
+    r.value = b.CreateTrunc(sum, b.getInt64Ty());
+    r.carry = b.CreateICmpNE(b.CreateLShr(sum, 64), llvm::ConstantInt::get(i128, 0));
+    r.overflow = b.CreateICmpSLT(b.CreateAnd(b.CreateXor(x, r.value), b.CreateXor(y, r.value)),
+                                 b.getInt64(0));
+    return r;
+}
+
+// Mirrors rotateWord
+llvm::Value* emitRotateWord(llvm::IRBuilder<>& b, llvm::Value* value, llvm::Value* n) {
+    llvm::Value* word = b.CreateTrunc(value, b.getInt32Ty());
+    llvm::Value* rotated = b.CreateIntrinsic(llvm::Intrinsic::fshl, {b.getInt32Ty()},
+                                             {word, word, b.CreateTrunc(n, b.getInt32Ty())});
+    rotated = b.CreateZExt(rotated, b.getInt64Ty());
+    return b.CreateOr(b.CreateShl(rotated, 32), rotated);
+}
+
+llvm::Value* emitRotateLeft64(llvm::IRBuilder<>& b, llvm::Value* value, llvm::Value* n) {
+    return b.CreateIntrinsic(llvm::Intrinsic::fshl, {b.getInt64Ty()}, {value, value, n});
+}
+
+// slw/srw/sld/srd: amounts of at least the operand width give zero
+llvm::Value* emitLogicalShift(llvm::IRBuilder<>& b, llvm::Value* value, llvm::Value* rb,
+                              bool left, bool word) {
+    uint64_t limit = word ? 31 : 63;
+    llvm::Value* sh = b.CreateAnd(rb, b.getInt64(word ? 0x3F : 0x7F));
+    llvm::Value* clamped = b.CreateAnd(sh, b.getInt64(limit));
+    llvm::Value* result;
+    if (word) {
+        llvm::Value* w = b.CreateTrunc(value, b.getInt32Ty());
+        llvm::Value* n = b.CreateTrunc(clamped, b.getInt32Ty());
+        result = b.CreateZExt(left ? b.CreateShl(w, n) : b.CreateLShr(w, n), b.getInt64Ty());
+    } else {
+        result = left ? b.CreateShl(value, clamped) : b.CreateLShr(value, clamped);
+    }
+    return b.CreateSelect(b.CreateICmpUGT(sh, b.getInt64(limit)), b.getInt64(0), result);
+}
+
+// sraw/srawi/srad/sradi: sh is the already-masked shift amount. Sets CA
+// when a negative value shifts out any one bits.
+llvm::Value* emitAlgebraicShift(llvm::IRBuilder<>& b, llvm::Value* regs, llvm::Value* value,
+                                llvm::Value* sh, bool word) {
+    uint64_t limit = word ? 31 : 63;
+    llvm::Value* operand = word ? b.CreateSExt(b.CreateTrunc(value, b.getInt32Ty()), b.getInt64Ty())
+                                : value;
+    llvm::Value* over = b.CreateICmpUGT(sh, b.getInt64(limit));
+    llvm::Value* clamped = b.CreateSelect(over, b.getInt64(limit), sh);
+    llvm::Value* result = b.CreateAShr(operand, clamped);
+
+    llvm::Value* negative = b.CreateICmpSLT(operand, b.getInt64(0));
+    llvm::Value* lostMask = b.CreateSub(b.CreateShl(b.getInt64(1), clamped), b.getInt64(1));
+    llvm::Value* lost = b.CreateOr(over, b.CreateICmpNE(b.CreateAnd(operand, lostMask), b.getInt64(0)));
+    storeCA(b, regs, b.CreateAnd(negative, lost));
+    return result;
+}
+
+// Mirrors PPUInterpreter::checkCondition. Returns nullptr if the branch is
+// unconditional for this BO encoding.
+llvm::Value* emitCondition(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t bo, uint32_t bi) {
+    llvm::Value* ok = nullptr;
+    if (!(bo & 0x04)) {
+        llvm::Value* ctr = b.CreateSub(loadField(b, regs, CTR_OFFSET, b.getInt64Ty()), b.getInt64(1));
+        storeField(b, regs, CTR_OFFSET, ctr);
+        ok = (bo & 0x02) ? b.CreateICmpEQ(ctr, b.getInt64(0))
+                         : b.CreateICmpNE(ctr, b.getInt64(0));
+    }
+    if (!(bo & 0x10)) {
+        llvm::Value* cr = loadField(b, regs, CR_OFFSET, b.getInt32Ty());
+        llvm::Value* bit = b.CreateAnd(b.CreateLShr(cr, 31 - bi), b.getInt32(1));
+        llvm::Value* cond = b.CreateICmpEQ(bit, b.getInt32((bo >> 3) & 1));
+        ok = ok ? b.CreateAnd(ok, cond) : cond;
+    }
+    return ok;
+}
+
+void incrementField(llvm::IRBuilder<>& b, llvm::Value* base, size_t offset) {
+    llvm::Value* count = loadField(b, base, offset, b.getInt64Ty());
+    storeField(b, base, offset, b.CreateAdd(count, b.getInt64(1)));
+}
+
+// Context fields that stay fixed while compiled code runs
+llvm::Value* loadInvariant(llvm::IRBuilder<>& b, llvm::Value* base, size_t offset, llvm::Type* ty) {
+    llvm::LoadInst* load = b.CreateLoad(ty, fieldPtr(b, base, offset, ty));
+    load->setMetadata(llvm::LLVMContext::MD_invariant_load, llvm::MDNode::get(b.getContext(), {}));
+    return load;
+}
+
+uint32_t clampWeight(uint64_t count) {
+    return static_cast<uint32_t>(std::min<uint64_t>(count, std::numeric_limits<uint32_t>::max()));
+}
+
+} // namespace
+
+// Slow-path guest memory access for compiled code: MMIO, unmapped pages,
+// accesses straddling a fastmem page, or no fastmem at all. Compiled code
+// refers to these by name only, so cached objects stay valid across runs.
+extern "C" {
+uint64_t pxs3c_ppu_read8(MemoryManager* m, uint64_t ea) { return m->read8(ea); }
+uint64_t pxs3c_ppu_read16(MemoryManager* m, uint64_t ea) { return m->read16(ea); }
+uint64_t pxs3c_ppu_read32(MemoryManager* m, uint64_t ea) { return m->read32(ea); }
+uint64_t pxs3c_ppu_read64(MemoryManager* m, uint64_t ea) { return m->read64(ea); }
+void pxs3c_ppu_write8(MemoryManager* m, uint64_t ea, uint64_t v) { m->write8(ea, static_cast<uint8_t>(v)); }
+void pxs3c_ppu_write16(MemoryManager* m, uint64_t ea, uint64_t v) { m->write16(ea, static_cast<uint16_t>(v)); }
+void pxs3c_ppu_write32(MemoryManager* m, uint64_t ea, uint64_t v) { m->write32(ea, static_cast<uint32_t>(v)); }
+void pxs3c_ppu_write64(MemoryManager* m, uint64_t ea, uint64_t v) { m->write64(ea, v); }
+}
+
+LLVMJITCompiler::LLVMJITCompiler() : regionBlocks_(0) {}
 
 LLVMJITCompiler::~LLVMJITCompiler() {
-    // ExecutionEngine will be deleted with module
+    // Engines own their modules and must go before the context; the object
+    // cache must outlive both engines.
+    baselineEngine_.reset();
+    optimizedEngine_.reset();
+    probeModule_.reset();
+    objectCache_.reset();
 }
 
 bool LLVMJITCompiler::init() {
@@ -18,240 +266,1167 @@ bool LLVMJITCompiler::init() {
     llvm::InitializeAllTargetMCs();
     llvm::InitializeAllAsmPrinters();
     llvm::InitializeAllAsmParsers();
-    
+
+    // Resolve the slow-path helpers without relying on the executable
+    // exporting its symbols
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_read8", reinterpret_cast<void*>(&pxs3c_ppu_read8));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_read16", reinterpret_cast<void*>(&pxs3c_ppu_read16));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_read32", reinterpret_cast<void*>(&pxs3c_ppu_read32));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_read64", reinterpret_cast<void*>(&pxs3c_ppu_read64));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_write8", reinterpret_cast<void*>(&pxs3c_ppu_write8));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_write16", reinterpret_cast<void*>(&pxs3c_ppu_write16));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_write32", reinterpret_cast<void*>(&pxs3c_ppu_write32));
+    llvm::sys::DynamicLibrary::AddSymbol("pxs3c_ppu_write64", reinterpret_cast<void*>(&pxs3c_ppu_write64));
+
     context_ = std::make_unique<llvm::LLVMContext>();
-    module_ = std::make_unique<llvm::Module>("pxs3c_jit", *context_);
-    
-    std::string error;
-    engine_ = llvm::EngineBuilder(std::move(module_))
-        .setErrorStr(&error)
-        .setEngineKind(llvm::EngineKind::JIT)
-        .setOptLevel(llvm::CodeGenOptLevel::Aggressive)
-        .create();
-    
-    if (!engine_) {
-        std::cerr << "Failed to create LLVM execution engine: " << error << std::endl;
+    probeModule_ = std::make_unique<llvm::Module>("pxs3c_jit_probe", *context_);
+
+    auto createEngine = [this](const char* name, JITOptLevel level) {
+        std::string error;
+        auto module = std::make_unique<llvm::Module>(name, *context_);
+        llvm::ExecutionEngine* engine = llvm::EngineBuilder(std::move(module))
+            .setErrorStr(&error)
+            .setEngineKind(llvm::EngineKind::JIT)
+            .setMCJITMemoryManager(std::make_unique<CodeArenaMemoryManager>(CodeArena::shared()))
+            .setOptLevel(level)
+            .create();
+        if (!engine) {
+            std::cerr << "Failed to create LLVM execution engine (" << name << "): "
+                      << error << std::endl;
+        }
+        return std::unique_ptr<llvm::ExecutionEngine>(engine);
+    };
+
+    baselineEngine_ = createEngine("pxs3c_jit_baseline", JITOptLevel::None);
+    optimizedEngine_ = createEngine("pxs3c_jit_optimized", JITOptLevel::Aggressive);
+    if (!baselineEngine_ || !optimizedEngine_) {
         return false;
     }
-    
+
     std::cout << "LLVM JIT compiler initialized" << std::endl;
     return true;
 }
 
+bool LLVMJITCompiler::setObjectCache(const std::string& directory) {
+    if (!baselineEngine_ || !optimizedEngine_) {
+        return false;
+    }
+
+    std::unique_ptr<PPUJITObjectCache> cache;
+    if (!directory.empty()) {
+        cache = std::make_unique<PPUJITObjectCache>(directory);
+        if (!cache->isValid()) {
+            cache.reset();
+        }
+    }
+
+    baselineEngine_->setObjectCache(cache.get());
+    optimizedEngine_->setObjectCache(cache.get());
+    objectCache_ = std::move(cache);
+    if (objectCache_) {
+        std::cout << "PPU JIT object cache: " << objectCache_->getDirectory() << std::endl;
+    }
+    return objectCache_ != nullptr;
+}
+
+std::string LLVMJITCompiler::cacheKey(PPUJITTier tier, uint64_t startPC, uint64_t codeHash) {
+    char key[80];
+    std::snprintf(key, sizeof(key), "ppu-v%u-%s-%llx-%016llx",
+                  PPU_JIT_CACHE_VERSION, tier == PPUJITTier::Optimized ? "opt" : "base",
+                  static_cast<unsigned long long>(startPC),
+                  static_cast<unsigned long long>(codeHash));
+    return key;
+}
+
+llvm::ExecutionEngine* LLVMJITCompiler::engineFor(PPUJITTier tier) const {
+    switch (tier) {
+        case PPUJITTier::Baseline:  return baselineEngine_.get();
+        case PPUJITTier::Optimized: return optimizedEngine_.get();
+        default:                    return nullptr;
+    }
+}
+
+void LLVMJITCompiler::optimizeModule(llvm::Module& module, llvm::ExecutionEngine& engine) {
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+
+    llvm::PassBuilder pb(engine.getTargetMachine());
+    pb.registerModuleAnalyses(mam);
+    pb.registerCGSCCAnalyses(cgam);
+    pb.registerFunctionAnalyses(fam);
+    pb.registerLoopAnalyses(lam);
+    pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+    llvm::ModulePassManager mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O3);
+    mpm.run(module, mam);
+}
+
+llvm::FunctionType* LLVMJITCompiler::blockFunctionType() const {
+    // uint64_t func(PPURegisters* regs, PPUJITContext* ctx, JITBlockHeader* self) -> next PC
+    auto& ctx = *context_;
+    auto* ptrTy = llvm::PointerType::get(llvm::Type::getInt8Ty(ctx), 0);
+    return llvm::FunctionType::get(llvm::Type::getInt64Ty(ctx), {ptrTy, ptrTy, ptrTy}, false);
+}
+
+LLVMJITCompiler::BlockArgs LLVMJITCompiler::bindArgs(llvm::Function* func, PPUJITTier tier) {
+    BlockArgs args;
+    args.regs = func->getArg(0);
+    args.ctx = func->getArg(1);
+    args.self = func->getArg(2);
+    args.tier = tier;
+    return args;
+}
+
+bool LLVMJITCompiler::canTranslate(uint64_t pc, uint32_t instr) {
+    // Build the instruction into a throwaway function: the IR builders are
+    // the only complete description of what the JIT supports.
+    auto* probe = llvm::Function::Create(blockFunctionType(), llvm::Function::ExternalLinkage,
+                                         "probe", probeModule_.get());
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(*context_, "probe", probe));
+    bool ok = buildInstructionIR(builder, bindArgs(probe, PPUJITTier::Baseline), pc, instr);
+    probe->eraseFromParent();
+    return ok;
+}
+
+bool LLVMJITCompiler::isBlockBranch(uint32_t instr) {
+    uint32_t opcode = (instr >> 26) & 0x3F;
+    uint32_t xop = (instr >> 1) & 0x3FF;
+    return opcode == 16 || opcode == 18 || (opcode == 19 && (xop == 16 || xop == 528));
+}
+
+LLVMJITCompiler::Region LLVMJITCompiler::formRegion(
+    MemoryManager* memory, uint64_t startPC, bool followEdges, uint32_t maxInstructions) {
+
+    // Discovery: walk every path from startPC through direct branches and
+    // conditional fall-throughs, recording each translatable instruction and
+    // every PC some edge enters (the basic block leaders).
+    std::map<uint64_t, uint32_t> code;
+    std::set<uint64_t> leaders = {startPC};
+    std::vector<uint64_t> worklist = {startPC};
+
+    auto follow = [&](uint64_t target) {
+        // Regions only extend forward from their entry, so [startPC, endPC)
+        // covers everything they contain.
+        if (!followEdges || target < startPC || (target & 3)) return;
+        if (leaders.insert(target).second) worklist.push_back(target);
+    };
+
+    while (!worklist.empty()) {
+        uint64_t pc = worklist.back();
+        worklist.pop_back();
+
+        while (code.size() < maxInstructions) {
+            if (code.count(pc)) {
+                leaders.insert(pc);  // ran into code already discovered
+                break;
+            }
+            uint32_t instr = memory->read32(pc);
+            if (isBlockBranch(instr)) {
+                code[pc] = instr;
+                uint32_t opcode = (instr >> 26) & 0x3F;
+                bool lk = instr & 1;
+                bool aa = (instr >> 1) & 1;
+                uint32_t bo = (instr >> 21) & 0x1F;
+                bool conditional = opcode != 18 && (bo & 0x14) != 0x14;
+                if (opcode == 18 && !lk) {
+                    int32_t li = instr & 0x03FFFFFC;
+                    if (li & 0x02000000) li |= 0xFC000000;
+                    follow(aa ? static_cast<uint64_t>(static_cast<int64_t>(li))
+                              : pc + static_cast<int64_t>(li));
+                } else if (opcode == 16 && !lk) {
+                    int32_t bd = instr & 0xFFFC;
+                    if (bd & 0x8000) bd |= 0xFFFF0000;
+                    follow(aa ? static_cast<uint64_t>(static_cast<int64_t>(bd))
+                              : pc + static_cast<int64_t>(bd));
+                }
+                if (conditional) follow(pc + 4);
+                break;
+            }
+            // Untranslatable code is left to the interpreter
+            if (!canTranslate(pc, instr)) break;
+            code[pc] = instr;
+            pc += 4;
+        }
+    }
+
+    // Split the discovered code into basic blocks at the leaders
+    Region region;
+    region.endPC = startPC;
+    for (uint64_t leader : leaders) {
+        if (!code.count(leader)) continue;
+        std::vector<uint32_t>& instrs = region.blocks[leader];
+        uint64_t pc = leader;
+        for (auto it = code.find(pc); it != code.end() && it->first == pc; ++it) {
+            if (pc != leader && leaders.count(pc)) break;
+            instrs.push_back(it->second);
+            pc += 4;
+            if (isBlockBranch(it->second)) break;
+        }
+        region.endPC = std::max(region.endPC, pc);
+    }
+    return region;
+}
+
 LLVMJITCompiler::CompiledFunc LLVMJITCompiler::compileBlock(
     PPUInterpreter* ppu, MemoryManager* memory,
-    uint64_t startPC, uint32_t maxInstructions) {
-    
-    if (!ppu || !memory || !engine_) {
+    JITBlockHeader& block, PPUJITTier tier, uint32_t maxInstructions,
+    const PPUCodeCache* profile) {
+
+    llvm::ExecutionEngine* engine = engineFor(tier);
+    if (!ppu || !memory || !engine) {
         return nullptr;
     }
-    
-    // Get LLVM types
+
+    // Baseline code covers one basic block (cheap to compile, and it gathers
+    // the exit profile); optimized code covers the whole region so LLVM sees
+    // loops as loops.
+    Region region = formRegion(memory, block.startPC, tier == PPUJITTier::Optimized,
+                               maxInstructions);
+    if (region.blocks.empty()) {
+        return nullptr;
+    }
+
     auto& ctx = *context_;
-    auto* i64Ty = llvm::Type::getInt64Ty(ctx);
-    auto* i32Ty = llvm::Type::getInt32Ty(ctx);
-    auto* i8Ty = llvm::Type::getInt8Ty(ctx);
-    auto* i1Ty = llvm::Type::getInt1Ty(ctx);
-    auto* doubleTy = llvm::Type::getDoubleTy(ctx);
-    auto* i64PtrTy = llvm::PointerType::get(i64Ty, 0);
-    auto* doublePtrTy = llvm::PointerType::get(doubleTy, 0);
-    
-    // Create function signature:
-    // uint64_t func(uint64_t* gpr, double* fpr, uint128_t* vr, uint64_t pc, uint64_t lr, uint32_t cr)
-    std::vector<llvm::Type*> paramTypes = {
-        i64PtrTy,    // gpr
-        doublePtrTy, // fpr
-        i64PtrTy,    // vr (simplified as uint64_t*)
-        i64Ty,       // pc
-        i64Ty,       // lr
-        i32Ty        // cr
-    };
-    
-    auto* funcType = llvm::FunctionType::get(i64Ty, paramTypes, false);
-    auto* func = llvm::Function::Create(funcType, llvm::Function::ExternalLinkage,
-                                        "compiled_block", module_.get());
-    
-    // Set parameter names for clarity
-    auto argIter = func->arg_begin();
-    llvm::Argument* argGpr = &*argIter;
-    argGpr->setName("gpr");
-    llvm::Argument* argFpr = &*(++argIter);
-    argFpr->setName("fpr");
-    llvm::Argument* argVr = &*(++argIter);
-    argVr->setName("vr");
-    llvm::Argument* argPc = &*(++argIter);
-    argPc->setName("pc");
-    llvm::Argument* argLr = &*(++argIter);
-    argLr->setName("lr");
-    llvm::Argument* argCr = &*(++argIter);
-    argCr->setName("cr");
-    
-    // Create entry basic block
+
+    // Named once the covered guest bytes are known; see cacheKey()
+    auto module = std::make_unique<llvm::Module>("ppu_block", ctx);
+    module->setDataLayout(engine->getDataLayout());
+
+    auto* func = llvm::Function::Create(blockFunctionType(), llvm::Function::ExternalLinkage,
+                                        "ppu_block", module.get());
+    BlockArgs args = bindArgs(func, tier);
+    args.regs->setName("regs");
+    args.ctx->setName("ctx");
+    args.self->setName("self");
+    func->addParamAttr(0, llvm::Attribute::NoAlias);
+
     auto* entryBB = llvm::BasicBlock::Create(ctx, "entry", func);
+    std::map<uint64_t, llvm::BasicBlock*> bbs;
+    for (const auto& [pc, instrs] : region.blocks) {
+        std::ostringstream name;
+        name << "bb_" << std::hex << pc;
+        bbs[pc] = llvm::BasicBlock::Create(ctx, name.str(), func);
+    }
+
     llvm::IRBuilder<> builder(entryBB);
-    
-    // Read all instructions in block (up to branch)
-    std::vector<uint32_t> instructions;
-    uint64_t currentPC = startPC;
-    uint32_t instrCount = 0;
-    
-    for (uint32_t i = 0; i < std::min(maxInstructions, 100u); i++) {
-        uint32_t instr = memory->read32(currentPC);
-        instructions.push_back(instr);
-        currentPC += 4;
-        instrCount++;
-        
-        // Stop at branch/conditional instructions
-        uint8_t opcode = (instr >> 26) & 0x3F;
-        if (opcode == 18 || opcode == 19 || opcode == 16) break; // b, bc, bcc
-    }
-    
-    // Compile each instruction to IR
-    for (uint32_t i = 0; i < instructions.size(); i++) {
-        uint32_t instr = instructions[i];
-        uint8_t opcode = (instr >> 26) & 0x3F;
-        uint8_t ra = (instr >> 16) & 0x1F;
-        uint8_t rb = (instr >> 11) & 0x1F;
-        uint8_t rd = (instr >> 21) & 0x1F;
-        int16_t imm = instr & 0xFFFF;
-        
-        // Generate optimized IR for most common instructions
-        switch (opcode) {
-            case 14: { // addi  rd, ra, imm
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* result = builder.CreateAdd(val_ra, 
-                    llvm::ConstantInt::get(i64Ty, (int64_t)imm));
-                builder.CreateStore(result, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                break;
+    if (tier == PPUJITTier::Baseline) {
+        incrementField(builder, args.self, HDR_CALLS_OFFSET);
+    }
+    builder.CreateBr(bbs.at(block.startPC));
+
+    // Edges into the region branch directly; back-edges first check the
+    // budget so loops hand control back to the dispatcher. Every other edge
+    // leaves through an exit slot that the dispatcher can link.
+    uint32_t nextSlot = PPU_JIT_EXIT_DIRECT;
+    auto edge = [&](uint64_t from, uint64_t target) {
+        auto it = bbs.find(target);
+        if (it == bbs.end()) {
+            uint32_t slot = nextSlot < PPU_JIT_EXIT_COUNT ? nextSlot++ : EXIT_UNLINKED;
+            emitExit(builder, args, builder.getInt64(target), slot);
+            return;
+        }
+        if (target <= from) {
+            auto* loopBB = llvm::BasicBlock::Create(ctx, "loop", func);
+            auto* outBB = llvm::BasicBlock::Create(ctx, "budget.exit", func);
+            int64_t count = static_cast<int64_t>(region.blocks.at(target).size());
+            llvm::Value* budget = loadField(builder, args.ctx, CTX_BUDGET_OFFSET,
+                                            builder.getInt64Ty());
+            llvm::Value* stay = builder.CreateICmpSGE(budget, builder.getInt64(count));
+            // A baseline loop re-enters its block without the dispatcher:
+            // count the entry, and return once it is hot enough to promote
+            if (tier == PPUJITTier::Baseline && target == block.startPC) {
+                incrementField(builder, args.self, HDR_CALLS_OFFSET);
+                llvm::Value* calls = loadField(builder, args.self, HDR_CALLS_OFFSET, builder.getInt64Ty());
+                llvm::Value* threshold = loadField(builder, args.ctx, CTX_THRESHOLD_OFFSET,
+                                                   builder.getInt64Ty());
+                stay = builder.CreateAnd(stay, builder.CreateICmpULT(calls, threshold));
             }
-            case 15: { // addis  rd, ra, imm
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* result = builder.CreateAdd(val_ra, 
-                    llvm::ConstantInt::get(i64Ty, ((int64_t)imm) << 16));
-                builder.CreateStore(result, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
+            builder.CreateCondBr(stay, loopBB, outBB);
+            builder.SetInsertPoint(outBB);
+            builder.CreateRet(builder.getInt64(target));
+            builder.SetInsertPoint(loopBB);
+        }
+        builder.CreateBr(it->second);
+    };
+
+    for (const auto& [leader, instrs] : region.blocks) {
+        builder.SetInsertPoint(bbs.at(leader));
+
+        // Charge the whole basic block against the chain's budget up front
+        llvm::Value* budget = loadField(builder, args.ctx, CTX_BUDGET_OFFSET, builder.getInt64Ty());
+        storeField(builder, args.ctx, CTX_BUDGET_OFFSET,
+                   builder.CreateSub(budget, builder.getInt64(instrs.size())));
+
+        uint64_t pc = leader;
+        for (uint32_t instr : instrs) {
+            if (isBlockBranch(instr)) {
+                BranchProfile branchProfile;
+                bool weighted = tier == PPUJITTier::Optimized &&
+                                lookupProfile(profile, block, leader, pc, branchProfile);
+                if (!buildBranchIR(builder, args, pc, instr, weighted ? &branchProfile : nullptr,
+                                   [&, from = pc](uint64_t target) { edge(from, target); })) {
+                    return nullptr;
+                }
                 break;
             }
-            case 8: { // subfic  rd, ra, imm
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* result = builder.CreateSub(
-                    llvm::ConstantInt::get(i64Ty, (int64_t)imm), val_ra);
-                builder.CreateStore(result, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                break;
+            if (!buildInstructionIR(builder, args, pc, instr)) {
+                return nullptr;
             }
-            case 10: { // cmpli
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* cond = builder.CreateICmpULT(val_ra, 
-                    llvm::ConstantInt::get(i64Ty, (uint64_t)(uint16_t)imm));
-                auto* crVal = builder.CreateLoad(i32Ty, argCr);
-                // Simple CR update (bits for field 0)
-                auto* newCr = builder.CreateSelect(cond,
-                    llvm::ConstantInt::get(i32Ty, 0x80000000),
-                    llvm::ConstantInt::get(i32Ty, 0));
-                builder.CreateStore(newCr, argCr);
-                break;
+            pc += 4;
+        }
+        if (!isBlockBranch(instrs.back())) {
+            edge(pc - 4, pc);
+        }
+    }
+
+    // Verify function
+    if (llvm::verifyFunction(*func, &llvm::errs())) {
+        std::cerr << "Failed to verify JIT function" << std::endl;
+        return nullptr;
+    }
+
+    // The key covers exactly the translated instructions and their layout,
+    // so any change to the guest code selects a different object.
+    std::vector<uint32_t> code;
+    for (const auto& [leader, instrs] : region.blocks) {
+        code.push_back(static_cast<uint32_t>(leader - block.startPC));
+        code.push_back(static_cast<uint32_t>(instrs.size()));
+        code.insert(code.end(), instrs.begin(), instrs.end());
+    }
+    const std::string key = cacheKey(tier, block.startPC,
+                                     hashCode(code.data(), code.size() * sizeof(uint32_t)));
+    uint64_t funcAddr = 0;
+
+    auto loaded = loaded_.find(key);
+    if (loaded != loaded_.end()) {
+        // Same code recompiled after invalidation: reuse the emitted function
+        funcAddr = loaded->second;
+    } else {
+        module->setModuleIdentifier(key);
+        func->setName(key);
+
+        // Objects found on disk skip the optimiser as well as codegen
+        if (tier == PPUJITTier::Optimized && !(objectCache_ && objectCache_->contains(key))) {
+            optimizeModule(*module, *engine);
+        }
+
+        // JIT compile to native code (or load it through the object cache)
+        engine->addModule(std::move(module));
+        funcAddr = engine->getFunctionAddress(key);
+        if (!funcAddr) {
+            std::cerr << "LLVM JIT failed to emit block at 0x" << std::hex << block.startPC
+                      << std::dec << std::endl;
+            return nullptr;
+        }
+        loaded_[key] = funcAddr;
+    }
+
+    block.instructionCount = static_cast<uint32_t>(region.blocks.begin()->second.size());
+    block.blockSize = region.endPC - block.startPC;
+    regionBlocks_ += region.blocks.size();
+    return reinterpret_cast<CompiledFunc>(funcAddr);
+}
+
+bool LLVMJITCompiler::lookupProfile(const PPUCodeCache* profile, const JITBlockHeader& block,
+                                    uint64_t leader, uint64_t branchPC, BranchProfile& out) {
+    // The baseline header for this basic block holds the branch's exit
+    // counts, provided it ended at the same branch.
+    const JITBlockHeader* header = leader == block.startPC ? &block
+                                 : profile ? profile->lookup(leader) : nullptr;
+    if (!header || header->startPC + header->instructionCount * 4ull != branchPC + 4) {
+        return false;
+    }
+    if (header->takenCount + header->fallthroughCount == 0) {
+        return false;
+    }
+    out.taken = header->takenCount;
+    out.fallthrough = header->fallthroughCount;
+    return true;
+}
+
+bool LLVMJITCompiler::buildInstructionIR(
+    llvm::IRBuilder<>& builder,
+    const BlockArgs& args,
+    uint64_t pc,
+    uint32_t instr) {
+
+    (void)pc;
+    llvm::Value* regs = args.regs;
+    uint32_t opcode = (instr >> 26) & 0x3F;
+    uint32_t rD = (instr >> 21) & 0x1F;  // also rS
+    uint32_t rA = (instr >> 16) & 0x1F;
+    uint32_t rB = (instr >> 11) & 0x1F;
+    int64_t simm = static_cast<int16_t>(instr & 0xFFFF);
+    uint64_t uimm = instr & 0xFFFF;
+    bool rc = instr & 1;
+
+    switch (opcode) {
+        case 7: { // mulli  rD, rA, simm
+            llvm::Value* result = builder.CreateMul(loadGPR(builder, regs, rA), builder.getInt64(simm));
+            storeGPR(builder, regs, rD, result);
+            return true;
+        }
+        case 8: { // subfic  rD, rA, simm
+            CarryIR r = emitAddWithCarry(builder, builder.CreateNot(loadGPR(builder, regs, rA)),
+                                         builder.getInt64(simm), builder.getInt64(1));
+            storeGPR(builder, regs, rD, r.value);
+            storeCA(builder, regs, r.carry);
+            return true;
+        }
+        case 10:   // cmpli  crfD, L, rA, uimm
+        case 11: { // cmpi  crfD, L, rA, simm
+            uint32_t bf = rD >> 2;
+            bool l = rD & 1;
+            llvm::Value* a = loadGPR(builder, regs, rA);
+            llvm::Value* lt;
+            llvm::Value* gt;
+            if (opcode == 10) {
+                if (!l) a = builder.CreateAnd(a, builder.getInt64(0xFFFFFFFF));
+                lt = builder.CreateICmpULT(a, builder.getInt64(uimm));
+                gt = builder.CreateICmpUGT(a, builder.getInt64(uimm));
+            } else {
+                if (!l) a = builder.CreateSExt(builder.CreateTrunc(a, builder.getInt32Ty()),
+                                               builder.getInt64Ty());
+                lt = builder.CreateICmpSLT(a, builder.getInt64(simm));
+                gt = builder.CreateICmpSGT(a, builder.getInt64(simm));
             }
-            case 28: { // andi.  rd, ra, imm
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* result = builder.CreateAnd(val_ra, 
-                    llvm::ConstantInt::get(i64Ty, (uint64_t)(uint16_t)imm));
-                builder.CreateStore(result, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                break;
+            setCRField(builder, regs, bf, compareResult(builder, lt, gt));
+            return true;
+        }
+        case 12:   // addic  rD, rA, simm
+        case 13: { // addic.
+            CarryIR r = emitAddWithCarry(builder, loadGPR(builder, regs, rA),
+                                         builder.getInt64(simm), builder.getInt64(0));
+            storeGPR(builder, regs, rD, r.value);
+            storeCA(builder, regs, r.carry);
+            if (opcode == 13) updateCR0(builder, regs, r.value);
+            return true;
+        }
+        case 14: { // addi  rD, rA|0, simm
+            llvm::Value* result = builder.CreateAdd(loadGPROrZero(builder, regs, rA),
+                                                    builder.getInt64(simm));
+            storeGPR(builder, regs, rD, result);
+            return true;
+        }
+        case 15: { // addis  rD, rA|0, simm
+            llvm::Value* result = builder.CreateAdd(loadGPROrZero(builder, regs, rA),
+                                                    builder.getInt64(simm * 65536));
+            storeGPR(builder, regs, rD, result);
+            return true;
+        }
+        case 19: { // mcrf, condition register logical, isync
+            uint32_t xop = (instr >> 1) & 0x3FF;
+            if (xop == 150) return true;  // isync
+            llvm::Value* cr = loadField(builder, regs, CR_OFFSET, builder.getInt32Ty());
+            if (xop == 0) { // mcrf
+                uint32_t bf = rD >> 2;
+                uint32_t bfa = rA >> 2;
+                llvm::Value* field = builder.CreateAnd(builder.CreateLShr(cr, 28 - bfa * 4),
+                                                       builder.getInt32(0xF));
+                cr = builder.CreateOr(builder.CreateAnd(cr, builder.getInt32(~(0xFU << (28 - bf * 4)))),
+                                      builder.CreateShl(field, 28 - bf * 4));
+                storeField(builder, regs, CR_OFFSET, cr);
+                return true;
             }
-            case 29: { // andis.  rd, ra, imm
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* result = builder.CreateAnd(val_ra, 
-                    llvm::ConstantInt::get(i64Ty, ((uint64_t)(uint16_t)imm) << 16));
-                builder.CreateStore(result, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                break;
+            llvm::Value* ba = builder.CreateAnd(builder.CreateLShr(cr, 31 - rA), builder.getInt32(1));
+            llvm::Value* bb = builder.CreateAnd(builder.CreateLShr(cr, 31 - rB), builder.getInt32(1));
+            llvm::Value* one = builder.getInt32(1);
+            llvm::Value* bit;
+            switch (xop) {
+                case 33:  bit = builder.CreateXor(builder.CreateOr(ba, bb), one); break;   // crnor
+                case 129: bit = builder.CreateAnd(ba, builder.CreateXor(bb, one)); break;  // crandc
+                case 193: bit = builder.CreateXor(ba, bb); break;                          // crxor
+                case 225: bit = builder.CreateXor(builder.CreateAnd(ba, bb), one); break;  // crnand
+                case 257: bit = builder.CreateAnd(ba, bb); break;                          // crand
+                case 289: bit = builder.CreateXor(builder.CreateXor(ba, bb), one); break;  // creqv
+                case 417: bit = builder.CreateOr(ba, builder.CreateXor(bb, one)); break;   // crorc
+                case 449: bit = builder.CreateOr(ba, bb); break;                           // cror
+                default:
+                    return false;
             }
-            case 30: { // ori  rd, ra, imm
-                auto* val_ra = builder.CreateLoad(i64Ty, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                auto* result = builder.CreateOr(val_ra, 
-                    llvm::ConstantInt::get(i64Ty, (uint64_t)(uint16_t)imm));
-                builder.CreateStore(result, 
-                    builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                break;
+            cr = builder.CreateOr(builder.CreateAnd(cr, builder.getInt32(~(1U << (31 - rD)))),
+                                  builder.CreateShl(bit, 31 - rD));
+            storeField(builder, regs, CR_OFFSET, cr);
+            return true;
+        }
+        case 20:   // rlwimi  rA, rS, sh, mb, me
+        case 21:   // rlwinm  rA, rS, sh, mb, me
+        case 23: { // rlwnm  rA, rS, rB, mb, me
+            uint32_t mb = (instr >> 6) & 0x1F;
+            uint32_t me = (instr >> 1) & 0x1F;
+            llvm::Value* n = opcode == 23 ? loadGPR(builder, regs, rB) : builder.getInt64(rB);
+            llvm::Value* rotated = emitRotateWord(builder, loadGPR(builder, regs, rD), n);
+            uint64_t mask = rotateMask(mb + 32, me + 32);
+            llvm::Value* result = builder.CreateAnd(rotated, builder.getInt64(mask));
+            if (opcode == 20) {
+                result = builder.CreateOr(result, builder.CreateAnd(loadGPR(builder, regs, rA),
+                                                                    builder.getInt64(~mask)));
             }
-            case 31: { // 2-opcode instructions (xop)
-                uint16_t xop = (instr >> 1) & 0x3FF;
-                if (xop == 266) { // add  rd, ra, rb
-                    auto* val_ra = builder.CreateLoad(i64Ty, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                    auto* val_rb = builder.CreateLoad(i64Ty, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rb)));
-                    auto* result = builder.CreateAdd(val_ra, val_rb);
-                    builder.CreateStore(result, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                } else if (xop == 40) { // subf  rd, ra, rb
-                    auto* val_ra = builder.CreateLoad(i64Ty, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                    auto* val_rb = builder.CreateLoad(i64Ty, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rb)));
-                    auto* result = builder.CreateSub(val_rb, val_ra);
-                    builder.CreateStore(result, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
-                } else if (xop == 444) { // or  rd, ra, rb
-                    auto* val_ra = builder.CreateLoad(i64Ty, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, ra)));
-                    auto* val_rb = builder.CreateLoad(i64Ty, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rb)));
-                    auto* result = builder.CreateOr(val_ra, val_rb);
-                    builder.CreateStore(result, 
-                        builder.CreateGEP(i64Ty, argGpr, llvm::ConstantInt::get(i64Ty, rd)));
+            storeGPR(builder, regs, rA, result);
+            if (rc) updateCR0(builder, regs, result);
+            return true;
+        }
+        case 24:   // ori  rA, rS, uimm
+        case 25:   // oris
+        case 26:   // xori
+        case 27:   // xoris
+        case 28:   // andi.
+        case 29: { // andis.
+            uint64_t imm = (opcode & 1) ? uimm << 16 : uimm;
+            llvm::Value* s = loadGPR(builder, regs, rD);
+            llvm::Value* result = opcode < 26 ? builder.CreateOr(s, builder.getInt64(imm))
+                                : opcode < 28 ? builder.CreateXor(s, builder.getInt64(imm))
+                                              : builder.CreateAnd(s, builder.getInt64(imm));
+            storeGPR(builder, regs, rA, result);
+            if (opcode >= 28) updateCR0(builder, regs, result);
+            return true;
+        }
+        case 30: { // rldicl, rldicr, rldic, rldimi, rldcl, rldcr
+            uint32_t field = (instr >> 5) & 0x3F;
+            uint32_t mb = (field >> 1) | ((field & 1) << 5);
+            uint32_t sh = rB | (((instr >> 1) & 1) << 5);
+            uint32_t xop = (instr >> 2) & 7;
+            llvm::Value* n = builder.getInt64(sh);
+            if (xop == 4) { // MDS-form: shift amount from rB
+                xop = 4 | ((instr >> 1) & 1);
+                n = builder.CreateAnd(loadGPR(builder, regs, rB), builder.getInt64(0x3F));
+            }
+            llvm::Value* rotated = emitRotateLeft64(builder, loadGPR(builder, regs, rD), n);
+            llvm::Value* result;
+            switch (xop) {
+                case 0: // rldicl
+                case 4: // rldcl
+                    result = builder.CreateAnd(rotated, builder.getInt64(rotateMask(mb, 63)));
+                    break;
+                case 1: // rldicr
+                case 5: // rldcr
+                    result = builder.CreateAnd(rotated, builder.getInt64(rotateMask(0, mb)));
+                    break;
+                case 2: // rldic
+                    result = builder.CreateAnd(rotated, builder.getInt64(rotateMask(mb, 63 - sh)));
+                    break;
+                case 3: { // rldimi
+                    uint64_t mask = rotateMask(mb, 63 - sh);
+                    result = builder.CreateOr(builder.CreateAnd(rotated, builder.getInt64(mask)),
+                                              builder.CreateAnd(loadGPR(builder, regs, rA),
+                                                                builder.getInt64(~mask)));
+                    break;
                 }
-                break;
+                default:
+                    return false;
             }
-            // Other instructions: skip (stub)
-            default:
-                break;
+            storeGPR(builder, regs, rA, result);
+            if (rc) updateCR0(builder, regs, result);
+            return true;
         }
+        case 31:
+            return buildExtendedIR(builder, args, instr);
+        case 32: case 33: case 34: case 35: case 36: case 37: case 38: case 39:
+        case 40: case 41: case 42: case 43: case 44: case 45: case 46: case 47:
+        case 58: case 62:
+            return buildLoadStoreIR(builder, args, instr);
+        default:
+            return false;
     }
-    
-    // Return next PC
-    auto* nextPC = builder.CreateAdd(
-        argPc, 
-        llvm::ConstantInt::get(i64Ty, instrCount * 4)
-    );
-    builder.CreateRet(nextPC);
-    
-    // Verify function
-    if (llvm::verifyFunction(*func, &llvm::errs())) {
-        std::cerr << "Failed to verify JIT function" << std::endl;
-        func->eraseFromParent();
-        return nullptr;
+}
+
+bool LLVMJITCompiler::buildExtendedIR(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                                      uint32_t instr) {
+    llvm::Value* regs = args.regs;
+    uint32_t rD = (instr >> 21) & 0x1F;  // also rS
+    uint32_t rA = (instr >> 16) & 0x1F;
+    uint32_t rB = (instr >> 11) & 0x1F;
+    uint32_t xop = (instr >> 1) & 0x3FF;
+    bool rc = instr & 1;
+    llvm::Type* i64 = builder.getInt64Ty();
+    llvm::Type* i32 = builder.getInt32Ty();
+    llvm::Type* i128 = builder.getIntNTy(128);
+
+    // XO-form arithmetic, mirrors PPUInterpreter::executeArithmetic
+    bool oe = (instr >> 10) & 1;
+    llvm::Value* result = nullptr;
+    llvm::Value* overflow = builder.getFalse();
+    auto addForm = [&](llvm::Value* x, llvm::Value* y, llvm::Value* carryIn, bool setsCA) {
+        CarryIR r = emitAddWithCarry(builder, x, y, carryIn);
+        if (setsCA) storeCA(builder, regs, r.carry);
+        result = r.value;
+        overflow = r.overflow;
+    };
+    auto a = [&]() { return loadGPR(builder, regs, rA); };
+    auto b = [&]() { return loadGPR(builder, regs, rB); };
+    auto word = [&](llvm::Value* v, bool sign) {
+        v = builder.CreateTrunc(v, i32);
+        return sign ? builder.CreateSExt(v, i64) : builder.CreateZExt(v, i64);
+    };
+    switch (xop & 0x1FF) {
+        case 8:   addForm(builder.CreateNot(a()), b(), builder.getInt64(1), true); break;    // subfc
+        case 10:  addForm(a(), b(), builder.getInt64(0), true); break;                      // addc
+        case 40:  addForm(builder.CreateNot(a()), b(), builder.getInt64(1), false); break;  // subf
+        case 104: addForm(builder.CreateNot(a()), builder.getInt64(0), builder.getInt64(1), false); break; // neg
+        case 136: addForm(builder.CreateNot(a()), b(), loadCA(builder, regs), true); break; // subfe
+        case 138: addForm(a(), b(), loadCA(builder, regs), true); break;                    // adde
+        case 200: addForm(builder.CreateNot(a()), builder.getInt64(0), loadCA(builder, regs), true); break; // subfze
+        case 202: addForm(a(), builder.getInt64(0), loadCA(builder, regs), true); break;    // addze
+        case 232: addForm(builder.CreateNot(a()), builder.getInt64(~0ULL), loadCA(builder, regs), true); break; // subfme
+        case 234: addForm(a(), builder.getInt64(~0ULL), loadCA(builder, regs), true); break; // addme
+        case 266: addForm(a(), b(), builder.getInt64(0), false); break;                     // add
+        case 9: { // mulhdu
+            llvm::Value* p = builder.CreateMul(builder.CreateZExt(a(), i128), builder.CreateZExt(b(), i128));
+            result = builder.CreateTrunc(builder.CreateLShr(p, 64), i64);
+            break;
+        }
+        case 73: { // mulhd
+            llvm::Value* p = builder.CreateMul(builder.CreateSExt(a(), i128), builder.CreateSExt(b(), i128));
+            result = builder.CreateTrunc(builder.CreateAShr(p, 64), i64);
+            break;
+        }
+        case 11: // mulhwu
+            result = builder.CreateLShr(builder.CreateMul(word(a(), false), word(b(), false)), 32);
+            break;
+        case 75: // mulhw
+            result = builder.CreateAShr(builder.CreateMul(word(a(), true), word(b(), true)), 32);
+            break;
+        case 233: { // mulld
+            llvm::Value* p = builder.CreateMul(builder.CreateSExt(a(), i128), builder.CreateSExt(b(), i128));
+            result = builder.CreateTrunc(p, i64);
+            overflow = builder.CreateICmpNE(builder.CreateSExt(result, i128), p);
+            break;
+        }
+        case 235: { // mullw
+            result = builder.CreateMul(word(a(), true), word(b(), true));
+            overflow = builder.CreateICmpNE(word(result, true), result);
+            break;
+        }
+        case 457:   // divdu
+        case 459:   // divwu
+        case 489:   // divd
+        case 491: { // divw
+            bool isWord = (xop & 0x1FF) == 459 || (xop & 0x1FF) == 491;
+            bool isSigned = (xop & 0x1FF) >= 489;
+            llvm::Type* ty = isWord ? i32 : i64;
+            llvm::Value* x = builder.CreateTrunc(a(), ty);
+            llvm::Value* y = builder.CreateTrunc(b(), ty);
+            llvm::Value* zero = llvm::ConstantInt::get(ty, 0);
+            // Undefined cases produce 0 without executing the host divide
+            overflow = builder.CreateICmpEQ(y, zero);
+            if (isSigned) {
+                llvm::Value* minValue = isWord ? builder.getInt32(0x80000000)
+                                               : builder.getInt64(0x8000000000000000ULL);
+                overflow = builder.CreateOr(overflow, builder.CreateAnd(
+                    builder.CreateICmpEQ(x, minValue),
+                    builder.CreateICmpEQ(y, llvm::ConstantInt::get(ty, ~0ULL))));
+            }
+            llvm::Value* divisor = builder.CreateSelect(overflow, llvm::ConstantInt::get(ty, 1), y);
+            llvm::Value* q = isSigned ? builder.CreateSDiv(x, divisor) : builder.CreateUDiv(x, divisor);
+            q = builder.CreateSelect(overflow, zero, q);
+            result = isWord ? builder.CreateZExt(q, i64) : q;
+            break;
+        }
+        default:
+            break;
+    }
+    if (result) {
+        storeGPR(builder, regs, rD, result);
+        if (oe) storeOV(builder, regs, overflow);
+        if (rc) updateCR0(builder, regs, result);
+        return true;
+    }
+
+    // X-form: rA is the destination, rD the source (rS)
+    auto s = [&]() { return loadGPR(builder, regs, rD); };
+    switch (xop) {
+        case 0:    // cmp  crfD, L, rA, rB
+        case 32: { // cmpl
+            bool l = rD & 1;
+            llvm::Value* x = a();
+            llvm::Value* y = b();
+            if (!l) {
+                x = word(x, xop == 0);
+                y = word(y, xop == 0);
+            }
+            llvm::Value* lt = xop == 0 ? builder.CreateICmpSLT(x, y) : builder.CreateICmpULT(x, y);
+            llvm::Value* gt = xop == 0 ? builder.CreateICmpSGT(x, y) : builder.CreateICmpUGT(x, y);
+            setCRField(builder, regs, rD >> 2, compareResult(builder, lt, gt));
+            return true;
+        }
+        case 19: // mfcr, mfocrf
+            storeGPR(builder, regs, rD,
+                     builder.CreateZExt(loadField(builder, regs, CR_OFFSET, i32), i64));
+            return true;
+        case 144: { // mtcrf, mtocrf
+            uint32_t fxm = (instr >> 12) & 0xFF;
+            uint32_t mask = 0;
+            for (int i = 0; i < 8; ++i) {
+                if (fxm & (0x80 >> i)) mask |= 0xF0000000u >> (i * 4);
+            }
+            llvm::Value* cr = loadField(builder, regs, CR_OFFSET, i32);
+            cr = builder.CreateOr(builder.CreateAnd(cr, builder.getInt32(~mask)),
+                                  builder.CreateAnd(builder.CreateTrunc(s(), i32), builder.getInt32(mask)));
+            storeField(builder, regs, CR_OFFSET, cr);
+            return true;
+        }
+        case 339: { // mfspr
+            uint32_t spr = (rB << 5) | rA;
+            if (spr == 268 || spr == 269) return false;  // timebase: interpreted
+            llvm::Value* value = spr == 1 ? builder.CreateZExt(loadField(builder, regs, XER_OFFSET, i32), i64)
+                               : spr == 8 ? loadField(builder, regs, LR_OFFSET, i64)
+                               : spr == 9 ? loadField(builder, regs, CTR_OFFSET, i64)
+                                          : builder.getInt64(0);
+            storeGPR(builder, regs, rD, value);
+            return true;
+        }
+        case 467: { // mtspr
+            uint32_t spr = (rB << 5) | rA;
+            if (spr == 1) storeField(builder, regs, XER_OFFSET, builder.CreateTrunc(s(), i32));
+            else if (spr == 8) storeField(builder, regs, LR_OFFSET, s());
+            else if (spr == 9) storeField(builder, regs, CTR_OFFSET, s());
+            return true;
+        }
+        case 54:  // dcbst
+        case 86:  // dcbf
+        case 246: // dcbtst
+        case 278: // dcbt
+        case 598: // sync
+        case 854: // eieio
+        case 982: // icbi
+            return true;
+        default:
+            break;
+    }
+
+    switch (xop) {
+        case 24:  result = emitLogicalShift(builder, s(), b(), true, true); break;    // slw
+        case 27:  result = emitLogicalShift(builder, s(), b(), true, false); break;   // sld
+        case 536: result = emitLogicalShift(builder, s(), b(), false, true); break;   // srw
+        case 539: result = emitLogicalShift(builder, s(), b(), false, false); break;  // srd
+        case 792: // sraw
+            result = emitAlgebraicShift(builder, regs, s(), builder.CreateAnd(b(), builder.getInt64(0x3F)), true);
+            break;
+        case 824: // srawi
+            result = emitAlgebraicShift(builder, regs, s(), builder.getInt64(rB), true);
+            break;
+        case 794: // srad
+            result = emitAlgebraicShift(builder, regs, s(), builder.CreateAnd(b(), builder.getInt64(0x7F)), false);
+            break;
+        case 826:   // sradi
+        case 827: {
+            uint32_t sh = rB | ((xop & 1) << 5);
+            result = emitAlgebraicShift(builder, regs, s(), builder.getInt64(sh), false);
+            break;
+        }
+        case 26: // cntlzw
+            result = builder.CreateZExt(
+                builder.CreateBinaryIntrinsic(llvm::Intrinsic::ctlz, builder.CreateTrunc(s(), i32),
+                                              builder.getFalse()), i64);
+            break;
+        case 58: // cntlzd
+            result = builder.CreateBinaryIntrinsic(llvm::Intrinsic::ctlz, s(), builder.getFalse());
+            break;
+        case 122: { // popcntb
+            auto* bytes = llvm::FixedVectorType::get(builder.getInt8Ty(), 8);
+            llvm::Value* counts = builder.CreateUnaryIntrinsic(llvm::Intrinsic::ctpop,
+                                                               builder.CreateBitCast(s(), bytes));
+            storeGPR(builder, regs, rA, builder.CreateBitCast(counts, i64));
+            return true;
+        }
+        case 28:  result = builder.CreateAnd(s(), b()); break;                           // and
+        case 60:  result = builder.CreateAnd(s(), builder.CreateNot(b())); break;        // andc
+        case 124: result = builder.CreateNot(builder.CreateOr(s(), b())); break;         // nor
+        case 284: result = builder.CreateNot(builder.CreateXor(s(), b())); break;        // eqv
+        case 316: result = builder.CreateXor(s(), b()); break;                           // xor
+        case 412: result = builder.CreateOr(s(), builder.CreateNot(b())); break;         // orc
+        case 444: result = builder.CreateOr(s(), b()); break;                            // or
+        case 476: result = builder.CreateNot(builder.CreateAnd(s(), b())); break;        // nand
+        case 922: result = builder.CreateSExt(builder.CreateTrunc(s(), builder.getInt16Ty()), i64); break; // extsh
+        case 954: result = builder.CreateSExt(builder.CreateTrunc(s(), builder.getInt8Ty()), i64); break;  // extsb
+        case 986: result = builder.CreateSExt(builder.CreateTrunc(s(), i32), i64); break;                  // extsw
+        default:
+            // Indexed loads and stores, or unsupported
+            return buildLoadStoreIR(builder, args, instr);
     }
-    
-    // JIT compile to native code
-    auto* funcPtr = engine_->getPointerToFunction(func);
-    
-    std::cout << "LLVM JIT compiled block at 0x" << std::hex << startPC << std::dec
-              << " (" << instrCount << " instructions) -> native code" << std::endl;
-    
-    return (CompiledFunc)funcPtr;
+    storeGPR(builder, regs, rA, result);
+    if (rc) updateCR0(builder, regs, result);
+    return true;
 }
 
-bool LLVMJITCompiler::buildInstructionIR(
+bool LLVMJITCompiler::buildLoadStoreIR(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                                       uint32_t instr) {
+    llvm::Value* regs = args.regs;
+    uint32_t opcode = (instr >> 26) & 0x3F;
+    uint32_t rD = (instr >> 21) & 0x1F;  // also rS
+    uint32_t rA = (instr >> 16) & 0x1F;
+    uint32_t rB = (instr >> 11) & 0x1F;
+
+    // Decode into one access: size, direction, extension, update, byte order
+    uint32_t bytes = 0;
+    bool store = false;
+    bool sign = false;
+    bool update = false;
+    bool reversed = false;
+    int64_t disp = static_cast<int16_t>(instr & 0xFFFF);
+    bool indexed = false;
+    switch (opcode) {
+        case 32: bytes = 4; break;                              // lwz
+        case 33: bytes = 4; update = true; break;               // lwzu
+        case 34: bytes = 1; break;                              // lbz
+        case 35: bytes = 1; update = true; break;               // lbzu
+        case 36: bytes = 4; store = true; break;                // stw
+        case 37: bytes = 4; store = true; update = true; break; // stwu
+        case 38: bytes = 1; store = true; break;                // stb
+        case 39: bytes = 1; store = true; update = true; break; // stbu
+        case 40: bytes = 2; break;                              // lhz
+        case 41: bytes = 2; update = true; break;               // lhzu
+        case 42: bytes = 2; sign = true; break;                 // lha
+        case 43: bytes = 2; sign = true; update = true; break;  // lhau
+        case 44: bytes = 2; store = true; break;                // sth
+        case 45: bytes = 2; store = true; update = true; break; // sthu
+        case 46:   // lmw
+        case 47: { // stmw
+            if (opcode == 46 && rA >= rD && rA != 0) return false;  // invalid form
+            llvm::Value* ea = builder.CreateAdd(loadGPROrZero(builder, regs, rA),
+                                                builder.getInt64(disp));
+            for (uint32_t r = rD; r < 32; ++r) {
+                llvm::Value* addr = builder.CreateAdd(ea, builder.getInt64((r - rD) * 4));
+                if (opcode == 46) {
+                    storeGPR(builder, regs, r, emitLoad(builder, args, addr, 4));
+                } else {
+                    emitStore(builder, args, addr, loadGPR(builder, regs, r), 4);
+                }
+            }
+            return true;
+        }
+        case 58: // ld, ldu, lwa
+            disp = static_cast<int16_t>(instr & 0xFFFC);
+            switch (instr & 3) {
+                case 0: bytes = 8; break;
+                case 1: bytes = 8; update = true; break;
+                case 2: bytes = 4; sign = true; break;
+                default: return false;
+            }
+            break;
+        case 62: // std, stdu
+            disp = static_cast<int16_t>(instr & 0xFFFC);
+            switch (instr & 3) {
+                case 0: bytes = 8; store = true; break;
+                case 1: bytes = 8; store = true; update = true; break;
+                default: return false;
+            }
+            break;
+        case 31: {
+            indexed = true;
+            uint32_t xop = (instr >> 1) & 0x3FF;
+            switch (xop) {
+                case 21:  bytes = 8; break;                                // ldx
+                case 23:  bytes = 4; break;                                // lwzx
+                case 87:  bytes = 1; break;                                // lbzx
+                case 279: bytes = 2; break;                                // lhzx
+                case 341: bytes = 4; sign = true; break;                   // lwax
+                case 343: bytes = 2; sign = true; break;                   // lhax
+                case 53:  bytes = 8; update = true; break;                 // ldux
+                case 55:  bytes = 4; update = true; break;                 // lwzux
+                case 119: bytes = 1; update = true; break;                 // lbzux
+                case 311: bytes = 2; update = true; break;                 // lhzux
+                case 373: bytes = 4; sign = true; update = true; break;    // lwaux
+                case 375: bytes = 2; sign = true; update = true; break;    // lhaux
+                case 532: bytes = 8; reversed = true; break;               // ldbrx
+                case 534: bytes = 4; reversed = true; break;               // lwbrx
+                case 790: bytes = 2; reversed = true; break;               // lhbrx
+                case 149: bytes = 8; store = true; break;                  // stdx
+                case 151: bytes = 4; store = true; break;                  // stwx
+                case 215: bytes = 1; store = true; break;                  // stbx
+                case 407: bytes = 2; store = true; break;                  // sthx
+                case 181: bytes = 8; store = true; update = true; break;   // stdux
+                case 183: bytes = 4; store = true; update = true; break;   // stwux
+                case 247: bytes = 1; store = true; update = true; break;   // stbux
+                case 439: bytes = 2; store = true; update = true; break;   // sthux
+                case 660: bytes = 8; store = true; reversed = true; break; // stdbrx
+                case 662: bytes = 4; store = true; reversed = true; break; // stwbrx
+                case 918: bytes = 2; store = true; reversed = true; break; // sthbrx
+                default:
+                    // lwarx/stwcx. and friends keep their reservation in the
+                    // interpreter; dcbz and anything else is not translated
+                    return false;
+            }
+            break;
+        }
+        default:
+            return false;
+    }
+
+    // Invalid update forms are left to the interpreter
+    if (update && (rA == 0 || (!store && rA == rD))) return false;
+
+    llvm::Type* ty = builder.getIntNTy(bytes * 8);
+    llvm::Value* offset = indexed ? loadGPR(builder, regs, rB) : builder.getInt64(disp);
+    llvm::Value* ea = builder.CreateAdd(loadGPROrZero(builder, regs, rA), offset);
+    if (store) {
+        llvm::Value* value = loadGPR(builder, regs, rD);
+        if (reversed) {
+            value = builder.CreateZExt(
+                builder.CreateUnaryIntrinsic(llvm::Intrinsic::bswap, builder.CreateTrunc(value, ty)),
+                builder.getInt64Ty());
+        }
+        emitStore(builder, args, ea, value, bytes);
+    } else {
+        llvm::Value* value = emitLoad(builder, args, ea, bytes);
+        if (sign || reversed) {
+            value = builder.CreateTrunc(value, ty);
+            if (reversed) value = builder.CreateUnaryIntrinsic(llvm::Intrinsic::bswap, value);
+            value = sign ? builder.CreateSExt(value, builder.getInt64Ty())
+                         : builder.CreateZExt(value, builder.getInt64Ty());
+        }
+        storeGPR(builder, regs, rD, value);
+    }
+    if (update) storeGPR(builder, regs, rA, ea);
+    return true;
+}
+
+llvm::Value* LLVMJITCompiler::emitFastmemCheck(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                                              llvm::Value* ea, uint32_t bytes, uint8_t need) {
+    // In the 4GB window, not straddling a fastmem page, and the page allows it
+    llvm::Value* page = builder.CreateLShr(ea, FASTMEM_PAGE_SHIFT);
+    llvm::Value* inRange = builder.CreateICmpULT(page, builder.getInt64(FASTMEM_PAGE_COUNT));
+    llvm::Value* inPage = builder.CreateICmpULE(
+        builder.CreateAnd(ea, builder.getInt64(FASTMEM_PAGE_SIZE - 1)),
+        builder.getInt64(FASTMEM_PAGE_SIZE - bytes));
+    llvm::Value* flags = loadInvariant(builder, args.ctx, CTX_PAGE_FLAGS_OFFSET,
+                                       llvm::PointerType::get(builder.getInt8Ty(), 0));
+    llvm::Value* flagPtr = builder.CreateInBoundsGEP(
+        builder.getInt8Ty(), flags,
+        builder.CreateAnd(page, builder.getInt64(FASTMEM_PAGE_COUNT - 1)));
+    llvm::Value* flag = builder.CreateLoad(builder.getInt8Ty(), flagPtr);
+    llvm::Value* allowed = builder.CreateICmpNE(builder.CreateAnd(flag, builder.getInt8(need)),
+                                                builder.getInt8(0));
+    return builder.CreateAnd(builder.CreateAnd(inRange, inPage), allowed);
+}
+
+llvm::Value* LLVMJITCompiler::emitLoad(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                                       llvm::Value* ea, uint32_t bytes) {
+    auto& ctx = builder.getContext();
+    llvm::Function* func = builder.GetInsertBlock()->getParent();
+    llvm::Type* ty = builder.getIntNTy(bytes * 8);
+
+    auto* fastBB = llvm::BasicBlock::Create(ctx, "load.fast", func);
+    auto* slowBB = llvm::BasicBlock::Create(ctx, "load.slow", func);
+    auto* joinBB = llvm::BasicBlock::Create(ctx, "load.done", func);
+    builder.CreateCondBr(emitFastmemCheck(builder, args, ea, bytes, FASTMEM_READ), fastBB, slowBB,
+                         llvm::MDBuilder(ctx).createBranchWeights(1000, 1));
+
+    // Guest memory is big-endian
+    builder.SetInsertPoint(fastBB);
+    llvm::Value* base = loadInvariant(builder, args.ctx, CTX_MEMORY_BASE_OFFSET,
+                                      llvm::PointerType::get(builder.getInt8Ty(), 0));
+    llvm::Value* host = builder.CreatePointerCast(builder.CreateGEP(builder.getInt8Ty(), base, ea),
+                                                  llvm::PointerType::get(ty, 0));
+    llvm::Value* fast = builder.CreateAlignedLoad(ty, host, llvm::MaybeAlign(1));
+    if (bytes > 1) {
+        fast = builder.CreateUnaryIntrinsic(llvm::Intrinsic::bswap, fast);
+    }
+    fast = builder.CreateZExt(fast, builder.getInt64Ty());
+    builder.CreateBr(joinBB);
+
+    builder.SetInsertPoint(slowBB);
+    llvm::Module* module = func->getParent();
+    auto* ptrTy = llvm::PointerType::get(builder.getInt8Ty(), 0);
+    llvm::FunctionCallee helper = module->getOrInsertFunction(
+        "pxs3c_ppu_read" + std::to_string(bytes * 8),
+        llvm::FunctionType::get(builder.getInt64Ty(), {ptrTy, builder.getInt64Ty()}, false));
+    llvm::Value* memory = loadInvariant(builder, args.ctx, CTX_MEMORY_OFFSET, ptrTy);
+    llvm::Value* slow = builder.CreateCall(helper, {memory, ea});
+    builder.CreateBr(joinBB);
+
+    builder.SetInsertPoint(joinBB);
+    llvm::PHINode* value = builder.CreatePHI(builder.getInt64Ty(), 2);
+    value->addIncoming(fast, fastBB);
+    value->addIncoming(slow, slowBB);
+    return value;
+}
+
+void LLVMJITCompiler::emitStore(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                                llvm::Value* ea, llvm::Value* value, uint32_t bytes) {
+    auto& ctx = builder.getContext();
+    llvm::Function* func = builder.GetInsertBlock()->getParent();
+    llvm::Type* ty = builder.getIntNTy(bytes * 8);
+
+    auto* fastBB = llvm::BasicBlock::Create(ctx, "store.fast", func);
+    auto* slowBB = llvm::BasicBlock::Create(ctx, "store.slow", func);
+    auto* joinBB = llvm::BasicBlock::Create(ctx, "store.done", func);
+    builder.CreateCondBr(emitFastmemCheck(builder, args, ea, bytes, FASTMEM_WRITE), fastBB, slowBB,
+                         llvm::MDBuilder(ctx).createBranchWeights(1000, 1));
+
+    builder.SetInsertPoint(fastBB);
+    llvm::Value* base = loadInvariant(builder, args.ctx, CTX_MEMORY_BASE_OFFSET,
+                                      llvm::PointerType::get(builder.getInt8Ty(), 0));
+    llvm::Value* host = builder.CreatePointerCast(builder.CreateGEP(builder.getInt8Ty(), base, ea),
+                                                  llvm::PointerType::get(ty, 0));
+    llvm::Value* data = builder.CreateTrunc(value, ty);
+    if (bytes > 1) {
+        data = builder.CreateUnaryIntrinsic(llvm::Intrinsic::bswap, data);
+    }
+    builder.CreateAlignedStore(data, host, llvm::MaybeAlign(1));
+    builder.CreateBr(joinBB);
+
+    builder.SetInsertPoint(slowBB);
+    llvm::Module* module = func->getParent();
+    auto* ptrTy = llvm::PointerType::get(builder.getInt8Ty(), 0);
+    llvm::FunctionCallee helper = module->getOrInsertFunction(
+        "pxs3c_ppu_write" + std::to_string(bytes * 8),
+        llvm::FunctionType::get(builder.getVoidTy(),
+                                {ptrTy, builder.getInt64Ty(), builder.getInt64Ty()}, false));
+    llvm::Value* memory = loadInvariant(builder, args.ctx, CTX_MEMORY_OFFSET, ptrTy);
+    builder.CreateCall(helper, {memory, ea, value});
+    builder.CreateBr(joinBB);
+
+    builder.SetInsertPoint(joinBB);
+}
+
+void LLVMJITCompiler::emitExit(
     llvm::IRBuilder<>& builder,
-    PPUInterpreter* ppu,
-    MemoryManager* memory,
+    const BlockArgs& args,
+    llvm::Value* nextPC,
+    uint32_t slot) {
+
+    if (slot == EXIT_UNLINKED) {
+        builder.CreateRet(nextPC);
+        return;
+    }
+
+    auto& ctx = builder.getContext();
+    llvm::Function* func = builder.GetInsertBlock()->getParent();
+    auto* ptrTy = llvm::PointerType::get(builder.getInt8Ty(), 0);
+    const size_t linkOffset = HDR_LINKS_OFFSET + slot * sizeof(JITBlockLink);
+
+    auto* checkBB = llvm::BasicBlock::Create(ctx, "chain.check", func);
+    auto* chainBB = llvm::BasicBlock::Create(ctx, "chain", func);
+    auto* exitBB = llvm::BasicBlock::Create(ctx, "exit", func);
+
+    // Linked, and for indirect exits the inline cache matches this target
+    llvm::Value* target = loadField(builder, args.self,
+                                    linkOffset + offsetof(JITBlockLink, target), ptrTy);
+    llvm::Value* linked = builder.CreateIsNotNull(target);
+    if (slot == PPU_JIT_EXIT_INDIRECT) {
+        llvm::Value* cachedPC = loadField(builder, args.self,
+                                          linkOffset + offsetof(JITBlockLink, pc),
+                                          builder.getInt64Ty());
+        linked = builder.CreateAnd(linked, builder.CreateICmpEQ(cachedPC, nextPC));
+    }
+    // Hot baseline blocks return so the dispatcher can promote them
+    if (args.tier == PPUJITTier::Baseline) {
+        llvm::Value* calls = loadField(builder, args.self, HDR_CALLS_OFFSET, builder.getInt64Ty());
+        llvm::Value* threshold = loadField(builder, args.ctx, CTX_THRESHOLD_OFFSET,
+                                           builder.getInt64Ty());
+        linked = builder.CreateAnd(linked, builder.CreateICmpULT(calls, threshold));
+    }
+    builder.CreateCondBr(linked, checkBB, exitBB);
+
+    // The next block must fit in what is left of the budget
+    builder.SetInsertPoint(checkBB);
+    llvm::Value* count = builder.CreateZExt(
+        loadField(builder, target, HDR_COUNT_OFFSET, builder.getInt32Ty()), builder.getInt64Ty());
+    llvm::Value* budget = loadField(builder, args.ctx, CTX_BUDGET_OFFSET, builder.getInt64Ty());
+    builder.CreateCondBr(builder.CreateICmpSLE(count, budget), chainBB, exitBB);
+
+    builder.SetInsertPoint(chainBB);
+    llvm::FunctionType* funcType = func->getFunctionType();
+    llvm::Value* next = loadField(builder, target, HDR_COMPILED_OFFSET,
+                                  llvm::PointerType::get(funcType, 0));
+    llvm::CallInst* call = builder.CreateCall(funcType, next, {args.regs, args.ctx, target});
+    call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+    builder.CreateRet(call);
+
+    builder.SetInsertPoint(exitBB);
+    storeField(builder, args.ctx, CTX_EXIT_BLOCK_OFFSET, args.self);
+    storeField(builder, args.ctx, CTX_EXIT_SLOT_OFFSET, builder.getInt32(slot));
+    builder.CreateRet(nextPC);
+}
+
+bool LLVMJITCompiler::buildBranchIR(
+    llvm::IRBuilder<>& builder,
+    const BlockArgs& args,
+    uint64_t pc,
     uint32_t instr,
-    std::vector<llvm::Value*>& gprValues,
-    std::vector<llvm::Value*>& fprValues) {
-    
-    // This would contain the actual PowerPC to LLVM IR translation
-    // for each opcode. For now, return true (placeholder)
+    const BranchProfile* profile,
+    const std::function<void(uint64_t)>& edge) {
+
+    auto& ctx = builder.getContext();
+    llvm::Value* regs = args.regs;
+    uint32_t opcode = (instr >> 26) & 0x3F;
+    bool aa = (instr >> 1) & 1;
+    bool lk = instr & 1;
+    uint64_t fallthrough = pc + 4;
+
+    if (opcode == 18) { // b
+        int32_t li = instr & 0x03FFFFFC;
+        if (li & 0x02000000) li |= 0xFC000000; // Sign extend
+        uint64_t target = aa ? static_cast<uint64_t>(static_cast<int64_t>(li))
+                             : pc + static_cast<int64_t>(li);
+        if (lk) storeField(builder, regs, LR_OFFSET, builder.getInt64(fallthrough));
+        edge(target);
+        return true;
+    }
+
+    uint32_t bo = (instr >> 21) & 0x1F;
+    uint32_t bi = (instr >> 16) & 0x1F;
+    llvm::Value* taken = nullptr;
+    llvm::Value* indirectTarget = nullptr;  // LR/CTR for bclr/bcctr
+    uint64_t target = 0;
+
+    if (opcode == 16) { // bc
+        int32_t bd = instr & 0xFFFC;
+        if (bd & 0x8000) bd |= 0xFFFF0000; // Sign extend
+        taken = emitCondition(builder, regs, bo, bi);
+        target = aa ? static_cast<uint64_t>(static_cast<int64_t>(bd))
+                    : pc + static_cast<int64_t>(bd);
+    } else if (opcode == 19) {
+        uint32_t xop = (instr >> 1) & 0x3FF;
+        if (xop != 16 && xop != 528) { // only bclr, bcctr end a block here
+            return false;
+        }
+        // The interpreter evaluates the condition (and CTR decrement) first
+        taken = emitCondition(builder, regs, bo, bi);
+        indirectTarget = loadField(builder, regs, xop == 16 ? LR_OFFSET : CTR_OFFSET,
+                                   builder.getInt64Ty());
+    } else {
+        return false;
+    }
+
+    auto emitTaken = [&]() {
+        if (lk) storeField(builder, regs, LR_OFFSET, builder.getInt64(fallthrough));
+        if (indirectTarget) {
+            emitExit(builder, args, indirectTarget, PPU_JIT_EXIT_INDIRECT);
+        } else {
+            edge(target);
+        }
+    };
+
+    if (!taken) {
+        emitTaken();
+        return true;
+    }
+
+    llvm::Function* func = builder.GetInsertBlock()->getParent();
+    auto* takenBB = llvm::BasicBlock::Create(ctx, "taken", func);
+    auto* fallBB = llvm::BasicBlock::Create(ctx, "fallthrough", func);
+
+    // Optimized code is laid out using the exit profile the baseline code
+    // gathered, so the hot successor becomes the fall-through path.
+    llvm::MDNode* weights = nullptr;
+    if (profile) {
+        weights = llvm::MDBuilder(ctx).createBranchWeights(
+            clampWeight(profile->taken + 1), clampWeight(profile->fallthrough + 1));
+    }
+    builder.CreateCondBr(taken, takenBB, fallBB, weights);
+
+    // Baseline code records which way the branch goes
+    builder.SetInsertPoint(takenBB);
+    if (args.tier == PPUJITTier::Baseline) incrementField(builder, args.self, HDR_TAKEN_OFFSET);
+    emitTaken();
+
+    builder.SetInsertPoint(fallBB);
+    if (args.tier == PPUJITTier::Baseline) incrementField(builder, args.self, HDR_FALLTHROUGH_OFFSET);
+    edge(fallthrough);
     return true;
 }
 
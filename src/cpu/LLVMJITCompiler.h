@@ -1,8 +1,12 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <map>
 #include <vector>
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #ifdef LLVM_AVAILABLE
 #include "llvm/IR/IRBuilder.h"
@@ -15,40 +19,136 @@
 #endif
 
 #include "cpu/PPUInterpreter.h"
+#include "cpu/PPUJIT.h"
 
 namespace pxs3c {
 
 class MemoryManager;
 class PPUInterpreter;
+class PPUJITObjectCache;
+class PPUCodeCache;
 
 #ifdef LLVM_AVAILABLE
-// JIT compilation engine using LLVM for 60 FPS performance
+// JIT compilation engine using LLVM for 60 FPS performance.
+// One MCJIT engine per compiled tier: the baseline engine runs codegen
+// without optimisation, the optimized engine runs the full O3 pipeline.
 class LLVMJITCompiler {
 public:
     LLVMJITCompiler();
     ~LLVMJITCompiler();
-    
+
     bool init();
-    
-    // Compile a PowerPC block to native x86-64 code
-    typedef uint64_t (*CompiledFunc)(uint64_t* gpr, double* fpr, uint128_t* vr,
-                                      uint64_t pc, uint64_t lr, uint32_t cr);
-    
+
+    // Compile a PowerPC block to native host code
+    typedef PPUCompiledBlock CompiledFunc;
+
+    // Compiles the code at block.startPC for the given tier and fills in
+    // block.instructionCount/blockSize. Baseline code is a single basic
+    // block; optimized code is the region of up to maxInstructions reachable
+    // through direct branches, laid out using the baseline exit profile of
+    // its blocks (looked up in profile). Returns nullptr if not even the
+    // first instruction can be translated.
     CompiledFunc compileBlock(PPUInterpreter* ppu, MemoryManager* memory,
-                              uint64_t startPC, uint32_t maxInstructions);
-    
+                              JITBlockHeader& block, PPUJITTier tier,
+                              uint32_t maxInstructions,
+                              const PPUCodeCache* profile = nullptr);
+
+    // Attach a persistent object cache rooted at directory (empty disables).
+    // Returns false if the cache could not be opened.
+    bool setObjectCache(const std::string& directory);
+    PPUJITObjectCache* getObjectCache() const { return objectCache_.get(); }
+
+    // Guest basic blocks emitted across all compiled functions
+    uint64_t getRegionBlocks() const { return regionBlocks_; }
+
 private:
     std::unique_ptr<llvm::LLVMContext> context_;
-    std::unique_ptr<llvm::Module> module_;
-    llvm::ExecutionEngine* engine_;
-    
-    // Build IR for a single PowerPC instruction
-    bool buildInstructionIR(llvm::IRBuilder<>& builder,
-                           PPUInterpreter* ppu,
-                           MemoryManager* memory,
-                           uint32_t instr,
-                           std::vector<llvm::Value*>& gprValues,
-                           std::vector<llvm::Value*>& fprValues);
+    std::unique_ptr<PPUJITObjectCache> objectCache_;
+    std::unique_ptr<llvm::ExecutionEngine> baselineEngine_;
+    std::unique_ptr<llvm::ExecutionEngine> optimizedEngine_;
+    std::unique_ptr<llvm::Module> probeModule_;  // scratch functions for canTranslate()
+    uint64_t regionBlocks_;
+
+    // Functions already emitted this session, by cache key. A block that is
+    // invalidated and recompiled from identical code reuses its function.
+    std::unordered_map<std::string, uint64_t> loaded_;
+
+    // Module and function name: tier, start PC and hash of the guest code
+    static std::string cacheKey(PPUJITTier tier, uint64_t startPC, uint64_t codeHash);
+
+    // Arguments of the function being built
+    struct BlockArgs {
+        llvm::Value* regs;
+        llvm::Value* ctx;
+        llvm::Value* self;
+        PPUJITTier tier;
+    };
+
+    // Guest code selected for one compiled function
+    struct Region {
+        std::map<uint64_t, std::vector<uint32_t>> blocks;  // leader PC -> instructions
+        uint64_t endPC;                                     // past the highest instruction
+    };
+
+    // Baseline exit counts of a conditional branch
+    struct BranchProfile {
+        uint64_t taken;
+        uint64_t fallthrough;
+    };
+
+    llvm::FunctionType* blockFunctionType() const;
+    static BlockArgs bindArgs(llvm::Function* func, PPUJITTier tier);
+
+    // Branches that end a guest basic block: b, bc, bclr, bcctr
+    static bool isBlockBranch(uint32_t instr);
+    bool canTranslate(uint64_t pc, uint32_t instr);
+
+    // Discover the basic blocks reachable from startPC. Without followEdges
+    // the region is the single basic block at startPC.
+    Region formRegion(MemoryManager* memory, uint64_t startPC, bool followEdges,
+                      uint32_t maxInstructions);
+
+    static bool lookupProfile(const PPUCodeCache* profile, const JITBlockHeader& block,
+                              uint64_t leader, uint64_t branchPC, BranchProfile& out);
+
+    llvm::ExecutionEngine* engineFor(PPUJITTier tier) const;
+    void optimizeModule(llvm::Module& module, llvm::ExecutionEngine& engine);
+
+    // Build IR for a single non-branch PowerPC instruction.
+    // Returns false if the instruction is not supported by the JIT.
+    bool buildInstructionIR(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                            uint64_t pc, uint32_t instr);
+
+    // Opcode 31 (XO- and X-form) integer instructions, and all integer
+    // loads and stores. Same contract as buildInstructionIR.
+    bool buildExtendedIR(llvm::IRBuilder<>& builder, const BlockArgs& args, uint32_t instr);
+    bool buildLoadStoreIR(llvm::IRBuilder<>& builder, const BlockArgs& args, uint32_t instr);
+
+    // Build IR for a block-terminating branch. Fixed targets are handed to
+    // edge, which branches within the region or emits an exit; LR/CTR
+    // targets leave through the indirect exit. profile, if given, weights
+    // the conditional branch. Returns false if the branch form is not
+    // supported by the JIT.
+    bool buildBranchIR(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                       uint64_t pc, uint32_t instr, const BranchProfile* profile,
+                       const std::function<void(uint64_t)>& edge);
+
+    // Guest memory access. The fast path indexes the fastmem window
+    // directly and byte-swaps; MMIO, unmapped pages and page-straddling
+    // accesses call back into MemoryManager. Loads return the value
+    // zero-extended to i64.
+    llvm::Value* emitFastmemCheck(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                                  llvm::Value* ea, uint32_t bytes, uint8_t need);
+    llvm::Value* emitLoad(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                          llvm::Value* ea, uint32_t bytes);
+    void emitStore(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                   llvm::Value* ea, llvm::Value* value, uint32_t bytes);
+
+    // Leave the block through the given exit slot: tail-call the linked
+    // successor if there is one and the budget allows, else record the
+    // exit in the context and return nextPC to the dispatcher.
+    void emitExit(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                  llvm::Value* nextPC, uint32_t slot);
 };
 #else
 // Stub when LLVM is not available
@@ -56,16 +156,19 @@ class LLVMJITCompiler {
 public:
     LLVMJITCompiler() {}
     ~LLVMJITCompiler() {}
-    
+
     bool init() { return false; }
-    
-    typedef uint64_t (*CompiledFunc)(uint64_t* gpr, double* fpr, uint128_t* vr,
-                                      uint64_t pc, uint64_t lr, uint32_t cr);
-    
+
+    typedef PPUCompiledBlock CompiledFunc;
+
     CompiledFunc compileBlock(PPUInterpreter* ppu, MemoryManager* memory,
-                              uint64_t startPC, uint32_t maxInstructions) {
+                              JITBlockHeader& block, PPUJITTier tier,
+                              uint32_t maxInstructions,
+                              const PPUCodeCache* profile = nullptr) {
         return nullptr;
     }
+
+    bool setObjectCache(const std::string& directory) { return false; }
 };
 #endif
 
@@ -0,0 +1,71 @@
+#include "cpu/PPUCodeCache.h"
+
+namespace pxs3c {
+
+PPUCodeCache::PPUCodeCache()
+    : l1_(new std::atomic<Page*>[L1_SIZE]()), arenaUsed_(ARENA_CHUNK), count_(0) {}
+
+PPUCodeCache::~PPUCodeCache() {}
+
+JITBlockHeader* PPUCodeCache::allocateHeader() {
+    if (arenaUsed_ == ARENA_CHUNK) {
+        arena_.emplace_back(new JITBlockHeader[ARENA_CHUNK]());
+        arenaUsed_ = 0;
+    }
+    return &arena_.back()[arenaUsed_++];
+}
+
+JITBlockHeader* PPUCodeCache::insert(uint64_t pc) {
+    if (!cacheable(pc)) return nullptr;
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    uint64_t index = pc >> 2;
+    std::atomic<Page*>& slot = l1_[index >> L2_BITS];
+    Page* page = slot.load(std::memory_order_relaxed);
+    if (!page) {
+        pages_.emplace_back(new Page());
+        page = pages_.back().get();
+        slot.store(page, std::memory_order_release);
+    }
+
+    std::atomic<JITBlockHeader*>& entry = page->entries[index & (L2_SIZE - 1)];
+    JITBlockHeader* header = entry.load(std::memory_order_relaxed);
+    if (header) return header;
+
+    // Fill in every field before the release store: a reader that finds
+    // the header must never see a half-initialised one
+    header = allocateHeader();
+    *header = JITBlockHeader{};
+    header->startPC = pc;
+    entry.store(header, std::memory_order_release);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    return header;
+}
+
+bool PPUCodeCache::remove(uint64_t pc) {
+    if (!cacheable(pc)) return false;
+
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    uint64_t index = pc >> 2;
+    Page* page = l1_[index >> L2_BITS].load(std::memory_order_relaxed);
+    if (!page) return false;
+
+    std::atomic<JITBlockHeader*>& entry = page->entries[index & (L2_SIZE - 1)];
+    if (!entry.load(std::memory_order_relaxed)) return false;
+    entry.store(nullptr, std::memory_order_release);
+    count_.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+}
+
+void PPUCodeCache::clear() {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    for (size_t i = 0; i < L1_SIZE; ++i) {
+        l1_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    pages_.clear();
+    arena_.clear();
+    arenaUsed_ = ARENA_CHUNK;
+    count_.store(0, std::memory_order_relaxed);
+}
+
+} // namespace pxs3c
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "cpu/PPUJIT.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace pxs3c {
+
+// PC-indexed lookup of JIT block headers.
+//
+// A two-level page table keyed by PC/4 over the 32-bit guest address space:
+// the top 16 bits of PC/4 select a page, the low 14 bits an entry in it, so
+// a lookup is two dependent loads. Pages are allocated on first insert and
+// never freed before clear().
+//
+// lookup() is lock-free and may run on any number of threads while a single
+// compiler thread inserts or removes entries (inserts are serialised by a
+// mutex). Headers live in a chunked arena and keep their address for the
+// lifetime of the cache, so a reader holding a header from a concurrent
+// remove() still sees valid memory. clear() requires all readers to be idle.
+class PPUCodeCache {
+public:
+    static constexpr int L1_BITS = 16;
+    static constexpr int L2_BITS = 14;
+    static constexpr size_t L1_SIZE = size_t(1) << L1_BITS;
+    static constexpr size_t L2_SIZE = size_t(1) << L2_BITS;
+    static constexpr size_t ARENA_CHUNK = 4096;  // headers per arena chunk
+
+    PPUCodeCache();
+    ~PPUCodeCache();
+
+    PPUCodeCache(const PPUCodeCache&) = delete;
+    PPUCodeCache& operator=(const PPUCodeCache&) = delete;
+
+    // Header for the block starting at pc, or nullptr
+    JITBlockHeader* lookup(uint64_t pc) const {
+        if (!cacheable(pc)) return nullptr;
+        uint64_t index = pc >> 2;
+        const Page* page = l1_[index >> L2_BITS].load(std::memory_order_acquire);
+        if (!page) return nullptr;
+        return page->entries[index & (L2_SIZE - 1)].load(std::memory_order_acquire);
+    }
+
+    // Existing header for pc, or a new one with startPC set and everything
+    // else zero (an unlinked interpreter-tier block), fully initialised
+    // before it becomes visible to lookup(). Returns nullptr for PCs outside
+    // the indexed range.
+    JITBlockHeader* insert(uint64_t pc);
+
+    // Unpublish the header for pc. Its memory stays valid until clear().
+    bool remove(uint64_t pc);
+
+    // Visit every published header (not safe against concurrent insert)
+    template <typename Func>
+    void forEach(Func&& func) const {
+        for (size_t i = 0; i < L1_SIZE; ++i) {
+            const Page* page = l1_[i].load(std::memory_order_acquire);
+            if (!page) continue;
+            for (size_t j = 0; j < L2_SIZE; ++j) {
+                JITBlockHeader* header = page->entries[j].load(std::memory_order_acquire);
+                if (header) func(*header);
+            }
+        }
+    }
+
+    void clear();
+
+    size_t size() const { return count_.load(std::memory_order_relaxed); }
+    size_t getPageCount() const { return pages_.size(); }
+
+    static bool cacheable(uint64_t pc) {
+        return (pc & 3) == 0 && pc < (uint64_t(1) << (L1_BITS + L2_BITS + 2));
+    }
+
+private:
+    struct Page {
+        std::atomic<JITBlockHeader*> entries[L2_SIZE];
+    };
+
+    std::unique_ptr<std::atomic<Page*>[]> l1_;
+    std::vector<std::unique_ptr<Page>> pages_;
+    std::vector<std::unique_ptr<JITBlockHeader[]>> arena_;
+    size_t arenaUsed_;  // headers handed out from the last chunk
+    std::atomic<size_t> count_;
+    std::mutex writeMutex_;
+
+    JITBlockHeader* allocateHeader();
+};
+
+} // namespace pxs3c
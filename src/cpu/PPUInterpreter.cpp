@@ -2,12 +2,27 @@
 #include "cpu/PPUJIT.h"
 #include "core/SyscallHandler.h"
 #include "memory/MemoryManager.h"
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
 
 namespace pxs3c {
 
-PPUInterpreter::PPUInterpreter() : memory_(nullptr), syscalls_(nullptr), halted_(false), jit_(nullptr) {
+PPUCarryResult addWithCarry(uint64_t a, uint64_t b, uint64_t carryIn) {
+    unsigned __int128 sum = (unsigned __int128)a + b + carryIn;
+    uint64_t value = (uint64_t)sum;
+    return {value, (sum >> 64) != 0, (((a ^ value) & (b ^ value)) >> 63) != 0};
+}
+
+uint64_t rotateMask(uint32_t mb, uint32_t me) {
+    uint64_t begin = ~0ULL >> mb;
+    uint64_t end = ~0ULL << (63 - me);
+    return mb <= me ? (begin & end) : (begin | end);
+}
+
+PPUInterpreter::PPUInterpreter()
+    : memory_(nullptr), syscalls_(nullptr), halted_(false), reserveAddr_(0), reserved_(false),
+      cycles_(0), jit_(nullptr) {
     // Initialize register pointers after regs_ is created
     gpr = regs_.gpr.data();
     fpr = regs_.fpr.data();
@@ -41,6 +56,8 @@ bool PPUInterpreter::init(MemoryManager* memory, SyscallHandler* syscalls) {
 void PPUInterpreter::reset() {
     regs_ = PPURegisters();
     halted_ = false;
+    reserved_ = false;
+    cycles_ = 0;
 }
 
 uint32_t PPUInterpreter::getBits(uint32_t value, int start, int end) const {
@@ -67,26 +84,80 @@ bool PPUInterpreter::checkCondition(uint32_t bo, uint32_t bi) {
     return ctr_ok && cond_ok;
 }
 
-void PPUInterpreter::executeInstruction() {
-    if (halted_ || !memory_) return;
+void PPUInterpreter::setCRField(uint32_t field, uint32_t value) {
+    // Compare-style results: LT/GT/EQ from value, SO copied from XER
+    if (regs_.xer & XER_SO) value |= 0x1;
+    uint32_t shift = 28 - field * 4;
+    regs_.cr = (regs_.cr & ~(0xFU << shift)) | ((value & 0xF) << shift);
+}
+
+void PPUInterpreter::setCA(bool carry) {
+    regs_.xer = carry ? (regs_.xer | XER_CA) : (regs_.xer & ~XER_CA);
+}
+
+void PPUInterpreter::setOV(bool overflow) {
+    // SO is sticky: set together with OV, cleared only by mtspr XER
+    regs_.xer = overflow ? (regs_.xer | XER_OV | XER_SO) : (regs_.xer & ~XER_OV);
+}
+
+uint32_t PPUInterpreter::executeInstruction() {
+    if (halted_ || !memory_) return 0;
     
     uint32_t instr = memory_->read32(regs_.pc);
     regs_.pc += 4;
     
     decodeAndExecute(instr);
+    cycles_++;
+    return instr;
 }
 
 void PPUInterpreter::executeBlock(int maxInstructions) {
-    for (int i = 0; i < maxInstructions && !halted_; ++i) {
-        executeInstruction();
+    // Offer every guest basic block entry to the JIT: it counts the entry,
+    // promotes hot blocks through the tiers and runs compiled code if the
+    // block has any. Everything else is interpreted here.
+    int executed = 0;
+    bool blockEntry = true;
+    while (executed < maxInstructions && !halted_) {
+        if (jit_ && blockEntry) {
+            uint32_t retired = jit_->executeBlock(regs_.pc, maxInstructions - executed);
+            if (retired > 0) {
+                executed += retired;
+                cycles_ += retired;
+                continue;
+            }
+        }
+        
+        uint32_t instr = executeInstruction();
+        ++executed;
+        
+        // Branches and syscalls end a block
+        uint32_t opcode = getBits(instr, 0, 5);
+        blockEntry = (opcode == 16 || opcode == 17 || opcode == 18 || opcode == 19);
     }
 }
 
+void PPUInterpreter::runUntil(uint64_t targetCycles) {
+    while (cycles_ < targetCycles && !halted_) {
+        uint64_t remaining = targetCycles - cycles_;
+        executeBlock(static_cast<int>(std::min<uint64_t>(remaining, 1000000)));
+    }
+    // A stopped core does not hold back guest time
+    if (cycles_ < targetCycles) {
+        cycles_ = targetCycles;
+    }
+}
+
+uint64_t PPUInterpreter::readTimeBaseSPR(uint32_t tbr) const {
+    uint64_t tb = getTimebase();
+    return tbr == 269 ? (tb >> 32) : tb;
+}
+
 void PPUInterpreter::decodeAndExecute(uint32_t instr) {
     uint32_t opcode = getBits(instr, 0, 5);
     
     // Decode primary opcode
     switch (opcode) {
+        case 2:  // tdi (trap doubleword immediate)
         case 3:  // twi (trap word immediate)
             break;
             
@@ -94,17 +165,6 @@ void PPUInterpreter::decodeAndExecute(uint32_t instr) {
             executeVector(instr);
             break;
             
-        case 6:  // subfic (subtract from immediate with carry)
-            {
-                uint32_t rD = getBits(instr, 6, 10);
-                uint32_t rA = getBits(instr, 11, 15);
-                int32_t simm = (int16_t)getBits(instr, 16, 31);
-                uint64_t result = simm - regs_.gpr[rA];
-                regs_.gpr[rD] = result;
-                regs_.xer = (regs_.xer & ~1) | ((simm >= regs_.gpr[rA]) ? 1 : 0);
-            }
-            break;
-            
         case 7:  // mulli
         case 8:  // subfic
         case 10: // cmpli
@@ -119,60 +179,21 @@ void PPUInterpreter::decodeAndExecute(uint32_t instr) {
             
         case 16: // bc (branch conditional)
         case 18: // b (branch)
-        case 19: // bclr, bcctr
+        case 19: // bclr, bcctr, condition register logical
             executeBranch(instr);
             break;
             
-        case 20: // rlwimi (rotate left word immediate then mask insert)
-            {
-                uint32_t rS = getBits(instr, 6, 10);
-                uint32_t rA = getBits(instr, 11, 15);
-                uint32_t sh = getBits(instr, 16, 20);
-                uint32_t mb = getBits(instr, 21, 25);
-                uint32_t me = getBits(instr, 26, 31);
-                uint32_t rotated = ((regs_.gpr[rS] << sh) | (regs_.gpr[rS] >> (32-sh))) & 0xFFFFFFFF;
-                uint32_t mask = 0;
-                for (int i = mb; i <= me; ++i) mask |= (1U << (31-i));
-                regs_.gpr[rA] = (regs_.gpr[rA] & ~mask) | (rotated & mask);
-            }
-            break;
-            
-        case 21: // rlwinm (rotate left word immediate then AND with mask)
-            {
-                uint32_t rS = getBits(instr, 6, 10);
-                uint32_t rA = getBits(instr, 11, 15);
-                uint32_t sh = getBits(instr, 16, 20);
-                uint32_t mb = getBits(instr, 21, 25);
-                uint32_t me = getBits(instr, 26, 31);
-                uint32_t rotated = ((regs_.gpr[rS] << sh) | (regs_.gpr[rS] >> (32-sh))) & 0xFFFFFFFF;
-                uint32_t mask = 0;
-                for (int i = mb; i <= me; ++i) mask |= (1U << (31-i));
-                regs_.gpr[rA] = rotated & mask;
-            }
-            break;
-            
-        case 22: // rlwnm (rotate left word then AND with mask)
-            {
-                uint32_t rS = getBits(instr, 6, 10);
-                uint32_t rA = getBits(instr, 11, 15);
-                uint32_t rB = getBits(instr, 16, 20);
-                uint32_t sh = regs_.gpr[rB] & 0x1F;
-                uint32_t mb = getBits(instr, 21, 25);
-                uint32_t me = getBits(instr, 26, 31);
-                uint32_t rotated = ((regs_.gpr[rS] << sh) | (regs_.gpr[rS] >> (32-sh))) & 0xFFFFFFFF;
-                uint32_t mask = 0;
-                for (int i = mb; i <= me; ++i) mask |= (1U << (31-i));
-                regs_.gpr[rA] = rotated & mask;
-            }
-            break;
-            
+        case 20: // rlwimi
+        case 21: // rlwinm
+        case 23: // rlwnm
         case 24: // ori
         case 25: // oris
         case 26: // xori
         case 27: // xoris
         case 28: // andi.
         case 29: // andis.
-            executeArithmetic(instr);
+        case 30: // rldicl, rldicr, rldic, rldimi, rldcl, rldcr
+            executeLogical(instr);
             break;
             
         case 32: // lwz
@@ -189,6 +210,8 @@ void PPUInterpreter::decodeAndExecute(uint32_t instr) {
         case 43: // lhau
         case 44: // sth
         case 45: // sthu
+        case 46: // lmw
+        case 47: // stmw
         case 58: // ld, ldu, lwa
         case 62: // std, stdu
             executeLoadStore(instr);
@@ -218,100 +241,278 @@ void PPUInterpreter::executeArithmetic(uint32_t instr) {
     uint32_t rB = getBits(instr, 16, 20);
     int32_t simm = (int16_t)getBits(instr, 16, 31);
     uint32_t uimm = getBits(instr, 16, 31);
+    bool rc = getBits(instr, 31, 31);
     
     switch (opcode) {
-        case 14: // addi
-            regs_.gpr[rD] = (rA == 0 ? 0 : regs_.gpr[rA]) + simm;
+        case 7: // mulli
+            regs_.gpr[rD] = (int64_t)regs_.gpr[rA] * simm;
             break;
             
-        case 15: // addis
-            regs_.gpr[rD] = (rA == 0 ? 0 : regs_.gpr[rA]) + (simm << 16);
+        case 8: { // subfic
+            PPUCarryResult r = addWithCarry(~regs_.gpr[rA], (int64_t)simm, 1);
+            regs_.gpr[rD] = r.value;
+            setCA(r.carry);
             break;
+        }
             
-        case 24: // ori
-            regs_.gpr[rA] = regs_.gpr[rD] | uimm;
+        case 10: { // cmpli
+            uint32_t bf = getBits(instr, 6, 8);
+            bool l = getBits(instr, 10, 10);
+            uint64_t a = l ? regs_.gpr[rA] : (uint32_t)regs_.gpr[rA];
+            setCRField(bf, a < uimm ? 0x8 : a > uimm ? 0x4 : 0x2);
             break;
+        }
             
-        case 28: // andi.
-            regs_.gpr[rA] = regs_.gpr[rD] & uimm;
-            updateCR0(regs_.gpr[rA]);
+        case 11: { // cmpi
+            uint32_t bf = getBits(instr, 6, 8);
+            bool l = getBits(instr, 10, 10);
+            int64_t a = l ? (int64_t)regs_.gpr[rA] : (int32_t)regs_.gpr[rA];
+            setCRField(bf, a < simm ? 0x8 : a > simm ? 0x4 : 0x2);
+            break;
+        }
+            
+        case 12: // addic
+        case 13: { // addic.
+            PPUCarryResult r = addWithCarry(regs_.gpr[rA], (int64_t)simm, 0);
+            regs_.gpr[rD] = r.value;
+            setCA(r.carry);
+            if (opcode == 13) updateCR0(r.value);
+            break;
+        }
+            
+        case 14: // addi
+            regs_.gpr[rD] = (rA == 0 ? 0 : regs_.gpr[rA]) + simm;
+            break;
+            
+        case 15: // addis
+            regs_.gpr[rD] = (rA == 0 ? 0 : regs_.gpr[rA]) + ((int64_t)simm << 16);
             break;
             
         case 31: { // Extended
             uint32_t xop = getBits(instr, 21, 30);
+            uint64_t a = regs_.gpr[rA];
+            uint64_t b = regs_.gpr[rB];
+            uint64_t s = regs_.gpr[rD];
+            
+            // XO-form: 9-bit extended opcode, bit 21 is OE
+            bool oe = getBits(instr, 21, 21);
+            bool handled = true;
+            uint64_t result = 0;
+            bool overflow = false;
+            switch (xop & 0x1FF) {
+                case 8: { // subfc
+                    PPUCarryResult r = addWithCarry(~a, b, 1);
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 9: // mulhdu
+                    result = (uint64_t)(((unsigned __int128)a * b) >> 64);
+                    break;
+                case 10: { // addc
+                    PPUCarryResult r = addWithCarry(a, b, 0);
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 11: // mulhwu
+                    result = ((uint64_t)(uint32_t)a * (uint32_t)b) >> 32;
+                    break;
+                case 40: { // subf
+                    PPUCarryResult r = addWithCarry(~a, b, 1);
+                    result = r.value; overflow = r.overflow;
+                    break;
+                }
+                case 73: // mulhd
+                    result = (uint64_t)(((__int128)(int64_t)a * (int64_t)b) >> 64);
+                    break;
+                case 75: // mulhw
+                    result = (uint64_t)(((int64_t)(int32_t)a * (int32_t)b) >> 32);
+                    break;
+                case 104: { // neg
+                    PPUCarryResult r = addWithCarry(~a, 0, 1);
+                    result = r.value; overflow = r.overflow;
+                    break;
+                }
+                case 136: { // subfe
+                    PPUCarryResult r = addWithCarry(~a, b, getCA());
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 138: { // adde
+                    PPUCarryResult r = addWithCarry(a, b, getCA());
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 200: { // subfze
+                    PPUCarryResult r = addWithCarry(~a, 0, getCA());
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 202: { // addze
+                    PPUCarryResult r = addWithCarry(a, 0, getCA());
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 232: { // subfme
+                    PPUCarryResult r = addWithCarry(~a, ~0ULL, getCA());
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 233: { // mulld
+                    __int128 product = (__int128)(int64_t)a * (int64_t)b;
+                    result = (uint64_t)product;
+                    overflow = product != (int64_t)result;
+                    break;
+                }
+                case 234: { // addme
+                    PPUCarryResult r = addWithCarry(a, ~0ULL, getCA());
+                    result = r.value; overflow = r.overflow;
+                    setCA(r.carry);
+                    break;
+                }
+                case 235: { // mullw
+                    int64_t product = (int64_t)(int32_t)a * (int32_t)b;
+                    result = product;
+                    overflow = product != (int32_t)product;
+                    break;
+                }
+                case 266: { // add
+                    PPUCarryResult r = addWithCarry(a, b, 0);
+                    result = r.value; overflow = r.overflow;
+                    break;
+                }
+                // Division results the architecture leaves undefined
+                // (divide by zero, most negative / -1) are 0 here.
+                case 457: // divdu
+                    overflow = b == 0;
+                    result = overflow ? 0 : a / b;
+                    break;
+                case 459: // divwu
+                    overflow = (uint32_t)b == 0;
+                    result = overflow ? 0 : (uint32_t)a / (uint32_t)b;
+                    break;
+                case 489: // divd
+                    overflow = b == 0 || ((int64_t)a == INT64_MIN && (int64_t)b == -1);
+                    result = overflow ? 0 : (uint64_t)((int64_t)a / (int64_t)b);
+                    break;
+                case 491: // divw
+                    overflow = (int32_t)b == 0 || ((int32_t)a == INT32_MIN && (int32_t)b == -1);
+                    result = overflow ? 0 : (uint32_t)((int32_t)a / (int32_t)b);
+                    break;
+                default:
+                    handled = false;
+                    break;
+            }
+            if (handled) {
+                regs_.gpr[rD] = result;
+                if (oe) setOV(overflow);
+                if (rc) updateCR0(result);
+                break;
+            }
+            
+            // X-form: rA is the destination, rD the source (rS)
             switch (xop) {
                 case 0:   // cmp
-                    {
-                        int64_t a = regs_.gpr[rA];
-                        int64_t b = regs_.gpr[rB];
-                        uint32_t cr = 0;
-                        if (a < b) cr = 8;
-                        else if (a > b) cr = 4;
-                        else cr = 2;
-                        int bf = getBits(instr, 6, 8);
-                        regs_.cr = (regs_.cr & ~(0xF << (28 - bf*4))) | (cr << (28 - bf*4));
+                case 32: { // cmpl
+                    uint32_t bf = getBits(instr, 6, 8);
+                    bool l = getBits(instr, 10, 10);
+                    uint32_t field;
+                    if (xop == 0) {
+                        int64_t x = l ? (int64_t)a : (int32_t)a;
+                        int64_t y = l ? (int64_t)b : (int32_t)b;
+                        field = x < y ? 0x8 : x > y ? 0x4 : 0x2;
+                    } else {
+                        uint64_t x = l ? a : (uint32_t)a;
+                        uint64_t y = l ? b : (uint32_t)b;
+                        field = x < y ? 0x8 : x > y ? 0x4 : 0x2;
                     }
+                    setCRField(bf, field);
+                    break;
+                }
+                    
+                case 4:   // tw
+                case 68:  // td
                     break;
                     
-                case 8:   // subfc (subtract from with carry)
-                    {
-                        uint64_t result = regs_.gpr[rB] - regs_.gpr[rA];
-                        regs_.gpr[rD] = result;
-                        regs_.xer = (regs_.xer & ~1) | ((regs_.gpr[rB] >= regs_.gpr[rA]) ? 1 : 0);
+                case 19:  // mfcr, mfocrf
+                    regs_.gpr[rD] = regs_.cr;
+                    break;
+                    
+                case 144: { // mtcrf, mtocrf
+                    uint32_t fxm = getBits(instr, 12, 19);
+                    uint32_t mask = 0;
+                    for (int i = 0; i < 8; ++i) {
+                        if (fxm & (0x80 >> i)) mask |= 0xF0000000u >> (i * 4);
                     }
+                    regs_.cr = (regs_.cr & ~mask) | ((uint32_t)s & mask);
                     break;
+                }
                     
-                case 10:  // addc (add with carry)
+                case 24:  // slw
                     {
-                        uint64_t a = regs_.gpr[rA];
-                        uint64_t b = regs_.gpr[rB];
-                        uint64_t result = a + b;
-                        regs_.gpr[rD] = result;
-                        regs_.xer = (regs_.xer & ~1) | ((result < a) ? 1 : 0);
+                        uint32_t sh = b & 0x3F;
+                        regs_.gpr[rA] = sh > 31 ? 0 : (uint32_t)((uint32_t)s << sh);
+                        if (rc) updateCR0(regs_.gpr[rA]);
                     }
                     break;
                     
-                case 11:  // mulhwu (multiply high word unsigned)
+                case 26:  // cntlzw
+                    regs_.gpr[rA] = (uint32_t)s ? __builtin_clz((uint32_t)s) : 32;
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                    
+                case 27:  // sld
                     {
-                        uint64_t a = regs_.gpr[rA] & 0xFFFFFFFF;
-                        uint64_t b = regs_.gpr[rB] & 0xFFFFFFFF;
-                        uint64_t result = (a * b) >> 32;
-                        regs_.gpr[rD] = result & 0xFFFFFFFF;
+                        uint32_t sh = b & 0x7F;
+                        regs_.gpr[rA] = sh > 63 ? 0 : s << sh;
+                        if (rc) updateCR0(regs_.gpr[rA]);
                     }
                     break;
                     
                 case 28:  // and
-                    regs_.gpr[rA] = regs_.gpr[rD] & regs_.gpr[rB];
-                    break;
-                    
-                case 40:  // subf
-                    regs_.gpr[rD] = regs_.gpr[rB] - regs_.gpr[rA];
-                    if (getBits(instr, 31, 31)) updateCR0(regs_.gpr[rD]);
+                    regs_.gpr[rA] = s & b;
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
-                case 104: // nand
-                    regs_.gpr[rA] = ~(regs_.gpr[rD] & regs_.gpr[rB]);
+                case 58:  // cntlzd
+                    regs_.gpr[rA] = s ? __builtin_clzll(s) : 64;
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
-                case 107: // nor
-                    regs_.gpr[rA] = ~(regs_.gpr[rD] | regs_.gpr[rB]);
+                case 60:  // andc
+                    regs_.gpr[rA] = s & ~b;
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
-                case 124: // nor (alt)
-                    regs_.gpr[rA] = ~(regs_.gpr[rD] | regs_.gpr[rB]);
+                case 122: // popcntb
+                    {
+                        uint64_t result = 0;
+                        for (int i = 0; i < 8; ++i) {
+                            result |= (uint64_t)__builtin_popcount((s >> (i * 8)) & 0xFF) << (i * 8);
+                        }
+                        regs_.gpr[rA] = result;
+                    }
                     break;
                     
-                case 266: // add
-                    regs_.gpr[rD] = regs_.gpr[rA] + regs_.gpr[rB];
-                    if (getBits(instr, 31, 31)) updateCR0(regs_.gpr[rD]);
+                case 124: // nor
+                    regs_.gpr[rA] = ~(s | b);
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
                 case 284: // eqv (equivalent)
-                    regs_.gpr[rA] = ~(regs_.gpr[rD] ^ regs_.gpr[rB]);
+                    regs_.gpr[rA] = ~(s ^ b);
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
                 case 316: // xor
-                    regs_.gpr[rA] = regs_.gpr[rD] ^ regs_.gpr[rB];
+                    regs_.gpr[rA] = s ^ b;
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
                 case 339: // mfspr (move from special purpose register)
@@ -321,57 +522,119 @@ void PPUInterpreter::executeArithmetic(uint32_t instr) {
                             case 1: regs_.gpr[rD] = regs_.xer; break;
                             case 8: regs_.gpr[rD] = regs_.lr; break;
                             case 9: regs_.gpr[rD] = regs_.ctr; break;
+                            case 268: case 269: regs_.gpr[rD] = readTimeBaseSPR(spr); break;
                             default: regs_.gpr[rD] = 0; break;
                         }
                     }
                     break;
                     
-                case 371: // mtspr (move to special purpose register)
+                case 371: // mftb (TBR 268 is TB, 269 TBU)
                     {
-                        uint32_t spr = (getBits(instr, 16, 20) << 5) | getBits(instr, 11, 15);
-                        switch (spr) {
-                            case 1: regs_.xer = regs_.gpr[rD]; break;
-                            case 8: regs_.lr = regs_.gpr[rD]; break;
-                            case 9: regs_.ctr = regs_.gpr[rD]; break;
-                        }
+                        uint32_t tbr = (getBits(instr, 16, 20) << 5) | getBits(instr, 11, 15);
+                        regs_.gpr[rD] = readTimeBaseSPR(tbr);
                     }
                     break;
                     
-                case 413: // mflr (move from link register)
-                    regs_.gpr[rD] = regs_.lr;
+                case 412: // orc
+                    regs_.gpr[rA] = s | ~b;
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
-                case 444: // or
-                    regs_.gpr[rA] = regs_.gpr[rD] | regs_.gpr[rB];
+                case 444: // or (or r0,r0,r0 is the nop)
+                    regs_.gpr[rA] = s | b;
+                    if (rc) updateCR0(regs_.gpr[rA]);
                     break;
                     
-                case 476: // nop (or r0,r0,r0)
+                case 467: // mtspr (move to special purpose register)
+                    {
+                        uint32_t spr = (getBits(instr, 16, 20) << 5) | getBits(instr, 11, 15);
+                        switch (spr) {
+                            case 1: regs_.xer = (uint32_t)s; break;
+                            case 8: regs_.lr = s; break;
+                            case 9: regs_.ctr = s; break;
+                        }
+                    }
                     break;
                     
-                case 535: // srw (shift right word)
+                case 476: // nand
+                    regs_.gpr[rA] = ~(s & b);
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                    
+                case 536: // srw (shift right word)
                     {
-                        uint32_t sh = regs_.gpr[rB] & 0x1F;
-                        regs_.gpr[rA] = (regs_.gpr[rD] >> sh) & 0xFFFFFFFF;
+                        uint32_t sh = b & 0x3F;
+                        regs_.gpr[rA] = sh > 31 ? 0 : (uint32_t)s >> sh;
+                        if (rc) updateCR0(regs_.gpr[rA]);
                     }
                     break;
                     
-                case 539: // sraw (shift right arithmetic word)
+                case 539: // srd
                     {
-                        uint32_t sh = regs_.gpr[rB] & 0x1F;
-                        int32_t val = (int32_t)regs_.gpr[rD];
-                        regs_.gpr[rA] = (uint64_t)((uint32_t)(val >> sh));
+                        uint32_t sh = b & 0x7F;
+                        regs_.gpr[rA] = sh > 63 ? 0 : s >> sh;
+                        if (rc) updateCR0(regs_.gpr[rA]);
                     }
                     break;
                     
-                case 824: // slw (shift left word)
-                    {
-                        uint32_t sh = regs_.gpr[rB] & 0x1F;
-                        regs_.gpr[rA] = (regs_.gpr[rD] << sh) & 0xFFFFFFFF;
+                case 792: // sraw (shift right algebraic word)
+                case 824: { // srawi
+                    uint32_t sh = xop == 824 ? rB : (b & 0x3F);
+                    int32_t val = (int32_t)s;
+                    if (sh > 31) {
+                        regs_.gpr[rA] = val < 0 ? ~0ULL : 0;
+                        setCA(val < 0);
+                    } else {
+                        regs_.gpr[rA] = (int64_t)(val >> sh);
+                        setCA(val < 0 && ((uint32_t)val & ((1U << sh) - 1)) != 0);
                     }
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                }
+                    
+                case 794: // srad
+                case 826: // sradi (sh bit 5 clear)
+                case 827: { // sradi (sh bit 5 set)
+                    uint32_t sh = xop == 794 ? (b & 0x7F) : (rB | (getBits(instr, 30, 30) << 5));
+                    int64_t val = (int64_t)s;
+                    if (sh > 63) {
+                        regs_.gpr[rA] = val < 0 ? ~0ULL : 0;
+                        setCA(val < 0);
+                    } else {
+                        regs_.gpr[rA] = (uint64_t)(val >> sh);
+                        setCA(val < 0 && ((uint64_t)val & ((1ULL << sh) - 1)) != 0);
+                    }
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                }
+                    
+                case 922: // extsh
+                    regs_.gpr[rA] = (int64_t)(int16_t)s;
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                    
+                case 954: // extsb
+                    regs_.gpr[rA] = (int64_t)(int8_t)s;
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                    
+                case 986: // extsw
+                    regs_.gpr[rA] = (int64_t)(int32_t)s;
+                    if (rc) updateCR0(regs_.gpr[rA]);
+                    break;
+                    
+                case 54:  // dcbst
+                case 86:  // dcbf
+                case 246: // dcbtst
+                case 278: // dcbt
+                case 598: // sync
+                case 854: // eieio
+                case 982: // icbi
                     break;
                     
                 default:
-                    // Stub for unimplemented xops
+                    // Indexed loads and stores
+                    executeLoadStore(instr);
                     break;
             }
             break;
@@ -384,13 +647,105 @@ void PPUInterpreter::executeArithmetic(uint32_t instr) {
 }
 
 void PPUInterpreter::executeLogical(uint32_t instr) {
-    // Handled in executeArithmetic for now
+    uint32_t opcode = getBits(instr, 0, 5);
+    uint32_t rS = getBits(instr, 6, 10);
+    uint32_t rA = getBits(instr, 11, 15);
+    uint32_t rB = getBits(instr, 16, 20);
+    uint64_t uimm = getBits(instr, 16, 31);
+    bool rc = getBits(instr, 31, 31);
+    uint64_t s = regs_.gpr[rS];
+    
+    switch (opcode) {
+        case 20: // rlwimi (rotate left word immediate then mask insert)
+        case 21: // rlwinm (rotate left word immediate then AND with mask)
+        case 23: { // rlwnm (rotate left word then AND with mask)
+            uint32_t sh = opcode == 23 ? (regs_.gpr[rB] & 0x1F) : rB;
+            uint32_t mb = getBits(instr, 21, 25);
+            uint32_t me = getBits(instr, 26, 30);
+            uint64_t rotated = rotateWord(s, sh);
+            uint64_t mask = rotateMask(mb + 32, me + 32);
+            if (opcode == 20) {
+                regs_.gpr[rA] = (rotated & mask) | (regs_.gpr[rA] & ~mask);
+            } else {
+                regs_.gpr[rA] = rotated & mask;
+            }
+            if (rc) updateCR0(regs_.gpr[rA]);
+            break;
+        }
+            
+        case 24: // ori
+            regs_.gpr[rA] = s | uimm;
+            break;
+            
+        case 25: // oris
+            regs_.gpr[rA] = s | (uimm << 16);
+            break;
+            
+        case 26: // xori
+            regs_.gpr[rA] = s ^ uimm;
+            break;
+            
+        case 27: // xoris
+            regs_.gpr[rA] = s ^ (uimm << 16);
+            break;
+            
+        case 28: // andi.
+            regs_.gpr[rA] = s & uimm;
+            updateCR0(regs_.gpr[rA]);
+            break;
+            
+        case 29: // andis.
+            regs_.gpr[rA] = s & (uimm << 16);
+            updateCR0(regs_.gpr[rA]);
+            break;
+            
+        case 30: { // 64-bit rotates (MD/MDS-form)
+            // mb/me is a 6-bit field stored as mb[0:4] || mb[5]
+            uint32_t field = getBits(instr, 21, 26);
+            uint32_t mb = (field >> 1) | ((field & 1) << 5);
+            uint32_t sh = rB | (getBits(instr, 30, 30) << 5);
+            uint32_t xop = getBits(instr, 27, 29);
+            if (xop == 4) { // MDS-form: shift amount from rB
+                xop = 4 | getBits(instr, 30, 30);
+                sh = regs_.gpr[rB] & 0x3F;
+            }
+            uint64_t rotated = rotateLeft64(s, sh);
+            switch (xop) {
+                case 0: // rldicl
+                case 4: // rldcl
+                    regs_.gpr[rA] = rotated & rotateMask(mb, 63);
+                    break;
+                case 1: // rldicr
+                case 5: // rldcr
+                    regs_.gpr[rA] = rotated & rotateMask(0, mb);
+                    break;
+                case 2: // rldic
+                    regs_.gpr[rA] = rotated & rotateMask(mb, 63 - sh);
+                    break;
+                case 3: { // rldimi
+                    uint64_t mask = rotateMask(mb, 63 - sh);
+                    regs_.gpr[rA] = (rotated & mask) | (regs_.gpr[rA] & ~mask);
+                    break;
+                }
+                default:
+                    std::cerr << "Unimplemented rotate: xop=" << xop << std::endl;
+                    return;
+            }
+            if (rc) updateCR0(regs_.gpr[rA]);
+            break;
+        }
+            
+        default:
+            std::cerr << "Unimplemented logical opcode: " << opcode << std::endl;
+            break;
+    }
 }
 
 void PPUInterpreter::executeLoadStore(uint32_t instr) {
     uint32_t opcode = getBits(instr, 0, 5);
     uint32_t rD = getBits(instr, 6, 10);
     uint32_t rA = getBits(instr, 11, 15);
+    uint32_t rB = getBits(instr, 16, 20);
     int32_t d = (int16_t)getBits(instr, 16, 31);
     
     uint64_t ea = (rA == 0 ? 0 : regs_.gpr[rA]) + d;
@@ -465,23 +820,37 @@ void PPUInterpreter::executeLoadStore(uint32_t instr) {
             regs_.gpr[rA] = ea;
             break;
             
-        case 58: { // ld
-            uint32_t ds = getBits(instr, 16, 29);
+        case 46: // lmw (load multiple word)
+            for (uint32_t r = rD; r < 32; ++r, ea += 4) {
+                regs_.gpr[r] = memory_->read32(ea);
+            }
+            break;
+            
+        case 47: // stmw (store multiple word)
+            for (uint32_t r = rD; r < 32; ++r, ea += 4) {
+                memory_->write32(ea, regs_.gpr[r]);
+            }
+            break;
+            
+        case 58: { // ld, ldu, lwa
+            int32_t ds = (int16_t)(instr & 0xFFFC);  // DS||0b00, sign-extended
             uint32_t xop = getBits(instr, 30, 31);
-            ea = (rA == 0 ? 0 : regs_.gpr[rA]) + (ds << 2);
+            ea = (rA == 0 ? 0 : regs_.gpr[rA]) + ds;
             if (xop == 0) { // ld
                 regs_.gpr[rD] = memory_->read64(ea);
             } else if (xop == 1) { // ldu
                 regs_.gpr[rD] = memory_->read64(ea);
                 regs_.gpr[rA] = ea;
+            } else if (xop == 2) { // lwa
+                regs_.gpr[rD] = (int64_t)(int32_t)memory_->read32(ea);
             }
             break;
         }
             
         case 62: { // std
-            uint32_t ds = getBits(instr, 16, 29);
+            int32_t ds = (int16_t)(instr & 0xFFFC);
             uint32_t xop = getBits(instr, 30, 31);
-            ea = (rA == 0 ? 0 : regs_.gpr[rA]) + (ds << 2);
+            ea = (rA == 0 ? 0 : regs_.gpr[rA]) + ds;
             if (xop == 0) { // std
                 memory_->write64(ea, regs_.gpr[rD]);
             } else if (xop == 1) { // stdu
@@ -491,6 +860,80 @@ void PPUInterpreter::executeLoadStore(uint32_t instr) {
             break;
         }
             
+        case 31: { // X-form: EA = (rA|0) + rB
+            uint32_t xop = getBits(instr, 21, 30);
+            ea = (rA == 0 ? 0 : regs_.gpr[rA]) + regs_.gpr[rB];
+            uint64_t s = regs_.gpr[rD];
+            switch (xop) {
+                case 20:  // lwarx
+                    regs_.gpr[rD] = memory_->read32(ea);
+                    reserveAddr_ = ea;
+                    reserved_ = true;
+                    break;
+                case 84:  // ldarx
+                    regs_.gpr[rD] = memory_->read64(ea);
+                    reserveAddr_ = ea;
+                    reserved_ = true;
+                    break;
+                case 150: // stwcx.
+                case 214: { // stdcx.
+                    // A single PPU thread never loses its reservation to
+                    // another processor; only a mismatched address fails.
+                    bool success = reserved_ && reserveAddr_ == ea;
+                    if (success) {
+                        if (xop == 150) memory_->write32(ea, s);
+                        else memory_->write64(ea, s);
+                    }
+                    reserved_ = false;
+                    setCRField(0, success ? 0x2 : 0);
+                    break;
+                }
+                case 21:  regs_.gpr[rD] = memory_->read64(ea); break;                       // ldx
+                case 23:  regs_.gpr[rD] = memory_->read32(ea); break;                       // lwzx
+                case 87:  regs_.gpr[rD] = memory_->read8(ea); break;                        // lbzx
+                case 279: regs_.gpr[rD] = memory_->read16(ea); break;                       // lhzx
+                case 341: regs_.gpr[rD] = (int64_t)(int32_t)memory_->read32(ea); break;     // lwax
+                case 343: regs_.gpr[rD] = (int64_t)(int16_t)memory_->read16(ea); break;     // lhax
+                case 53:  regs_.gpr[rD] = memory_->read64(ea); regs_.gpr[rA] = ea; break;   // ldux
+                case 55:  regs_.gpr[rD] = memory_->read32(ea); regs_.gpr[rA] = ea; break;   // lwzux
+                case 119: regs_.gpr[rD] = memory_->read8(ea); regs_.gpr[rA] = ea; break;    // lbzux
+                case 311: regs_.gpr[rD] = memory_->read16(ea); regs_.gpr[rA] = ea; break;   // lhzux
+                case 373: // lwaux
+                    regs_.gpr[rD] = (int64_t)(int32_t)memory_->read32(ea);
+                    regs_.gpr[rA] = ea;
+                    break;
+                case 375: // lhaux
+                    regs_.gpr[rD] = (int64_t)(int16_t)memory_->read16(ea);
+                    regs_.gpr[rA] = ea;
+                    break;
+                case 532: regs_.gpr[rD] = __builtin_bswap64(memory_->read64(ea)); break;    // ldbrx
+                case 534: regs_.gpr[rD] = __builtin_bswap32(memory_->read32(ea)); break;    // lwbrx
+                case 790: regs_.gpr[rD] = __builtin_bswap16(memory_->read16(ea)); break;    // lhbrx
+                case 149: memory_->write64(ea, s); break;                                   // stdx
+                case 151: memory_->write32(ea, s); break;                                   // stwx
+                case 215: memory_->write8(ea, s & 0xFF); break;                             // stbx
+                case 407: memory_->write16(ea, s & 0xFFFF); break;                          // sthx
+                case 181: memory_->write64(ea, s); regs_.gpr[rA] = ea; break;               // stdux
+                case 183: memory_->write32(ea, s); regs_.gpr[rA] = ea; break;               // stwux
+                case 247: memory_->write8(ea, s & 0xFF); regs_.gpr[rA] = ea; break;         // stbux
+                case 439: memory_->write16(ea, s & 0xFFFF); regs_.gpr[rA] = ea; break;      // sthux
+                case 660: memory_->write64(ea, __builtin_bswap64(s)); break;                // stdbrx
+                case 662: memory_->write32(ea, __builtin_bswap32((uint32_t)s)); break;      // stwbrx
+                case 918: memory_->write16(ea, __builtin_bswap16((uint16_t)s)); break;      // sthbrx
+                case 1014: { // dcbz (128-byte cache line)
+                    uint64_t line = ea & ~127ULL;
+                    for (uint64_t i = 0; i < 128; i += 8) {
+                        memory_->write64(line + i, 0);
+                    }
+                    break;
+                }
+                default:
+                    std::cerr << "Unimplemented extended opcode: xop=" << xop << std::endl;
+                    break;
+            }
+            break;
+        }
+            
         default:
             std::cerr << "Unimplemented load/store opcode: " << opcode << std::endl;
             break;
@@ -545,6 +988,30 @@ void PPUInterpreter::executeBranch(uint32_t instr) {
                     if (lk) regs_.lr = regs_.pc;
                     regs_.pc = target;
                 }
+            } else if (xop == 0) { // mcrf
+                uint32_t bf = getBits(instr, 6, 8);
+                uint32_t bfa = getBits(instr, 11, 13);
+                uint32_t field = (regs_.cr >> (28 - bfa * 4)) & 0xF;
+                regs_.cr = (regs_.cr & ~(0xFU << (28 - bf * 4))) | (field << (28 - bf * 4));
+            } else if (xop != 150) { // condition register logical (isync is a no-op)
+                uint32_t bt = getBits(instr, 6, 10);
+                uint32_t ba = (regs_.cr >> (31 - bi)) & 1;
+                uint32_t bb = (regs_.cr >> (31 - getBits(instr, 16, 20))) & 1;
+                uint32_t bit;
+                switch (xop) {
+                    case 33:  bit = !(ba | bb); break;  // crnor
+                    case 129: bit = ba & !bb; break;    // crandc
+                    case 193: bit = ba ^ bb; break;     // crxor
+                    case 225: bit = !(ba & bb); break;  // crnand
+                    case 257: bit = ba & bb; break;     // crand
+                    case 289: bit = !(ba ^ bb); break;  // creqv
+                    case 417: bit = ba | !bb; break;    // crorc
+                    case 449: bit = ba | bb; break;     // cror
+                    default:
+                        std::cerr << "Unimplemented opcode 19: xop=" << xop << std::endl;
+                        return;
+                }
+                regs_.cr = (regs_.cr & ~(1U << (31 - bt))) | (bit << (31 - bt));
             }
             break;
         }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "core/Timebase.h"
 #include <cstdint>
 #include <array>
 #include <memory>
@@ -49,6 +50,37 @@ struct PPURegisters {
     }
 };
 
+// XER bits (32-bit register, IBM bit 32 is the MSB here)
+constexpr uint32_t XER_SO = 0x80000000;  // summary overflow
+constexpr uint32_t XER_OV = 0x40000000;  // overflow
+constexpr uint32_t XER_CA = 0x20000000;  // carry
+
+// a + b + carryIn with the carry out of bit 0 and signed overflow, the
+// shared core of the add/subtract-from family (subtracts pass ~a)
+struct PPUCarryResult {
+    uint64_t value;
+    bool carry;
+    bool overflow;
+};
+PPUCarryResult addWithCarry(uint64_t a, uint64_t b, uint64_t carryIn);
+
+// 64-bit rotate mask with ones from bit mb to bit me (IBM numbering),
+// wrapping around when mb > me
+uint64_t rotateMask(uint32_t mb, uint32_t me);
+
+inline uint64_t rotateLeft64(uint64_t value, uint32_t n) {
+    n &= 63;
+    return n ? (value << n) | (value >> (64 - n)) : value;
+}
+
+// rlw* rotate: the low word rotated and replicated into both halves
+inline uint64_t rotateWord(uint64_t value, uint32_t n) {
+    uint32_t word = static_cast<uint32_t>(value);
+    n &= 31;
+    word = n ? (word << n) | (word >> (32 - n)) : word;
+    return (static_cast<uint64_t>(word) << 32) | word;
+}
+
 // PPU Interpreter (simplified)
 class PPUInterpreter {
 private:
@@ -56,6 +88,9 @@ private:
     MemoryManager* memory_;
     SyscallHandler* syscalls_;
     bool halted_;
+    uint64_t reserveAddr_;  // lwarx/ldarx reservation
+    bool reserved_;
+    uint64_t cycles_;  // guest cycles executed, one per instruction
     std::unique_ptr<PPUJIT> jit_;  // JIT compiler for 60 FPS
     
 public:
@@ -73,12 +108,21 @@ public:
     uint64_t getPC() const { return regs_.pc; }
     
     // Execute instructions (with JIT acceleration)
-    void executeInstruction();
+    // executeInstruction returns the instruction word it executed.
+    uint32_t executeInstruction();
     void executeBlock(int maxInstructions = 1000);
+    bool isHalted() const { return halted_; }
+    
+    // Guest time: run until the cycle counter reaches targetCycles (a
+    // halted core idles forward). mftb reads cycles_ as timebase ticks.
+    void runUntil(uint64_t targetCycles);
+    uint64_t getCycles() const { return cycles_; }
+    uint64_t getTimebase() const { return Timebase::cyclesToTicks(cycles_); }
     
     // Register access (public for JIT)
     uint64_t getGPR(int n) const { return regs_.gpr[n]; }
     void setGPR(int n, uint64_t val) { regs_.gpr[n] = val; }
+    PPURegisters& getRegisters() { return regs_; }
     
     // Public register arrays for JIT access
     uint64_t* gpr = nullptr;
@@ -104,6 +148,11 @@ public:
     // Common helpers
     uint32_t getBits(uint32_t value, int start, int end) const;
     void updateCR0(int64_t result);
+    void setCRField(uint32_t field, uint32_t value);
+    bool getCA() const { return regs_.xer & XER_CA; }
+    void setCA(bool carry);
+    void setOV(bool overflow);
+    uint64_t readTimeBaseSPR(uint32_t tbr) const;
     bool checkCondition(uint32_t bo, uint32_t bi);
 };
 
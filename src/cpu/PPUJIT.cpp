@@ -1,18 +1,31 @@
 #include "cpu/PPUJIT.h"
+#include "cpu/PPUCodeCache.h"
 #include "cpu/PPUInterpreter.h"
 #ifdef LLVM_AVAILABLE
 #include "cpu/LLVMJITCompiler.h"
+#include "cpu/PPUJITObjectCache.h"
 #endif
 #include "memory/MemoryManager.h"
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 
 namespace pxs3c {
 
+static const char* tierName(PPUJITTier tier) {
+    switch (tier) {
+        case PPUJITTier::Interpreter: return "interpreter";
+        case PPUJITTier::Baseline:    return "baseline";
+        case PPUJITTier::Optimized:   return "optimized";
+    }
+    return "unknown";
+}
+
 PPUJIT::PPUJIT()
     : ppu_(nullptr), memory_(nullptr),
-      totalCompilations_(0), cacheHits_(0), cacheMisses_(0),
-      llvmJit_(nullptr) {}
+      llvmJit_(nullptr), codeCache_(std::make_unique<PPUCodeCache>()),
+      totalCompilations_(0), cacheHits_(0), cacheMisses_(0), linksPatched_(0),
+      codeWritten_(false), invalidatedBlocks_(0), pendingBlock_(nullptr), pendingSlot_(0), pendingPC_(0) {}
 
 PPUJIT::~PPUJIT() {
     shutdown();
@@ -22,7 +35,8 @@ bool PPUJIT::init(PPUInterpreter* ppu, MemoryManager* memory) {
     if (!ppu || !memory) return false;
     ppu_ = ppu;
     memory_ = memory;
-    
+    memory_->setCodeWriteHandler([this](uint64_t vaddr, uint64_t size) { noteCodeWrite(vaddr, size); });
+
 #ifdef LLVM_AVAILABLE
     // Initialize LLVM JIT compiler
     llvmJit_ = std::make_unique<LLVMJITCompiler>();
@@ -31,8 +45,10 @@ bool PPUJIT::init(PPUInterpreter* ppu, MemoryManager* memory) {
         llvmJit_ = nullptr;
         return false;
     }
-    
-    std::cout << "PPU JIT compiler initialized with LLVM backend" << std::endl;
+
+    std::cout << "PPU JIT compiler initialized with LLVM backend (tiers: baseline after "
+              << config_.baselineThreshold << ", optimized after "
+              << config_.optimizeThreshold << " entries)" << std::endl;
 #else
     std::cout << "PPU JIT compiler initialized (LLVM not available, using interpreter only)" << std::endl;
 #endif
@@ -41,106 +57,341 @@ bool PPUJIT::init(PPUInterpreter* ppu, MemoryManager* memory) {
 
 void PPUJIT::shutdown() {
     clearCache();
+    if (memory_) {
+        memory_->setCodeWriteHandler(nullptr);
+    }
     llvmJit_ = nullptr;
     ppu_ = nullptr;
     memory_ = nullptr;
 }
 
-bool PPUJIT::compileBlock(uint64_t pc, uint32_t maxInstructions) {
-    if (!ppu_ || !memory_) return false;
-    
-    // Check if already compiled
-    if (cache_.find(pc) != cache_.end()) {
-        if (cache_[pc]->compiled != nullptr) {
-            cache_[pc]->callCount++;
-            cacheHits_++;
-            return true;
-        }
+JITBlockHeader* PPUJIT::getOrCreateBlock(uint64_t pc) {
+    JITBlockHeader* header = codeCache_->lookup(pc);
+    if (header) {
+        return header;
     }
-    
-    cacheMisses_++;
-    
-    // Read block of instructions from memory
-    std::vector<uint32_t> instructions;
-    uint64_t currentPC = pc;
-    
-    for (uint32_t i = 0; i < maxInstructions; i++) {
-        uint32_t instr = memory_->read32(currentPC);
-        
-        // Already in big-endian from PS3 memory
-        instructions.push_back(instr);
-        currentPC += 4;
-        
-        // Stop at branch/return instructions
-        uint8_t opcode = (instr >> 26) & 0x3F;
-        if (opcode == 18 || opcode == 16 || opcode == 19) { // b, bc, bcctr, bclr
-            break;
-        }
+
+    header = codeCache_->insert(pc);
+    if (!header) {
+        return nullptr;  // outside the code cache's address range, interpret
     }
-    
-    if (instructions.empty()) {
-        return false;
+    trackBlock(*header);
+    tierStats_[static_cast<int>(PPUJITTier::Interpreter)].blocks++;
+    return header;
+}
+
+bool PPUJIT::compileBlock(uint64_t pc, PPUJITTier tier, uint32_t maxInstructions) {
+    if (!ppu_ || !memory_ || tier == PPUJITTier::Interpreter) return false;
+
+    JITBlockHeader* block = getOrCreateBlock(pc);
+    if (!block) return false;
+    if (block->compiled != nullptr && block->tier >= tier) {
+        cacheHits_++;
+        return true;
     }
-    
-    auto header = std::make_unique<JITBlockHeader>();
-    header->startPC = pc;
-    header->blockSize = instructions.size() * 4;
-    header->instructionCount = instructions.size();
-    header->callCount = 1;
-    header->compiledAt = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-    header->compiled = nullptr;
-    
+
+    cacheMisses_++;
+
+    PPUCompiledBlock compiled = nullptr;
+    auto start = std::chrono::steady_clock::now();
 #ifdef LLVM_AVAILABLE
-    // Try to compile with LLVM JIT
     if (llvmJit_) {
-        auto compiled = llvmJit_->compileBlock(ppu_, memory_, pc, maxInstructions);
-        header->compiled = compiled;
+        compiled = llvmJit_->compileBlock(ppu_, memory_, *block, tier, maxInstructions,
+                                          codeCache_.get());
     }
 #endif
-    
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    auto& stats = tierStats_[static_cast<int>(tier)];
+    stats.compilations++;
+    stats.compileTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
     totalCompilations_++;
-    cache_[pc] = std::move(header);
-    
-    if (cache_[pc]->compiled != nullptr) {
-        std::cout << "LLVM JIT compiled block at 0x" << std::hex << pc << std::dec << std::endl;
-        return true;
+
+    if (compiled == nullptr) {
+        // Leave the block at its current tier; a failed baseline compile
+        // means the block starts with something the JIT cannot translate.
+        if (block->compiled == nullptr) {
+            block->compileFailed = true;
+        }
+        return false;
     }
-    
-    return false;
+
+    // The new code numbers its exits differently: drop the old links
+    for (auto& l : block->links) {
+        unlink(l);
+    }
+    if (pendingBlock_ == block) {
+        pendingBlock_ = nullptr;
+    }
+
+    tierStats_[static_cast<int>(block->tier)].blocks--;
+    tierStats_[static_cast<int>(tier)].blocks++;
+    trackBlock(*block);  // the new code may cover more pages
+    block->compiled = compiled;
+    block->tier = tier;
+    block->compiledAt = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    return true;
 }
 
-bool PPUJIT::executeBlock(uint64_t& pc, uint64_t maxInstructions) {
-    if (!ppu_) return false;
-    
-    // Try to find compiled block
-    auto it = cache_.find(pc);
-    if (it != cache_.end() && it->second->compiled != nullptr) {
-        std::cout << "JIT hit: Executing compiled block at 0x" << std::hex << pc << std::dec << std::endl;
-        cacheHits_++;
-        it->second->callCount++;
-        return true;
+void PPUJIT::promoteBlock(JITBlockHeader& block) {
+    if (block.compileFailed) return;
+
+    if (block.tier == PPUJITTier::Interpreter &&
+        block.callCount >= config_.baselineThreshold) {
+        compileBlock(block.startPC, PPUJITTier::Baseline);
+    } else if (block.tier == PPUJITTier::Baseline &&
+               block.callCount >= config_.optimizeThreshold) {
+        compileBlock(block.startPC, PPUJITTier::Optimized, config_.regionInstructions);
+    }
+}
+
+void PPUJIT::link(JITBlockHeader& from, uint32_t slot, uint64_t pc, JITBlockHeader& to) {
+    JITBlockLink& l = from.links[slot];
+    if (l.target == &to && l.pc == pc) return;
+    unlink(l);
+    l.pc = pc;
+    l.target = &to;
+    incoming_[&to].push_back(&l);
+    linksPatched_++;
+}
+
+void PPUJIT::unlink(JITBlockLink& slot) {
+    if (!slot.target) return;
+    auto it = incoming_.find(slot.target);
+    if (it != incoming_.end()) {
+        auto& slots = it->second;
+        slots.erase(std::remove(slots.begin(), slots.end(), &slot), slots.end());
+    }
+    slot.target = nullptr;
+}
+
+void PPUJIT::unlinkBlock(JITBlockHeader& block) {
+    // Unpatch every exit that jumps into this block...
+    auto it = incoming_.find(&block);
+    if (it != incoming_.end()) {
+        for (JITBlockLink* slot : it->second) {
+            slot->target = nullptr;
+        }
+        incoming_.erase(it);
+    }
+    // ...and withdraw its own exits from their targets
+    for (auto& l : block.links) {
+        unlink(l);
+    }
+    if (pendingBlock_ == &block) {
+        pendingBlock_ = nullptr;
+    }
+}
+
+uint32_t PPUJIT::executeBlock(uint64_t pc, uint64_t maxInstructions) {
+    if (!ppu_ || !config_.enabled) return 0;
+    dropWrittenCode();
+
+    JITBlockHeader* block = getOrCreateBlock(pc);
+    if (!block) return 0;
+    // Compiled baseline code counts its own entries, including chained ones
+    if (block->compiled == nullptr) {
+        block->callCount++;
+    }
+    promoteBlock(*block);
+
+    if (block->compiled == nullptr || block->instructionCount > maxInstructions) {
+        tierStats_[static_cast<int>(PPUJITTier::Interpreter)].executions++;
+        pendingBlock_ = nullptr;
+        return 0;
     }
-    
-    // Try to compile if not yet attempted
-    if (cache_.find(pc) == cache_.end()) {
-        compileBlock(pc, maxInstructions);
-        if (cache_[pc]->compiled != nullptr) {
-            return true;
+
+    // The previous chain left through an exit leading here: link it, so
+    // next time that exit jumps straight into this block.
+    if (pendingBlock_ && pendingPC_ == pc && config_.chaining) {
+        link(*pendingBlock_, pendingSlot_, pc, *block);
+    }
+    pendingBlock_ = nullptr;
+
+    PPUJITContext ctx;
+    ctx.budget = static_cast<int64_t>(maxInstructions);
+    ctx.optimizeThreshold = config_.optimizeThreshold;
+    ctx.exitBlock = nullptr;
+    ctx.exitSlot = 0;
+    ctx.memoryBase = memory_->getFastmemBase();
+    ctx.pageFlags = memory_->getPageFlags();
+    ctx.memory = memory_;
+
+    PPURegisters& regs = ppu_->getRegisters();
+    uint64_t nextPC = block->compiled(&regs, &ctx, block);
+    regs.pc = nextPC;
+
+    // Regions charge whole basic blocks, so the chain can overshoot the
+    // budget by a few instructions
+    uint32_t retired = static_cast<uint32_t>(static_cast<int64_t>(maxInstructions) - ctx.budget);
+    auto& stats = tierStats_[static_cast<int>(block->tier)];
+    stats.executions++;
+    stats.instructions += retired;
+
+    // The chain may have stored over compiled code, maybe its own: drop
+    // that before remembering an exit of a block that may be gone
+    uint64_t invalidated = invalidatedBlocks_;
+    dropWrittenCode();
+    if (ctx.exitBlock && invalidated == invalidatedBlocks_) {
+        pendingBlock_ = ctx.exitBlock;
+        pendingSlot_ = ctx.exitSlot;
+        pendingPC_ = nextPC;
+        // A hot baseline block may have refused to chain so it can be
+        // promoted; it need not be the block the chain was entered at.
+        if (ctx.exitBlock != block) {
+            promoteBlock(*ctx.exitBlock);
         }
     }
-    
-    // Fall back to interpreter
+    return retired;
+}
+
+void PPUJIT::invalidateRange(uint64_t start, uint64_t size) {
+    if (size == 0) return;
+    std::vector<JITBlockHeader*> stale;
+    uint64_t lastPage = (start + size - 1) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = start >> FASTMEM_PAGE_SHIFT; page <= lastPage; ++page) {
+        auto it = codePages_.find(page);
+        if (it == codePages_.end()) continue;
+        for (JITBlockHeader* block : it->second) {
+            uint64_t end = block->startPC + std::max<uint64_t>(block->blockSize, 4);
+            if (block->startPC < start + size && end > start) {
+                stale.push_back(block);
+            }
+        }
+    }
+    // A block spanning several pages is found once per page
+    std::sort(stale.begin(), stale.end());
+    stale.erase(std::unique(stale.begin(), stale.end()), stale.end());
+    for (JITBlockHeader* block : stale) {
+        untrackBlock(*block);
+        unlinkBlock(*block);
+        tierStats_[static_cast<int>(block->tier)].blocks--;
+        codeCache_->remove(block->startPC);
+    }
+    invalidatedBlocks_ += stale.size();
+}
+
+void PPUJIT::trackBlock(JITBlockHeader& block) {
+    uint64_t first = block.startPC >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = (block.startPC + std::max<uint64_t>(block.blockSize, 4) - 1) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = first; page <= last; ++page) {
+        auto& blocks = codePages_[page];
+        if (blocks.empty()) {
+            memory_->markCode(page << FASTMEM_PAGE_SHIFT, FASTMEM_PAGE_SIZE);
+        }
+        blocks.insert(&block);
+    }
+}
+
+void PPUJIT::untrackBlock(JITBlockHeader& block) {
+    uint64_t first = block.startPC >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = (block.startPC + std::max<uint64_t>(block.blockSize, 4) - 1) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = first; page <= last; ++page) {
+        auto it = codePages_.find(page);
+        if (it == codePages_.end()) continue;
+        it->second.erase(&block);
+        if (it->second.empty()) {
+            codePages_.erase(it);
+            memory_->unmarkCode(page << FASTMEM_PAGE_SHIFT, FASTMEM_PAGE_SIZE);
+        }
+    }
+}
+
+void PPUJIT::noteCodeWrite(uint64_t vaddr, uint64_t size) {
+    std::lock_guard<std::mutex> lock(writtenMutex_);
+    writtenRanges_.emplace_back(vaddr, size);
+    codeWritten_.store(true, std::memory_order_release);
+}
+
+void PPUJIT::dropWrittenCode() {
+    if (!codeWritten_.load(std::memory_order_acquire)) return;
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    {
+        std::lock_guard<std::mutex> lock(writtenMutex_);
+        ranges.swap(writtenRanges_);
+        codeWritten_.store(false, std::memory_order_relaxed);
+    }
+    for (const auto& [start, size] : ranges) {
+        invalidateRange(start, size);
+    }
+}
+
+uint64_t PPUJIT::getCacheSize() const {
+    return codeCache_->size();
+}
+
+void PPUJIT::dumpStats() const {
+    std::cout << "PPU JIT: " << codeCache_->size() << " blocks, "
+              << totalCompilations_ << " compilations, "
+              << linksPatched_ << " links" << std::endl;
+    for (int i = 0; i < PPU_JIT_TIER_COUNT; ++i) {
+        const auto& s = tierStats_[i];
+        std::cout << "  " << tierName(static_cast<PPUJITTier>(i))
+                  << ": blocks=" << s.blocks
+                  << " compilations=" << s.compilations
+                  << " compileTime=" << (s.compileTimeNs / 1000) << "us"
+                  << " executions=" << s.executions
+                  << " instructions=" << s.instructions << std::endl;
+    }
+#ifdef LLVM_AVAILABLE
+    if (llvmJit_) {
+        std::cout << "  region basic blocks emitted: " << llvmJit_->getRegionBlocks() << std::endl;
+    }
+    if (llvmJit_ && llvmJit_->getObjectCache()) {
+        const auto* cache = llvmJit_->getObjectCache();
+        std::cout << "  object cache: hits=" << cache->getHits()
+                  << " misses=" << cache->getMisses()
+                  << " stores=" << cache->getStores() << std::endl;
+    }
+#endif
+}
+
+PPUJITObjectCacheStats PPUJIT::getObjectCacheStats() const {
+    PPUJITObjectCacheStats stats;
+#ifdef LLVM_AVAILABLE
+    if (llvmJit_ && llvmJit_->getObjectCache()) {
+        const auto* cache = llvmJit_->getObjectCache();
+        stats.hits = cache->getHits();
+        stats.misses = cache->getMisses();
+        stats.stores = cache->getStores();
+    }
+#endif
+    return stats;
+}
+
+bool PPUJIT::setCacheDirectory(const std::string& directory) {
+#ifdef LLVM_AVAILABLE
+    if (llvmJit_) {
+        return llvmJit_->setObjectCache(directory);
+    }
+#endif
+    (void)directory;
     return false;
 }
 
 void PPUJIT::clearCache() {
-    cache_.clear();
+    for (const auto& [page, blocks] : codePages_) {
+        memory_->unmarkCode(page << FASTMEM_PAGE_SHIFT, FASTMEM_PAGE_SIZE);
+    }
+    codePages_.clear();
+    {
+        std::lock_guard<std::mutex> lock(writtenMutex_);
+        writtenRanges_.clear();
+        codeWritten_.store(false, std::memory_order_relaxed);
+    }
+    codeCache_->clear();
+    incoming_.clear();
+    pendingBlock_ = nullptr;
     std::cout << "JIT cache cleared (" << totalCompilations_ << " blocks compiled, "
               << cacheHits_ << " hits, " << cacheMisses_ << " misses)" << std::endl;
     totalCompilations_ = 0;
     cacheHits_ = 0;
     cacheMisses_ = 0;
+    linksPatched_ = 0;
+    invalidatedBlocks_ = 0;
+    for (auto& stats : tierStats_) {
+        stats = PPUJITTierStats();
+    }
 }
 
 } // namespace pxs3c
-
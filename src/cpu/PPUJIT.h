@@ -1,9 +1,14 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <vector>
-#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 namespace pxs3c {
 
@@ -11,21 +16,93 @@ class MemoryManager;
 class SyscallHandler;
 class PPUInterpreter;
 class LLVMJITCompiler;
+class PPUCodeCache;
+struct PPURegisters;
+struct JITBlockHeader;
 
 // Forward declare uint128_t (defined in PPUInterpreter.h)
 union uint128_t;
 
-// PPU JIT compiler - translates PowerPC blocks to native code via LLVM
-typedef uint64_t (*PPUCompiledBlock)(uint64_t* gpr, double* fpr, uint128_t* vr,
-                                      uint64_t pc, uint64_t lr, uint32_t cr);
+// State shared by a chain of compiled blocks entered from the dispatcher
+struct PPUJITContext {
+    int64_t budget;               // guest instructions the chain may still retire
+    uint64_t optimizeThreshold;   // baseline blocks at this count return to be promoted
+    JITBlockHeader* exitBlock;    // block that returned through a linkable exit
+    uint32_t exitSlot;            // which of its exits it left through
+    // Guest memory, see MemoryManager's fastmem
+    uint8_t* memoryBase;          // host address of guest address 0 (may be null)
+    const uint8_t* pageFlags;     // FASTMEM_* flags per 64KB guest page
+    MemoryManager* memory;        // slow path for everything else
+};
+
+// PPU JIT compiler - translates PowerPC blocks to native code via LLVM.
+// Compiled blocks operate directly on the interpreter's register file and
+// return the guest PC execution continues at. A block whose exit has been
+// linked tail-calls the next block itself instead of returning.
+typedef uint64_t (*PPUCompiledBlock)(PPURegisters* regs, PPUJITContext* ctx,
+                                     JITBlockHeader* self);
+
+// Exit slots of a compiled block. Exits with a fixed target PC are given
+// slots from PPU_JIT_EXIT_DIRECT on in the order they are emitted; a region
+// with more exits than slots leaves the rest unlinked.
+enum PPUJITExit : uint32_t {
+    PPU_JIT_EXIT_INDIRECT = 0,     // bclr/bcctr target, single-entry inline cache
+    PPU_JIT_EXIT_DIRECT = 1,       // first slot for fixed-target exits
+    PPU_JIT_EXIT_COUNT = 8,
+};
+
+struct JITBlockLink {
+    uint64_t pc;              // target PC; compared against LR/CTR for indirect exits
+    JITBlockHeader* target;   // nullptr while unlinked
+};
+
+// Execution tiers. Every block starts in the interpreter and is promoted as
+// its callCount crosses the configured thresholds.
+enum class PPUJITTier : uint8_t {
+    Interpreter = 0,  // cold code, not compiled
+    Baseline = 1,     // warm code, fast low-opt compile
+    Optimized = 2,    // hot code, full LLVM pipeline + profile-guided layout
+};
+
+constexpr int PPU_JIT_TIER_COUNT = 3;
+
+struct PPUJITConfig {
+    bool enabled = true;
+    uint64_t baselineThreshold = 8;     // block entries before baseline compile
+    uint64_t optimizeThreshold = 4096;  // block entries before optimizing recompile
+    bool chaining = true;               // link block exits directly to compiled successors
+    uint32_t regionInstructions = 2048; // guest instructions per optimized region
+};
+
+struct PPUJITObjectCacheStats {
+    uint64_t hits = 0;    // blocks loaded from disk instead of compiled
+    uint64_t misses = 0;  // lookups with no usable object on disk
+    uint64_t stores = 0;  // objects written
+};
+
+struct PPUJITTierStats {
+    uint64_t blocks = 0;          // blocks currently at this tier
+    uint64_t compilations = 0;    // compiles performed for this tier
+    uint64_t compileTimeNs = 0;   // time spent in those compiles
+    uint64_t executions = 0;      // block entries served by this tier
+    uint64_t instructions = 0;    // guest instructions retired (compiled tiers)
+};
 
 struct JITBlockHeader {
     uint64_t startPC;
-    uint64_t blockSize;
-    uint32_t instructionCount;
+    uint64_t blockSize;         // guest bytes covered from startPC (whole region)
+    uint32_t instructionCount;  // instructions in the entry basic block
     PPUCompiledBlock compiled;
     uint64_t callCount;  // How many times executed
     uint64_t compiledAt;  // When compiled
+    PPUJITTier tier;
+    bool compileFailed;   // Nothing translatable at startPC, stays interpreted
+    // Exit profile gathered while the block runs at the baseline tier,
+    // used to lay out the optimized code.
+    uint64_t takenCount;
+    uint64_t fallthroughCount;
+    // Patched by the dispatcher, read by the compiled code on exit
+    JITBlockLink links[PPU_JIT_EXIT_COUNT];
 };
 
 // JIT compilation cache with LLVM backend
@@ -33,23 +110,55 @@ class PPUJIT {
 public:
     PPUJIT();
     ~PPUJIT();
-    
+
     bool init(PPUInterpreter* ppu, MemoryManager* memory);
     void shutdown();
-    
-    // Compile a block starting at PC
-    bool compileBlock(uint64_t pc, uint32_t maxInstructions = 100);
-    
-    // Try to execute compiled block, fallback to interpreter if not found
-    bool executeBlock(uint64_t& pc, uint64_t maxInstructions);
-    
+
+    // Compile (or recompile) the block starting at PC for the given tier.
+    // Baseline code covers a single guest basic block; optimized code covers
+    // the region reachable from PC through direct branches.
+    bool compileBlock(uint64_t pc, PPUJITTier tier = PPUJITTier::Baseline,
+                      uint32_t maxInstructions = 100);
+
+    // Called by the interpreter at every block entry. Counts the entry,
+    // promotes the block when it crosses a tier threshold and runs the
+    // compiled code if there is any. Returns the number of guest
+    // instructions retired, or 0 if the caller should interpret.
+    uint32_t executeBlock(uint64_t pc, uint64_t maxInstructions);
+
     // Clear cache
     void clearCache();
-    
+
+    // Drop compiled code for blocks overlapping [start, start + size), e.g.
+    // after the guest rewrites it. Links into those blocks are unpatched.
+    // Guest memory writes to pages holding blocks (stores, loads over
+    // existing code, unmapping) are reported by MemoryManager and dropped
+    // this way at the next block entry.
+    void invalidateRange(uint64_t start, uint64_t size);
+
+    // Persist compiled blocks under directory and reuse them across runs.
+    // An empty path disables the on-disk cache.
+    bool setCacheDirectory(const std::string& directory);
+
+    // Whether there is a backend to compile with; without one every block
+    // stays in the interpreter
+    bool isAvailable() const { return llvmJit_ != nullptr; }
+
+    // Configuration
+    void setConfig(const PPUJITConfig& config) { config_ = config; }
+    const PPUJITConfig& getConfig() const { return config_; }
+
     // Statistics
-    uint64_t getCacheSize() const { return cache_.size(); }
+    uint64_t getCacheSize() const;
     uint64_t getTotalCompilations() const { return totalCompilations_; }
-    
+    uint64_t getLinksPatched() const { return linksPatched_; }
+    uint64_t getInvalidatedBlocks() const { return invalidatedBlocks_; }
+    PPUJITObjectCacheStats getObjectCacheStats() const;  // zero without a cache directory
+    const PPUJITTierStats& getTierStats(PPUJITTier tier) const {
+        return tierStats_[static_cast<int>(tier)];
+    }
+    void dumpStats() const;
+
 private:
     PPUInterpreter* ppu_;
     MemoryManager* memory_;
@@ -58,10 +167,38 @@ private:
 #else
     void* llvmJit_;  // Placeholder when LLVM not available
 #endif
-    std::map<uint64_t, std::unique_ptr<JITBlockHeader>> cache_;
+    std::unique_ptr<PPUCodeCache> codeCache_;
+    PPUJITConfig config_;
+    PPUJITTierStats tierStats_[PPU_JIT_TIER_COUNT];
     uint64_t totalCompilations_;
     uint64_t cacheHits_;
     uint64_t cacheMisses_;
+    uint64_t linksPatched_;
+
+    // Link slots pointing at each block, so they can be unpatched
+    std::unordered_map<JITBlockHeader*, std::vector<JITBlockLink*>> incoming_;
+    // Blocks by the fastmem pages they cover; MemoryManager reports stores
+    // to those pages
+    std::unordered_map<uint64_t, std::unordered_set<JITBlockHeader*>> codePages_;
+    // Ranges written since the last block entry, from any thread
+    std::mutex writtenMutex_;
+    std::vector<std::pair<uint64_t, uint64_t>> writtenRanges_;
+    std::atomic<bool> codeWritten_;
+    uint64_t invalidatedBlocks_;
+    // Exit taken by the last chain, linked once its target is compiled
+    JITBlockHeader* pendingBlock_;
+    uint32_t pendingSlot_;
+    uint64_t pendingPC_;
+
+    JITBlockHeader* getOrCreateBlock(uint64_t pc);
+    void promoteBlock(JITBlockHeader& block);
+    void link(JITBlockHeader& from, uint32_t slot, uint64_t pc, JITBlockHeader& to);
+    void unlink(JITBlockLink& slot);
+    void unlinkBlock(JITBlockHeader& block);
+    void trackBlock(JITBlockHeader& block);
+    void untrackBlock(JITBlockHeader& block);
+    void noteCodeWrite(uint64_t vaddr, uint64_t size);
+    void dropWrittenCode();
 };
 
 } // namespace pxs3c
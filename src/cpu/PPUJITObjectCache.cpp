@@ -0,0 +1,158 @@
+#include "cpu/PPUJITObjectCache.h"
+#include "cpu/CodeHash.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/Module.h"
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace pxs3c {
+
+namespace {
+
+constexpr uint32_t LLVM_VERSION_ID = LLVM_VERSION_MAJOR * 100 + LLVM_VERSION_MINOR;
+
+uint64_t hashString(const std::string& s) {
+    return hashCode(s.data(), s.size());
+}
+
+// Read-only view of a cached object mapped straight from its file
+class MappedObjectBuffer : public llvm::MemoryBuffer {
+public:
+    MappedObjectBuffer(void* mapping, size_t mappingSize, size_t offset, size_t size,
+                       std::string name)
+        : mapping_(mapping), mappingSize_(mappingSize), name_(std::move(name)) {
+        const char* start = static_cast<const char*>(mapping) + offset;
+        init(start, start + size, false);
+    }
+
+    ~MappedObjectBuffer() override {
+        munmap(mapping_, mappingSize_);
+    }
+
+    BufferKind getBufferKind() const override { return MemoryBuffer_MMap; }
+    llvm::StringRef getBufferIdentifier() const override { return name_; }
+
+private:
+    void* mapping_;
+    size_t mappingSize_;
+    std::string name_;
+};
+
+} // namespace
+
+PPUJITObjectCache::PPUJITObjectCache(const std::string& directory)
+    : directory_(directory), valid_(false),
+      tripleHash_(hashString(LLVM_HOST_TRIPLE)),
+      hits_(0), misses_(0), stores_(0) {
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) {
+        std::cerr << "PPU JIT cache: cannot create " << directory_ << ": "
+                  << ec.message() << std::endl;
+        return;
+    }
+    valid_ = true;
+}
+
+PPUJITObjectCache::~PPUJITObjectCache() {}
+
+std::string PPUJITObjectCache::pathFor(const std::string& key) const {
+    return directory_ + "/" + key + ".obj";
+}
+
+bool PPUJITObjectCache::readHeader(int fd, const std::string& key,
+                                   PPUJITCacheHeader& header) const {
+    if (pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        return false;
+    }
+    return std::memcmp(header.magic, "PXJC", 4) == 0 &&
+           header.version == PPU_JIT_CACHE_VERSION &&
+           header.llvmVersion == LLVM_VERSION_ID &&
+           header.headerSize == sizeof(PPUJITCacheHeader) &&
+           header.keyHash == hashString(key) &&
+           header.tripleHash == tripleHash_ &&
+           header.objectSize > 0;
+}
+
+bool PPUJITObjectCache::contains(const std::string& key) const {
+    if (!valid_) return false;
+    int fd = open(pathFor(key).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    PPUJITCacheHeader header;
+    bool ok = readHeader(fd, key, header);
+    close(fd);
+    return ok;
+}
+
+void PPUJITObjectCache::notifyObjectCompiled(const llvm::Module* module,
+                                             llvm::MemoryBufferRef object) {
+    if (!valid_ || !module) return;
+    const std::string key = module->getModuleIdentifier();
+
+    PPUJITCacheHeader header = {};
+    std::memcpy(header.magic, "PXJC", 4);
+    header.version = PPU_JIT_CACHE_VERSION;
+    header.llvmVersion = LLVM_VERSION_ID;
+    header.headerSize = sizeof(PPUJITCacheHeader);
+    header.objectSize = object.getBufferSize();
+    header.keyHash = hashString(key);
+    header.tripleHash = tripleHash_;
+
+    // Write to a temporary file and rename, so a concurrent or interrupted
+    // run never sees a half-written object.
+    const std::string path = pathFor(key);
+    const std::string tmpPath = path + ".tmp" + std::to_string(getpid());
+    int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+
+    bool ok = write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+              write(fd, object.getBufferStart(), object.getBufferSize()) ==
+                  static_cast<ssize_t>(object.getBufferSize());
+    close(fd);
+
+    if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+        unlink(tmpPath.c_str());
+        return;
+    }
+    stores_++;
+}
+
+std::unique_ptr<llvm::MemoryBuffer> PPUJITObjectCache::getObject(const llvm::Module* module) {
+    if (!valid_ || !module) return nullptr;
+    const std::string key = module->getModuleIdentifier();
+
+    int fd = open(pathFor(key).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        misses_++;
+        return nullptr;
+    }
+
+    PPUJITCacheHeader header;
+    struct stat st;
+    if (!readHeader(fd, key, header) || fstat(fd, &st) != 0 ||
+        static_cast<uint64_t>(st.st_size) != header.headerSize + header.objectSize) {
+        // Stale or foreign object: recompile, notifyObjectCompiled replaces it
+        close(fd);
+        misses_++;
+        return nullptr;
+    }
+
+    size_t mappingSize = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        misses_++;
+        return nullptr;
+    }
+
+    hits_++;
+    return std::make_unique<MappedObjectBuffer>(mapping, mappingSize, header.headerSize,
+                                                header.objectSize, key);
+}
+
+} // namespace pxs3c
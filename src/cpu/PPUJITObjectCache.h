@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#ifdef LLVM_AVAILABLE
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/MemoryBuffer.h"
+#endif
+
+namespace pxs3c {
+
+// Bump whenever generated code or the compiled block ABI changes; objects
+// written by an older emulator are then ignored and overwritten.
+constexpr uint32_t PPU_JIT_CACHE_VERSION = 6;
+
+// On-disk header preceding every cached object
+struct PPUJITCacheHeader {
+    char magic[4];          // "PXJC"
+    uint32_t version;       // PPU_JIT_CACHE_VERSION
+    uint32_t llvmVersion;   // LLVM major * 100 + minor that produced the object
+    uint32_t headerSize;    // offset of the object within the file
+    uint64_t objectSize;
+    uint64_t keyHash;       // hash of the cache key, guards against renamed files
+    uint64_t tripleHash;    // hash of the host target triple
+    uint8_t reserved[24];
+};
+static_assert(sizeof(PPUJITCacheHeader) == 64, "cache header must stay 64 bytes");
+
+#ifdef LLVM_AVAILABLE
+// Persistent PPU JIT object cache. Compiled blocks are stored per game as
+// <directory>/<key>.obj, where the key (the module identifier) encodes the
+// tier, start PC and a hash of the guest code bytes. Later runs map the
+// object straight from disk instead of running the optimiser and codegen.
+class PPUJITObjectCache : public llvm::ObjectCache {
+public:
+    explicit PPUJITObjectCache(const std::string& directory);
+    ~PPUJITObjectCache() override;
+
+    bool isValid() const { return valid_; }
+    const std::string& getDirectory() const { return directory_; }
+
+    // True if a valid object for this key is on disk
+    bool contains(const std::string& key) const;
+
+    // llvm::ObjectCache
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override;
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override;
+
+    uint64_t getHits() const { return hits_; }
+    uint64_t getMisses() const { return misses_; }
+    uint64_t getStores() const { return stores_; }
+
+private:
+    std::string directory_;
+    bool valid_;
+    uint64_t tripleHash_;
+    uint64_t hits_;
+    uint64_t misses_;
+    uint64_t stores_;
+
+    std::string pathFor(const std::string& key) const;
+    bool readHeader(int fd, const std::string& key, PPUJITCacheHeader& header) const;
+};
+#endif
+
+} // namespace pxs3c
@@ -0,0 +1,193 @@
+#include "cpu/SPUChannels.h"
+#include "cpu/SPUMFC.h"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace pxs3c {
+
+namespace {
+
+constexpr uint64_t SIGNAL_PENDING = 1ULL << 32;
+
+} // namespace
+
+SPUChannels::SPUChannels() : mfc_(nullptr), signalSeq_(0) {
+    signals_[0] = 0;
+    signals_[1] = 0;
+    reset();
+}
+
+void SPUChannels::reset() {
+    inMbox_.clear();
+    outMbox_.clear();
+    outIntrMbox_.clear();
+    signals_[0].store(0, std::memory_order_relaxed);
+    signals_[1].store(0, std::memory_order_relaxed);
+    signalOrMode_[0] = false;
+    signalOrMode_[1] = false;
+    mfcLsa_ = 0;
+    mfcEah_ = 0;
+    mfcEal_ = 0;
+    mfcSize_ = 0;
+    mfcTag_ = 0;
+    tagMask_ = 0;
+    tagUpdate_ = MFC_TAG_UPDATE_IMMEDIATE;
+    eventMask_ = 0;
+    srr0_ = 0;
+}
+
+ChannelStatus SPUChannels::read(uint32_t channel, uint32_t& value) {
+    switch (channel) {
+    case SPU_RdInMbox:
+        return inMbox_.pop(value) ? ChannelStatus::Ok : ChannelStatus::WouldBlock;
+    case SPU_RdSigNotify1:
+    case SPU_RdSigNotify2: {
+        uint64_t signal = signals_[channel - SPU_RdSigNotify1].exchange(0, std::memory_order_acq_rel);
+        if (!(signal & SIGNAL_PENDING)) return ChannelStatus::WouldBlock;
+        value = static_cast<uint32_t>(signal);
+        return ChannelStatus::Ok;
+    }
+    case MFC_RdTagStat:
+        if (!tagStatusReady()) return ChannelStatus::WouldBlock;
+        value = (mfc_ ? mfc_->getCompletedTags() : ~0u) & tagMask_;
+        tagUpdate_ = MFC_TAG_UPDATE_IMMEDIATE;
+        return ChannelStatus::Ok;
+    case MFC_RdTagMask: value = tagMask_; return ChannelStatus::Ok;
+    case SPU_RdEventMask: value = eventMask_; return ChannelStatus::Ok;
+    case SPU_RdMachStat: value = 0; return ChannelStatus::Ok;
+    case SPU_RdSRR0: value = srr0_; return ChannelStatus::Ok;
+    case SPU_RdEventStat:
+    case MFC_RdListStallStat:
+    case MFC_RdAtomicStat:
+        return ChannelStatus::WouldBlock;  // nothing ever raises these
+    default:
+        return ChannelStatus::Invalid;
+    }
+}
+
+ChannelStatus SPUChannels::write(uint32_t channel, uint32_t value) {
+    switch (channel) {
+    case SPU_WrOutMbox:
+        return outMbox_.push(value) ? ChannelStatus::Ok : ChannelStatus::WouldBlock;
+    case SPU_WrOutIntrMbox:
+        return outIntrMbox_.push(value) ? ChannelStatus::Ok : ChannelStatus::WouldBlock;
+    case MFC_LSA: mfcLsa_ = value; return ChannelStatus::Ok;
+    case MFC_EAH: mfcEah_ = value; return ChannelStatus::Ok;
+    case MFC_EAL: mfcEal_ = value; return ChannelStatus::Ok;
+    case MFC_Size: mfcSize_ = value & 0xFFFF; return ChannelStatus::Ok;
+    case MFC_TagID: mfcTag_ = value & 0xFFFF; return ChannelStatus::Ok;
+    case MFC_Cmd: {
+        if (!mfc_) return ChannelStatus::Ok;
+        MFCCommand command;
+        command.lsa = mfcLsa_;
+        command.ea = (uint64_t(mfcEah_) << 32) | mfcEal_;
+        command.size = mfcSize_;
+        command.tag = mfcTag_;
+        command.cmd = value & 0xFFFF;
+        MFCStatus status = mfc_->enqueue(command);
+        if (status == MFCStatus::QueueFull) return ChannelStatus::WouldBlock;
+        if (status != MFCStatus::Ok) {
+            // Hardware raises a DMA alignment/command error interrupt,
+            // which is not modelled: report and drop the command
+            std::cerr << "MFC: rejected command 0x" << std::hex << command.cmd << " LSA=0x" << command.lsa
+                      << " EA=0x" << command.ea << std::dec << " size=" << command.size
+                      << " tag=" << command.tag << std::endl;
+        }
+        return ChannelStatus::Ok;
+    }
+    case MFC_WrTagMask: tagMask_ = value; return ChannelStatus::Ok;
+    case MFC_WrTagUpdate: tagUpdate_ = value & 3; return ChannelStatus::Ok;
+    case MFC_WrListStallAck: return ChannelStatus::Ok;
+    case SPU_WrEventMask: eventMask_ = value; return ChannelStatus::Ok;
+    case SPU_WrEventAck: return ChannelStatus::Ok;
+    case SPU_WrSRR0: srr0_ = value; return ChannelStatus::Ok;
+    default:
+        return ChannelStatus::Invalid;
+    }
+}
+
+uint32_t SPUChannels::count(uint32_t channel) const {
+    switch (channel) {
+    case SPU_RdInMbox: return inMbox_.size();
+    case SPU_WrOutMbox: return outMbox_.capacity() - outMbox_.size();
+    case SPU_WrOutIntrMbox: return outIntrMbox_.capacity() - outIntrMbox_.size();
+    case SPU_RdSigNotify1:
+    case SPU_RdSigNotify2:
+        return (signals_[channel - SPU_RdSigNotify1].load(std::memory_order_acquire) & SIGNAL_PENDING) ? 1 : 0;
+    case MFC_Cmd: return mfc_ ? mfc_->getQueueSpace() : MFC_QUEUE_DEPTH;
+    case MFC_RdTagStat: return tagStatusReady() ? 1 : 0;
+    case SPU_RdEventStat:
+    case MFC_RdListStallStat:
+    case MFC_RdAtomicStat:
+        return 0;
+    case SPU_WrEventMask: case SPU_WrEventAck: case SPU_RdEventMask: case MFC_RdTagMask:
+    case SPU_RdMachStat: case SPU_WrSRR0: case SPU_RdSRR0:
+    case MFC_LSA: case MFC_EAH: case MFC_EAL: case MFC_Size: case MFC_TagID:
+    case MFC_WrTagMask: case MFC_WrTagUpdate: case MFC_WrListStallAck:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+bool SPUChannels::waitReady(uint32_t channel, uint64_t timeoutNs) {
+    switch (channel) {
+    case SPU_RdInMbox: return inMbox_.waitNotEmpty(timeoutNs);
+    case SPU_WrOutMbox: return outMbox_.waitNotFull(timeoutNs);
+    case SPU_WrOutIntrMbox: return outIntrMbox_.waitNotFull(timeoutNs);
+    case MFC_RdTagStat:
+        // Only outstanding with a DMA thread, which always makes progress
+        if (mfc_ && !tagStatusReady()) {
+            mfc_->waitForTags(tagMask_, tagUpdate_ == MFC_TAG_UPDATE_ALL);
+        }
+        return tagStatusReady();
+    default:
+        break;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeoutNs);
+    while (!isReady(channel)) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) return false;
+        if (channel == SPU_RdSigNotify1 || channel == SPU_RdSigNotify2) {
+            uint32_t seq = signalSeq_.load(std::memory_order_acquire);
+            if (isReady(channel)) break;
+            futexWait(signalSeq_, seq,
+                      std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+        } else {
+            std::this_thread::yield();  // MFC queue space: the DMA thread is draining it
+        }
+    }
+    return true;
+}
+
+uint32_t SPUChannels::getMailboxStatus() const {
+    return outMbox_.size() | ((SPU_IN_MBOX_DEPTH - inMbox_.size()) << 8) | (outIntrMbox_.size() << 16);
+}
+
+void SPUChannels::writeSignal(int which, uint32_t value) {
+    if (which != 1 && which != 2) return;
+    std::atomic<uint64_t>& signal = signals_[which - 1];
+    if (signalOrMode_[which - 1]) {
+        signal.fetch_or(SIGNAL_PENDING | value, std::memory_order_acq_rel);
+    } else {
+        signal.store(SIGNAL_PENDING | value, std::memory_order_release);
+    }
+    signalSeq_.fetch_add(1, std::memory_order_acq_rel);
+    futexWakeAll(signalSeq_);
+}
+
+void SPUChannels::setSignalOrMode(int which, bool orMode) {
+    if (which == 1 || which == 2) signalOrMode_[which - 1] = orMode;
+}
+
+bool SPUChannels::tagStatusReady() const {
+    if (tagUpdate_ == MFC_TAG_UPDATE_IMMEDIATE || tagMask_ == 0 || !mfc_) {
+        return true;
+    }
+    uint32_t done = mfc_->getCompletedTags() & tagMask_;
+    return tagUpdate_ == MFC_TAG_UPDATE_ALL ? done == tagMask_ : done != 0;
+}
+
+} // namespace pxs3c
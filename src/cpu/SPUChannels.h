@@ -0,0 +1,117 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "core/SPSCQueue.h"
+
+namespace pxs3c {
+
+class SPUMFC;
+
+// SPU channel numbers (rdch/wrch/rchcnt), as named by the Cell SDK
+constexpr uint32_t SPU_RdEventStat = 0;
+constexpr uint32_t SPU_WrEventMask = 1;
+constexpr uint32_t SPU_WrEventAck = 2;
+constexpr uint32_t SPU_RdSigNotify1 = 3;
+constexpr uint32_t SPU_RdSigNotify2 = 4;
+constexpr uint32_t SPU_WrDec = 7;
+constexpr uint32_t SPU_RdDec = 8;
+constexpr uint32_t SPU_RdEventMask = 11;
+constexpr uint32_t MFC_RdTagMask = 12;
+constexpr uint32_t SPU_RdMachStat = 13;
+constexpr uint32_t SPU_WrSRR0 = 14;
+constexpr uint32_t SPU_RdSRR0 = 15;
+constexpr uint32_t MFC_LSA = 16;
+constexpr uint32_t MFC_EAH = 17;
+constexpr uint32_t MFC_EAL = 18;
+constexpr uint32_t MFC_Size = 19;
+constexpr uint32_t MFC_TagID = 20;
+constexpr uint32_t MFC_Cmd = 21;
+constexpr uint32_t MFC_WrTagMask = 22;
+constexpr uint32_t MFC_WrTagUpdate = 23;
+constexpr uint32_t MFC_RdTagStat = 24;
+constexpr uint32_t MFC_RdListStallStat = 25;
+constexpr uint32_t MFC_WrListStallAck = 26;
+constexpr uint32_t MFC_RdAtomicStat = 27;
+constexpr uint32_t SPU_WrOutMbox = 28;
+constexpr uint32_t SPU_RdInMbox = 29;
+constexpr uint32_t SPU_WrOutIntrMbox = 30;
+
+// MFC_WrTagUpdate modes
+constexpr uint32_t MFC_TAG_UPDATE_IMMEDIATE = 0;
+constexpr uint32_t MFC_TAG_UPDATE_ANY = 1;
+constexpr uint32_t MFC_TAG_UPDATE_ALL = 2;
+
+constexpr uint32_t SPU_IN_MBOX_DEPTH = 4;
+
+enum class ChannelStatus {
+    Ok,
+    WouldBlock,  // channel count is zero: the SPU stalls until it is not
+    Invalid,     // no such channel in this direction
+};
+
+// The SPU side of the channel interface, plus the problem-state registers
+// the PPU uses to reach it (mailboxes and signal notification).
+//
+// Each mailbox has exactly one producer and one consumer, the PPU thread
+// and the SPU's worker, so they are lock-free SPSC queues. A stalled SPU
+// can sleep on a queue's futex word until the other side moves it. The MFC
+// parameter channels belong to the SPU alone and need no synchronisation.
+// Events are not modelled: SPU_RdEventStat never becomes ready.
+class SPUChannels {
+public:
+    SPUChannels();
+
+    void init(SPUMFC* mfc) { mfc_ = mfc; }
+    // Only while the SPU is not running
+    void reset();
+
+    // SPU side. The decrementer lives with the SPU's cycle counter and is
+    // handled by the interpreter.
+    ChannelStatus read(uint32_t channel, uint32_t& value);
+    ChannelStatus write(uint32_t channel, uint32_t value);
+    uint32_t count(uint32_t channel) const;
+    bool isReady(uint32_t channel) const { return count(channel) != 0; }
+    // Sleep until the channel is ready or timeoutNs passes; true if ready
+    bool waitReady(uint32_t channel, uint64_t timeoutNs);
+
+    // PPU side
+    bool writeInboundMailbox(uint32_t value) { return inMbox_.push(value); }
+    bool readOutboundMailbox(uint32_t& value) { return outMbox_.pop(value); }
+    bool readOutboundInterruptMailbox(uint32_t& value) { return outIntrMbox_.pop(value); }
+    // SPU_Mbox_Stat layout: outbound count in bits 0-7, free inbound slots
+    // in bits 8-15, outbound interrupt count in bits 16-23
+    uint32_t getMailboxStatus() const;
+    // which is 1 or 2; in OR mode writes accumulate until the SPU reads
+    void writeSignal(int which, uint32_t value);
+    void setSignalOrMode(int which, bool orMode);
+
+private:
+    SPUMFC* mfc_;
+
+    SPSCQueue<uint32_t, SPU_IN_MBOX_DEPTH> inMbox_;
+    SPSCQueue<uint32_t, 1> outMbox_;
+    SPSCQueue<uint32_t, 1> outIntrMbox_;
+
+    // Bit 32 marks a pending notification, so a read takes value and
+    // pending flag in one exchange. signalSeq_ is the futex word.
+    std::atomic<uint64_t> signals_[2];
+    std::atomic<uint32_t> signalSeq_;
+    bool signalOrMode_[2];
+
+    // MFC command parameters, latched until MFC_Cmd
+    uint32_t mfcLsa_;
+    uint32_t mfcEah_;
+    uint32_t mfcEal_;
+    uint32_t mfcSize_;
+    uint32_t mfcTag_;
+    uint32_t tagMask_;
+    uint32_t tagUpdate_;
+
+    uint32_t eventMask_;
+    uint32_t srr0_;
+
+    bool tagStatusReady() const;
+};
+
+} // namespace pxs3c
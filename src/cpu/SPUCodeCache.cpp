@@ -0,0 +1,169 @@
+#include "cpu/SPUCodeCache.h"
+#include "cpu/CodeHash.h"
+#include "cpu/SPULLVMCompiler.h"
+#include <chrono>
+#include <iostream>
+
+namespace pxs3c {
+
+SPUCodeCache::SPUCodeCache()
+    : backend_(std::make_unique<SPULLVMCompiler>()), available_(false), capacity_(DEFAULT_CAPACITY) {
+    available_ = backend_->init();
+    if (!available_) {
+        backend_.reset();
+    }
+}
+
+SPUCodeCache::~SPUCodeCache() {
+    // The backend owns the code; entries only point into it
+    entries_.clear();
+    backend_.reset();
+}
+
+std::shared_ptr<SPUCodeCache> SPUCodeCache::shared() {
+    static std::shared_ptr<SPUCodeCache> cache = std::make_shared<SPUCodeCache>();
+    return cache;
+}
+
+const SPUCodeCache::Entry* SPUCodeCache::acquire(uint32_t pc, const std::vector<uint32_t>& code,
+                                                 uint32_t lsSize, bool& hit) {
+    hit = false;
+    if (!available_ || code.empty()) {
+        return nullptr;
+    }
+    Key key{hashCode(code.data(), code.size() * sizeof(uint32_t)), pc, lsSize};
+
+    auto find = [&]() -> Entry* {
+        auto range = entries_.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            Entry* entry = it->second.get();
+            if (entry->code != code) {
+                continue;
+            }
+            if (entry->users++ == 0) {
+                idle_.erase(entry->idle);
+            }
+            stats_.hits++;
+            hit = true;
+            return entry;
+        }
+        return nullptr;
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (Entry* entry = find()) {
+            return entry;
+        }
+    }
+
+    // Compile without mutex_, so other SPUs still get their hits
+    auto start = std::chrono::steady_clock::now();
+    auto entry = std::make_unique<Entry>();
+    {
+        std::lock_guard<std::mutex> lock(backendMutex_);
+        entry->compiled = backend_->compile(pc, code, lsSize, entry->native);
+    }
+    uint64_t compileNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    std::vector<SPUCompiledBlock> freed;
+    Entry* raw = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.compileTimeNs += compileNs;
+        if (!entry->compiled) {
+            stats_.failures++;
+            return nullptr;
+        }
+        // Another SPU may have compiled the same block meanwhile: keep the
+        // entry that got there first and free ours
+        if (Entry* existing = find()) {
+            raw = existing;
+            freed.push_back(entry->compiled);
+        } else {
+            entry->pc = pc;
+            entry->lsSize = lsSize;
+            entry->hash = key.hash;
+            entry->code = code;
+            entry->users = 1;
+            stats_.misses++;
+            raw = entry.get();
+            entries_.emplace(key, std::move(entry));
+            evict(capacity_, freed);
+        }
+    }
+    freeCode(freed);
+    return raw;
+}
+
+void SPUCodeCache::release(const Entry* entry) {
+    if (!entry) {
+        return;
+    }
+    std::vector<SPUCompiledBlock> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Entry* mutableEntry = const_cast<Entry*>(entry);
+        if (--mutableEntry->users == 0) {
+            idle_.push_front(mutableEntry);
+            mutableEntry->idle = idle_.begin();
+            evict(capacity_, freed);
+        }
+    }
+    freeCode(freed);
+}
+
+void SPUCodeCache::evict(size_t keep, std::vector<SPUCompiledBlock>& freed) {
+    while (entries_.size() > keep && !idle_.empty()) {
+        Entry* victim = idle_.back();
+        idle_.pop_back();
+        Key key{victim->hash, victim->pc, victim->lsSize};
+        auto range = entries_.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second.get() == victim) {
+                freed.push_back(victim->compiled);
+                entries_.erase(it);
+                stats_.evictions++;
+                break;
+            }
+        }
+    }
+}
+
+void SPUCodeCache::freeCode(const std::vector<SPUCompiledBlock>& freed) {
+    if (freed.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(backendMutex_);
+    for (SPUCompiledBlock block : freed) {
+        backend_->release(block);
+    }
+}
+
+void SPUCodeCache::purge() {
+    std::vector<SPUCompiledBlock> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        evict(0, freed);
+    }
+    freeCode(freed);
+}
+
+void SPUCodeCache::setCapacity(size_t capacity) {
+    std::vector<SPUCompiledBlock> freed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        capacity_ = capacity;
+        evict(capacity_, freed);
+    }
+    freeCode(freed);
+}
+
+SPUCodeCacheStats SPUCodeCache::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    SPUCodeCacheStats stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+} // namespace pxs3c
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "cpu/SPURecompiler.h"
+
+namespace pxs3c {
+
+class SPULLVMCompiler;
+
+struct SPUCodeCacheStats {
+    uint64_t hits = 0;         // blocks found already translated
+    uint64_t misses = 0;       // blocks compiled
+    uint64_t failures = 0;     // blocks the backend could not compile
+    uint64_t evictions = 0;
+    uint64_t entries = 0;
+    uint64_t compileTimeNs = 0;
+};
+
+// One translated block. Only SPUCodeCache changes it.
+struct SPUCodeCacheEntry {
+    SPUCompiledBlock compiled = nullptr;
+    uint32_t pc = 0;
+    uint32_t lsSize = 0;
+    uint64_t hash = 0;
+    std::vector<uint32_t> code;
+    uint32_t native = 0;  // instructions translated rather than interpreted
+    uint32_t users = 0;
+    std::list<SPUCodeCacheEntry*>::iterator idle;  // in the idle list while users == 0
+};
+
+// Compiled SPU code shared by every SPU, keyed by the content of the code
+// rather than by which SPU runs it. SPU programs are typically uploaded to
+// several SPUs and uploaded again frame after frame; whichever SPU reaches a
+// block first compiles it and the others pick up the same translation.
+//
+// A block's key is a hash of its instructions together with its start PC
+// and the local store size: compiled code embeds absolute local store
+// addresses, so the same bytes at another address are another block. The
+// instructions themselves are kept and compared, so a hash collision can
+// never return the wrong code.
+//
+// Compiled blocks reach local store, the code shadow and the interpreter
+// only through SPUJITContext, so any SPU can run any entry. Entries are
+// reference counted by the SPUs using them; unused entries stay cached for
+// the next upload of the same program until the cache outgrows its
+// capacity, then the least recently used are freed.
+class SPUCodeCache {
+public:
+    using Entry = SPUCodeCacheEntry;
+
+    static constexpr size_t DEFAULT_CAPACITY = 4096;
+
+    SPUCodeCache();
+    ~SPUCodeCache();
+
+    SPUCodeCache(const SPUCodeCache&) = delete;
+    SPUCodeCache& operator=(const SPUCodeCache&) = delete;
+
+    // The cache all SPU recompilers share
+    static std::shared_ptr<SPUCodeCache> shared();
+
+    // False if there is no backend for this host
+    bool isAvailable() const { return available_; }
+
+    // The translation of code (the instructions at pc), compiled now if no
+    // SPU has compiled it yet. The caller holds it until release(). hit
+    // tells whether it was already cached. Returns nullptr if the backend
+    // cannot compile it. Compilation is serialised across SPUs but does not
+    // hold up lookups: other SPUs keep finding cached blocks meanwhile.
+    const Entry* acquire(uint32_t pc, const std::vector<uint32_t>& code, uint32_t lsSize, bool& hit);
+    void release(const Entry* entry);
+
+    // Drop every entry no SPU is using
+    void purge();
+    void setCapacity(size_t capacity);
+    SPUCodeCacheStats getStats() const;
+
+private:
+    struct Key {
+        uint64_t hash;
+        uint32_t pc;
+        uint32_t lsSize;
+        bool operator==(const Key& other) const {
+            return hash == other.hash && pc == other.pc && lsSize == other.lsSize;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return static_cast<size_t>(key.hash ^ (uint64_t(key.pc) << 32) ^ key.lsSize);
+        }
+    };
+
+    mutable std::mutex mutex_;  // the entries, the idle list and stats
+    std::mutex backendMutex_;   // compiling and freeing code; never taken before mutex_
+    std::unique_ptr<SPULLVMCompiler> backend_;
+    bool available_;
+    size_t capacity_;
+    std::unordered_multimap<Key, std::unique_ptr<Entry>, KeyHash> entries_;
+    std::list<Entry*> idle_;  // unused entries, most recently released first
+    SPUCodeCacheStats stats_;
+
+    // With mutex_ held: unlink idle entries beyond keep and collect their
+    // code for freeCode(), which must run after mutex_ is released
+    void evict(size_t keep, std::vector<SPUCompiledBlock>& freed);
+    void freeCode(const std::vector<SPUCompiledBlock>& freed);
+};
+
+} // namespace pxs3c
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace pxs3c {
+
+// SPU instruction formats. Opcodes are left-aligned and 4 to 11 bits wide;
+// register and immediate fields sit to their right (IBM bit numbering):
+//   RRR   op[0:3]   rt[4:10]   rb[11:17]  ra[18:24]  rc[25:31]
+//   RR    op[0:10]  rb[11:17]  ra[18:24]  rt[25:31]
+//   RI7   op[0:10]  i7[11:17]  ra[18:24]  rt[25:31]
+//   RI8   op[0:9]   i8[10:17]  ra[18:24]  rt[25:31]
+//   RI10  op[0:7]   i10[8:17]  ra[18:24]  rt[25:31]
+//   RI16  op[0:8]   i16[9:24]  rt[25:31]
+//   RI18  op[0:6]   i18[7:24]  rt[25:31]
+enum class SPUForm : uint8_t { RRR, RR, RI7, RI8, RI10, RI16, RI18 };
+
+// The SPU ISA: X(mnemonic, form, opcode bits, opcode)
+#define PXS3C_SPU_INSTRUCTIONS(X) \
+    /* RRR */ \
+    X(SELB,      RRR,  4, 0x8)   X(SHUFB,     RRR,  4, 0xb)   X(MPYA,      RRR,  4, 0xc)  \
+    X(FNMS,      RRR,  4, 0xd)   X(FMA,       RRR,  4, 0xe)   X(FMS,       RRR,  4, 0xf)  \
+    /* RI18 */ \
+    X(HBRA,      RI18, 7, 0x08)  X(HBRR,      RI18, 7, 0x09)  X(ILA,       RI18, 7, 0x21) \
+    /* RI10 */ \
+    X(ORI,       RI10, 8, 0x04)  X(ORHI,      RI10, 8, 0x05)  X(ORBI,      RI10, 8, 0x06) \
+    X(SFI,       RI10, 8, 0x0c)  X(SFHI,      RI10, 8, 0x0d)  X(ANDI,      RI10, 8, 0x14) \
+    X(ANDHI,     RI10, 8, 0x15)  X(ANDBI,     RI10, 8, 0x16)  X(AI,        RI10, 8, 0x1c) \
+    X(AHI,       RI10, 8, 0x1d)  X(STQD,      RI10, 8, 0x24)  X(LQD,       RI10, 8, 0x34) \
+    X(XORI,      RI10, 8, 0x44)  X(XORHI,     RI10, 8, 0x45)  X(XORBI,     RI10, 8, 0x46) \
+    X(CGTI,      RI10, 8, 0x4c)  X(CGTHI,     RI10, 8, 0x4d)  X(CGTBI,     RI10, 8, 0x4e) \
+    X(HGTI,      RI10, 8, 0x4f)  X(CLGTI,     RI10, 8, 0x5c)  X(CLGTHI,    RI10, 8, 0x5d) \
+    X(CLGTBI,    RI10, 8, 0x5e)  X(HLGTI,     RI10, 8, 0x5f)  X(MPYI,      RI10, 8, 0x74) \
+    X(MPYUI,     RI10, 8, 0x75)  X(CEQI,      RI10, 8, 0x7c)  X(CEQHI,     RI10, 8, 0x7d) \
+    X(CEQBI,     RI10, 8, 0x7e)  X(HEQI,      RI10, 8, 0x7f) \
+    /* RI16 */ \
+    X(BRZ,       RI16, 9, 0x040) X(STQA,      RI16, 9, 0x041) X(BRNZ,      RI16, 9, 0x042) \
+    X(BRHZ,      RI16, 9, 0x044) X(BRHNZ,     RI16, 9, 0x046) X(STQR,      RI16, 9, 0x047) \
+    X(BRA,       RI16, 9, 0x060) X(LQA,       RI16, 9, 0x061) X(BRASL,     RI16, 9, 0x062) \
+    X(BR,        RI16, 9, 0x064) X(FSMBI,     RI16, 9, 0x065) X(BRSL,      RI16, 9, 0x066) \
+    X(LQR,       RI16, 9, 0x067) X(IL,        RI16, 9, 0x081) X(ILHU,      RI16, 9, 0x082) \
+    X(ILH,       RI16, 9, 0x083) X(IOHL,      RI16, 9, 0x0c1) \
+    /* RI8 */ \
+    X(CFLTS,     RI8, 10, 0x1d8) X(CFLTU,     RI8, 10, 0x1d9) X(CSFLT,     RI8, 10, 0x1da) \
+    X(CUFLT,     RI8, 10, 0x1db) \
+    /* RR and RI7 */ \
+    X(STOP,      RR,  11, 0x000) X(LNOP,      RR,  11, 0x001) X(SYNC,      RR,  11, 0x002) \
+    X(DSYNC,     RR,  11, 0x003) X(MFSPR,     RR,  11, 0x00c) X(RDCH,      RR,  11, 0x00d) \
+    X(RCHCNT,    RR,  11, 0x00f) X(SF,        RR,  11, 0x040) X(OR,        RR,  11, 0x041) \
+    X(BG,        RR,  11, 0x042) X(SFH,       RR,  11, 0x048) X(NOR,       RR,  11, 0x049) \
+    X(ABSDB,     RR,  11, 0x053) X(ROT,       RR,  11, 0x058) X(ROTM,      RR,  11, 0x059) \
+    X(ROTMA,     RR,  11, 0x05a) X(SHL,       RR,  11, 0x05b) X(ROTH,      RR,  11, 0x05c) \
+    X(ROTHM,     RR,  11, 0x05d) X(ROTMAH,    RR,  11, 0x05e) X(SHLH,      RR,  11, 0x05f) \
+    X(ROTI,      RI7, 11, 0x078) X(ROTMI,     RI7, 11, 0x079) X(ROTMAI,    RI7, 11, 0x07a) \
+    X(SHLI,      RI7, 11, 0x07b) X(ROTHI,     RI7, 11, 0x07c) X(ROTHMI,    RI7, 11, 0x07d) \
+    X(ROTMAHI,   RI7, 11, 0x07e) X(SHLHI,     RI7, 11, 0x07f) X(A,         RR,  11, 0x0c0) \
+    X(AND,       RR,  11, 0x0c1) X(CG,        RR,  11, 0x0c2) X(AH,        RR,  11, 0x0c8) \
+    X(NAND,      RR,  11, 0x0c9) X(AVGB,      RR,  11, 0x0d3) X(MTSPR,     RR,  11, 0x10c) \
+    X(WRCH,      RR,  11, 0x10d) X(BIZ,       RR,  11, 0x128) X(BINZ,      RR,  11, 0x129) \
+    X(BIHZ,      RR,  11, 0x12a) X(BIHNZ,     RR,  11, 0x12b) X(STOPD,     RR,  11, 0x140) \
+    X(STQX,      RR,  11, 0x144) X(BI,        RR,  11, 0x1a8) X(BISL,      RR,  11, 0x1a9) \
+    X(IRET,      RR,  11, 0x1aa) X(BISLED,    RR,  11, 0x1ab) X(HBR,       RR,  11, 0x1ac) \
+    X(GB,        RR,  11, 0x1b0) X(GBH,       RR,  11, 0x1b1) X(GBB,       RR,  11, 0x1b2) \
+    X(FSM,       RR,  11, 0x1b4) X(FSMH,      RR,  11, 0x1b5) X(FSMB,      RR,  11, 0x1b6) \
+    X(FREST,     RR,  11, 0x1b8) X(FRSQEST,   RR,  11, 0x1b9) X(LQX,       RR,  11, 0x1c4) \
+    X(ROTQBYBI,  RR,  11, 0x1cc) X(ROTQMBYBI, RR,  11, 0x1cd) X(SHLQBYBI,  RR,  11, 0x1cf) \
+    X(CBX,       RR,  11, 0x1d4) X(CHX,       RR,  11, 0x1d5) X(CWX,       RR,  11, 0x1d6) \
+    X(CDX,       RR,  11, 0x1d7) X(ROTQBI,    RR,  11, 0x1d8) X(ROTQMBI,   RR,  11, 0x1d9) \
+    X(SHLQBI,    RR,  11, 0x1db) X(ROTQBY,    RR,  11, 0x1dc) X(ROTQMBY,   RR,  11, 0x1dd) \
+    X(SHLQBY,    RR,  11, 0x1df) X(ORX,       RR,  11, 0x1f0) X(CBD,       RI7, 11, 0x1f4) \
+    X(CHD,       RI7, 11, 0x1f5) X(CWD,       RI7, 11, 0x1f6) X(CDD,       RI7, 11, 0x1f7) \
+    X(ROTQBII,   RI7, 11, 0x1f8) X(ROTQMBII,  RI7, 11, 0x1f9) X(SHLQBII,   RI7, 11, 0x1fb) \
+    X(ROTQBYI,   RI7, 11, 0x1fc) X(ROTQMBYI,  RI7, 11, 0x1fd) X(SHLQBYI,   RI7, 11, 0x1ff) \
+    X(NOP,       RR,  11, 0x201) X(CGT,       RR,  11, 0x240) X(XOR,       RR,  11, 0x241) \
+    X(CGTH,      RR,  11, 0x248) X(EQV,       RR,  11, 0x249) X(CGTB,      RR,  11, 0x250) \
+    X(SUMB,      RR,  11, 0x253) X(HGT,       RR,  11, 0x258) X(CLZ,       RR,  11, 0x2a5) \
+    X(XSWD,      RR,  11, 0x2a6) X(XSHW,      RR,  11, 0x2ae) X(CNTB,      RR,  11, 0x2b4) \
+    X(XSBH,      RR,  11, 0x2b6) X(CLGT,      RR,  11, 0x2c0) X(ANDC,      RR,  11, 0x2c1) \
+    X(FCGT,      RR,  11, 0x2c2) X(DFCGT,     RR,  11, 0x2c3) X(FA,        RR,  11, 0x2c4) \
+    X(FS,        RR,  11, 0x2c5) X(FM,        RR,  11, 0x2c6) X(CLGTH,     RR,  11, 0x2c8) \
+    X(ORC,       RR,  11, 0x2c9) X(FCMGT,     RR,  11, 0x2ca) X(DFCMGT,    RR,  11, 0x2cb) \
+    X(DFA,       RR,  11, 0x2cc) X(DFS,       RR,  11, 0x2cd) X(DFM,       RR,  11, 0x2ce) \
+    X(CLGTB,     RR,  11, 0x2d0) X(HLGT,      RR,  11, 0x2d8) X(ADDX,      RR,  11, 0x340) \
+    X(SFX,       RR,  11, 0x341) X(CGX,       RR,  11, 0x342) X(BGX,       RR,  11, 0x343) \
+    X(MPYHHA,    RR,  11, 0x346) X(MPYHHAU,   RR,  11, 0x34e) X(DFMA,      RR,  11, 0x35c) \
+    X(DFMS,      RR,  11, 0x35d) X(DFNMS,     RR,  11, 0x35e) X(DFNMA,     RR,  11, 0x35f) \
+    X(FSCRRD,    RR,  11, 0x398) X(FESD,      RR,  11, 0x3b8) X(FRDS,      RR,  11, 0x3b9) \
+    X(FSCRWR,    RR,  11, 0x3ba) X(DFTSV,     RI7, 11, 0x3bf) X(CEQ,       RR,  11, 0x3c0) \
+    X(FCEQ,      RR,  11, 0x3c2) X(DFCEQ,     RR,  11, 0x3c3) X(MPY,       RR,  11, 0x3c4) \
+    X(MPYH,      RR,  11, 0x3c5) X(MPYHH,     RR,  11, 0x3c6) X(MPYS,      RR,  11, 0x3c7) \
+    X(CEQH,      RR,  11, 0x3c8) X(FCMEQ,     RR,  11, 0x3ca) X(DFCMEQ,    RR,  11, 0x3cb) \
+    X(MPYU,      RR,  11, 0x3cc) X(MPYHHU,    RR,  11, 0x3ce) X(CEQB,      RR,  11, 0x3d0) \
+    X(FI,        RR,  11, 0x3d4) X(HEQ,       RR,  11, 0x3d8)
+
+enum class SPUOp : uint8_t {
+    INVALID,
+#define PXS3C_SPU_ENUM(name, form, bits, opcode) name,
+    PXS3C_SPU_INSTRUCTIONS(PXS3C_SPU_ENUM)
+#undef PXS3C_SPU_ENUM
+    COUNT
+};
+
+constexpr int SPU_OP_COUNT = static_cast<int>(SPUOp::COUNT);
+
+struct SPUOpInfo {
+    const char* name;
+    SPUForm form;
+    uint8_t bits;
+    uint16_t opcode;
+};
+
+constexpr std::array<SPUOpInfo, SPU_OP_COUNT> SPU_OP_INFO = {{
+    {"(invalid)", SPUForm::RR, 0, 0},
+#define PXS3C_SPU_INFO(name, form, bits, opcode) {#name, SPUForm::form, bits, opcode},
+    PXS3C_SPU_INSTRUCTIONS(PXS3C_SPU_INFO)
+#undef PXS3C_SPU_INFO
+}};
+
+// Every opcode is a prefix of the top 11 instruction bits, so one
+// 2048-entry table indexed by instr >> 21 decodes all formats in O(1). It
+// is built at compile time: an opcode of n bits claims the 2^(11-n) slots
+// it prefixes.
+constexpr std::array<SPUOp, 2048> buildSPUDecodeTable() {
+    std::array<SPUOp, 2048> table{};
+    for (int op = 1; op < SPU_OP_COUNT; ++op) {
+        const SPUOpInfo& info = SPU_OP_INFO[op];
+        uint32_t shift = 11 - info.bits;
+        uint32_t first = static_cast<uint32_t>(info.opcode) << shift;
+        for (uint32_t i = 0; i < (1u << shift); ++i) {
+            table[first + i] = static_cast<SPUOp>(op);
+        }
+    }
+    return table;
+}
+
+// No two opcodes may claim the same slot (the ISA is prefix-free)
+constexpr bool spuOpcodesArePrefixFree() {
+    std::array<int, 2048> owners{};
+    for (int op = 1; op < SPU_OP_COUNT; ++op) {
+        const SPUOpInfo& info = SPU_OP_INFO[op];
+        uint32_t shift = 11 - info.bits;
+        uint32_t first = static_cast<uint32_t>(info.opcode) << shift;
+        for (uint32_t i = 0; i < (1u << shift); ++i) {
+            if (owners[first + i] != 0) return false;
+            owners[first + i] = op;
+        }
+    }
+    return true;
+}
+
+static_assert(spuOpcodesArePrefixFree(), "overlapping SPU opcodes");
+
+inline constexpr std::array<SPUOp, 2048> SPU_DECODE_TABLE = buildSPUDecodeTable();
+
+inline SPUOp spuDecode(uint32_t instr) {
+    return SPU_DECODE_TABLE[instr >> 21];
+}
+
+inline const char* spuOpName(SPUOp op) {
+    return SPU_OP_INFO[static_cast<int>(op)].name;
+}
+
+// Field extraction, shared by the interpreter and the recompilers
+struct SPUInstruction {
+    uint32_t raw;
+
+    uint32_t rt() const { return raw & 0x7F; }
+    uint32_t ra() const { return (raw >> 7) & 0x7F; }
+    uint32_t rb() const { return (raw >> 14) & 0x7F; }
+    // RRR puts its target in bits 4-10 and rc where the others keep rt
+    uint32_t rtRRR() const { return (raw >> 21) & 0x7F; }
+    uint32_t rc() const { return raw & 0x7F; }
+
+    int32_t i7() const { return static_cast<int32_t>(raw << 11) >> 25; }
+    uint32_t i8() const { return (raw >> 14) & 0xFF; }
+    int32_t i10() const { return static_cast<int32_t>(raw << 8) >> 22; }
+    uint32_t i16() const { return (raw >> 7) & 0xFFFF; }
+    int32_t si16() const { return static_cast<int16_t>(i16()); }
+    uint32_t i18() const { return (raw >> 7) & 0x3FFFF; }
+
+    // Branch hints name the hinted branch by its word offset from the hint,
+    // a signed 9-bit field split into ROH (above i16 for hbra/hbrr, in the
+    // low bits of rb for hbr) and ROL (where rt usually sits)
+    int32_t hintOffsetRI16() const { return signExtend9((((raw >> 23) & 3) << 7) | rt()); }
+    int32_t hintOffsetRR() const { return signExtend9((((raw >> 14) & 3) << 7) | rt()); }
+
+private:
+    static int32_t signExtend9(uint32_t v) { return static_cast<int32_t>(v << 23) >> 23; }
+};
+
+} // namespace pxs3c
@@ -1,14 +1,19 @@
 #include "cpu/SPUInterpreter.h"
 #include "memory/MemoryManager.h"
+#include "core/Timebase.h"
 #include <iostream>
 #include <iomanip>
 #include <cstring>
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 namespace pxs3c {
 
 SPUInterpreter::SPUInterpreter(int id)
-    : id_(id), halted_(false) {
+    : id_(id), shadowStale_(false), halted_(false), stalled_(false), stallChannel_(0), channelWaitNs_(0),
+      decrementer_(0), decrementerCycles_(0), cycles_(0), stopCode_(0), loopStart_(0), loopEnd_(0),
+      loopWritten_(false), loopIterations_(0) {
     // Local store allocated later in init() with fallback
 }
 
@@ -16,283 +21,1183 @@ SPUInterpreter::~SPUInterpreter() {}
 
 bool SPUInterpreter::init(std::shared_ptr<MemoryManager> mainMemory) {
     mainMemory_ = mainMemory;
-    // Allocate local store with fallback to 64KB if 256KB fails
-    bool allocated = false;
-    try {
-        localStorage_.assign(SPU_LOCAL_STORE_SIZE, 0);
-        allocated = true;
-    } catch (const std::exception& e) {
-        std::cerr << "SPU" << id_ << " failed to allocate 256KB local store: " << e.what() << std::endl;
-    }
-    if (!allocated) {
-        try {
-            localStorage_.assign(64 * 1024, 0);
-            allocated = true;
-            std::cerr << "SPU" << id_ << " using fallback 64KB local store" << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << "SPU" << id_ << " failed to allocate fallback local store: " << e.what() << std::endl;
-            return false;
-        }
-    }
-
-    // Allocate registers on first init
-    if (!regs_.regs) {
-        try {
-            regs_.regs = std::make_shared<std::array<SPUVector, 128>>();
-        } catch (const std::exception& e) {
-            std::cerr << "SPU" << id_ << " failed to allocate registers: " << e.what() << std::endl;
+    // Reserve the local store with fallback to 64KB if 256KB fails. Pages
+    // are committed when first touched, by a program upload, DMA or a run.
+    if (!localStore_.allocate(SPU_LOCAL_STORE_SIZE)) {
+        std::cerr << "SPU" << id_ << " failed to map 256KB local store" << std::endl;
+        if (!localStore_.allocate(64 * 1024)) {
+            std::cerr << "SPU" << id_ << " failed to map fallback local store" << std::endl;
             return false;
         }
+        std::cerr << "SPU" << id_ << " using fallback 64KB local store" << std::endl;
     }
+    mfc_.init(this, mainMemory_);
+    channels_.init(&mfc_);
     reset();
-    std::cout << "SPU" << id_ << " initialized (" << (localStorage_.size() / 1024) << "KB local store)" << std::endl;
+    std::cout << "SPU" << id_ << " initialized (" << (localStore_.size() / 1024) << "KB local store)" << std::endl;
     return true;
 }
 
 void SPUInterpreter::reset() {
     regs_ = SPURegisters();
-    if (!localStorage_.empty()) {
-        std::fill(localStorage_.begin(), localStorage_.end(), 0);
-    }
+    // Hands the pages back instead of writing zeros over them
+    localStore_.discard();
+    shadowStale_ = false;
+    mfc_.reset();
+    channels_.reset();
     halted_ = false;
+    stalled_ = false;
+    stallChannel_ = 0;
+    decrementer_ = 0;
+    decrementerCycles_ = 0;
+    cycles_ = 0;
+    stopCode_ = 0;
+    loops_.clear();
+    if (recompiler_) {
+        recompiler_->clearCache();
+    }
 }
 
-uint32_t SPUInterpreter::getBits(uint32_t value, int start, int end) const {
-    int count = end - start + 1;
-    return (value >> (31 - end)) & ((1U << count) - 1);
+void SPUInterpreter::setRecompilerConfig(const SPURecompilerConfig& config) {
+    if (!config.enabled) {
+        recompiler_.reset();
+        return;
+    }
+    if (!recompiler_) {
+        auto recompiler = std::make_unique<SPURecompiler>();
+        if (!recompiler->init(this)) {
+            std::cerr << "SPU" << id_ << " recompiler unavailable, using the interpreter" << std::endl;
+            return;
+        }
+        recompiler_ = std::move(recompiler);
+    }
+    recompiler_->setConfig(config);
 }
 
-SPUVector SPUInterpreter::add128(const SPUVector& a, const SPUVector& b) {
-    SPUVector result;
-    result.u64[0] = a.u64[0] + b.u64[0];
-    result.u64[1] = a.u64[1] + b.u64[1];
-    return result;
+void SPUInterpreter::setProfilerConfig(const SPUProfilerConfig& config) {
+    if (!config.enabled || localStore_.empty()) {
+        profiler_.reset();
+        return;
+    }
+    profiler_ = std::make_unique<SPUProfiler>(localStore_.shadow(), localStore_.size(), config.sampleInterval);
 }
 
-SPUVector SPUInterpreter::sub128(const SPUVector& a, const SPUVector& b) {
+SPUVector SPUInterpreter::loadQuad(uint32_t addr) const {
     SPUVector result;
-    result.u64[0] = a.u64[0] - b.u64[0];
-    result.u64[1] = a.u64[1] - b.u64[1];
-    return result;
+    std::memcpy(&result, localStore_.data() + lsAddress(addr), sizeof(result));
+    return spu::byteReverse(result);
 }
 
-SPUVector SPUInterpreter::mul128(const SPUVector& a, const SPUVector& b) {
-    SPUVector result;
-    // Simple 32-bit multiplication
+void SPUInterpreter::storeQuad(uint32_t addr, const SPUVector& val) {
+    uint32_t ls = lsAddress(addr);
+    SPUVector swapped = spu::byteReverse(val);
+    std::memcpy(localStore_.data() + ls, &swapped, sizeof(swapped));
+    // Word element i is already guest word i in host order
+    uint32_t* code = localStore_.shadow() + (ls >> 2);
     for (int i = 0; i < 4; ++i) {
-        result.u32[i] = a.u32[i] * b.u32[i];
+        code[i] = val.w(i);
     }
-    return result;
-}
-
-SPUVector SPUInterpreter::loadWord(uint32_t addr) {
-    if (addr + 16 > localStorage_.size()) {
-        std::cerr << "SPU" << id_ << " load out of bounds: 0x" << std::hex << addr << std::dec << std::endl;
-        return SPUVector();
+    if (recompiler_) {
+        recompiler_->noteWrite(ls, sizeof(val));
+    }
+    if (ls < loopEnd_ && ls + sizeof(val) > loopStart_) {
+        loopWritten_ = true;
     }
-    
-    SPUVector result;
-    std::memcpy(&result, localStorage_.data() + addr, 16);
-    return result;
 }
 
-void SPUInterpreter::storeWord(uint32_t addr, const SPUVector& val) {
-    if (addr + 16 > localStorage_.size()) {
-        std::cerr << "SPU" << id_ << " store out of bounds: 0x" << std::hex << addr << std::dec << std::endl;
+void SPUInterpreter::localStoreWritten(uint32_t addr, uint32_t size) {
+    if (localStore_.empty() || size == 0) {
         return;
     }
-    
-    std::memcpy(localStorage_.data() + addr, &val, 16);
+    uint32_t mask = localStore_.size() - 4;
+    uint32_t words = std::min<uint32_t>((size + (addr & 3) + 3) / 4, localStore_.size() / 4);
+    uint32_t* shadow = localStore_.shadow();
+    for (uint32_t i = 0, a = addr & mask; i < words; ++i, a = (a + 4) & mask) {
+        const uint8_t* p = localStore_.data() + a;
+        uint32_t word = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+                        (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+        // Unchanged words are not written, so rebuilding the shadow of a
+        // mostly empty local store leaves its pages uncommitted
+        if (shadow[a >> 2] != word) {
+            shadow[a >> 2] = word;
+        }
+    }
+    if (recompiler_) {
+        recompiler_->noteWrite(addr, size);
+    }
+}
+
+void SPUInterpreter::rebuildCodeShadow() {
+    shadowStale_ = false;
+    localStoreWritten(0, localStore_.size());
 }
 
 void SPUInterpreter::executeInstruction() {
-    if (halted_ || regs_.pc >= SPU_LOCAL_STORE_SIZE) {
+    if (halted_ || localStore_.empty()) {
         return;
     }
-    
-    // Load instruction from local store (big-endian)
-    uint32_t instr = 0;
-    if (regs_.pc + 4 <= SPU_LOCAL_STORE_SIZE) {
-        std::memcpy(&instr, localStorage_.data() + regs_.pc, 4);
-        // Convert from big-endian if needed
-        instr = ((instr & 0xFF000000) >> 24) |
-                ((instr & 0x00FF0000) >> 8) |
-                ((instr & 0x0000FF00) << 8) |
-                ((instr & 0x000000FF) << 24);
+    if (stalled_) {
+        if (!channels_.isReady(stallChannel_)) {
+            return;
+        }
+        stalled_ = false;
     }
-    
+
+    regs_.pc = instructionAddress(regs_.pc);
+    uint32_t instr = fetchInstruction(regs_.pc);
     regs_.pc += 4;
     decodeAndExecute(instr);
+    if (!stalled_) {
+        cycles_++;
+    }
 }
 
 void SPUInterpreter::executeBlock(int maxInstructions) {
-    for (int i = 0; i < maxInstructions && !halted_; ++i) {
+    // As on the PPU, every block entry is offered to the recompiler. A
+    // compiled block never stops or stalls: those instructions are always
+    // interpreted here.
+    int executed = 0;
+    bool blockEntry = true;
+    while (executed < maxInstructions && !halted_) {
+        if (recompiler_ && blockEntry && !stalled_) {
+            uint32_t start = regs_.pc;
+            uint32_t length = 0;
+            uint32_t retired = recompiler_->executeBlock(maxInstructions - executed, &length);
+            if (retired > 0) {
+                executed += retired;
+                cycles_ += retired;
+                if (profiler_) {
+                    profiler_->recordBlock(start, retired, length, regs_.pc);
+                }
+                continue;
+            }
+        }
+        
+        uint32_t pc = instructionAddress(regs_.pc);
+        uint32_t instr = recompiler_ ? fetchInstruction(pc) : 0;
         executeInstruction();
+        ++executed;
+        if (stalled_) break;
+        if (profiler_) {
+            profiler_->recordInstruction(pc, regs_.pc);
+        }
+        if (recompiler_) {
+            blockEntry = SPURecompiler::precedesBlock(instr);
+        } else if (regs_.pc <= pc && !halted_ && executed < maxInstructions) {
+            // Only a branch goes backwards: run the loop it closes
+            uint32_t head = regs_.pc;
+            int retired = runLoop(head, pc, maxInstructions - executed);
+            if (retired > 0) {
+                executed += retired;
+                cycles_ += retired;
+                if (profiler_) {
+                    profiler_->recordBlock(head, retired, (pc - head) / 4 + 1, regs_.pc);
+                }
+            }
+        }
     }
 }
 
-void SPUInterpreter::decodeAndExecute(uint32_t instr) {
-    uint32_t opcode = getBits(instr, 0, 7);
-    
-    switch (opcode) {
-        case 0x18: // ai (add immediate)
-        case 0x1C: // ahi (add half-word immediate)
-        case 0x08: // a (add)
-        case 0x0C: // ah (add half-word)
-            executeArithmetic(instr);
-            break;
-            
-        case 0x0F: // or, xor, and
-        case 0x0E: // eqv
-            executeLogical(instr);
-            break;
-            
-        case 0x34: // lqd (load quad)
-        case 0x24: // stqd (store quad)
-            executeLoad(instr);
-            break;
-            
-        case 0x64: // br, bra (branch)
-        case 0x65: // brsl (branch with link)
-            executeBranch(instr);
-            break;
-            
-        case 0x20: // il (immediate load)
-        case 0x21: // ilh (immediate load high)
-        case 0x22: // ilhu
-            executeImmediate(instr);
-            break;
-            
-        default:
-            std::cerr << "SPU" << id_ << " unknown instruction: 0x" << std::hex << instr 
-                      << " at PC=0x" << (regs_.pc - 4) << std::dec << std::endl;
-            halted_ = true;
-            break;
-    }
-}
-
-void SPUInterpreter::executeArithmetic(uint32_t instr) {
-    uint32_t opcode = getBits(instr, 0, 7);
-    uint32_t rt = getBits(instr, 8, 12);   // Target register
-    uint32_t ra = getBits(instr, 13, 17);  // Source A
-    uint32_t rb = getBits(instr, 18, 22);  // Source B
-    int32_t imm = (int16_t)getBits(instr, 18, 31);  // Immediate
-    
-    SPUVector result;
-    
-    switch (opcode) {
-        case 0x18: // ai (add immediate)
-            result = add128((*regs_.regs)[ra], SPUVector());
-            result.u32[0] += imm;
-            (*regs_.regs)[rt] = result;
-            break;
-            
-        case 0x08: // a (add)
-            result = add128((*regs_.regs)[ra], (*regs_.regs)[rb]);
-            (*regs_.regs)[rt] = result;
-            break;
-            
-        case 0x04: // s (subtract)
-            result = sub128((*regs_.regs)[ra], (*regs_.regs)[rb]);
-            (*regs_.regs)[rt] = result;
-            break;
-            
-        case 0x14: // m (multiply)
-            result = mul128((*regs_.regs)[ra], (*regs_.regs)[rb]);
-            (*regs_.regs)[rt] = result;
-            break;
-            
-        default:
-            std::cerr << "SPU" << id_ << " unimplemented arithmetic opcode: " << opcode << std::endl;
-            break;
-    }
-}
-
-void SPUInterpreter::executeLogical(uint32_t instr) {
-    uint32_t opcode = getBits(instr, 0, 7);
-    uint32_t rt = getBits(instr, 8, 12);
-    uint32_t ra = getBits(instr, 13, 17);
-    uint32_t rb = getBits(instr, 18, 22);
-    
-    SPUVector result = (*regs_.regs)[ra];
-    
-    switch (opcode) {
-        case 0x0F: { // or, xor, and
-            uint32_t subop = getBits(instr, 23, 31);
-            if (subop == 0x0B8) { // or
-                result.u64[0] |= (*regs_.regs)[rb].u64[0];
-                result.u64[1] |= (*regs_.regs)[rb].u64[1];
-            } else if (subop == 0x0B9) { // xor
-                result.u64[0] ^= (*regs_.regs)[rb].u64[0];
-                result.u64[1] ^= (*regs_.regs)[rb].u64[1];
-            } else if (subop == 0x0BA) { // and
-                result.u64[0] &= (*regs_.regs)[rb].u64[0];
-                result.u64[1] &= (*regs_.regs)[rb].u64[1];
+int SPUInterpreter::runLoop(uint32_t head, uint32_t branchPC, int maxInstructions) {
+    uint32_t length = (branchPC - head) / 4 + 1;
+    if (length > MAX_LOOP_INSTRUCTIONS || static_cast<int>(length) > maxInstructions) {
+        return 0;
+    }
+    if (shadowStale_) {
+        rebuildCodeShadow();
+    }
+    const uint32_t* code = localStore_.shadow() + (head >> 2);
+    DecodedLoop& loop = loops_[head];
+    if (loop.code.size() != length || std::memcmp(loop.code.data(), code, length * sizeof(uint32_t)) != 0) {
+        loop.code.assign(code, code + length);
+        loop.handlers.clear();
+        loop.runnable = SPURecompiler::branchTarget(code[length - 1], branchPC, localStore_.size()) == head;
+        for (uint32_t i = 0; i < length && loop.runnable; ++i) {
+            SPUOp op = spuDecode(code[i]);
+            loop.runnable = !SPURecompiler::leavesBlock(op) && (i == length - 1 || !SPURecompiler::isBranch(op));
+            loop.handlers.push_back(handlers_[static_cast<int>(op)]);
+        }
+    }
+    if (!loop.runnable) {
+        return 0;
+    }
+
+    // Stores into the loop itself end it after the storing instruction, as
+    // does a halt; the caller interprets on from there
+    loopStart_ = head;
+    loopEnd_ = head + length * 4;
+    loopWritten_ = false;
+    int executed = 0;
+    do {
+        for (uint32_t i = 0; i < length; ++i) {
+            regs_.pc = head + i * 4 + 4;
+            (this->*loop.handlers[i])(SPUInstruction{loop.code[i]});
+            if (halted_ || loopWritten_) {
+                executed += i + 1;
+                loopStart_ = loopEnd_ = 0;
+                return executed;
             }
-            break;
         }
-        default:
-            break;
+        executed += length;
+        loopIterations_++;
+    } while (regs_.pc == head && executed + static_cast<int>(length) <= maxInstructions);
+    loopStart_ = loopEnd_ = 0;
+    return executed;
+}
+
+void SPUInterpreter::runUntil(uint64_t targetCycles) {
+    while (cycles_ < targetCycles && !halted_) {
+        uint64_t before = cycles_;
+        executeBlock(static_cast<int>(std::min<uint64_t>(targetCycles - cycles_, 1000000)));
+        if (cycles_ == before && !(stalled_ && waitForChannel())) {
+            break;  // stalled (or not initialised)
+        }
     }
-    
-    (*regs_.regs)[rt] = result;
+    // Stopped and stalled SPUs idle forward with guest time
+    idleUntil(targetCycles);
 }
 
-void SPUInterpreter::executeLoad(uint32_t instr) {
-    uint32_t opcode = getBits(instr, 0, 7);
-    uint32_t rt = getBits(instr, 8, 12);
-    uint32_t ra = getBits(instr, 13, 17);
-    int32_t offset = (int16_t)getBits(instr, 18, 31) << 2; // Offset is in quad-words
-    
-    if (opcode == 0x34) { // lqd
-        uint32_t addr = (*regs_.regs)[ra].u32[0] + offset;
-        SPUVector val = loadWord(addr);
-        (*regs_.regs)[rt] = val;
-    } else if (opcode == 0x24) { // stqd
-        uint32_t addr = (*regs_.regs)[ra].u32[0] + offset;
-        storeWord(addr, (*regs_.regs)[rt]);
+void SPUInterpreter::idleUntil(uint64_t targetCycles) {
+    if (cycles_ >= targetCycles) {
+        return;
     }
+    if (profiler_) {
+        if (stalled_) {
+            profiler_->recordStallCycles(stallChannel_, targetCycles - cycles_);
+        } else if (halted_) {
+            profiler_->recordStoppedCycles(targetCycles - cycles_);
+        }
+    }
+    cycles_ = targetCycles;
 }
 
-void SPUInterpreter::executeBranch(uint32_t instr) {
-    uint32_t opcode = getBits(instr, 0, 7);
-    int32_t target = (int32_t)getBits(instr, 8, 31) << 2; // Offset is in quad-words
-    
-    if (opcode == 0x64) { // br
-        regs_.pc += target - 4; // Adjust because PC was already incremented
-    } else if (opcode == 0x65) { // brsl
-        regs_.lr = regs_.pc;
-        regs_.pc += target - 4;
+const std::array<SPUInterpreter::Handler, SPU_OP_COUNT> SPUInterpreter::handlers_ = {{
+    &SPUInterpreter::INVALID,
+#define PXS3C_SPU_HANDLER_PTR(name, form, bits, opcode) &SPUInterpreter::name,
+    PXS3C_SPU_INSTRUCTIONS(PXS3C_SPU_HANDLER_PTR)
+#undef PXS3C_SPU_HANDLER_PTR
+}};
+
+void SPUInterpreter::decodeAndExecute(uint32_t instr) {
+    (this->*handlers_[static_cast<int>(spuDecode(instr))])(SPUInstruction{instr});
+}
+
+void SPUInterpreter::INVALID(SPUInstruction op) {
+    std::cerr << "SPU" << id_ << " unknown instruction: 0x" << std::hex << op.raw
+              << " at PC=0x" << (regs_.pc - 4) << std::dec << std::endl;
+    halted_ = true;
+}
+
+void SPUInterpreter::unimplemented(SPUInstruction op) {
+    std::cerr << "SPU" << id_ << " unimplemented instruction " << spuOpName(spuDecode(op.raw))
+              << " (0x" << std::hex << op.raw << ") at PC=0x" << (regs_.pc - 4)
+              << std::dec << std::endl;
+    halted_ = true;
+}
+
+void SPUInterpreter::haltIf(bool condition, SPUInstruction op) {
+    if (condition) {
+        std::cerr << "SPU" << id_ << " halt (" << spuOpName(spuDecode(op.raw))
+                  << ") at PC=0x" << std::hex << (regs_.pc - 4) << std::dec << std::endl;
+        halted_ = true;
     }
 }
 
-void SPUInterpreter::executeImmediate(uint32_t instr) {
-    uint32_t opcode = getBits(instr, 0, 7);
-    uint32_t rt = getBits(instr, 8, 12);
-    int32_t imm = (int16_t)getBits(instr, 13, 31);
-    
+void SPUInterpreter::branch(uint32_t target) {
+    regs_.pc = instructionAddress(target);
+}
+
+// A channel access that would block is retried from the same PC once the
+// channel count is non-zero; until then the SPU executes nothing
+void SPUInterpreter::stallOn(uint32_t channel) {
+    regs_.pc -= 4;
+    stalled_ = true;
+    stallChannel_ = channel;
+    if (profiler_) {
+        profiler_->recordStall(channel);
+    }
+}
+
+bool SPUInterpreter::waitForChannel() {
+    // The DMA thread runs alongside the SPUs, so a wait on it always ends;
+    // anything else waits on the PPU and only sleeps if configured to
+    bool dma = mfc_.isAsync() && (stallChannel_ == MFC_RdTagStat || stallChannel_ == MFC_Cmd);
+    uint64_t timeout = dma ? 1000000000ULL : channelWaitNs_;
+    return timeout != 0 && channels_.waitReady(stallChannel_, timeout);
+}
+
+namespace {
+
+using u128 = unsigned __int128;
+
+u128 toU128(const SPUVector& v) {
+    return (static_cast<u128>(v.u64[1]) << 64) | v.u64[0];
+}
+
+SPUVector fromU128(u128 x) {
+    SPUVector v;
+    v.u64[0] = static_cast<uint64_t>(x);
+    v.u64[1] = static_cast<uint64_t>(x >> 64);
+    return v;
+}
+
+// Scalar form of spu::normalizeFloat for the conversions
+float spuFloat(float x) {
+    if (std::isnan(x) || std::isinf(x)) return std::copysign(FLT_MAX, x);
+    if (std::fpclassify(x) == FP_SUBNORMAL) return std::copysign(0.0f, x);
+    return x;
+}
+
+// Byte-granular shifts of the whole quadword; byte 0 is the leftmost
+SPUVector shiftLeftBytes(const SPUVector& a, uint32_t n) {
+    return n > 15 ? SPUVector() : fromU128(toU128(a) << (n * 8));
+}
+
+SPUVector shiftRightBytes(const SPUVector& a, uint32_t n) {
+    return n > 15 ? SPUVector() : fromU128(toU128(a) >> (n * 8));
+}
+
+SPUVector rotateLeftBytes(const SPUVector& a, uint32_t n) {
+    n &= 15;
+    u128 x = toU128(a);
+    return n ? fromU128((x << (n * 8)) | (x >> (128 - n * 8))) : a;
+}
+
+// Generate-controls-for-insertion: the identity shuffle of a into rt with
+// the element at offset t taken from the preferred slot of rb
+SPUVector insertionControl(uint32_t t, int size) {
+    SPUVector r;
+    for (int i = 0; i < 16; ++i) r.b(i) = static_cast<uint8_t>(0x10 + i);
+    uint32_t start = t & ~static_cast<uint32_t>(size - 1) & 0xF;
+    // Preferred slots: byte 3, halfword at byte 2, word at 0, doubleword at 0
+    uint32_t source = size == 1 ? 3 : size == 2 ? 2 : 0;
+    for (int i = 0; i < size; ++i) r.b(start + i) = static_cast<uint8_t>(source + i);
+    return r;
+}
+
+} // namespace
+
+// ---- Memory -----------------------------------------------------------
+
+void SPUInterpreter::LQD(SPUInstruction op) {
+    reg(op.rt()) = loadQuad(reg(op.ra()).w(0) + (op.i10() << 4));
+}
+
+void SPUInterpreter::LQX(SPUInstruction op) {
+    reg(op.rt()) = loadQuad(reg(op.ra()).w(0) + reg(op.rb()).w(0));
+}
+
+void SPUInterpreter::LQA(SPUInstruction op) {
+    reg(op.rt()) = loadQuad(op.si16() << 2);
+}
+
+void SPUInterpreter::LQR(SPUInstruction op) {
+    reg(op.rt()) = loadQuad(regs_.pc - 4 + (op.si16() << 2));
+}
+
+void SPUInterpreter::STQD(SPUInstruction op) {
+    storeQuad(reg(op.ra()).w(0) + (op.i10() << 4), reg(op.rt()));
+}
+
+void SPUInterpreter::STQX(SPUInstruction op) {
+    storeQuad(reg(op.ra()).w(0) + reg(op.rb()).w(0), reg(op.rt()));
+}
+
+void SPUInterpreter::STQA(SPUInstruction op) {
+    storeQuad(op.si16() << 2, reg(op.rt()));
+}
+
+void SPUInterpreter::STQR(SPUInstruction op) {
+    storeQuad(regs_.pc - 4 + (op.si16() << 2), reg(op.rt()));
+}
+
+void SPUInterpreter::CBD(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + op.i7(), 1); }
+void SPUInterpreter::CHD(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + op.i7(), 2); }
+void SPUInterpreter::CWD(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + op.i7(), 4); }
+void SPUInterpreter::CDD(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + op.i7(), 8); }
+void SPUInterpreter::CBX(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + reg(op.rb()).w(0), 1); }
+void SPUInterpreter::CHX(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + reg(op.rb()).w(0), 2); }
+void SPUInterpreter::CWX(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + reg(op.rb()).w(0), 4); }
+void SPUInterpreter::CDX(SPUInstruction op) { reg(op.rt()) = insertionControl(reg(op.ra()).w(0) + reg(op.rb()).w(0), 8); }
+
+// ---- Constant formation -----------------------------------------------
+
+void SPUInterpreter::IL(SPUInstruction op) { reg(op.rt()) = spu::splat32(static_cast<uint32_t>(op.si16())); }
+void SPUInterpreter::ILH(SPUInstruction op) { reg(op.rt()) = spu::splat16(static_cast<uint16_t>(op.i16())); }
+void SPUInterpreter::ILHU(SPUInstruction op) { reg(op.rt()) = spu::splat32(op.i16() << 16); }
+void SPUInterpreter::ILA(SPUInstruction op) { reg(op.rt()) = spu::splat32(op.i18()); }
+
+void SPUInterpreter::IOHL(SPUInstruction op) {
+    reg(op.rt()) = spu::or_(reg(op.rt()), spu::splat32(op.i16()));
+}
+
+void SPUInterpreter::FSMBI(SPUInstruction op) {
+    reg(op.rt()) = spu::expandBits8(op.i16());
+}
+
+// ---- Integer arithmetic -----------------------------------------------
+
+void SPUInterpreter::A(SPUInstruction op) {
+    reg(op.rt()) = spu::add32(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::AH(SPUInstruction op) {
+    reg(op.rt()) = spu::add16(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::AI(SPUInstruction op) {
+    reg(op.rt()) = spu::add32(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::AHI(SPUInstruction op) {
+    reg(op.rt()) = spu::add16(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::SF(SPUInstruction op) {
+    reg(op.rt()) = spu::sub32(reg(op.rb()), reg(op.ra()));
+}
+
+void SPUInterpreter::SFH(SPUInstruction op) {
+    reg(op.rt()) = spu::sub16(reg(op.rb()), reg(op.ra()));
+}
+
+void SPUInterpreter::SFI(SPUInstruction op) {
+    reg(op.rt()) = spu::sub32(spu::splat32(op.i10()), reg(op.ra()));
+}
+
+void SPUInterpreter::SFHI(SPUInstruction op) {
+    reg(op.rt()) = spu::sub16(spu::splat16(static_cast<uint16_t>(op.i10())), reg(op.ra()));
+}
+
+// Carry out iff the wrapped sum is below an operand
+void SPUInterpreter::CG(SPUInstruction op) {
+    const SPUVector& a = reg(op.ra());
+    SPUVector sum = spu::add32(a, reg(op.rb()));
+    reg(op.rt()) = spu::and_(spu::cmpgtu32(a, sum), spu::splat32(1));
+}
+
+void SPUInterpreter::BG(SPUInstruction op) {
+    reg(op.rt()) = spu::andc(spu::splat32(1), spu::cmpgtu32(reg(op.ra()), reg(op.rb())));
+}
+
+void SPUInterpreter::ADDX(SPUInstruction op) {
+    SPUVector carry = spu::and_(reg(op.rt()), spu::splat32(1));
+    reg(op.rt()) = spu::add32(spu::add32(reg(op.ra()), reg(op.rb())), carry);
+}
+
+void SPUInterpreter::SFX(SPUInstruction op) {
+    SPUVector carry = spu::and_(reg(op.rt()), spu::splat32(1));
+    reg(op.rt()) = spu::add32(spu::add32(reg(op.rb()), spu::not_(reg(op.ra()))), carry);
+}
+
+void SPUInterpreter::CGX(SPUInstruction op) {
+    SPUVector& t = reg(op.rt());
+    for (int i = 0; i < 4; ++i) {
+        uint64_t sum = (uint64_t)reg(op.ra()).u32[i] + reg(op.rb()).u32[i] + (t.u32[i] & 1);
+        t.u32[i] = (uint32_t)(sum >> 32);
+    }
+}
+
+void SPUInterpreter::BGX(SPUInstruction op) {
+    SPUVector& t = reg(op.rt());
+    for (int i = 0; i < 4; ++i) {
+        uint32_t a = reg(op.ra()).u32[i], b = reg(op.rb()).u32[i];
+        t.u32[i] = (t.u32[i] & 1) ? (b >= a) : (b > a);
+    }
+}
+
+void SPUInterpreter::MPY(SPUInstruction op) {
+    reg(op.rt()) = spu::mulLowSigned(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::MPYU(SPUInstruction op) {
+    reg(op.rt()) = spu::mulLowUnsigned(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::MPYH(SPUInstruction op) {
+    reg(op.rt()) = spu::mulHighLowShifted(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::MPYS(SPUInstruction op) {
+    reg(op.rt()) = spu::sra32(spu::mulLowSigned(reg(op.ra()), reg(op.rb())), 16);
+}
+
+void SPUInterpreter::MPYHH(SPUInstruction op) {
+    reg(op.rt()) = spu::mulHighSigned(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::MPYHHU(SPUInstruction op) {
+    reg(op.rt()) = spu::mulHighUnsigned(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::MPYHHA(SPUInstruction op) {
+    reg(op.rt()) = spu::add32(reg(op.rt()), spu::mulHighSigned(reg(op.ra()), reg(op.rb())));
+}
+
+void SPUInterpreter::MPYHHAU(SPUInstruction op) {
+    reg(op.rt()) = spu::add32(reg(op.rt()), spu::mulHighUnsigned(reg(op.ra()), reg(op.rb())));
+}
+
+void SPUInterpreter::MPYI(SPUInstruction op) {
+    reg(op.rt()) = spu::mulLowSigned(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::MPYUI(SPUInstruction op) {
+    reg(op.rt()) = spu::mulLowUnsigned(reg(op.ra()), spu::splat32(static_cast<uint32_t>(op.i10()) & 0xFFFF));
+}
+
+void SPUInterpreter::MPYA(SPUInstruction op) {
+    reg(op.rtRRR()) = spu::add32(spu::mulLowSigned(reg(op.ra()), reg(op.rb())), reg(op.rc()));
+}
+
+void SPUInterpreter::CLZ(SPUInstruction op) {
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) {
+        uint32_t x = reg(op.ra()).u32[i];
+        r.u32[i] = x ? __builtin_clz(x) : 32;
+    }
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::CNTB(SPUInstruction op) {
+    SPUVector r;
+    for (int i = 0; i < 16; ++i) r.u8[i] = (uint8_t)__builtin_popcount(reg(op.ra()).u8[i]);
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::AVGB(SPUInstruction op) {
+    reg(op.rt()) = spu::avgu8(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::ABSDB(SPUInstruction op) {
+    reg(op.rt()) = spu::absdiffu8(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::SUMB(SPUInstruction op) {
+    const SPUVector& a = reg(op.ra());
+    const SPUVector& b = reg(op.rb());
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) {
+        uint16_t sumA = 0, sumB = 0;
+        for (int j = 0; j < 4; ++j) {
+            sumA += a.b(i * 4 + j);
+            sumB += b.b(i * 4 + j);
+        }
+        r.h(i * 2) = sumB;
+        r.h(i * 2 + 1) = sumA;
+    }
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::XSBH(SPUInstruction op) {
+    reg(op.rt()) = spu::extendByteToHalf(reg(op.ra()));
+}
+
+void SPUInterpreter::XSHW(SPUInstruction op) {
+    reg(op.rt()) = spu::extendHalfToWord(reg(op.ra()));
+}
+
+void SPUInterpreter::XSWD(SPUInstruction op) {
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.u64[i] = (uint64_t)(int64_t)(int32_t)reg(op.ra()).u64[i];
+    reg(op.rt()) = r;
+}
+
+// ---- Logical ----------------------------------------------------------
+
+void SPUInterpreter::AND(SPUInstruction op) {
+    reg(op.rt()) = spu::and_(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::ANDC(SPUInstruction op) {
+    reg(op.rt()) = spu::andc(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::OR(SPUInstruction op) {
+    reg(op.rt()) = spu::or_(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::ORC(SPUInstruction op) {
+    reg(op.rt()) = spu::orc(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::XOR(SPUInstruction op) {
+    reg(op.rt()) = spu::xor_(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::NAND(SPUInstruction op) {
+    reg(op.rt()) = spu::not_(spu::and_(reg(op.ra()), reg(op.rb())));
+}
+
+void SPUInterpreter::NOR(SPUInstruction op) {
+    reg(op.rt()) = spu::not_(spu::or_(reg(op.ra()), reg(op.rb())));
+}
+
+void SPUInterpreter::EQV(SPUInstruction op) {
+    reg(op.rt()) = spu::not_(spu::xor_(reg(op.ra()), reg(op.rb())));
+}
+
+void SPUInterpreter::ANDI(SPUInstruction op) {
+    reg(op.rt()) = spu::and_(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::ANDHI(SPUInstruction op) {
+    reg(op.rt()) = spu::and_(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::ANDBI(SPUInstruction op) {
+    reg(op.rt()) = spu::and_(reg(op.ra()), spu::splat8(static_cast<uint8_t>(op.i10())));
+}
+
+void SPUInterpreter::ORI(SPUInstruction op) {
+    reg(op.rt()) = spu::or_(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::ORHI(SPUInstruction op) {
+    reg(op.rt()) = spu::or_(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::ORBI(SPUInstruction op) {
+    reg(op.rt()) = spu::or_(reg(op.ra()), spu::splat8(static_cast<uint8_t>(op.i10())));
+}
+
+void SPUInterpreter::XORI(SPUInstruction op) {
+    reg(op.rt()) = spu::xor_(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::XORHI(SPUInstruction op) {
+    reg(op.rt()) = spu::xor_(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::XORBI(SPUInstruction op) {
+    reg(op.rt()) = spu::xor_(reg(op.ra()), spu::splat8(static_cast<uint8_t>(op.i10())));
+}
+
+void SPUInterpreter::SELB(SPUInstruction op) {
+    reg(op.rtRRR()) = spu::select(reg(op.ra()), reg(op.rb()), reg(op.rc()));
+}
+
+void SPUInterpreter::SHUFB(SPUInstruction op) {
+    reg(op.rtRRR()) = spu::shuffleBytes(reg(op.ra()), reg(op.rb()), reg(op.rc()));
+}
+
+void SPUInterpreter::GB(SPUInstruction op) {
+    SPUVector r;
+    r.w(0) = spu::gatherBits32(reg(op.ra()));
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::GBH(SPUInstruction op) {
+    SPUVector r;
+    r.w(0) = spu::gatherBits16(reg(op.ra()));
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::GBB(SPUInstruction op) {
+    SPUVector r;
+    r.w(0) = spu::gatherBits8(reg(op.ra()));
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::FSM(SPUInstruction op) {
+    reg(op.rt()) = spu::expandBits32(reg(op.ra()).w(0));
+}
+
+void SPUInterpreter::FSMH(SPUInstruction op) {
+    reg(op.rt()) = spu::expandBits16(reg(op.ra()).w(0));
+}
+
+void SPUInterpreter::FSMB(SPUInstruction op) {
+    reg(op.rt()) = spu::expandBits8(reg(op.ra()).w(0));
+}
+
+void SPUInterpreter::ORX(SPUInstruction op) {
+    const SPUVector& a = reg(op.ra());
+    SPUVector r;
+    r.w(0) = a.u32[0] | a.u32[1] | a.u32[2] | a.u32[3];
+    reg(op.rt()) = r;
+}
+
+// ---- Shifts and rotates -----------------------------------------------
+
+void SPUInterpreter::SHL(SPUInstruction op) {
+    reg(op.rt()) = spu::shl32v(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::SHLH(SPUInstruction op) {
+    reg(op.rt()) = spu::shl16v(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::SHLI(SPUInstruction op) {
+    reg(op.rt()) = spu::shl32(reg(op.ra()), op.i7() & 0x3F);
+}
+
+void SPUInterpreter::SHLHI(SPUInstruction op) {
+    reg(op.rt()) = spu::shl16(reg(op.ra()), op.i7() & 0x1F);
+}
+
+void SPUInterpreter::ROT(SPUInstruction op) {
+    reg(op.rt()) = spu::rotl32v(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::ROTH(SPUInstruction op) {
+    reg(op.rt()) = spu::rotl16v(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::ROTI(SPUInstruction op) {
+    reg(op.rt()) = spu::rotl32(reg(op.ra()), op.i7());
+}
+
+void SPUInterpreter::ROTHI(SPUInstruction op) {
+    reg(op.rt()) = spu::rotl16(reg(op.ra()), op.i7());
+}
+
+// rotm* shift right by the negated count
+void SPUInterpreter::ROTM(SPUInstruction op) {
+    reg(op.rt()) = spu::shr32v(reg(op.ra()), spu::sub32(SPUVector(), reg(op.rb())));
+}
+
+void SPUInterpreter::ROTHM(SPUInstruction op) {
+    reg(op.rt()) = spu::shr16v(reg(op.ra()), spu::sub16(SPUVector(), reg(op.rb())));
+}
+
+void SPUInterpreter::ROTMI(SPUInstruction op) {
+    reg(op.rt()) = spu::shr32(reg(op.ra()), (0 - op.i7()) & 0x3F);
+}
+
+void SPUInterpreter::ROTHMI(SPUInstruction op) {
+    reg(op.rt()) = spu::shr16(reg(op.ra()), (0 - op.i7()) & 0x1F);
+}
+
+void SPUInterpreter::ROTMA(SPUInstruction op) {
+    reg(op.rt()) = spu::sra32v(reg(op.ra()), spu::sub32(SPUVector(), reg(op.rb())));
+}
+
+void SPUInterpreter::ROTMAH(SPUInstruction op) {
+    reg(op.rt()) = spu::sra16v(reg(op.ra()), spu::sub16(SPUVector(), reg(op.rb())));
+}
+
+void SPUInterpreter::ROTMAI(SPUInstruction op) {
+    reg(op.rt()) = spu::sra32(reg(op.ra()), (0 - op.i7()) & 0x3F);
+}
+
+void SPUInterpreter::ROTMAHI(SPUInstruction op) {
+    reg(op.rt()) = spu::sra16(reg(op.ra()), (0 - op.i7()) & 0x1F);
+}
+
+// Quadword shifts and rotates, by bytes or by 0-7 bits
+void SPUInterpreter::ROTQBY(SPUInstruction op) { reg(op.rt()) = rotateLeftBytes(reg(op.ra()), reg(op.rb()).w(0)); }
+void SPUInterpreter::ROTQBYI(SPUInstruction op) { reg(op.rt()) = rotateLeftBytes(reg(op.ra()), op.i7()); }
+void SPUInterpreter::ROTQBYBI(SPUInstruction op) { reg(op.rt()) = rotateLeftBytes(reg(op.ra()), reg(op.rb()).w(0) >> 3); }
+void SPUInterpreter::SHLQBY(SPUInstruction op) { reg(op.rt()) = shiftLeftBytes(reg(op.ra()), reg(op.rb()).w(0) & 0x1F); }
+void SPUInterpreter::SHLQBYI(SPUInstruction op) { reg(op.rt()) = shiftLeftBytes(reg(op.ra()), op.i7() & 0x1F); }
+void SPUInterpreter::SHLQBYBI(SPUInstruction op) { reg(op.rt()) = shiftLeftBytes(reg(op.ra()), (reg(op.rb()).w(0) >> 3) & 0x1F); }
+void SPUInterpreter::ROTQMBY(SPUInstruction op) { reg(op.rt()) = shiftRightBytes(reg(op.ra()), (0 - reg(op.rb()).w(0)) & 0x1F); }
+void SPUInterpreter::ROTQMBYI(SPUInstruction op) { reg(op.rt()) = shiftRightBytes(reg(op.ra()), (0 - op.i7()) & 0x1F); }
+void SPUInterpreter::ROTQMBYBI(SPUInstruction op) { reg(op.rt()) = shiftRightBytes(reg(op.ra()), (0 - (reg(op.rb()).w(0) >> 3)) & 0x1F); }
+
+void SPUInterpreter::ROTQBI(SPUInstruction op) {
+    uint32_t n = reg(op.rb()).w(0) & 7;
+    u128 x = toU128(reg(op.ra()));
+    reg(op.rt()) = n ? fromU128((x << n) | (x >> (128 - n))) : reg(op.ra());
+}
+
+void SPUInterpreter::ROTQBII(SPUInstruction op) {
+    uint32_t n = op.i7() & 7;
+    u128 x = toU128(reg(op.ra()));
+    reg(op.rt()) = n ? fromU128((x << n) | (x >> (128 - n))) : reg(op.ra());
+}
+
+void SPUInterpreter::SHLQBI(SPUInstruction op) {
+    reg(op.rt()) = fromU128(toU128(reg(op.ra())) << (reg(op.rb()).w(0) & 7));
+}
+
+void SPUInterpreter::SHLQBII(SPUInstruction op) {
+    reg(op.rt()) = fromU128(toU128(reg(op.ra())) << (op.i7() & 7));
+}
+
+void SPUInterpreter::ROTQMBI(SPUInstruction op) {
+    reg(op.rt()) = fromU128(toU128(reg(op.ra())) >> ((0 - reg(op.rb()).w(0)) & 7));
+}
+
+void SPUInterpreter::ROTQMBII(SPUInstruction op) {
+    reg(op.rt()) = fromU128(toU128(reg(op.ra())) >> ((0 - op.i7()) & 7));
+}
+
+// ---- Compares and halts -----------------------------------------------
+
+void SPUInterpreter::CEQ(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpeq32(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CEQH(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpeq16(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CEQB(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpeq8(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CEQI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpeq32(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::CEQHI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpeq16(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::CEQBI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpeq8(reg(op.ra()), spu::splat8(static_cast<uint8_t>(op.i10())));
+}
+
+void SPUInterpreter::CGT(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgt32(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CGTH(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgt16(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CGTB(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgt8(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CGTI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgt32(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::CGTHI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgt16(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::CGTBI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgt8(reg(op.ra()), spu::splat8(static_cast<uint8_t>(op.i10())));
+}
+
+void SPUInterpreter::CLGT(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgtu32(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CLGTH(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgtu16(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CLGTB(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgtu8(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::CLGTI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgtu32(reg(op.ra()), spu::splat32(op.i10()));
+}
+
+void SPUInterpreter::CLGTHI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgtu16(reg(op.ra()), spu::splat16(static_cast<uint16_t>(op.i10())));
+}
+
+void SPUInterpreter::CLGTBI(SPUInstruction op) {
+    reg(op.rt()) = spu::cmpgtu8(reg(op.ra()), spu::splat8(static_cast<uint8_t>(op.i10())));
+}
+
+void SPUInterpreter::HEQ(SPUInstruction op) { haltIf(reg(op.ra()).w(0) == reg(op.rb()).w(0), op); }
+void SPUInterpreter::HEQI(SPUInstruction op) { haltIf(reg(op.ra()).w(0) == (uint32_t)op.i10(), op); }
+void SPUInterpreter::HGT(SPUInstruction op) { haltIf((int32_t)reg(op.ra()).w(0) > (int32_t)reg(op.rb()).w(0), op); }
+void SPUInterpreter::HGTI(SPUInstruction op) { haltIf((int32_t)reg(op.ra()).w(0) > op.i10(), op); }
+void SPUInterpreter::HLGT(SPUInstruction op) { haltIf(reg(op.ra()).w(0) > reg(op.rb()).w(0), op); }
+void SPUInterpreter::HLGTI(SPUInstruction op) { haltIf(reg(op.ra()).w(0) > (uint32_t)op.i10(), op); }
+
+// ---- Branches ---------------------------------------------------------
+
+// Relative targets are from the branch itself; regs_.pc is already past it
+void SPUInterpreter::BR(SPUInstruction op) { branch(regs_.pc - 4 + (op.si16() << 2)); }
+void SPUInterpreter::BRA(SPUInstruction op) { branch(op.si16() << 2); }
+
+void SPUInterpreter::BRSL(SPUInstruction op) {
+    uint32_t target = regs_.pc - 4 + (op.si16() << 2);
+    reg(op.rt()) = SPUVector();
+    reg(op.rt()).w(0) = instructionAddress(regs_.pc);
+    branch(target);
+}
+
+void SPUInterpreter::BRASL(SPUInstruction op) {
+    reg(op.rt()) = SPUVector();
+    reg(op.rt()).w(0) = instructionAddress(regs_.pc);
+    branch(op.si16() << 2);
+}
+
+void SPUInterpreter::BRZ(SPUInstruction op) { if (reg(op.rt()).w(0) == 0) BR(op); }
+void SPUInterpreter::BRNZ(SPUInstruction op) { if (reg(op.rt()).w(0) != 0) BR(op); }
+void SPUInterpreter::BRHZ(SPUInstruction op) { if (reg(op.rt()).h(1) == 0) BR(op); }
+void SPUInterpreter::BRHNZ(SPUInstruction op) { if (reg(op.rt()).h(1) != 0) BR(op); }
+
+void SPUInterpreter::BI(SPUInstruction op) { branch(reg(op.ra()).w(0)); }
+
+void SPUInterpreter::BISL(SPUInstruction op) {
+    uint32_t target = reg(op.ra()).w(0);
+    reg(op.rt()) = SPUVector();
+    reg(op.rt()).w(0) = instructionAddress(regs_.pc);
+    branch(target);
+}
+
+void SPUInterpreter::BIZ(SPUInstruction op) { if (reg(op.rt()).w(0) == 0) branch(reg(op.ra()).w(0)); }
+void SPUInterpreter::BINZ(SPUInstruction op) { if (reg(op.rt()).w(0) != 0) branch(reg(op.ra()).w(0)); }
+void SPUInterpreter::BIHZ(SPUInstruction op) { if (reg(op.rt()).h(1) == 0) branch(reg(op.ra()).w(0)); }
+void SPUInterpreter::BIHNZ(SPUInstruction op) { if (reg(op.rt()).h(1) != 0) branch(reg(op.ra()).w(0)); }
+
+// Interrupts and events are not modelled
+void SPUInterpreter::IRET(SPUInstruction op) { unimplemented(op); }
+void SPUInterpreter::BISLED(SPUInstruction op) { unimplemented(op); }
+
+// Branch hints only steer the hardware's fetch; the recompiler reads loops
+// from them
+void SPUInterpreter::HBR(SPUInstruction) {}
+
+void SPUInterpreter::HBRA(SPUInstruction op) {
+    if (recompiler_) {
+        recompiler_->noteHint(op.raw, regs_.pc - 4);
+    }
+}
+
+void SPUInterpreter::HBRR(SPUInstruction op) {
+    if (recompiler_) {
+        recompiler_->noteHint(op.raw, regs_.pc - 4);
+    }
+}
+
+// ---- Control ----------------------------------------------------------
+
+void SPUInterpreter::STOP(SPUInstruction op) {
+    stopCode_ = op.raw & 0x3FFF;
+    halted_ = true;
+}
+
+void SPUInterpreter::STOPD(SPUInstruction op) {
+    stopCode_ = 0x3FFF;
+    haltIf(true, op);
+}
+
+void SPUInterpreter::LNOP(SPUInstruction) {}
+void SPUInterpreter::NOP(SPUInstruction) {}
+void SPUInterpreter::SYNC(SPUInstruction) {}
+void SPUInterpreter::DSYNC(SPUInstruction) {}
+
+// No SPRs are implemented on the SPU: reads return zero
+void SPUInterpreter::MFSPR(SPUInstruction op) { reg(op.rt()) = SPUVector(); }
+void SPUInterpreter::MTSPR(SPUInstruction) {}
+
+// Channels: the value travels in the preferred slot, the rest is zero
+void SPUInterpreter::RDCH(SPUInstruction op) {
+    uint32_t channel = op.ra();
+    uint32_t value = 0;
+    if (channel == SPU_RdDec) {
+        value = decrementer_ - static_cast<uint32_t>(Timebase::cyclesToTicks(cycles_ - decrementerCycles_));
+    } else {
+        ChannelStatus status = channels_.read(channel, value);
+        if (status == ChannelStatus::WouldBlock) {
+            stallOn(channel);
+            return;
+        }
+        haltIf(status == ChannelStatus::Invalid, op);
+    }
     SPUVector result;
-    
-    switch (opcode) {
-        case 0x20: // il (immediate load)
-            result.u32[0] = imm;
-            result.u32[1] = 0;
-            result.u32[2] = 0;
-            result.u32[3] = 0;
-            break;
-            
-        case 0x21: // ilh (immediate load high)
-            result.u32[0] = imm << 16;
-            result.u32[1] = imm << 16;
-            result.u32[2] = imm << 16;
-            result.u32[3] = imm << 16;
-            break;
-            
-        default:
-            break;
+    result.w(0) = value;
+    reg(op.rt()) = result;
+}
+
+void SPUInterpreter::RCHCNT(SPUInstruction op) {
+    uint32_t channel = op.ra();
+    uint32_t count = (channel == SPU_RdDec || channel == SPU_WrDec) ? 1 : channels_.count(channel);
+    SPUVector result;
+    result.w(0) = count;
+    reg(op.rt()) = result;
+}
+
+void SPUInterpreter::WRCH(SPUInstruction op) {
+    uint32_t channel = op.ra();
+    uint32_t value = reg(op.rt()).w(0);
+    if (channel == SPU_WrDec) {
+        decrementer_ = value;
+        decrementerCycles_ = cycles_;
+        return;
     }
-    
-    (*regs_.regs)[rt] = result;
+    ChannelStatus status = channels_.write(channel, value);
+    if (status == ChannelStatus::WouldBlock) {
+        stallOn(channel);
+        return;
+    }
+    haltIf(status == ChannelStatus::Invalid, op);
+}
+
+// The FPSCR is not modelled: reads as zero, writes are dropped
+void SPUInterpreter::FSCRRD(SPUInstruction op) { reg(op.rt()) = SPUVector(); }
+void SPUInterpreter::FSCRWR(SPUInstruction) {}
+
+// ---- Single precision -------------------------------------------------
+
+void SPUInterpreter::FA(SPUInstruction op) {
+    reg(op.rt()) = spu::normalizeFloat(spu::fadd(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb()))));
+}
+
+void SPUInterpreter::FS(SPUInstruction op) {
+    reg(op.rt()) = spu::normalizeFloat(spu::fsub(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb()))));
+}
+
+void SPUInterpreter::FM(SPUInstruction op) {
+    reg(op.rt()) = spu::normalizeFloat(spu::fmul(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb()))));
+}
+
+void SPUInterpreter::FMA(SPUInstruction op) {
+    reg(op.rtRRR()) = spu::normalizeFloat(spu::fmadd(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb())), spu::normalizeFloat(reg(op.rc()))));
+}
+
+void SPUInterpreter::FMS(SPUInstruction op) {
+    reg(op.rtRRR()) = spu::normalizeFloat(spu::fmadd(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb())), spu::fneg(spu::normalizeFloat(reg(op.rc())))));
+}
+
+void SPUInterpreter::FNMS(SPUInstruction op) {
+    reg(op.rtRRR()) = spu::normalizeFloat(spu::fneg(spu::fmadd(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb())), spu::fneg(spu::normalizeFloat(reg(op.rc()))))));
+}
+
+void SPUInterpreter::FCEQ(SPUInstruction op) {
+    reg(op.rt()) = spu::fcmpeq(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb())));
+}
+
+void SPUInterpreter::FCMEQ(SPUInstruction op) {
+    reg(op.rt()) = spu::fcmpeq(spu::fabs(spu::normalizeFloat(reg(op.ra()))), spu::fabs(spu::normalizeFloat(reg(op.rb()))));
+}
+
+void SPUInterpreter::FCGT(SPUInstruction op) {
+    reg(op.rt()) = spu::fcmpgt(spu::normalizeFloat(reg(op.ra())), spu::normalizeFloat(reg(op.rb())));
+}
+
+void SPUInterpreter::FCMGT(SPUInstruction op) {
+    reg(op.rt()) = spu::fcmpgt(spu::fabs(spu::normalizeFloat(reg(op.ra()))), spu::fabs(spu::normalizeFloat(reg(op.rb()))));
+}
+
+// The estimates are exact here, so fi (interpolate) passes them through
+void SPUInterpreter::FREST(SPUInstruction op) {
+    reg(op.rt()) = spu::normalizeFloat(spu::fdiv(spu::splat32(0x3F800000), spu::normalizeFloat(reg(op.ra()))));
+}
+
+void SPUInterpreter::FRSQEST(SPUInstruction op) {
+    reg(op.rt()) = spu::normalizeFloat(spu::fdiv(spu::splat32(0x3F800000), spu::fsqrt(spu::fabs(spu::normalizeFloat(reg(op.ra()))))));
+}
+
+void SPUInterpreter::FI(SPUInstruction op) {
+    reg(op.rt()) = reg(op.rb());
+}
+
+// Fixed-point conversions scale by 2^(173 - i8) and 2^(i8 - 155)
+void SPUInterpreter::CFLTS(SPUInstruction op) {
+    double scale = std::ldexp(1.0, 173 - (int)op.i8());
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) {
+        double x = (double)spuFloat(reg(op.ra()).f32[i]) * scale;
+        r.u32[i] = x >= 2147483647.0 ? 0x7FFFFFFF : x <= -2147483648.0 ? 0x80000000 : (uint32_t)(int32_t)x;
+    }
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::CFLTU(SPUInstruction op) {
+    double scale = std::ldexp(1.0, 173 - (int)op.i8());
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) {
+        double x = (double)spuFloat(reg(op.ra()).f32[i]) * scale;
+        r.u32[i] = x >= 4294967295.0 ? 0xFFFFFFFF : x <= 0.0 ? 0 : (uint32_t)x;
+    }
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::CSFLT(SPUInstruction op) {
+    double scale = std::ldexp(1.0, (int)op.i8() - 155);
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = spuFloat((float)((int32_t)reg(op.ra()).u32[i] * scale));
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::CUFLT(SPUInstruction op) {
+    double scale = std::ldexp(1.0, (int)op.i8() - 155);
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = spuFloat((float)(reg(op.ra()).u32[i] * scale));
+    reg(op.rt()) = r;
+}
+
+// ---- Double precision -------------------------------------------------
+
+void SPUInterpreter::DFA(SPUInstruction op) {
+    reg(op.rt()) = spu::dadd(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::DFS(SPUInstruction op) {
+    reg(op.rt()) = spu::dsub(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::DFM(SPUInstruction op) {
+    reg(op.rt()) = spu::dmul(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::DFMA(SPUInstruction op) {
+    reg(op.rt()) = spu::dfmadd(reg(op.ra()), reg(op.rb()), reg(op.rt()));
+}
+
+void SPUInterpreter::DFMS(SPUInstruction op) {
+    reg(op.rt()) = spu::dfmadd(reg(op.ra()), reg(op.rb()), spu::dneg(reg(op.rt())));
+}
+
+void SPUInterpreter::DFNMS(SPUInstruction op) {
+    reg(op.rt()) = spu::dneg(spu::dfmadd(reg(op.ra()), reg(op.rb()), spu::dneg(reg(op.rt()))));
+}
+
+void SPUInterpreter::DFNMA(SPUInstruction op) {
+    reg(op.rt()) = spu::dneg(spu::dfmadd(reg(op.ra()), reg(op.rb()), reg(op.rt())));
+}
+
+void SPUInterpreter::DFCEQ(SPUInstruction op) {
+    reg(op.rt()) = spu::dcmpeq(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::DFCMEQ(SPUInstruction op) {
+    reg(op.rt()) = spu::dcmpeq(spu::dabs(reg(op.ra())), spu::dabs(reg(op.rb())));
+}
+
+void SPUInterpreter::DFCGT(SPUInstruction op) {
+    reg(op.rt()) = spu::dcmpgt(reg(op.ra()), reg(op.rb()));
+}
+
+void SPUInterpreter::DFCMGT(SPUInstruction op) {
+    reg(op.rt()) = spu::dcmpgt(spu::dabs(reg(op.ra())), spu::dabs(reg(op.rb())));
+}
+
+// i7 selects: NaN, +inf, -inf, +0, -0, +denormal, -denormal
+void SPUInterpreter::DFTSV(SPUInstruction op) {
+    uint32_t sel = op.i7() & 0x7F;
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) {
+        double x = reg(op.ra()).f64[i];
+        bool neg = std::signbit(x);
+        int cls = std::fpclassify(x);
+        bool match = ((sel & 0x40) && cls == FP_NAN) ||
+                     ((sel & 0x20) && cls == FP_INFINITE && !neg) ||
+                     ((sel & 0x10) && cls == FP_INFINITE && neg) ||
+                     ((sel & 0x08) && cls == FP_ZERO && !neg) ||
+                     ((sel & 0x04) && cls == FP_ZERO && neg) ||
+                     ((sel & 0x02) && cls == FP_SUBNORMAL && !neg) ||
+                     ((sel & 0x01) && cls == FP_SUBNORMAL && neg);
+        r.u64[i] = match ? ~0ULL : 0;
+    }
+    reg(op.rt()) = r;
+}
+
+// Singles live in the left word of each doubleword
+void SPUInterpreter::FESD(SPUInstruction op) {
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.df(i) = (double)reg(op.ra()).f(i * 2);
+    reg(op.rt()) = r;
+}
+
+void SPUInterpreter::FRDS(SPUInstruction op) {
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.f(i * 2) = spuFloat((float)reg(op.ra()).df(i));
+    reg(op.rt()) = r;
 }
 
 void SPUInterpreter::dumpRegisters() const {
@@ -305,7 +1210,7 @@ void SPUInterpreter::dumpRegisters() const {
         std::cout << "R" << std::setw(2) << i << "-" << std::setw(2) << (i+3) << ": ";
         for (int j = 0; j < 4; ++j) {
             std::cout << "0x" << std::hex << std::setfill('0') << std::setw(8) 
-                      << (*regs_.regs)[i + j].u32[0] << " ";
+                      << regs_.regs[i + j].w(0) << " ";
         }
         std::cout << std::dec << std::endl;
     }
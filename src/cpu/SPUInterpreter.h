@@ -4,6 +4,14 @@
 #include <array>
 #include <vector>
 #include <memory>
+#include <unordered_map>
+#include "cpu/SPUDecoder.h"
+#include "cpu/SPUVector.h"
+#include "cpu/SPUMFC.h"
+#include "cpu/SPUChannels.h"
+#include "cpu/SPULocalStore.h"
+#include "cpu/SPUProfiler.h"
+#include "cpu/SPURecompiler.h"
 
 namespace pxs3c {
 
@@ -14,19 +22,10 @@ class MemoryManager;
 // Local Store: 256KB per SPU
 // Registers: 128 x 128-bit
 
-union SPUVector {
-    uint64_t u64[2];
-    uint32_t u32[4];
-    uint16_t u16[8];
-    uint8_t u8[16];
-    float f32[4];
-    double f64[2];
-    
-    SPUVector() { u64[0] = 0; u64[1] = 0; }
-};
-
 struct SPURegisters {
-    std::shared_ptr<std::array<SPUVector, 128>> regs;  // 128 x 128-bit registers (dynamic)
+    // 128 x 128-bit registers, inline and 16-byte aligned so every operand
+    // is a single aligned vector load
+    alignas(16) std::array<SPUVector, 128> regs;
     
     uint32_t pc;      // Program Counter
     uint32_t sp;      // Stack Pointer (r1)
@@ -35,8 +34,6 @@ struct SPURegisters {
     uint32_t status;  // SPU Status Register
     
     SPURegisters() {
-        // Lazy init - allocate registers only when needed
-        regs = nullptr;
         pc = 0;
         sp = 0x3FFF0;  // Top of local store
         lr = 0;
@@ -49,13 +46,6 @@ struct SPURegisters {
 constexpr uint32_t SPU_LOCAL_STORE_SIZE = 256 * 1024;
 constexpr uint32_t SPU_LOCAL_STORE_BASE = 0x0;
 
-// SPU instruction types
-constexpr uint32_t SPU_OP_LOAD = 0x34;    // Load from memory
-constexpr uint32_t SPU_OP_STORE = 0x24;   // Store to memory
-constexpr uint32_t SPU_OP_IMMEDIATE = 0x20; // Immediate load
-constexpr uint32_t SPU_OP_ARITHMETIC = 0x0C; // Arithmetic ops
-constexpr uint32_t SPU_OP_BRANCH = 0x64;  // Branch
-
 class SPUInterpreter {
 public:
     SPUInterpreter(int id = 0);
@@ -64,53 +54,145 @@ public:
     bool init(std::shared_ptr<MemoryManager> mainMemory);
     void reset();
     
-    // Local store
-    std::vector<uint8_t>& getLocalStore() { return localStorage_; }
+    // Local store, in guest (big-endian) byte order. Taking the mutable
+    // reference marks the code shadow stale; it is rebuilt before the next
+    // fetch, so write through it before resuming execution or report the
+    // range with localStoreWritten().
+    SPULocalStore& getLocalStore() { shadowStale_ = true; return localStore_; }
+    const SPULocalStore& getLocalStore() const { return localStore_; }
+    void localStoreWritten(uint32_t addr, uint32_t size);
+    // Raw bytes for bulk writers (DMA), which report what they changed
+    // with localStoreWritten() instead of staling the whole shadow
+    uint8_t* getLocalStorePointer() { return localStore_.data(); }
+    uint32_t getLocalStoreSize() const { return localStore_.size(); }
+    
+    // Quadword access: one 16-byte move and one byte reverse into the
+    // register layout
+    SPUVector loadQuad(uint32_t addr) const;
+    void storeQuad(uint32_t addr, const SPUVector& val);
+    
+    // Instruction fetch from the pre-swapped code shadow
+    uint32_t fetchInstruction(uint32_t addr) {
+        if (shadowStale_) rebuildCodeShadow();
+        return localStore_.shadow()[instructionAddress(addr) >> 2];
+    }
     
     // PC control
     void setPC(uint32_t pc) { regs_.pc = pc; }
     uint32_t getPC() const { return regs_.pc; }
     
     // Register access
-    SPUVector getRegister(int n) const { if (n >= 0 && n < 128) return (*regs_.regs)[n]; return SPUVector(); }
-    void setRegister(int n, const SPUVector& val) { if (n >= 0 && n < 128) (*regs_.regs)[n] = val; }
+    SPUVector getRegister(int n) const { if (n >= 0 && n < 128) return regs_.regs[n]; return SPUVector(); }
+    void setRegister(int n, const SPUVector& val) { if (n >= 0 && n < 128) regs_.regs[n] = val; }
+    
+    // DMA engine
+    SPUMFC& getMFC() { return mfc_; }
+    
+    // Channels, mailboxes and signal notification
+    SPUChannels& getChannels() { return channels_; }
+    // How long a stalled SPU sleeps on its channel before giving up the
+    // rest of its slice. Zero (the default) never sleeps: the PPU only
+    // runs between slices, so nothing could wake it.
+    void setChannelWait(uint64_t ns) { channelWaitNs_ = ns; }
+    
+    // Recompiler: blocks that get hot run as compiled code. Off by default;
+    // enabling it on a host without a backend leaves the interpreter alone.
+    void setRecompilerConfig(const SPURecompilerConfig& config);
+    SPURecompiler* getRecompiler() { return recompiler_.get(); }
     
-    // Execute
+    // Profiler: per-PC counts, branch ratios and stall reasons. Off by
+    // default; a config change starts a fresh profile.
+    void setProfilerConfig(const SPUProfilerConfig& config);
+    SPUProfiler* getProfiler() { return profiler_.get(); }
+    
+    // Execute. executeBlock() runs a loop closed by a backward branch from
+    // its pre-decoded instructions once the branch is first taken, unless
+    // the recompiler is enabled and compiles loops itself.
     void executeInstruction();
     void executeBlock(int maxInstructions = 1000);
+    uint64_t getLoopIterations() const { return loopIterations_; }
+    
+    // Guest time: execute until the cycle counter reaches targetCycles
+    void runUntil(uint64_t targetCycles);
+    // Advance the clock without executing, for a parked SPU
+    void idleUntil(uint64_t targetCycles);
+    uint64_t getCycles() const { return cycles_; }
     
     // Status
     void dumpRegisters() const;
     int getId() const { return id_; }
     bool isHalted() const { return halted_; }
+    bool isStalled() const { return stalled_; }
+    // Nothing to do until someone else acts: stopped, or stalled on a
+    // channel that is still not ready
+    bool isParked() const { return halted_ || (stalled_ && !channels_.isReady(stallChannel_)); }
+    uint32_t getStopCode() const { return stopCode_; }
     
 private:
     int id_;
     SPURegisters regs_;
-    std::vector<uint8_t> localStorage_;  // 256KB local store
+    SPULocalStore localStore_;  // 256KB local store and its code shadow
+    bool shadowStale_;
     std::shared_ptr<MemoryManager> mainMemory_;
+    SPUMFC mfc_;
+    SPUChannels channels_;
     bool halted_;
+    bool stalled_;           // the last rdch/wrch would block; it is retried
+    uint32_t stallChannel_;
+    uint64_t channelWaitNs_;
+    uint32_t decrementer_;   // value last written to SPU_WrDec
+    uint64_t decrementerCycles_;  // and when
+    uint64_t cycles_;  // guest cycles executed, one per instruction
+    uint32_t stopCode_;  // signal of the last stop instruction
+    std::unique_ptr<SPURecompiler> recompiler_;  // null unless enabled
+    std::unique_ptr<SPUProfiler> profiler_;      // null unless enabled
+    
+    friend class SPURecompiler;
+    
+    using Handler = void (SPUInterpreter::*)(SPUInstruction);
+    
+    // A loop body, decoded once: straight-line code ending in the branch
+    // back to its first instruction
+    struct DecodedLoop {
+        std::vector<uint32_t> code;  // revalidated against the shadow on entry
+        std::vector<Handler> handlers;
+        bool runnable = false;       // nothing in it can branch out, stall or stop
+    };
+    static constexpr uint32_t MAX_LOOP_INSTRUCTIONS = 256;
+    std::unordered_map<uint32_t, DecodedLoop> loops_;  // by loop head
+    uint32_t loopStart_;  // local store range of the loop running, empty when none
+    uint32_t loopEnd_;
+    bool loopWritten_;    // a store hit the loop running
+    uint64_t loopIterations_;
+    int runLoop(uint32_t head, uint32_t branchPC, int maxInstructions);
     
-    // Instruction decoding
+    // Instruction decoding: one handler per SPUOp, indexed through the
+    // compile-time decode table
     void decodeAndExecute(uint32_t instruction);
     
-    // Instruction groups
-    void executeLoad(uint32_t instr);
-    void executeStore(uint32_t instr);
-    void executeArithmetic(uint32_t instr);
-    void executeLogical(uint32_t instr);
-    void executeBranch(uint32_t instr);
-    void executeImmediate(uint32_t instr);
+    static const std::array<Handler, SPU_OP_COUNT> handlers_;
+    
+    void INVALID(SPUInstruction op);
+#define PXS3C_SPU_HANDLER(name, form, bits, opcode) void name(SPUInstruction op);
+    PXS3C_SPU_INSTRUCTIONS(PXS3C_SPU_HANDLER)
+#undef PXS3C_SPU_HANDLER
     
     // Helpers
-    uint32_t getBits(uint32_t value, int start, int end) const;
-    SPUVector add128(const SPUVector& a, const SPUVector& b);
-    SPUVector sub128(const SPUVector& a, const SPUVector& b);
-    SPUVector mul128(const SPUVector& a, const SPUVector& b);
-    
-    // Local store access
-    SPUVector loadWord(uint32_t addr);
-    void storeWord(uint32_t addr, const SPUVector& val);
+    SPUVector& reg(uint32_t n) { return regs_.regs[n]; }
+    void unimplemented(SPUInstruction op);
+    void haltIf(bool condition, SPUInstruction op);
+    void branch(uint32_t target);
+    void stallOn(uint32_t channel);
+    bool waitForChannel();
+    
+    // Local store access (quadword aligned, wraps at the local store size)
+    uint32_t lsAddress(uint32_t addr) const {
+        return addr & (localStore_.size() - 1) & ~0xFu;
+    }
+    uint32_t instructionAddress(uint32_t addr) const {
+        return addr & (localStore_.size() - 4);
+    }
+    void rebuildCodeShadow();
 };
 
 } // namespace pxs3c
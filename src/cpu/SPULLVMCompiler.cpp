@@ -0,0 +1,583 @@
+#include "cpu/SPULLVMCompiler.h"
+#include "cpu/SPUInterpreter.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+
+extern "C" void pxs3c_spu_interpret(pxs3c::SPUInterpreter* spu, uint32_t instr, uint32_t pc) {
+    pxs3c::SPURecompiler::interpret(spu, instr, pc);
+}
+
+extern "C" void pxs3c_spu_code_written(pxs3c::SPUInterpreter* spu, uint32_t addr) {
+    pxs3c::SPURecompiler::codeWritten(spu, addr);
+}
+
+namespace pxs3c {
+
+namespace {
+
+#if LLVM_VERSION_MAJOR >= 18
+using JITOptLevel = llvm::CodeGenOptLevel;
+#else
+using JITOptLevel = llvm::CodeGenOpt::Level;
+#endif
+
+constexpr size_t CTX_LOCAL_STORE_OFFSET = offsetof(SPUJITContext, localStore);
+constexpr size_t CTX_CODE_SHADOW_OFFSET = offsetof(SPUJITContext, codeShadow);
+constexpr size_t CTX_SPU_OFFSET = offsetof(SPUJITContext, spu);
+constexpr size_t CTX_CODE_MAP_OFFSET = offsetof(SPUJITContext, codeMap);
+constexpr size_t CTX_BUDGET_OFFSET = offsetof(SPUJITContext, budget);
+constexpr size_t CTX_RETIRED_OFFSET = offsetof(SPUJITContext, retired);
+
+// The register file is an array of 16-byte SPUVectors. Element j of the
+// <4 x i32> (<8 x i16>, <16 x i8>) view is u32[j] (u16[j], u8[j]), so the
+// preferred word slot w(0) is element 3 and halfword h(1) is element 6.
+constexpr unsigned PREFERRED_WORD = 3;
+constexpr unsigned PREFERRED_HALF = 6;
+
+llvm::FixedVectorType* words(llvm::IRBuilder<>& b) { return llvm::FixedVectorType::get(b.getInt32Ty(), 4); }
+llvm::FixedVectorType* halves(llvm::IRBuilder<>& b) { return llvm::FixedVectorType::get(b.getInt16Ty(), 8); }
+llvm::FixedVectorType* bytes(llvm::IRBuilder<>& b) { return llvm::FixedVectorType::get(b.getInt8Ty(), 16); }
+
+llvm::Value* fieldPtr(llvm::IRBuilder<>& b, llvm::Value* base, size_t offset, llvm::Type* ty) {
+    llvm::Value* p = b.CreateConstInBoundsGEP1_64(b.getInt8Ty(), base, offset);
+    return b.CreatePointerCast(p, llvm::PointerType::get(ty, 0));
+}
+
+// Context fields that stay fixed while compiled code runs
+llvm::Value* loadInvariant(llvm::IRBuilder<>& b, llvm::Value* base, size_t offset, llvm::Type* ty) {
+    llvm::LoadInst* load = b.CreateLoad(ty, fieldPtr(b, base, offset, ty));
+    load->setMetadata(llvm::LLVMContext::MD_invariant_load, llvm::MDNode::get(b.getContext(), {}));
+    return load;
+}
+
+llvm::Value* loadReg(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n, llvm::Type* ty) {
+    return b.CreateAlignedLoad(ty, fieldPtr(b, regs, n * sizeof(SPUVector), ty), llvm::Align(16));
+}
+
+void storeReg(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n, llvm::Value* value) {
+    value = b.CreateBitCast(value, words(b));
+    b.CreateAlignedStore(value, fieldPtr(b, regs, n * sizeof(SPUVector), value->getType()), llvm::Align(16));
+}
+
+// An SPUVector computed at compile time, e.g. by the interpreter's own
+// splat and expand helpers, as a constant of the given view
+llvm::Value* constant(llvm::IRBuilder<>& b, const SPUVector& v, llvm::Type* ty) {
+    const uint32_t lanes[4] = {v.u32[0], v.u32[1], v.u32[2], v.u32[3]};
+    llvm::Value* c = llvm::ConstantDataVector::get(b.getContext(), llvm::ArrayRef<uint32_t>(lanes, 4));
+    return b.CreateBitCast(c, ty);
+}
+
+llvm::Value* preferredWord(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n) {
+    return b.CreateExtractElement(loadReg(b, regs, n, words(b)), b.getInt32(PREFERRED_WORD));
+}
+
+llvm::Value* preferredHalf(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n) {
+    return b.CreateExtractElement(loadReg(b, regs, n, halves(b)), b.getInt32(PREFERRED_HALF));
+}
+
+// Link register value: the return address in the preferred slot, zeros
+// elsewhere
+void storeLink(llvm::IRBuilder<>& b, llvm::Value* regs, uint32_t n, uint32_t address) {
+    SPUVector link;
+    link.w(0) = address;
+    storeReg(b, regs, n, constant(b, link, words(b)));
+}
+
+llvm::Value* allOnesWhere(llvm::IRBuilder<>& b, llvm::Value* condition, llvm::Type* ty) {
+    return b.CreateSExt(condition, ty);
+}
+
+llvm::Value* splat(llvm::Type* ty, uint64_t value) {
+    auto* vty = llvm::cast<llvm::FixedVectorType>(ty);
+    return llvm::ConstantVector::getSplat(llvm::ElementCount::getFixed(vty->getNumElements()),
+                                          llvm::ConstantInt::get(vty->getElementType(), value));
+}
+
+// Shifts whose counts may reach the lane width: LLVM leaves those
+// undefined, the SPU gives zero (logical) or the sign (arithmetic)
+llvm::Value* shiftLeft(llvm::IRBuilder<>& b, llvm::Value* a, llvm::Value* n, unsigned width) {
+    llvm::Type* ty = a->getType();
+    llvm::Value* shifted = b.CreateShl(a, b.CreateAnd(n, splat(ty, width - 1)));
+    return b.CreateSelect(b.CreateICmpUGT(n, splat(ty, width - 1)), llvm::Constant::getNullValue(ty), shifted);
+}
+
+llvm::Value* shiftRight(llvm::IRBuilder<>& b, llvm::Value* a, llvm::Value* n, unsigned width) {
+    llvm::Type* ty = a->getType();
+    llvm::Value* shifted = b.CreateLShr(a, b.CreateAnd(n, splat(ty, width - 1)));
+    return b.CreateSelect(b.CreateICmpUGT(n, splat(ty, width - 1)), llvm::Constant::getNullValue(ty), shifted);
+}
+
+llvm::Value* shiftRightArithmetic(llvm::IRBuilder<>& b, llvm::Value* a, llvm::Value* n, unsigned width) {
+    llvm::Type* ty = a->getType();
+    llvm::Value* limit = splat(ty, width - 1);
+    return b.CreateAShr(a, b.CreateSelect(b.CreateICmpUGT(n, limit), limit, n));
+}
+
+llvm::Value* rotateLeft(llvm::IRBuilder<>& b, llvm::Value* a, llvm::Value* n) {
+    return b.CreateIntrinsic(llvm::Intrinsic::fshl, {a->getType()}, {a, a, n});
+}
+
+// Sign- or zero-extended low halfword of each word
+llvm::Value* lowHalfSigned(llvm::IRBuilder<>& b, llvm::Value* a) {
+    return b.CreateAShr(b.CreateShl(a, splat(a->getType(), 16)), splat(a->getType(), 16));
+}
+
+llvm::Value* lowHalfUnsigned(llvm::IRBuilder<>& b, llvm::Value* a) {
+    return b.CreateAnd(a, splat(a->getType(), 0xFFFF));
+}
+
+} // namespace
+
+SPULLVMCompiler::SPULLVMCompiler() : memory_(nullptr), functions_(0) {}
+
+SPULLVMCompiler::~SPULLVMCompiler() {
+    engine_.reset();
+}
+
+bool SPULLVMCompiler::init() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+        llvm::InitializeNativeTargetAsmParser();
+        llvm::sys::DynamicLibrary::AddSymbol("pxs3c_spu_interpret", reinterpret_cast<void*>(&pxs3c_spu_interpret));
+        llvm::sys::DynamicLibrary::AddSymbol("pxs3c_spu_code_written",
+                                             reinterpret_cast<void*>(&pxs3c_spu_code_written));
+    });
+
+    context_ = std::make_unique<llvm::LLVMContext>();
+    std::string error;
+    auto module = std::make_unique<llvm::Module>("pxs3c_spu_jit", *context_);
+    auto memory = std::make_unique<CodeArenaMemoryManager>(CodeArena::shared());
+    CodeArenaMemoryManager* arenaMemory = memory.get();
+    llvm::ExecutionEngine* engine = llvm::EngineBuilder(std::move(module))
+        .setErrorStr(&error)
+        .setEngineKind(llvm::EngineKind::JIT)
+        .setMCJITMemoryManager(std::move(memory))
+        .setOptLevel(JITOptLevel::Default)
+        .create();
+    if (!engine) {
+        std::cerr << "Failed to create SPU LLVM execution engine: " << error << std::endl;
+        return false;
+    }
+    engine_.reset(engine);
+    memory_ = arenaMemory;
+    return true;
+}
+
+SPUCompiledBlock SPULLVMCompiler::compile(uint32_t startPC, const std::vector<uint32_t>& code,
+                                          uint32_t lsSize, uint32_t& native) {
+    native = 0;
+    if (!engine_ || code.empty()) {
+        return nullptr;
+    }
+    auto& ctx = *context_;
+    char name[48];
+    std::snprintf(name, sizeof(name), "spu_%05x_%llu", startPC, static_cast<unsigned long long>(functions_++));
+
+    auto module = std::make_unique<llvm::Module>(name, ctx);
+    module->setDataLayout(engine_->getDataLayout());
+
+    // uint32_t func(SPUVector* regs, SPUJITContext* ctx) -> next PC
+    auto* ptrTy = llvm::PointerType::get(llvm::Type::getInt8Ty(ctx), 0);
+    auto* funcTy = llvm::FunctionType::get(llvm::Type::getInt32Ty(ctx), {ptrTy, ptrTy}, false);
+    auto* func = llvm::Function::Create(funcTy, llvm::Function::ExternalLinkage, name, module.get());
+    BlockArgs args;
+    args.regs = func->getArg(0);
+    args.ctx = func->getArg(1);
+    args.lsSize = lsSize;
+    args.codeWritten = nullptr;
+    args.regs->setName("regs");
+    args.ctx->setName("ctx");
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(ctx, "entry", func));
+    const uint32_t length = static_cast<uint32_t>(code.size());
+    const bool loop = SPURecompiler::isLoop(code, startPC, lsSize);
+    llvm::Value* budget = nullptr;
+    llvm::PHINode* done = nullptr;  // loops: instructions retired by earlier passes
+    if (loop) {
+        args.codeWritten = builder.CreateAlloca(builder.getInt1Ty(), nullptr, "code_written");
+        builder.CreateStore(builder.getFalse(), args.codeWritten);
+        budget = loadInvariant(builder, args.ctx, CTX_BUDGET_OFFSET, builder.getInt32Ty());
+        llvm::BasicBlock* entry = builder.GetInsertBlock();
+        llvm::BasicBlock* body = llvm::BasicBlock::Create(ctx, "loop", func);
+        builder.CreateBr(body);
+        builder.SetInsertPoint(body);
+        done = builder.CreatePHI(builder.getInt32Ty(), 2, "done");
+        done->addIncoming(builder.getInt32(0), entry);
+    }
+    uint32_t pc = startPC;
+    llvm::Value* nextPC = nullptr;
+    bool interpreted = false;
+    for (uint32_t instr : code) {
+        if (SPURecompiler::isBranch(spuDecode(instr))) {
+            nextPC = buildBranchIR(builder, args, pc, instr);
+            native++;
+            break;
+        }
+        if (buildInstructionIR(builder, args, pc, instr)) {
+            native++;
+        } else {
+            buildInterpreterCall(builder, args, pc, instr);
+            interpreted = true;
+        }
+        pc += 4;
+    }
+    if (!nextPC) {
+        nextPC = builder.getInt32(pc & (lsSize - 4));
+    }
+    llvm::Value* retired = builder.getInt32(length);
+    if (loop) {
+        // Go round again while the branch is taken, another pass fits in
+        // the budget and the code is unchanged
+        retired = builder.CreateAdd(done, retired);
+        llvm::Value* again = builder.CreateAnd(
+            builder.CreateAnd(builder.CreateICmpEQ(nextPC, builder.getInt32(startPC & (lsSize - 4))),
+                              builder.CreateICmpULE(builder.CreateAdd(retired, builder.getInt32(length)), budget)),
+            builder.CreateNot(builder.CreateLoad(builder.getInt1Ty(), args.codeWritten)));
+        llvm::BasicBlock* latch = builder.GetInsertBlock();
+        llvm::BasicBlock* exit = llvm::BasicBlock::Create(ctx, "exit", func);
+        builder.CreateCondBr(again, done->getParent(), exit, llvm::MDBuilder(ctx).createBranchWeights(1000, 1));
+        done->addIncoming(retired, latch);
+        builder.SetInsertPoint(exit);
+    }
+    builder.CreateStore(retired, fieldPtr(builder, args.ctx, CTX_RETIRED_OFFSET, builder.getInt32Ty()));
+    builder.CreateRet(nextPC);
+
+    // Without calls out, nothing else can touch the register file
+    if (!interpreted) {
+        func->addParamAttr(0, llvm::Attribute::NoAlias);
+    }
+
+    if (llvm::verifyFunction(*func, &llvm::errs())) {
+        std::cerr << "Failed to verify SPU JIT function" << std::endl;
+        return nullptr;
+    }
+
+    {
+        llvm::LoopAnalysisManager lam;
+        llvm::FunctionAnalysisManager fam;
+        llvm::CGSCCAnalysisManager cgam;
+        llvm::ModuleAnalysisManager mam;
+        llvm::PassBuilder pb(engine_->getTargetMachine());
+        pb.registerModuleAnalyses(mam);
+        pb.registerCGSCCAnalyses(cgam);
+        pb.registerFunctionAnalyses(fam);
+        pb.registerLoopAnalyses(lam);
+        pb.crossRegisterProxies(lam, fam, cgam, mam);
+        pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2).run(*module, mam);
+    }
+
+    // Once the code is emitted the IR is only dead weight
+    llvm::Module* raw = module.get();
+    engine_->addModule(std::move(module));
+    uint64_t address = engine_->getFunctionAddress(name);
+    if (engine_->removeModule(raw)) {
+        delete raw;
+    }
+    CodeArenaMemoryManager::Allocation allocation = memory_->takeAllocation();
+    if (!address) {
+        std::cerr << "SPU LLVM JIT failed to emit block at 0x" << std::hex << startPC << std::dec << std::endl;
+        memory_->release(allocation);
+        return nullptr;
+    }
+    auto block = reinterpret_cast<SPUCompiledBlock>(address);
+    allocations_[block] = std::move(allocation);
+    return block;
+}
+
+void SPULLVMCompiler::release(SPUCompiledBlock block) {
+    auto it = allocations_.find(block);
+    if (it != allocations_.end()) {
+        memory_->release(it->second);
+        allocations_.erase(it);
+    }
+}
+
+void SPULLVMCompiler::buildInterpreterCall(llvm::IRBuilder<>& b, const BlockArgs& args,
+                                           uint32_t pc, uint32_t instr) {
+    llvm::Module* module = b.GetInsertBlock()->getModule();
+    auto* ptrTy = llvm::PointerType::get(b.getInt8Ty(), 0);
+    llvm::FunctionCallee callee = module->getOrInsertFunction(
+        "pxs3c_spu_interpret", llvm::FunctionType::get(b.getVoidTy(), {ptrTy, b.getInt32Ty(), b.getInt32Ty()}, false));
+    llvm::Value* spu = loadInvariant(b, args.ctx, CTX_SPU_OFFSET, ptrTy);
+    b.CreateCall(callee, {spu, b.getInt32(instr), b.getInt32(pc)});
+}
+
+llvm::Value* SPULLVMCompiler::emitLoadQuad(llvm::IRBuilder<>& b, const BlockArgs& args, llvm::Value* addr) {
+    auto* ptrTy = llvm::PointerType::get(b.getInt8Ty(), 0);
+    llvm::Value* ls = loadInvariant(b, args.ctx, CTX_LOCAL_STORE_OFFSET, ptrTy);
+    llvm::Value* offset = b.CreateZExt(b.CreateAnd(addr, b.getInt32((args.lsSize - 1) & ~0xFu)), b.getInt64Ty());
+    llvm::Value* p = b.CreatePointerCast(b.CreateInBoundsGEP(b.getInt8Ty(), ls, offset),
+                                         llvm::PointerType::get(bytes(b), 0));
+    llvm::Value* quad = b.CreateAlignedLoad(bytes(b), p, llvm::Align(16));
+    // Guest byte order to the register layout
+    return b.CreateShuffleVector(quad, {15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0});
+}
+
+void SPULLVMCompiler::emitStoreQuad(llvm::IRBuilder<>& b, const BlockArgs& args, llvm::Value* addr,
+                                    llvm::Value* value) {
+    auto* ptrTy = llvm::PointerType::get(b.getInt8Ty(), 0);
+    llvm::Value* ls = loadInvariant(b, args.ctx, CTX_LOCAL_STORE_OFFSET, ptrTy);
+    llvm::Value* shadow = loadInvariant(b, args.ctx, CTX_CODE_SHADOW_OFFSET, ptrTy);
+    llvm::Value* offset = b.CreateZExt(b.CreateAnd(addr, b.getInt32((args.lsSize - 1) & ~0xFu)), b.getInt64Ty());
+
+    llvm::Value* swapped = b.CreateShuffleVector(b.CreateBitCast(value, bytes(b)),
+                                                 {15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0});
+    b.CreateAlignedStore(swapped, b.CreatePointerCast(b.CreateInBoundsGEP(b.getInt8Ty(), ls, offset),
+                                                      llvm::PointerType::get(bytes(b), 0)),
+                         llvm::Align(16));
+    // The shadow holds guest words in host order: w(0) first
+    llvm::Value* code = b.CreateShuffleVector(b.CreateBitCast(value, words(b)), {3, 2, 1, 0});
+    b.CreateAlignedStore(code, b.CreatePointerCast(b.CreateInBoundsGEP(b.getInt8Ty(), shadow, offset),
+                                                   llvm::PointerType::get(words(b), 0)),
+                         llvm::Align(16));
+
+    // Stores into granules holding compiled code are reported; the rest
+    // fall straight through
+    llvm::Value* codeMap = loadInvariant(b, args.ctx, CTX_CODE_MAP_OFFSET, ptrTy);
+    llvm::Value* granule = b.CreateLShr(offset, SPURecompiler::CODE_GRANULE_SHIFT);
+    llvm::Value* isCode = b.CreateICmpNE(b.CreateLoad(b.getInt8Ty(), b.CreateInBoundsGEP(b.getInt8Ty(), codeMap, granule)),
+                                         b.getInt8(0));
+    llvm::Function* func = b.GetInsertBlock()->getParent();
+    llvm::LLVMContext& ctx = b.getContext();
+    auto* notify = llvm::BasicBlock::Create(ctx, "code_written", func);
+    auto* done = llvm::BasicBlock::Create(ctx, "stored", func);
+    b.CreateCondBr(isCode, notify, done, llvm::MDBuilder(ctx).createBranchWeights(1, 1000));
+    b.SetInsertPoint(notify);
+    llvm::FunctionCallee callee = func->getParent()->getOrInsertFunction(
+        "pxs3c_spu_code_written", llvm::FunctionType::get(b.getVoidTy(), {ptrTy, b.getInt32Ty()}, false));
+    b.CreateCall(callee, {loadInvariant(b, args.ctx, CTX_SPU_OFFSET, ptrTy), b.CreateTrunc(offset, b.getInt32Ty())});
+    if (args.codeWritten) {
+        b.CreateStore(b.getTrue(), args.codeWritten);
+    }
+    b.CreateBr(done);
+    b.SetInsertPoint(done);
+}
+
+bool SPULLVMCompiler::buildInstructionIR(llvm::IRBuilder<>& b, const BlockArgs& args,
+                                         uint32_t pc, uint32_t instr) {
+    SPUInstruction op{instr};
+    llvm::Value* regs = args.regs;
+    llvm::Type* w = words(b);
+    llvm::Type* h = halves(b);
+    llvm::Type* y = bytes(b);
+    auto ra = [&](llvm::Type* ty) { return loadReg(b, regs, op.ra(), ty); };
+    auto rb = [&](llvm::Type* ty) { return loadReg(b, regs, op.rb(), ty); };
+    auto set = [&](llvm::Value* value) { storeReg(b, regs, op.rt(), value); };
+    auto i10w = [&] { return constant(b, spu::splat32(static_cast<uint32_t>(op.i10())), w); };
+    auto i10h = [&] { return constant(b, spu::splat16(static_cast<uint16_t>(op.i10())), h); };
+    auto i10b = [&] { return constant(b, spu::splat8(static_cast<uint8_t>(op.i10())), y); };
+
+    switch (spuDecode(instr)) {
+    // ---- Hints and no-ops ----
+    case SPUOp::NOP: case SPUOp::LNOP: case SPUOp::SYNC: case SPUOp::DSYNC:
+    case SPUOp::HBR: case SPUOp::HBRA: case SPUOp::HBRR:
+        return true;
+
+    // ---- Constant formation ----
+    case SPUOp::IL: set(constant(b, spu::splat32(static_cast<uint32_t>(op.si16())), w)); return true;
+    case SPUOp::ILH: set(constant(b, spu::splat16(static_cast<uint16_t>(op.i16())), w)); return true;
+    case SPUOp::ILHU: set(constant(b, spu::splat32(op.i16() << 16), w)); return true;
+    case SPUOp::ILA: set(constant(b, spu::splat32(op.i18()), w)); return true;
+    case SPUOp::IOHL:
+        set(b.CreateOr(loadReg(b, regs, op.rt(), w), constant(b, spu::splat32(op.i16()), w)));
+        return true;
+    case SPUOp::FSMBI: set(constant(b, spu::expandBits8(op.i16()), w)); return true;
+
+    // ---- Add and subtract ----
+    case SPUOp::A: set(b.CreateAdd(ra(w), rb(w))); return true;
+    case SPUOp::AH: set(b.CreateAdd(ra(h), rb(h))); return true;
+    case SPUOp::AI: set(b.CreateAdd(ra(w), i10w())); return true;
+    case SPUOp::AHI: set(b.CreateAdd(ra(h), i10h())); return true;
+    case SPUOp::SF: set(b.CreateSub(rb(w), ra(w))); return true;
+    case SPUOp::SFH: set(b.CreateSub(rb(h), ra(h))); return true;
+    case SPUOp::SFI: set(b.CreateSub(i10w(), ra(w))); return true;
+    case SPUOp::SFHI: set(b.CreateSub(i10h(), ra(h))); return true;
+
+    // ---- Multiply: 16x16 -> 32 within each word ----
+    case SPUOp::MPY: set(b.CreateMul(lowHalfSigned(b, ra(w)), lowHalfSigned(b, rb(w)))); return true;
+    case SPUOp::MPYU: set(b.CreateMul(lowHalfUnsigned(b, ra(w)), lowHalfUnsigned(b, rb(w)))); return true;
+    case SPUOp::MPYI: set(b.CreateMul(lowHalfSigned(b, ra(w)), lowHalfSigned(b, i10w()))); return true;
+    case SPUOp::MPYUI: set(b.CreateMul(lowHalfUnsigned(b, ra(w)), lowHalfUnsigned(b, i10w()))); return true;
+    case SPUOp::MPYS:
+        set(b.CreateAShr(b.CreateMul(lowHalfSigned(b, ra(w)), lowHalfSigned(b, rb(w))), splat(w, 16)));
+        return true;
+    case SPUOp::MPYH:
+        set(b.CreateShl(b.CreateMul(b.CreateLShr(ra(w), splat(w, 16)), lowHalfUnsigned(b, rb(w))),
+                        splat(w, 16)));
+        return true;
+    case SPUOp::MPYHH:
+        set(b.CreateMul(b.CreateAShr(ra(w), splat(w, 16)), b.CreateAShr(rb(w), splat(w, 16))));
+        return true;
+    case SPUOp::MPYHHU:
+        set(b.CreateMul(b.CreateLShr(ra(w), splat(w, 16)), b.CreateLShr(rb(w), splat(w, 16))));
+        return true;
+    case SPUOp::MPYHHA:
+        set(b.CreateAdd(loadReg(b, regs, op.rt(), w),
+                        b.CreateMul(b.CreateAShr(ra(w), splat(w, 16)), b.CreateAShr(rb(w), splat(w, 16)))));
+        return true;
+    case SPUOp::MPYHHAU:
+        set(b.CreateAdd(loadReg(b, regs, op.rt(), w),
+                        b.CreateMul(b.CreateLShr(ra(w), splat(w, 16)), b.CreateLShr(rb(w), splat(w, 16)))));
+        return true;
+    case SPUOp::MPYA:
+        storeReg(b, regs, op.rtRRR(),
+                 b.CreateAdd(b.CreateMul(lowHalfSigned(b, ra(w)), lowHalfSigned(b, rb(w))),
+                             loadReg(b, regs, op.rc(), w)));
+        return true;
+
+    // ---- Logical ----
+    case SPUOp::AND: set(b.CreateAnd(ra(w), rb(w))); return true;
+    case SPUOp::ANDC: set(b.CreateAnd(ra(w), b.CreateNot(rb(w)))); return true;
+    case SPUOp::OR: set(b.CreateOr(ra(w), rb(w))); return true;
+    case SPUOp::ORC: set(b.CreateOr(ra(w), b.CreateNot(rb(w)))); return true;
+    case SPUOp::XOR: set(b.CreateXor(ra(w), rb(w))); return true;
+    case SPUOp::NAND: set(b.CreateNot(b.CreateAnd(ra(w), rb(w)))); return true;
+    case SPUOp::NOR: set(b.CreateNot(b.CreateOr(ra(w), rb(w)))); return true;
+    case SPUOp::EQV: set(b.CreateNot(b.CreateXor(ra(w), rb(w)))); return true;
+    case SPUOp::ANDI: set(b.CreateAnd(ra(w), i10w())); return true;
+    case SPUOp::ANDHI: set(b.CreateAnd(ra(h), i10h())); return true;
+    case SPUOp::ANDBI: set(b.CreateAnd(ra(y), i10b())); return true;
+    case SPUOp::ORI: set(b.CreateOr(ra(w), i10w())); return true;
+    case SPUOp::ORHI: set(b.CreateOr(ra(h), i10h())); return true;
+    case SPUOp::ORBI: set(b.CreateOr(ra(y), i10b())); return true;
+    case SPUOp::XORI: set(b.CreateXor(ra(w), i10w())); return true;
+    case SPUOp::XORHI: set(b.CreateXor(ra(h), i10h())); return true;
+    case SPUOp::XORBI: set(b.CreateXor(ra(y), i10b())); return true;
+    case SPUOp::SELB: {
+        llvm::Value* mask = loadReg(b, regs, op.rc(), w);
+        storeReg(b, regs, op.rtRRR(),
+                 b.CreateOr(b.CreateAnd(ra(w), b.CreateNot(mask)), b.CreateAnd(rb(w), mask)));
+        return true;
+    }
+
+    // ---- Compare ----
+    case SPUOp::CEQ: set(allOnesWhere(b, b.CreateICmpEQ(ra(w), rb(w)), w)); return true;
+    case SPUOp::CEQH: set(allOnesWhere(b, b.CreateICmpEQ(ra(h), rb(h)), h)); return true;
+    case SPUOp::CEQB: set(allOnesWhere(b, b.CreateICmpEQ(ra(y), rb(y)), y)); return true;
+    case SPUOp::CEQI: set(allOnesWhere(b, b.CreateICmpEQ(ra(w), i10w()), w)); return true;
+    case SPUOp::CEQHI: set(allOnesWhere(b, b.CreateICmpEQ(ra(h), i10h()), h)); return true;
+    case SPUOp::CEQBI: set(allOnesWhere(b, b.CreateICmpEQ(ra(y), i10b()), y)); return true;
+    case SPUOp::CGT: set(allOnesWhere(b, b.CreateICmpSGT(ra(w), rb(w)), w)); return true;
+    case SPUOp::CGTH: set(allOnesWhere(b, b.CreateICmpSGT(ra(h), rb(h)), h)); return true;
+    case SPUOp::CGTB: set(allOnesWhere(b, b.CreateICmpSGT(ra(y), rb(y)), y)); return true;
+    case SPUOp::CGTI: set(allOnesWhere(b, b.CreateICmpSGT(ra(w), i10w()), w)); return true;
+    case SPUOp::CGTHI: set(allOnesWhere(b, b.CreateICmpSGT(ra(h), i10h()), h)); return true;
+    case SPUOp::CGTBI: set(allOnesWhere(b, b.CreateICmpSGT(ra(y), i10b()), y)); return true;
+    case SPUOp::CLGT: set(allOnesWhere(b, b.CreateICmpUGT(ra(w), rb(w)), w)); return true;
+    case SPUOp::CLGTH: set(allOnesWhere(b, b.CreateICmpUGT(ra(h), rb(h)), h)); return true;
+    case SPUOp::CLGTB: set(allOnesWhere(b, b.CreateICmpUGT(ra(y), rb(y)), y)); return true;
+    case SPUOp::CLGTI: set(allOnesWhere(b, b.CreateICmpUGT(ra(w), i10w()), w)); return true;
+    case SPUOp::CLGTHI: set(allOnesWhere(b, b.CreateICmpUGT(ra(h), i10h()), h)); return true;
+    case SPUOp::CLGTBI: set(allOnesWhere(b, b.CreateICmpUGT(ra(y), i10b()), y)); return true;
+
+    // ---- Shift and rotate, per element ----
+    case SPUOp::SHL: set(shiftLeft(b, ra(w), b.CreateAnd(rb(w), splat(w, 0x3F)), 32)); return true;
+    case SPUOp::SHLH: set(shiftLeft(b, ra(h), b.CreateAnd(rb(h), splat(h, 0x1F)), 16)); return true;
+    case SPUOp::SHLI: set(shiftLeft(b, ra(w), splat(w, op.i7() & 0x3F), 32)); return true;
+    case SPUOp::SHLHI: set(shiftLeft(b, ra(h), splat(h, op.i7() & 0x1F), 16)); return true;
+    case SPUOp::ROT: set(rotateLeft(b, ra(w), rb(w))); return true;
+    case SPUOp::ROTH: set(rotateLeft(b, ra(h), rb(h))); return true;
+    case SPUOp::ROTI: set(rotateLeft(b, ra(w), splat(w, op.i7() & 31))); return true;
+    case SPUOp::ROTHI: set(rotateLeft(b, ra(h), splat(h, op.i7() & 15))); return true;
+    // rotm* shift right by the negated count
+    case SPUOp::ROTM:
+        set(shiftRight(b, ra(w), b.CreateAnd(b.CreateNeg(rb(w)), splat(w, 0x3F)), 32));
+        return true;
+    case SPUOp::ROTHM:
+        set(shiftRight(b, ra(h), b.CreateAnd(b.CreateNeg(rb(h)), splat(h, 0x1F)), 16));
+        return true;
+    case SPUOp::ROTMI: set(shiftRight(b, ra(w), splat(w, (0 - op.i7()) & 0x3F), 32)); return true;
+    case SPUOp::ROTHMI: set(shiftRight(b, ra(h), splat(h, (0 - op.i7()) & 0x1F), 16)); return true;
+    case SPUOp::ROTMA:
+        set(shiftRightArithmetic(b, ra(w), b.CreateAnd(b.CreateNeg(rb(w)), splat(w, 0x3F)), 32));
+        return true;
+    case SPUOp::ROTMAH:
+        set(shiftRightArithmetic(b, ra(h), b.CreateAnd(b.CreateNeg(rb(h)), splat(h, 0x1F)), 16));
+        return true;
+    case SPUOp::ROTMAI:
+        set(shiftRightArithmetic(b, ra(w), splat(w, (0 - op.i7()) & 0x3F), 32));
+        return true;
+    case SPUOp::ROTMAHI:
+        set(shiftRightArithmetic(b, ra(h), splat(h, (0 - op.i7()) & 0x1F), 16));
+        return true;
+
+    // ---- Quadword loads and stores ----
+    case SPUOp::LQD:
+        set(emitLoadQuad(b, args, b.CreateAdd(preferredWord(b, regs, op.ra()), b.getInt32(op.i10() << 4))));
+        return true;
+    case SPUOp::LQX:
+        set(emitLoadQuad(b, args, b.CreateAdd(preferredWord(b, regs, op.ra()), preferredWord(b, regs, op.rb()))));
+        return true;
+    case SPUOp::LQA: set(emitLoadQuad(b, args, b.getInt32(op.si16() << 2))); return true;
+    case SPUOp::LQR: set(emitLoadQuad(b, args, b.getInt32(pc + (op.si16() << 2)))); return true;
+    case SPUOp::STQD:
+        emitStoreQuad(b, args, b.CreateAdd(preferredWord(b, regs, op.ra()), b.getInt32(op.i10() << 4)),
+                      loadReg(b, regs, op.rt(), w));
+        return true;
+    case SPUOp::STQX:
+        emitStoreQuad(b, args, b.CreateAdd(preferredWord(b, regs, op.ra()), preferredWord(b, regs, op.rb())),
+                      loadReg(b, regs, op.rt(), w));
+        return true;
+    case SPUOp::STQA:
+        emitStoreQuad(b, args, b.getInt32(op.si16() << 2), loadReg(b, regs, op.rt(), w));
+        return true;
+    case SPUOp::STQR:
+        emitStoreQuad(b, args, b.getInt32(pc + (op.si16() << 2)), loadReg(b, regs, op.rt(), w));
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+llvm::Value* SPULLVMCompiler::buildBranchIR(llvm::IRBuilder<>& b, const BlockArgs& args,
+                                            uint32_t pc, uint32_t instr) {
+    SPUInstruction op{instr};
+    llvm::Value* regs = args.regs;
+    const uint32_t mask = args.lsSize - 4;
+    const uint32_t next = (pc + 4) & mask;
+    const uint32_t relative = (pc + (op.si16() << 2)) & mask;
+    const uint32_t absolute = static_cast<uint32_t>(op.si16() << 2) & mask;
+    auto indirect = [&] { return b.CreateAnd(preferredWord(b, regs, op.ra()), b.getInt32(mask)); };
+    auto choose = [&](llvm::Value* taken, llvm::Value* target) {
+        return b.CreateSelect(taken, target, b.getInt32(next));
+    };
+    auto wordZero = [&] { return b.CreateICmpEQ(preferredWord(b, regs, op.rt()), b.getInt32(0)); };
+    auto halfZero = [&] { return b.CreateICmpEQ(preferredHalf(b, regs, op.rt()), b.getInt16(0)); };
+
+    switch (spuDecode(instr)) {
+    case SPUOp::BR: return b.getInt32(relative);
+    case SPUOp::BRA: return b.getInt32(absolute);
+    case SPUOp::BRSL: storeLink(b, regs, op.rt(), next); return b.getInt32(relative);
+    case SPUOp::BRASL: storeLink(b, regs, op.rt(), next); return b.getInt32(absolute);
+    case SPUOp::BRZ: return choose(wordZero(), b.getInt32(relative));
+    case SPUOp::BRNZ: return choose(b.CreateNot(wordZero()), b.getInt32(relative));
+    case SPUOp::BRHZ: return choose(halfZero(), b.getInt32(relative));
+    case SPUOp::BRHNZ: return choose(b.CreateNot(halfZero()), b.getInt32(relative));
+    case SPUOp::BI: return indirect();
+    case SPUOp::BISL: {
+        llvm::Value* target = indirect();  // before rt, which may be ra
+        storeLink(b, regs, op.rt(), next);
+        return target;
+    }
+    case SPUOp::BIZ: return choose(wordZero(), indirect());
+    case SPUOp::BINZ: return choose(b.CreateNot(wordZero()), indirect());
+    case SPUOp::BIHZ: return choose(halfZero(), indirect());
+    case SPUOp::BIHNZ: return choose(b.CreateNot(halfZero()), indirect());
+    default:
+        return b.getInt32(next);
+    }
+}
+
+} // namespace pxs3c
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#ifdef LLVM_AVAILABLE
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/ExecutionEngine/ExecutionEngine.h"
+#endif
+
+#include "cpu/CodeArenaMemoryManager.h"
+#include "cpu/SPURecompiler.h"
+
+namespace pxs3c {
+
+#ifdef LLVM_AVAILABLE
+// LLVM backend of the SPU recompiler. Integer, logical, compare, shift,
+// multiply, quadword load/store and branch instructions become host vector
+// code (SSE/AVX on x86-64, NEON elsewhere, whatever LLVM targets); the rest
+// call back into the interpreter's handlers. A block that branches back to
+// its start becomes a native loop, left when the branch falls through, the
+// budget could not cover another pass or a store hit compiled code.
+// SPUCodeCache owns the one instance and serialises calls into it.
+class SPULLVMCompiler {
+public:
+    SPULLVMCompiler();
+    ~SPULLVMCompiler();
+
+    bool init();
+
+    // Compile code (the instructions at startPC) for a local store of
+    // lsSize bytes. The last instruction may be a branch. native receives
+    // the number of instructions translated rather than handed back.
+    SPUCompiledBlock compile(uint32_t startPC, const std::vector<uint32_t>& code,
+                             uint32_t lsSize, uint32_t& native);
+    // Frees the code of a block that will not run again
+    void release(SPUCompiledBlock block);
+
+private:
+    std::unique_ptr<llvm::LLVMContext> context_;
+    std::unique_ptr<llvm::ExecutionEngine> engine_;
+    CodeArenaMemoryManager* memory_;  // owned by engine_
+    uint64_t functions_;  // names compiled functions uniquely
+    std::unordered_map<SPUCompiledBlock, CodeArenaMemoryManager::Allocation> allocations_;
+
+    struct BlockArgs {
+        llvm::Value* regs;
+        llvm::Value* ctx;
+        uint32_t lsSize;
+        llvm::Value* codeWritten;  // loops: an i1 slot set when a store hits compiled code
+    };
+
+    // Build IR for one non-branch instruction. Returns false if it has no
+    // translation and must go through the interpreter.
+    bool buildInstructionIR(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                            uint32_t pc, uint32_t instr);
+    // Build the block's terminating branch; returns the next PC
+    llvm::Value* buildBranchIR(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                               uint32_t pc, uint32_t instr);
+    void buildInterpreterCall(llvm::IRBuilder<>& builder, const BlockArgs& args,
+                              uint32_t pc, uint32_t instr);
+
+    llvm::Value* emitLoadQuad(llvm::IRBuilder<>& builder, const BlockArgs& args, llvm::Value* addr);
+    void emitStoreQuad(llvm::IRBuilder<>& builder, const BlockArgs& args, llvm::Value* addr,
+                       llvm::Value* value);
+};
+#else
+// Stub when LLVM is not available
+class SPULLVMCompiler {
+public:
+    bool init() { return false; }
+
+    SPUCompiledBlock compile(uint32_t, const std::vector<uint32_t>&, uint32_t, uint32_t& native) {
+        native = 0;
+        return nullptr;
+    }
+    void release(SPUCompiledBlock) {}
+};
+#endif
+
+} // namespace pxs3c
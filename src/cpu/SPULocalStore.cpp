@@ -0,0 +1,75 @@
+#include "cpu/SPULocalStore.h"
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace pxs3c {
+
+SPULocalStore::SPULocalStore() : data_(nullptr), shadow_(nullptr), size_(0) {}
+
+SPULocalStore::~SPULocalStore() {
+    release();
+}
+
+bool SPULocalStore::allocate(uint32_t size) {
+    release();
+    // The shadow has one host-order word per guest word: as many bytes again
+    void* mapping = mmap(nullptr, size_t(size) * 2, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    data_ = static_cast<uint8_t*>(mapping);
+    shadow_ = reinterpret_cast<uint32_t*>(data_ + size);
+    size_ = size;
+    return true;
+}
+
+void SPULocalStore::release() {
+    if (data_) {
+        munmap(data_, size_t(size_) * 2);
+    }
+    data_ = nullptr;
+    shadow_ = nullptr;
+    size_ = 0;
+}
+
+void SPULocalStore::discard() {
+    if (!data_) {
+        return;
+    }
+#ifdef __linux__
+    // Private anonymous pages read back as zero once dropped
+    madvise(data_, size_t(size_) * 2, MADV_DONTNEED);
+#else
+    // Elsewhere MADV_DONTNEED may keep the contents; map fresh zero pages
+    // over the range instead
+    mmap(data_, size_t(size_) * 2, PROT_READ | PROT_WRITE,
+         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+#endif
+}
+
+size_t SPULocalStore::getResidentBytes() const {
+    if (!data_) {
+        return 0;
+    }
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t length = size_t(size_) * 2;
+#ifdef __linux__
+    std::vector<unsigned char> resident((length + page - 1) / page);
+#else
+    std::vector<char> resident((length + page - 1) / page);
+#endif
+    if (mincore(data_, length, resident.data()) != 0) {
+        return length;
+    }
+    size_t bytes = 0;
+    for (auto flag : resident) {
+        if (flag & 1) {
+            bytes += page;
+        }
+    }
+    return bytes;
+}
+
+} // namespace pxs3c
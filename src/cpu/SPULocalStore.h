@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pxs3c {
+
+// Local store of one SPU context together with its pre-swapped code
+// shadow, in one private anonymous mapping. Mapping only reserves address
+// space: pages are committed by the host when first touched, so a context
+// that never runs or receives DMA costs no memory. discard() returns every
+// page to the host and leaves both views reading as zero, which is what a
+// reset needs, without writing a byte.
+class SPULocalStore {
+public:
+    SPULocalStore();
+    ~SPULocalStore();
+
+    SPULocalStore(const SPULocalStore&) = delete;
+    SPULocalStore& operator=(const SPULocalStore&) = delete;
+
+    // size bytes of local store (a power of two) plus the shadow
+    bool allocate(uint32_t size);
+    void release();
+
+    // Zero the local store and shadow, dropping their pages
+    void discard();
+
+    // Guest (big-endian) bytes
+    uint8_t* data() { return data_; }
+    const uint8_t* data() const { return data_; }
+    uint32_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    uint8_t& operator[](size_t i) { return data_[i]; }
+    const uint8_t& operator[](size_t i) const { return data_[i]; }
+    uint8_t* begin() { return data_; }
+    uint8_t* end() { return data_ + size_; }
+
+    // Local store words in host order, size() / 4 of them
+    uint32_t* shadow() { return shadow_; }
+    const uint32_t* shadow() const { return shadow_; }
+
+    // Host memory currently backing the mapping, in bytes
+    size_t getResidentBytes() const;
+
+private:
+    uint8_t* data_;
+    uint32_t* shadow_;
+    uint32_t size_;
+};
+
+} // namespace pxs3c
@@ -0,0 +1,314 @@
+#include "cpu/SPUMFC.h"
+#include "cpu/SPUInterpreter.h"
+#include "memory/MemoryManager.h"
+#include <algorithm>
+#include <iostream>
+
+namespace pxs3c {
+
+namespace {
+
+bool isListCommand(uint32_t cmd) {
+    return (cmd & ~0x3u) == MFC_PUTL_CMD || (cmd & ~0x3u) == MFC_GETL_CMD;
+}
+
+bool isGetCommand(uint32_t cmd) {
+    return (cmd & 0xF0) == 0x40;
+}
+
+bool isTransferCommand(uint32_t cmd) {
+    switch (cmd) {
+    case MFC_PUT_CMD: case MFC_PUTB_CMD: case MFC_PUTF_CMD:
+    case MFC_PUTL_CMD: case MFC_PUTLB_CMD: case MFC_PUTLF_CMD:
+    case MFC_GET_CMD: case MFC_GETB_CMD: case MFC_GETF_CMD:
+    case MFC_GETL_CMD: case MFC_GETLB_CMD: case MFC_GETLF_CMD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Transfers are 1, 2, 4 or 8 bytes naturally aligned, or whole quadwords;
+// both addresses share their offset within the quadword
+MFCStatus checkTransfer(uint32_t lsa, uint64_t ea, uint32_t size) {
+    if (size > MFC_MAX_TRANSFER) return MFCStatus::InvalidSize;
+    if (size < 16) {
+        if (size != 0 && size != 1 && size != 2 && size != 4 && size != 8) return MFCStatus::InvalidSize;
+        if (size > 1 && ((lsa | ea) & (size - 1))) return MFCStatus::InvalidAlignment;
+        if ((lsa & 0xF) != (ea & 0xF)) return MFCStatus::InvalidAlignment;
+    } else {
+        if (size & 0xF) return MFCStatus::InvalidSize;
+        if ((lsa | ea) & 0xF) return MFCStatus::InvalidAlignment;
+    }
+    return MFCStatus::Ok;
+}
+
+} // namespace
+
+SPUMFC::SPUMFC()
+    : spu_(nullptr), dmaThread_(nullptr), head_(0), count_(0), generation_(0), bytes_(0), completed_(0) {
+    outstanding_.fill(0);
+}
+
+void SPUMFC::init(SPUInterpreter* spu, std::shared_ptr<MemoryManager> memory) {
+    spu_ = spu;
+    memory_ = memory;
+    reset();
+}
+
+void SPUMFC::reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    head_ = 0;
+    count_ = 0;
+    generation_++;
+    outstanding_.fill(0);
+    doneCv_.notify_all();
+}
+
+MFCStatus SPUMFC::enqueue(const MFCCommand& command) {
+    if (command.tag >= MFC_TAG_COUNT) {
+        return MFCStatus::InvalidTag;
+    }
+    if (isListCommand(command.cmd)) {
+        // The list itself lives in local store, 8-byte aligned
+        if (command.size > MFC_MAX_TRANSFER || (command.size & 7) || (command.ea & 7)) {
+            return MFCStatus::InvalidSize;
+        }
+        if (command.lsa & 0xF) {
+            return MFCStatus::InvalidAlignment;
+        }
+    } else if (isTransferCommand(command.cmd)) {
+        MFCStatus status = checkTransfer(command.lsa, command.ea, command.size);
+        if (status != MFCStatus::Ok) return status;
+    } else if (command.cmd != MFC_BARRIER_CMD && command.cmd != MFC_EIEIO_CMD &&
+               command.cmd != MFC_SYNC_CMD) {
+        return MFCStatus::InvalidCommand;
+    }
+
+    if (!dmaThread_) {
+        execute(command);
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        return MFCStatus::Ok;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == MFC_QUEUE_DEPTH) {
+            return MFCStatus::QueueFull;
+        }
+        queue_[(head_ + count_) % MFC_QUEUE_DEPTH] = command;
+        count_++;
+        outstanding_[command.tag]++;
+    }
+    dmaThread_->notify();
+    return MFCStatus::Ok;
+}
+
+uint32_t SPUMFC::getQueueSpace() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<uint32_t>(MFC_QUEUE_DEPTH - count_);
+}
+
+uint32_t SPUMFC::getCompletedTags() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t done = 0;
+    for (int tag = 0; tag < MFC_TAG_COUNT; ++tag) {
+        if (outstanding_[tag] == 0) done |= 1u << tag;
+    }
+    return done;
+}
+
+uint32_t SPUMFC::waitForTags(uint32_t mask, bool all) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto completed = [this, mask] {
+        uint32_t done = 0;
+        for (int tag = 0; tag < MFC_TAG_COUNT; ++tag) {
+            if ((mask & (1u << tag)) && outstanding_[tag] == 0) done |= 1u << tag;
+        }
+        return done;
+    };
+    doneCv_.wait(lock, [&] {
+        uint32_t done = completed();
+        return mask == 0 || (all ? done == mask : done != 0);
+    });
+    return completed();
+}
+
+bool SPUMFC::process() {
+    bool worked = false;
+    for (;;) {
+        MFCCommand command;
+        uint32_t generation;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (count_ == 0) {
+                return worked;
+            }
+            command = queue_[head_];
+            generation = generation_;
+        }
+        // The SPU keeps running (and queueing) during the copy. A command
+        // holds its queue slot and tag until it has finished.
+        execute(command);
+        worked = true;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != generation_) {
+            continue;  // reset while transferring: the queue was dropped
+        }
+        head_ = (head_ + 1) % MFC_QUEUE_DEPTH;
+        count_--;
+        outstanding_[command.tag]--;
+        completed_.fetch_add(1, std::memory_order_relaxed);
+        doneCv_.notify_all();
+    }
+}
+
+void SPUMFC::execute(const MFCCommand& command) {
+    if (!spu_ || !isTransferCommand(command.cmd)) {
+        return;  // barrier/eieio/sync: ordering only, and the queue is in order
+    }
+    bool get = isGetCommand(command.cmd);
+    if (!isListCommand(command.cmd)) {
+        transfer(command.lsa, command.ea, command.size, get);
+        return;
+    }
+
+    // List elements: {stall-and-notify | size, EAL}, big-endian, in local
+    // store at the command's EAL. Stall-and-notify is not modelled; the
+    // list always runs to the end.
+    const uint8_t* ls = spu_->getLocalStorePointer();
+    uint32_t lsMask = spu_->getLocalStoreSize() - 1;
+    uint32_t listAddr = static_cast<uint32_t>(command.ea) & lsMask & ~7u;
+    uint64_t eah = command.ea & 0xFFFFFFFF00000000ULL;
+    uint32_t lsa = command.lsa;
+    for (uint32_t offset = 0; offset < command.size; offset += 8) {
+        const uint8_t* element = ls + ((listAddr + offset) & lsMask);
+        uint32_t size = ((uint32_t(element[2]) << 8) | element[3]) & 0x7FFF;
+        uint32_t eal = (uint32_t(element[4]) << 24) | (uint32_t(element[5]) << 16) |
+                       (uint32_t(element[6]) << 8) | uint32_t(element[7]);
+        if (checkTransfer(lsa, eah | eal, size) != MFCStatus::Ok) {
+            std::cerr << "SPU" << spu_->getId() << " MFC: bad list element at LS 0x" << std::hex
+                      << ((listAddr + offset) & lsMask) << std::dec << std::endl;
+            return;
+        }
+        transfer(lsa, eah | eal, size, get);
+        lsa += size;
+    }
+}
+
+void SPUMFC::transfer(uint32_t lsa, uint64_t ea, uint32_t size, bool get) {
+    if (size == 0 || !memory_) {
+        return;
+    }
+    uint8_t* ls = spu_->getLocalStorePointer();
+    uint32_t lsSize = spu_->getLocalStoreSize();
+    lsa &= lsSize - 1;
+
+    // Local store addresses wrap, so a transfer may come in two pieces
+    uint32_t first = std::min(size, lsSize - lsa);
+    bool ok = get ? memory_->read(ea, ls + lsa, first) : memory_->write(ea, ls + lsa, first);
+    if (ok && first < size) {
+        ok = get ? memory_->read(ea + first, ls, size - first) : memory_->write(ea + first, ls, size - first);
+    }
+    if (!ok) {
+        std::cerr << "SPU" << spu_->getId() << " MFC: " << (get ? "GET" : "PUT") << " of " << size
+                  << " bytes at EA 0x" << std::hex << ea << " failed" << std::dec << std::endl;
+        return;
+    }
+    if (get) {
+        spu_->localStoreWritten(lsa, first);
+        if (first < size) spu_->localStoreWritten(0, size - first);
+    }
+    bytes_.fetch_add(size, std::memory_order_relaxed);
+}
+
+MFCDMAThread::MFCDMAThread()
+    : pending_(false), exit_(false), running_(false) {}
+
+MFCDMAThread::~MFCDMAThread() {
+    stop();
+}
+
+bool MFCDMAThread::start(const std::vector<SPUMFC*>& mfcs) {
+    if (running_) return true;
+    mfcs_ = mfcs;
+    pending_ = false;
+    exit_ = false;
+    try {
+        thread_ = std::thread(&MFCDMAThread::loop, this);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to start MFC DMA thread: " << e.what() << std::endl;
+        return false;
+    }
+    running_ = true;
+    for (SPUMFC* mfc : mfcs_) {
+        if (mfc) mfc->setDMAThread(this);
+    }
+    std::cout << "MFC DMA thread started" << std::endl;
+    return true;
+}
+
+void MFCDMAThread::stop() {
+    if (!running_) return;
+    // Back to inline transfers first, so nothing new is queued for us
+    for (SPUMFC* mfc : mfcs_) {
+        if (mfc) mfc->setDMAThread(nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        exit_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    // Finish whatever was still queued
+    for (SPUMFC* mfc : mfcs_) {
+        if (mfc) mfc->process();
+    }
+    mfcs_.clear();
+    running_ = false;
+}
+
+void MFCDMAThread::attach(SPUMFC* mfc) {
+    if (!running_ || !mfc) return;
+    {
+        std::lock_guard<std::mutex> lock(mfcsMutex_);
+        mfcs_.push_back(mfc);
+    }
+    mfc->setDMAThread(this);
+}
+
+void MFCDMAThread::detach(SPUMFC* mfc) {
+    if (!running_ || !mfc) return;
+    mfc->setDMAThread(nullptr);
+    {
+        std::lock_guard<std::mutex> lock(mfcsMutex_);
+        mfcs_.erase(std::remove(mfcs_.begin(), mfcs_.end(), mfc), mfcs_.end());
+    }
+    mfc->process();
+}
+
+void MFCDMAThread::notify() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_ = true;
+    }
+    cv_.notify_one();
+}
+
+void MFCDMAThread::loop() {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return pending_ || exit_; });
+            if (exit_) return;
+            pending_ = false;
+        }
+        std::lock_guard<std::mutex> lock(mfcsMutex_);
+        for (SPUMFC* mfc : mfcs_) {
+            if (mfc) mfc->process();
+        }
+    }
+}
+
+} // namespace pxs3c
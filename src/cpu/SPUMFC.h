@@ -0,0 +1,144 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pxs3c {
+
+class MemoryManager;
+class SPUInterpreter;
+class MFCDMAThread;
+
+// Memory Flow Controller: each SPU's DMA engine between its local store
+// and main memory. Commands carry a tag (0-31); software waits on tag
+// groups rather than on individual transfers.
+constexpr int MFC_QUEUE_DEPTH = 16;
+constexpr int MFC_TAG_COUNT = 32;
+constexpr uint32_t MFC_MAX_TRANSFER = 16 * 1024;
+
+// Command opcodes (as written to the MFC_Cmd channel). The B and F forms
+// add a barrier or fence within the command's tag group.
+constexpr uint32_t MFC_PUT_CMD = 0x20;
+constexpr uint32_t MFC_PUTB_CMD = 0x21;
+constexpr uint32_t MFC_PUTF_CMD = 0x22;
+constexpr uint32_t MFC_PUTL_CMD = 0x24;
+constexpr uint32_t MFC_PUTLB_CMD = 0x25;
+constexpr uint32_t MFC_PUTLF_CMD = 0x26;
+constexpr uint32_t MFC_GET_CMD = 0x40;
+constexpr uint32_t MFC_GETB_CMD = 0x41;
+constexpr uint32_t MFC_GETF_CMD = 0x42;
+constexpr uint32_t MFC_GETL_CMD = 0x44;
+constexpr uint32_t MFC_GETLB_CMD = 0x45;
+constexpr uint32_t MFC_GETLF_CMD = 0x46;
+constexpr uint32_t MFC_BARRIER_CMD = 0xC0;
+constexpr uint32_t MFC_EIEIO_CMD = 0xC8;
+constexpr uint32_t MFC_SYNC_CMD = 0xCC;
+
+struct MFCCommand {
+    uint32_t lsa = 0;   // local store address
+    uint64_t ea = 0;    // effective address; for lists, EAH plus the list's LS address
+    uint32_t size = 0;  // bytes; for lists, the list size (8 bytes per element)
+    uint32_t tag = 0;
+    uint32_t cmd = 0;
+};
+
+enum class MFCStatus {
+    Ok,
+    QueueFull,       // 16 commands outstanding; retry once some complete
+    InvalidCommand,
+    InvalidTag,
+    InvalidSize,     // not 1, 2, 4, 8 or a multiple of 16 up to 16KB
+    InvalidAlignment,
+};
+
+// Per-SPU command queue and tag-group completion.
+//
+// Without a DMA thread a command runs to completion inside enqueue(). With
+// one, enqueue() only queues it and the thread drains the queue while the
+// SPU keeps executing. The queue is drained strictly in order, which
+// satisfies every fence, barrier and sync ordering rule; the MFC is free
+// to reorder unrelated commands, it just never needs to here.
+class SPUMFC {
+public:
+    SPUMFC();
+
+    void init(SPUInterpreter* spu, std::shared_ptr<MemoryManager> memory);
+    void reset();
+
+    // Set by the owner of the DMA thread; null runs commands inline
+    void setDMAThread(MFCDMAThread* thread) { dmaThread_ = thread; }
+    bool isAsync() const { return dmaThread_ != nullptr; }
+
+    MFCStatus enqueue(const MFCCommand& command);
+    uint32_t getQueueSpace() const;
+
+    // Tag groups with no outstanding commands, bit n for tag n
+    uint32_t getCompletedTags() const;
+    // Block until any (or all) of the tag groups in mask are complete;
+    // returns the completed groups within mask
+    uint32_t waitForTags(uint32_t mask, bool all);
+
+    // DMA thread side: run queued commands; false if there were none
+    bool process();
+
+    uint64_t getBytesTransferred() const { return bytes_.load(std::memory_order_relaxed); }
+    uint64_t getCommandsCompleted() const { return completed_.load(std::memory_order_relaxed); }
+
+private:
+    SPUInterpreter* spu_;
+    std::shared_ptr<MemoryManager> memory_;
+    MFCDMAThread* dmaThread_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable doneCv_;
+    std::array<MFCCommand, MFC_QUEUE_DEPTH> queue_;
+    int head_;
+    int count_;
+    uint32_t generation_;  // bumped by reset() to drop in-flight completions
+    std::array<uint16_t, MFC_TAG_COUNT> outstanding_;  // queued commands per tag
+
+    std::atomic<uint64_t> bytes_;
+    std::atomic<uint64_t> completed_;
+
+    void execute(const MFCCommand& command);
+    void transfer(uint32_t lsa, uint64_t ea, uint32_t size, bool get);
+};
+
+// One host thread that performs the queued transfers of every SPU context
+class MFCDMAThread {
+public:
+    MFCDMAThread();
+    ~MFCDMAThread();
+
+    bool start(const std::vector<SPUMFC*>& mfcs);
+    void stop();
+    bool isRunning() const { return running_; }
+
+    // Contexts created or destroyed while the thread runs. detach() returns
+    // once the thread is done with mfc; its queue is then finished inline.
+    void attach(SPUMFC* mfc);
+    void detach(SPUMFC* mfc);
+
+    // Called after a command is queued
+    void notify();
+
+private:
+    std::vector<SPUMFC*> mfcs_;
+    std::mutex mfcsMutex_;  // held while the thread walks mfcs_
+    std::thread thread_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool pending_;
+    bool exit_;
+    bool running_;
+
+    void loop();
+};
+
+} // namespace pxs3c
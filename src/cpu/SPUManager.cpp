@@ -1,13 +1,13 @@
 #include "cpu/SPUManager.h"
 #include "memory/MemoryManager.h"
+#include <algorithm>
 #include <iostream>
-#include <thread>
 
 namespace pxs3c {
 
-SPUManager::SPUManager() {
-    for (int i = 0; i < 6; ++i) {
-        spus_[i] = std::make_unique<SPUInterpreter>(i);
+SPUManager::SPUManager() : guestCycles_(0) {
+    for (int i = 0; i < SPU_RAW_COUNT; ++i) {
+        contexts_.push_back({std::make_unique<SPUInterpreter>(i), -1});
     }
 }
 
@@ -16,54 +16,226 @@ SPUManager::~SPUManager() {
 }
 
 bool SPUManager::init(std::shared_ptr<MemoryManager> mainMemory) {
-    std::cout << "Initializing 6 SPU cores..." << std::endl;
-    for (int i = 0; i < 6; ++i) {
-        if (!spus_[i]->init(mainMemory)) {
+    mainMemory_ = mainMemory;
+    std::cout << "Initializing " << SPU_RAW_COUNT << " SPU cores..." << std::endl;
+    for (int i = 0; i < SPU_RAW_COUNT; ++i) {
+        if (!contexts_[i].spu->init(mainMemory)) {
             std::cerr << "Failed to initialize SPU" << i << std::endl;
             return false;
         }
     }
     std::cout << "All SPU cores initialized (256KB local store each)" << std::endl;
+    if (!startWorkers()) {
+        std::cerr << "SPU worker threads unavailable, running SPUs on the caller" << std::endl;
+    }
     return true;
 }
 
-void SPUManager::shutdown() {
-    for (int i = 0; i < 6; ++i) {
-        spus_[i].reset();
+bool SPUManager::startWorkers() {
+    if (workerConfig_.asyncDMA) {
+        std::vector<SPUMFC*> mfcs;
+        for (auto& context : contexts_) {
+            if (context.spu) {
+                mfcs.push_back(&context.spu->getMFC());
+            }
+        }
+        if (!dma_.start(mfcs)) {
+            std::cerr << "MFC transfers will run inline" << std::endl;
+        }
+    }
+    return workers_.start(workerConfig_);
+}
+
+void SPUManager::setWorkerConfig(const SPUWorkerConfig& config) {
+    workerConfig_ = config;
+    for (auto& context : contexts_) {
+        if (context.spu) {
+            context.spu->setChannelWait(uint64_t(config.channelWaitUs) * 1000);
+        }
+    }
+    if (workers_.isRunning() || dma_.isRunning()) {
+        workers_.stop();
+        dma_.stop();
+        startWorkers();
+    }
+}
+
+void SPUManager::setRecompilerConfig(const SPURecompilerConfig& config) {
+    recompilerConfig_ = config;
+    for (auto& context : contexts_) {
+        if (context.spu) {
+            context.spu->setRecompilerConfig(config);
+        }
+    }
+}
+
+void SPUManager::setProfilerConfig(const SPUProfilerConfig& config) {
+    profilerConfig_ = config;
+    for (auto& context : contexts_) {
+        if (context.spu) {
+            context.spu->setProfilerConfig(config);
+        }
+    }
+}
+
+void SPUManager::reportProfiles(std::ostream& out, size_t top) const {
+    for (const auto& context : contexts_) {
+        SPUProfiler* profiler = context.spu ? context.spu->getProfiler() : nullptr;
+        if (profiler && profiler->getSamples() > 0) {
+            profiler->report(out, context.spu->getId(), top);
+        }
     }
 }
 
+int SPUManager::createContext(int group) {
+    // Reuse the lowest free id
+    int id = 0;
+    while (id < static_cast<int>(contexts_.size()) && contexts_[id].spu) {
+        ++id;
+    }
+    auto spu = std::make_unique<SPUInterpreter>(id);
+    if (!spu->init(mainMemory_)) {
+        return -1;
+    }
+    spu->setChannelWait(uint64_t(workerConfig_.channelWaitUs) * 1000);
+    if (recompilerConfig_.enabled) {
+        spu->setRecompilerConfig(recompilerConfig_);
+    }
+    if (profilerConfig_.enabled) {
+        spu->setProfilerConfig(profilerConfig_);
+    }
+    dma_.attach(&spu->getMFC());
+    if (id == static_cast<int>(contexts_.size())) {
+        contexts_.emplace_back();
+    }
+    contexts_[id].spu = std::move(spu);
+    contexts_[id].group = group;
+    return id;
+}
+
+void SPUManager::destroyContext(int id) {
+    Context& context = contexts_[id];
+    dma_.detach(&context.spu->getMFC());
+    context.spu.reset();
+    context.group = -1;
+    while (!contexts_.empty() && !contexts_.back().spu) {
+        contexts_.pop_back();
+    }
+}
+
+int SPUManager::createThreadGroup(const std::string& name, int threads) {
+    if (threads <= 0) {
+        return -1;
+    }
+    int group = 0;
+    while (group < static_cast<int>(groups_.size()) && !groups_[group].threads.empty()) {
+        ++group;
+    }
+    if (group == static_cast<int>(groups_.size())) {
+        groups_.emplace_back();
+    }
+    SPUThreadGroup& g = groups_[group];
+    g.name = name;
+    g.running = false;
+    for (int i = 0; i < threads; ++i) {
+        int id = createContext(group);
+        if (id < 0) {
+            std::cerr << "SPU thread group " << name << ": failed to create thread " << i << std::endl;
+            for (int created : g.threads) {
+                destroyContext(created);
+            }
+            g.threads.clear();
+            return -1;
+        }
+        g.threads.push_back(id);
+    }
+    std::cout << "SPU thread group " << group << " (" << name << ") created with "
+              << threads << " threads" << std::endl;
+    return group;
+}
+
+bool SPUManager::startThreadGroup(int group) {
+    if (!getThreadGroup(group)) return false;
+    SPUThreadGroup& g = groups_[group];
+    if (!g.running) {
+        for (int id : g.threads) {
+            contexts_[id].spu->idleUntil(guestCycles_);
+        }
+        g.running = true;
+    }
+    return true;
+}
+
+bool SPUManager::stopThreadGroup(int group) {
+    if (!getThreadGroup(group)) return false;
+    groups_[group].running = false;
+    return true;
+}
+
+bool SPUManager::destroyThreadGroup(int group) {
+    if (!getThreadGroup(group)) return false;
+    SPUThreadGroup& g = groups_[group];
+    for (int id : g.threads) {
+        destroyContext(id);
+    }
+    g = SPUThreadGroup();
+    while (!groups_.empty() && groups_.back().threads.empty()) {
+        groups_.pop_back();
+    }
+    return true;
+}
+
+const std::vector<SPUInterpreter*>& SPUManager::scheduledContexts() {
+    scheduled_.clear();
+    for (auto& context : contexts_) {
+        if (context.spu && (context.group < 0 || groups_[context.group].running)) {
+            scheduled_.push_back(context.spu.get());
+        }
+    }
+    return scheduled_;
+}
+
+void SPUManager::shutdown() {
+    workers_.stop();
+    dma_.stop();
+    contexts_.clear();
+    groups_.clear();
+}
+
 void SPUManager::executeAllSPUs(int maxInstructions) {
     // Sequential execution (simplified)
-    for (int i = 0; i < 6; ++i) {
-        if (!spus_[i]->isHalted()) {
-            spus_[i]->executeBlock(maxInstructions);
+    for (SPUInterpreter* spu : scheduledContexts()) {
+        if (!spu->isParked()) {
+            spu->executeBlock(maxInstructions);
         }
     }
 }
 
-void SPUManager::executeAllSPUsParallel(int maxInstructions) {
-    // Parallel execution using threads
-    std::array<std::thread, 6> threads;
-    
-    for (int i = 0; i < 6; ++i) {
-        threads[i] = std::thread([this, i, maxInstructions]() {
-            if (!spus_[i]->isHalted()) {
-                spus_[i]->executeBlock(maxInstructions);
-            }
-        });
+void SPUManager::runUntil(uint64_t targetCycles) {
+    guestCycles_ = std::max(guestCycles_, targetCycles);
+    if (workers_.isRunning()) {
+        workers_.runUntil(scheduledContexts(), targetCycles);
+        return;
+    }
+    for (SPUInterpreter* spu : scheduledContexts()) {
+        spu->runUntil(targetCycles);
     }
-    
-    // Wait for all threads to complete
-    for (int i = 0; i < 6; ++i) {
-        threads[i].join();
+}
+
+void SPUManager::executeAllSPUsParallel(int maxInstructions) {
+    if (!workers_.isRunning()) {
+        executeAllSPUs(maxInstructions);
+        return;
     }
+    workers_.runBlock(scheduledContexts(), maxInstructions);
 }
 
 void SPUManager::dumpAllRegisters() const {
-    for (int i = 0; i < 6; ++i) {
-        std::cout << "\n";
-        spus_[i]->dumpRegisters();
+    for (const auto& context : contexts_) {
+        if (context.spu) {
+            std::cout << "\n";
+            context.spu->dumpRegisters();
+        }
     }
 }
 
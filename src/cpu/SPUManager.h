@@ -1,14 +1,34 @@
 #pragma once
 
 #include "cpu/SPUInterpreter.h"
-#include <array>
+#include "cpu/SPUWorkerPool.h"
 #include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
 
 namespace pxs3c {
 
 class MemoryManager;
 
-// SPU Manager - controls 6 SPU cores
+// Raw SPUs, present from init as contexts 0..5
+constexpr int SPU_RAW_COUNT = 6;
+
+// A guest SPU thread group: contexts that are started and stopped together
+struct SPUThreadGroup {
+    std::string name;
+    std::vector<int> threads;  // context ids
+    bool running = false;
+};
+
+// SPU Manager - owns every guest SPU context and schedules them on the
+// worker pool. A context is an SPUInterpreter: registers, local store,
+// MFC and channels. There can be any number of them; the host workers run
+// whichever are runnable, so contexts that are stopped, stalled or in a
+// group that is not running take no host time.
+//
+// Contexts and groups are created and destroyed while the SPUs are not
+// running (between slices, from the PPU thread).
 class SPUManager {
 public:
     SPUManager();
@@ -16,22 +36,73 @@ public:
 
     bool init(std::shared_ptr<MemoryManager> mainMemory);
     void shutdown();
-    
-    // Access individual SPUs
+
+    // Access individual contexts
     SPUInterpreter* getSPU(int id) {
-        if (id < 0 || id >= 6) return nullptr;
-        return spus_[id].get();
+        if (id < 0 || id >= static_cast<int>(contexts_.size())) return nullptr;
+        return contexts_[id].spu.get();
     }
-    
-    // Execute all SPUs in parallel (simulated)
+    int getContextCount() const { return static_cast<int>(contexts_.size()); }
+
+    // Thread groups. createThreadGroup makes a stopped group of threads new
+    // contexts and returns its id, or -1. Starting a group brings its
+    // contexts' clocks up to the current guest time.
+    int createThreadGroup(const std::string& name, int threads);
+    bool startThreadGroup(int group);
+    bool stopThreadGroup(int group);
+    // Frees the group's contexts; their ids are reused
+    bool destroyThreadGroup(int group);
+    const SPUThreadGroup* getThreadGroup(int group) const {
+        if (group < 0 || group >= static_cast<int>(groups_.size()) || groups_[group].threads.empty()) return nullptr;
+        return &groups_[group];
+    }
+
+    // Execute all runnable contexts, sequentially or on the worker pool
     void executeAllSPUs(int maxInstructions = 1000);
     void executeAllSPUsParallel(int maxInstructions = 1000);
-    
+
+    // Bring every context's cycle counter up to targetCycles (on the worker
+    // pool when it is running)
+    void runUntil(uint64_t targetCycles);
+
+    // Worker threads; a config change restarts them
+    const SPUWorkerConfig& getWorkerConfig() const { return workerConfig_; }
+    void setWorkerConfig(const SPUWorkerConfig& config);
+    SPUWorkerPool& getWorkerPool() { return workers_; }
+    bool isAsyncDMARunning() const { return dma_.isRunning(); }
+
+    // SPU recompiler for all contexts; set it while they are not running
+    void setRecompilerConfig(const SPURecompilerConfig& config);
+
+    // Profiler for all contexts, likewise. reportProfiles() prints the
+    // profile of every context that has executed anything.
+    void setProfilerConfig(const SPUProfilerConfig& config);
+    void reportProfiles(std::ostream& out, size_t top = 16) const;
+
     // Status
     void dumpAllRegisters() const;
-    
+
 private:
-    std::array<std::unique_ptr<SPUInterpreter>, 6> spus_;
+    struct Context {
+        std::unique_ptr<SPUInterpreter> spu;
+        int group = -1;  // -1 for raw SPUs, which are always scheduled
+    };
+
+    std::vector<Context> contexts_;
+    std::vector<SPUThreadGroup> groups_;
+    std::vector<SPUInterpreter*> scheduled_;  // scratch for each run command
+    std::shared_ptr<MemoryManager> mainMemory_;
+    SPUWorkerPool workers_;
+    SPUWorkerConfig workerConfig_;
+    SPURecompilerConfig recompilerConfig_;
+    SPUProfilerConfig profilerConfig_;
+    MFCDMAThread dma_;
+    uint64_t guestCycles_;  // the last runUntil target
+
+    bool startWorkers();
+    int createContext(int group);
+    void destroyContext(int id);
+    const std::vector<SPUInterpreter*>& scheduledContexts();
 };
 
 } // namespace pxs3c
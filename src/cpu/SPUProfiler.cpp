@@ -0,0 +1,254 @@
+#include "cpu/SPUProfiler.h"
+#include "cpu/SPUChannels.h"
+#include "cpu/SPURecompiler.h"
+#include "loader/ElfLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace pxs3c {
+
+namespace {
+
+uint16_t be16(const uint8_t* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+uint32_t be32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+constexpr uint8_t ELFCLASS32 = 1;
+constexpr uint8_t STT_NOTYPE = 0;
+constexpr uint8_t STT_FUNC = 2;
+constexpr size_t ELF32_SHDR_SIZE = 40;
+constexpr size_t ELF32_SYM_SIZE = 16;
+
+double percent(uint64_t part, uint64_t whole) {
+    return whole ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+} // namespace
+
+const char* spuStallReasonName(SPUStallReason reason) {
+    switch (reason) {
+    case SPUStallReason::DMA: return "DMA wait";
+    case SPUStallReason::InMailbox: return "inbound mailbox";
+    case SPUStallReason::OutMailbox: return "outbound mailbox";
+    case SPUStallReason::Signal: return "signal notification";
+    default: return "other channel";
+    }
+}
+
+SPUStallReason spuStallReason(uint32_t channel) {
+    switch (channel) {
+    case MFC_RdTagStat: case MFC_RdListStallStat: case MFC_Cmd: case MFC_RdAtomicStat:
+        return SPUStallReason::DMA;
+    case SPU_RdInMbox:
+        return SPUStallReason::InMailbox;
+    case SPU_WrOutMbox: case SPU_WrOutIntrMbox:
+        return SPUStallReason::OutMailbox;
+    case SPU_RdSigNotify1: case SPU_RdSigNotify2:
+        return SPUStallReason::Signal;
+    default:
+        return SPUStallReason::Other;
+    }
+}
+
+SPUProfiler::SPUProfiler(const uint32_t* code, uint32_t lsSize, uint32_t sampleInterval)
+    : code_(code), lsSize_(lsSize), interval_(std::max(sampleInterval, 1u)), countdown_(1),
+      samples_(0), stoppedCycles_(0), counts_(lsSize / 4, 0) {}
+
+void SPUProfiler::reset() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    branches_.clear();
+    stalls_.fill(SPUStallProfile());
+    countdown_ = 1;
+    samples_ = 0;
+    stoppedCycles_ = 0;
+}
+
+void SPUProfiler::sample(uint32_t pc, uint32_t nextPC, bool mayBranch) {
+    pc &= lsSize_ - 4;
+    counts_[pc >> 2]++;
+    samples_++;
+    if (mayBranch && SPURecompiler::isBranch(spuDecode(code_[pc >> 2]))) {
+        SPUBranchProfile& branch = branches_[pc];
+        branch.executed++;
+        if ((nextPC & (lsSize_ - 4)) != ((pc + 4) & (lsSize_ - 4))) {
+            branch.taken++;
+        }
+    }
+}
+
+void SPUProfiler::recordBlock(uint32_t pc, uint32_t count, uint32_t length, uint32_t nextPC) {
+    // Sample the instructions at which the countdown runs out
+    uint32_t i = countdown_ - 1;
+    for (; i < count; i += interval_) {
+        uint32_t slot = i % length;
+        sample(pc + slot * 4, i == count - 1 ? nextPC : pc, slot == length - 1);
+    }
+    countdown_ = i - count + 1;
+}
+
+SPUBranchProfile SPUProfiler::getBranch(uint32_t pc) const {
+    auto it = branches_.find(pc & (lsSize_ - 4));
+    return it != branches_.end() ? it->second : SPUBranchProfile();
+}
+
+void SPUProfiler::addSymbol(const std::string& name, uint32_t addr, uint32_t size) {
+    symbols_[addr & (lsSize_ - 1)] = {name, size};
+}
+
+size_t SPUProfiler::loadSymbols(const uint8_t* elf, size_t size) {
+    if (!elf || size < 52 || be32(elf) != ELF_MAGIC || elf[4] != ELFCLASS32 || elf[5] != ELFDATA2MSB) {
+        return 0;
+    }
+    uint32_t shoff = be32(elf + 32);
+    uint16_t shentsize = be16(elf + 46);
+    uint16_t shnum = be16(elf + 48);
+    if (shentsize < ELF32_SHDR_SIZE || shoff > size || size_t(shnum) * shentsize > size - shoff) {
+        return 0;
+    }
+    auto section = [&](uint32_t index) { return elf + shoff + size_t(index) * shentsize; };
+
+    size_t added = 0;
+    for (uint16_t s = 0; s < shnum; ++s) {
+        const uint8_t* symtab = section(s);
+        if (be32(symtab + 4) != SHT_SYMTAB) continue;
+        uint32_t symOffset = be32(symtab + 16);
+        uint32_t symSize = be32(symtab + 20);
+        uint32_t link = be32(symtab + 24);
+        if (link >= shnum || symOffset > size || symSize > size - symOffset) continue;
+        const uint8_t* strtab = section(link);
+        uint32_t strOffset = be32(strtab + 16);
+        uint32_t strSize = be32(strtab + 20);
+        if (strOffset > size || strSize > size - strOffset) continue;
+        const char* strings = reinterpret_cast<const char*>(elf + strOffset);
+
+        for (uint32_t off = 0; off + ELF32_SYM_SIZE <= symSize; off += ELF32_SYM_SIZE) {
+            const uint8_t* sym = elf + symOffset + off;
+            uint32_t name = be32(sym);
+            uint32_t value = be32(sym + 4);
+            uint32_t length = be32(sym + 8);
+            uint8_t type = sym[12] & 0xF;
+            uint16_t shndx = be16(sym + 14);
+            if (shndx == 0 || name >= strSize || !(type == STT_FUNC || (type == STT_NOTYPE && length))) {
+                continue;
+            }
+            std::string symbolName(strings + name, strnlen(strings + name, strSize - name));
+            if (symbolName.empty()) continue;
+            addSymbol(symbolName, value, length);
+            added++;
+        }
+    }
+    return added;
+}
+
+const std::pair<const uint32_t, SPUProfiler::Symbol>* SPUProfiler::findSymbol(uint32_t pc) const {
+    auto it = symbols_.upper_bound(pc);
+    if (it == symbols_.begin()) return nullptr;
+    --it;
+    if (it->second.size && pc - it->first >= it->second.size) return nullptr;
+    return &*it;
+}
+
+std::string SPUProfiler::symbolize(uint32_t pc) const {
+    std::ostringstream out;
+    const auto* symbol = findSymbol(pc);
+    if (symbol) {
+        out << symbol->second.name;
+        if (pc != symbol->first) {
+            out << "+0x" << std::hex << (pc - symbol->first);
+        }
+    } else {
+        out << "0x" << std::hex << std::setw(5) << std::setfill('0') << pc;
+    }
+    return out.str();
+}
+
+void SPUProfiler::report(std::ostream& out, int spuId, size_t top) const {
+    uint64_t busy = samples_ * interval_;
+    uint64_t stalled = 0;
+    uint64_t stallEvents = 0;
+    for (const auto& stall : stalls_) {
+        stalled += stall.cycles;
+        stallEvents += stall.events;
+    }
+    uint64_t total = busy + stalled + stoppedCycles_;
+
+    // Leave the stream formatted as we found it
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << "SPU" << spuId << " profile: " << samples_ << " samples"
+        << (interval_ > 1 ? " (1 in " + std::to_string(interval_) + ")" : "") << std::fixed
+        << std::setprecision(1) << ", busy " << percent(busy, total) << "%, stalled "
+        << percent(stalled, total) << "%, stopped " << percent(stoppedCycles_, total) << "%\n";
+    if (samples_ == 0 && stallEvents == 0) {
+        out.flags(flags);
+        out.precision(precision);
+        return;
+    }
+
+    // Hottest instructions
+    std::vector<std::pair<uint64_t, uint32_t>> hot;
+    for (uint32_t i = 0; i < counts_.size(); ++i) {
+        if (counts_[i]) hot.emplace_back(counts_[i], i * 4);
+    }
+    size_t shown = std::min(top, hot.size());
+    std::partial_sort(hot.begin(), hot.begin() + shown, hot.end(),
+                      [](const auto& a, const auto& b) { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+    out << "  hot instructions:\n";
+    for (size_t i = 0; i < shown; ++i) {
+        uint32_t pc = hot[i].second;
+        out << "    " << std::setw(6) << percent(hot[i].first, samples_) << "%  " << std::setw(10)
+            << hot[i].first << "  0x" << std::hex << std::setw(5) << std::setfill('0') << pc
+            << std::dec << std::setfill(' ') << "  " << std::left << std::setw(8)
+            << spuOpName(spuDecode(code_[pc >> 2])) << std::right << "  " << symbolize(pc) << "\n";
+    }
+
+    // Hottest functions, when there are symbols
+    if (!symbols_.empty()) {
+        std::map<std::string, uint64_t> byFunction;
+        for (const auto& [count, pc] : hot) {
+            const auto* symbol = findSymbol(pc);
+            byFunction[symbol ? symbol->second.name : "(no symbol)"] += count;
+        }
+        std::vector<std::pair<uint64_t, std::string>> functions;
+        for (const auto& [name, count] : byFunction) functions.emplace_back(count, name);
+        std::sort(functions.begin(), functions.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        out << "  hot functions:\n";
+        for (size_t i = 0; i < std::min(top, functions.size()); ++i) {
+            out << "    " << std::setw(6) << percent(functions[i].first, samples_) << "%  " << std::setw(10)
+                << functions[i].first << "  " << functions[i].second << "\n";
+        }
+    }
+
+    // Most executed branches
+    std::vector<std::pair<uint32_t, SPUBranchProfile>> branches(branches_.begin(), branches_.end());
+    std::sort(branches.begin(), branches.end(), [](const auto& a, const auto& b) {
+        return a.second.executed > b.second.executed || (a.second.executed == b.second.executed && a.first < b.first);
+    });
+    if (!branches.empty()) {
+        out << "  branches:\n";
+        for (size_t i = 0; i < std::min(top, branches.size()); ++i) {
+            const auto& [pc, branch] = branches[i];
+            out << "    " << std::setw(10) << branch.executed << "  taken " << std::setw(5)
+                << percent(branch.taken, branch.executed) << "%  " << std::left << std::setw(8)
+                << spuOpName(spuDecode(code_[pc >> 2])) << std::right << "  " << symbolize(pc) << "\n";
+        }
+    }
+
+    if (stallEvents) {
+        out << "  stalls:\n";
+        for (int r = 0; r < static_cast<int>(SPUStallReason::Count); ++r) {
+            const SPUStallProfile& stall = stalls_[r];
+            if (!stall.events && !stall.cycles) continue;
+            out << "    " << std::left << std::setw(20) << spuStallReasonName(static_cast<SPUStallReason>(r))
+                << std::right << std::setw(8) << stall.events << " events  " << std::setw(12) << stall.cycles
+                << " cycles\n";
+        }
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace pxs3c
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cpu/SPUDecoder.h"
+
+namespace pxs3c {
+
+struct SPUProfilerConfig {
+    bool enabled = false;
+    uint32_t sampleInterval = 1;  // 1 counts every instruction; N records one in N
+};
+
+// What a stalled SPU is waiting for, by the channel it stalled on
+enum class SPUStallReason {
+    DMA,         // tag status, list stall or a full MFC queue
+    InMailbox,   // inbound mailbox empty
+    OutMailbox,  // outbound (interrupt) mailbox full
+    Signal,      // signal notification not yet written
+    Other,
+    Count
+};
+
+const char* spuStallReasonName(SPUStallReason reason);
+SPUStallReason spuStallReason(uint32_t channel);
+
+struct SPUBranchProfile {
+    uint64_t executed = 0;
+    uint64_t taken = 0;
+};
+
+struct SPUStallProfile {
+    uint64_t events = 0;  // rdch/wrch that had to wait
+    uint64_t cycles = 0;  // guest cycles spent waiting
+};
+
+// Execution profile of one SPU context: per-PC instruction counts,
+// branch-taken ratios and why the SPU stalls. The interpreter reports every
+// retired instruction, compiled code and loops every block; with a sample
+// interval of N only every Nth is recorded, so counts are 1/N of the real
+// figure and the overhead drops accordingly.
+//
+// report() prints the hottest instructions and functions, using symbols
+// loaded from the SPU program's ELF image or added by hand, the most
+// executed branches and a busy/stalled/stopped breakdown of guest time. The
+// profile is updated by whichever worker runs the SPU; read it only while
+// the SPUs are not running.
+class SPUProfiler {
+public:
+    // code: the context's code shadow, lsSize bytes of local store
+    SPUProfiler(const uint32_t* code, uint32_t lsSize, uint32_t sampleInterval);
+
+    // Interpreter: one retired instruction at pc, continuing at nextPC
+    void recordInstruction(uint32_t pc, uint32_t nextPC) {
+        if (--countdown_ == 0) {
+            countdown_ = interval_;
+            sample(pc, nextPC, true);
+        }
+    }
+    // Compiled code and loops: count instructions retired by a block of
+    // length straight-line instructions from pc, the last of which may be a
+    // branch. A loop runs the block count / length times, branching back to
+    // pc after each pass but the last, which continues at nextPC.
+    void recordBlock(uint32_t pc, uint32_t count, uint32_t length, uint32_t nextPC);
+    // A channel access stalled, then the SPU waited cycles for it
+    void recordStall(uint32_t channel) { stalls_[static_cast<int>(spuStallReason(channel))].events++; }
+    void recordStallCycles(uint32_t channel, uint64_t cycles) {
+        stalls_[static_cast<int>(spuStallReason(channel))].cycles += cycles;
+    }
+    void recordStoppedCycles(uint64_t cycles) { stoppedCycles_ += cycles; }
+
+    void reset();
+
+    uint32_t getSampleInterval() const { return interval_; }
+    uint64_t getSamples() const { return samples_; }
+    uint64_t getCount(uint32_t pc) const { return counts_[(pc & (lsSize_ - 4)) >> 2]; }
+    SPUBranchProfile getBranch(uint32_t pc) const;
+    const SPUStallProfile& getStalls(SPUStallReason reason) const { return stalls_[static_cast<int>(reason)]; }
+
+    // Symbols, by local store address. size 0 extends to the next symbol.
+    void addSymbol(const std::string& name, uint32_t addr, uint32_t size = 0);
+    // Function symbols of an SPU ELF image (32-bit big-endian); returns
+    // how many were added
+    size_t loadSymbols(const uint8_t* elf, size_t size);
+    // "name+0x10", or the bare address without a symbol
+    std::string symbolize(uint32_t pc) const;
+
+    void report(std::ostream& out, int spuId, size_t top = 16) const;
+
+private:
+    struct Symbol {
+        std::string name;
+        uint32_t size;
+    };
+
+    const uint32_t* code_;
+    uint32_t lsSize_;
+    uint32_t interval_;
+    uint32_t countdown_;  // instructions until the next sample
+    uint64_t samples_;
+    uint64_t stoppedCycles_;
+    std::vector<uint64_t> counts_;  // per instruction word
+    std::unordered_map<uint32_t, SPUBranchProfile> branches_;
+    std::array<SPUStallProfile, static_cast<int>(SPUStallReason::Count)> stalls_;
+    std::map<uint32_t, Symbol> symbols_;
+
+    void sample(uint32_t pc, uint32_t nextPC, bool mayBranch);
+    const std::pair<const uint32_t, Symbol>* findSymbol(uint32_t pc) const;
+};
+
+} // namespace pxs3c
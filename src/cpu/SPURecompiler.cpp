@@ -0,0 +1,310 @@
+#include "cpu/SPURecompiler.h"
+#include "cpu/SPUCodeCache.h"
+#include "cpu/SPUInterpreter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace pxs3c {
+
+SPURecompiler::SPURecompiler() : spu_(nullptr), context_{}, codeWritten_(false) {}
+
+SPURecompiler::~SPURecompiler() {
+    clearCache();
+}
+
+bool SPURecompiler::init(SPUInterpreter* spu) {
+    spu_ = spu;
+    if (!spu_ || spu_->getLocalStoreSize() == 0) {
+        return false;
+    }
+    cache_ = SPUCodeCache::shared();
+    if (!cache_->isAvailable()) {
+        cache_.reset();
+        return false;
+    }
+    size_t granules = (spu_->getLocalStoreSize() + CODE_GRANULE - 1) >> CODE_GRANULE_SHIFT;
+    codeMap_.assign(granules, 0);
+    writtenGranules_ = std::make_unique<std::atomic<uint8_t>[]>(granules);
+    for (size_t g = 0; g < granules; ++g) {
+        writtenGranules_[g].store(0, std::memory_order_relaxed);
+    }
+    context_.spu = spu_;
+    context_.codeMap = codeMap_.data();
+    return true;
+}
+
+bool SPURecompiler::leavesBlock(SPUOp op) {
+    switch (op) {
+    case SPUOp::INVALID:
+    case SPUOp::STOP: case SPUOp::STOPD:
+    case SPUOp::RDCH: case SPUOp::WRCH:  // may stall
+    case SPUOp::HEQ: case SPUOp::HEQI: case SPUOp::HGT: case SPUOp::HGTI:
+    case SPUOp::HLGT: case SPUOp::HLGTI:
+    case SPUOp::IRET: case SPUOp::BISLED:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool SPURecompiler::isBranch(SPUOp op) {
+    switch (op) {
+    case SPUOp::BR: case SPUOp::BRA: case SPUOp::BRSL: case SPUOp::BRASL:
+    case SPUOp::BRZ: case SPUOp::BRNZ: case SPUOp::BRHZ: case SPUOp::BRHNZ:
+    case SPUOp::BI: case SPUOp::BISL: case SPUOp::BIZ: case SPUOp::BINZ:
+    case SPUOp::BIHZ: case SPUOp::BIHNZ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+uint32_t SPURecompiler::branchTarget(uint32_t instr, uint32_t pc, uint32_t lsSize) {
+    SPUInstruction op{instr};
+    switch (spuDecode(instr)) {
+    case SPUOp::BR: case SPUOp::BRSL: case SPUOp::BRZ: case SPUOp::BRNZ:
+    case SPUOp::BRHZ: case SPUOp::BRHNZ:
+        return (pc + (op.si16() << 2)) & (lsSize - 4);
+    case SPUOp::BRA: case SPUOp::BRASL:
+        return static_cast<uint32_t>(op.si16() << 2) & (lsSize - 4);
+    default:
+        return ~0u;
+    }
+}
+
+bool SPURecompiler::isLoop(const std::vector<uint32_t>& code, uint32_t pc, uint32_t lsSize) {
+    if (code.empty()) {
+        return false;
+    }
+    uint32_t last = (pc + static_cast<uint32_t>(code.size() - 1) * 4) & (lsSize - 4);
+    return branchTarget(code.back(), last, lsSize) == (pc & (lsSize - 4));
+}
+
+void SPURecompiler::interpret(SPUInterpreter* spu, uint32_t instr, uint32_t pc) {
+    spu->regs_.pc = pc + 4;
+    spu->decodeAndExecute(instr);
+}
+
+void SPURecompiler::codeWritten(SPUInterpreter* spu, uint32_t addr) {
+    if (spu->recompiler_) {
+        spu->recompiler_->noteWrite(addr, 16);
+    }
+}
+
+void SPURecompiler::noteWrite(uint32_t addr, uint32_t size) {
+    if (codeMap_.empty() || size == 0) {
+        return;
+    }
+    uint32_t count = static_cast<uint32_t>(codeMap_.size());
+    uint32_t first = (addr & (spu_->getLocalStoreSize() - 1)) >> CODE_GRANULE_SHIFT;
+    uint32_t granules = std::min(((addr & (CODE_GRANULE - 1)) + size + CODE_GRANULE - 1) >> CODE_GRANULE_SHIFT,
+                                 count);
+    bool code = false;
+    for (uint32_t i = 0, g = first; i < granules; ++i, g = (g + 1) % count) {
+        if (std::atomic_ref<uint8_t>(codeMap_[g]).load(std::memory_order_relaxed)) {
+            writtenGranules_[g].store(1, std::memory_order_relaxed);
+            code = true;
+        }
+    }
+    if (code) {
+        codeWritten_.store(true, std::memory_order_release);
+    }
+}
+
+void SPURecompiler::markWrittenBlocks() {
+    // Take each granule's mark before looking at it: a write landing after
+    // that sets codeWritten_ again and is seen on the next entry
+    std::vector<uint8_t> written(codeMap_.size(), 0);
+    bool any = false;
+    for (size_t g = 0; g < codeMap_.size(); ++g) {
+        if (codeMap_[g] && writtenGranules_[g].exchange(0, std::memory_order_relaxed)) {
+            written[g] = 1;
+            any = true;
+        }
+    }
+    if (!any) {
+        return;
+    }
+    for (auto& [pc, block] : blocks_) {
+        if (!block.entry) {
+            continue;
+        }
+        uint32_t last = pc + static_cast<uint32_t>(block.entry->code.size()) * 4 - 1;
+        for (uint32_t g = pc >> CODE_GRANULE_SHIFT; g <= last >> CODE_GRANULE_SHIFT; ++g) {
+            if (written[g]) {
+                block.written = true;
+                break;
+            }
+        }
+    }
+}
+
+uint32_t SPURecompiler::executeBlock(uint32_t maxInstructions, uint32_t* blockSize) {
+    if (!cache_) {
+        return 0;
+    }
+    if (spu_->shadowStale_) {
+        spu_->rebuildCodeShadow();  // reports the whole local store as written
+    }
+    if (codeWritten_.exchange(false, std::memory_order_acquire)) {
+        markWrittenBlocks();
+    }
+    uint32_t pc = spu_->getPC() & (spu_->getLocalStoreSize() - 4);
+    Block& block = blocks_[pc];
+    if (block.failed) {
+        return 0;
+    }
+    if (!block.entry) {
+        // Loop heads are worth compiling on sight
+        if ((!block.loopHead && ++block.entries < config_.threshold) || !compile(block, pc)) {
+            return 0;
+        }
+    } else if (block.written) {
+        block.written = false;
+        if (codeMatches(block, pc)) {
+            stats_.revalidations++;
+        } else {
+            stats_.invalidations++;
+            if (!compile(block, pc)) {
+                return 0;
+            }
+        }
+    }
+    uint32_t count = static_cast<uint32_t>(block.entry->code.size());
+    if (count > maxInstructions) {
+        return 0;  // would overrun the caller's cycle target
+    }
+
+    context_.localStore = spu_->getLocalStorePointer();
+    context_.codeShadow = spu_->localStore_.shadow();
+    context_.budget = maxInstructions;
+    context_.retired = 0;
+    spu_->regs_.pc = block.entry->compiled(spu_->regs_.regs.data(), &context_);
+    uint32_t retired = context_.retired;
+    stats_.executions++;
+    stats_.iterations += retired / count - 1;
+    stats_.instructions += retired;
+    if (blockSize) {
+        *blockSize = count;
+    }
+    return retired;
+}
+
+bool SPURecompiler::compileBlock(uint32_t pc) {
+    if (!cache_) {
+        return false;
+    }
+    pc &= spu_->getLocalStoreSize() - 4;
+    Block& block = blocks_[pc];
+    block.failed = false;
+    return compile(block, pc);
+}
+
+void SPURecompiler::drop(Block& block) {
+    cache_->release(block.entry);
+    block.entry = nullptr;
+    block.written = false;
+}
+
+void SPURecompiler::clearCache() {
+    if (cache_) {
+        for (auto& [pc, block] : blocks_) {
+            drop(block);
+        }
+    }
+    blocks_.clear();
+    std::fill(codeMap_.begin(), codeMap_.end(), 0);
+    for (size_t g = 0; g < codeMap_.size(); ++g) {
+        writtenGranules_[g].store(0, std::memory_order_relaxed);
+    }
+    codeWritten_.store(false, std::memory_order_relaxed);
+}
+
+bool SPURecompiler::compile(Block& block, uint32_t pc) {
+    drop(block);
+
+    // Straight-line code up to the first branch (included), the first
+    // instruction the interpreter has to run itself, the next loop head or
+    // the local store end. Hints met on the way name loop heads ahead.
+    std::vector<uint32_t> code;
+    uint32_t lsSize = spu_->getLocalStoreSize();
+    for (uint32_t addr = pc; addr < lsSize && code.size() < config_.maxBlockInstructions; addr += 4) {
+        if (addr != pc) {
+            auto next = blocks_.find(addr);
+            if (next != blocks_.end() && next->second.loopHead) {
+                break;
+            }
+        }
+        uint32_t instr = spu_->fetchInstruction(addr);
+        SPUOp op = spuDecode(instr);
+        if (leavesBlock(op)) {
+            break;
+        }
+        noteHint(instr, addr);
+        code.push_back(instr);
+        if (isBranch(op)) {
+            noteLoop(branchTarget(instr, addr, lsSize), addr);
+            break;
+        }
+    }
+    if (code.empty()) {
+        block.failed = true;
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool hit = false;
+    block.entry = cache_->acquire(pc, code, lsSize, hit);
+    stats_.compileTimeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    if (!block.entry) {
+        std::cerr << "SPU" << spu_->getId() << " recompiler: failed to compile block at 0x"
+                  << std::hex << pc << std::dec << std::endl;
+        block.failed = true;
+        return false;
+    }
+    if (hit) {
+        stats_.cacheHits++;
+    } else {
+        stats_.compilations++;
+    }
+    stats_.native += block.entry->native;
+    stats_.interpreted += code.size() - block.entry->native;
+
+    // From here on, stores into these granules are reported. DMA may have
+    // landed since the code was read, before anything was watching.
+    uint32_t last = pc + static_cast<uint32_t>(code.size()) * 4 - 1;
+    for (uint32_t g = pc >> CODE_GRANULE_SHIFT; g <= last >> CODE_GRANULE_SHIFT; ++g) {
+        std::atomic_ref<uint8_t>(codeMap_[g]).store(1, std::memory_order_seq_cst);
+    }
+    block.written = !codeMatches(block, pc);
+    return true;
+}
+
+void SPURecompiler::noteHint(uint32_t instr, uint32_t pc) {
+    // hbr names its target by register, so only these two can be followed
+    SPUInstruction hint{instr};
+    uint32_t mask = spu_->getLocalStoreSize() - 4;
+    uint32_t branchPC = (pc + (hint.hintOffsetRI16() << 2)) & mask;
+    switch (spuDecode(instr)) {
+    case SPUOp::HBRR: noteLoop((pc + (hint.si16() << 2)) & mask, branchPC); break;
+    case SPUOp::HBRA: noteLoop(static_cast<uint32_t>(hint.si16() << 2) & mask, branchPC); break;
+    default: break;
+    }
+}
+
+void SPURecompiler::noteLoop(uint32_t head, uint32_t branchPC) {
+    // Only backward branches make loops; ~0u is an indirect target
+    if (head <= branchPC) {
+        blocks_[head].loopHead = true;
+    }
+}
+
+bool SPURecompiler::codeMatches(const Block& block, uint32_t pc) {
+    return std::memcmp(spu_->localStore_.shadow() + (pc >> 2), block.entry->code.data(),
+                       block.entry->code.size() * sizeof(uint32_t)) == 0;
+}
+
+} // namespace pxs3c
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "cpu/SPUDecoder.h"
+#include "cpu/SPUVector.h"
+
+namespace pxs3c {
+
+class SPUInterpreter;
+class SPUCodeCache;
+struct SPUCodeCacheEntry;
+
+// State compiled SPU code reads besides the register file
+struct SPUJITContext {
+    uint8_t* localStore;   // guest (big-endian) byte order
+    uint32_t* codeShadow;  // host-order words; compiled stores keep it in step
+    SPUInterpreter* spu;   // runs the instructions the backend hands back
+    const uint8_t* codeMap;  // nonzero for granules holding compiled code
+    uint32_t budget;       // instructions a compiled loop may retire
+    uint32_t retired;      // set by compiled code: instructions it retired
+};
+
+// Compiled code for one SPU basic block: executes every instruction of the
+// block against the register file and returns the PC to continue at. A
+// block whose branch goes back to its own start is a loop and keeps
+// iterating while the next pass fits in ctx->budget.
+typedef uint32_t (*SPUCompiledBlock)(SPUVector* regs, SPUJITContext* ctx);
+
+struct SPURecompilerConfig {
+    bool enabled = false;
+    uint32_t threshold = 2;              // block entries before it is compiled
+    uint32_t maxBlockInstructions = 256;
+};
+
+struct SPURecompilerStats {
+    uint64_t compilations = 0;
+    uint64_t cacheHits = 0;      // blocks already compiled, by this or another SPU
+    uint64_t compileTimeNs = 0;
+    uint64_t executions = 0;     // block entries served by compiled code
+    uint64_t iterations = 0;     // loop passes compiled code made without returning
+    uint64_t instructions = 0;   // guest instructions retired by compiled code
+    uint64_t native = 0;         // compiled instructions translated to host code
+    uint64_t interpreted = 0;    // compiled instructions handed back to the interpreter
+    uint64_t invalidations = 0;  // blocks recompiled because their code changed
+    uint64_t revalidations = 0;  // blocks written to but found unchanged
+};
+
+// SPU recompiler front end. It shares SPUDecoder with the interpreter:
+// blocks are formed from decoded instructions, each instruction the backend
+// has no translation for becomes a call to the interpreter's handler, and
+// instructions that can stop, stall or halt the SPU end the block and are
+// left to the interpreter. Translations come from the shared SPUCodeCache,
+// so an SPU running a program another SPU already ran compiles nothing.
+//
+// Loops get regions of their own. A block that ends in a branch back to its
+// start runs as a native loop, and the head of every backward branch named
+// by a branch hint (hbra, hbrr) or taken by a compiled block becomes a
+// loop head: blocks stop short of it, so the loop is always entered at its
+// top, and it is compiled on its first entry rather than after threshold.
+//
+// Local store is tracked in CODE_GRANULE-byte granules. Stores into a
+// granule holding compiled code, whether from the interpreter, compiled
+// code or DMA, mark it written; the blocks overlapping it are checked
+// against the code shadow at their next entry and replaced if their code
+// changed. Stores anywhere else cost nothing.
+class SPURecompiler {
+public:
+    static constexpr uint32_t CODE_GRANULE_SHIFT = 7;
+    static constexpr uint32_t CODE_GRANULE = 1u << CODE_GRANULE_SHIFT;
+
+    SPURecompiler();
+    ~SPURecompiler();
+
+    // False if there is no backend for this host
+    bool init(SPUInterpreter* spu);
+
+    // Called by the interpreter at block entries. Counts the entry,
+    // compiles the block once it is warm and runs it if it fits in
+    // maxInstructions. Returns the instructions retired, or 0 if the caller
+    // should interpret; blockSize receives the length of the block, which a
+    // loop may have run several times.
+    uint32_t executeBlock(uint32_t maxInstructions, uint32_t* blockSize = nullptr);
+
+    // Compile the block at pc now, regardless of the threshold
+    bool compileBlock(uint32_t pc);
+    // Drops this SPU's blocks; their translations stay in the shared cache
+    void clearCache();
+
+    // Local store bytes [addr, addr + size) changed. Safe to call from the
+    // DMA thread while the SPU runs.
+    void noteWrite(uint32_t addr, uint32_t size);
+    // The interpreter executed the branch hint instr at pc
+    void noteHint(uint32_t instr, uint32_t pc);
+
+    void setConfig(const SPURecompilerConfig& config) { config_ = config; }
+    const SPURecompilerConfig& getConfig() const { return config_; }
+    const SPURecompilerStats& getStats() const { return stats_; }
+
+    // Instructions the interpreter must execute itself: they end a block
+    // without being part of it
+    static bool leavesBlock(SPUOp op);
+    // Branches: the last instruction of a block
+    static bool isBranch(SPUOp op);
+    static bool endsBlock(uint32_t instr) {
+        SPUOp op = spuDecode(instr);
+        return leavesBlock(op) || isBranch(op);
+    }
+    // Where the interpreter offers the next instruction as a block entry:
+    // after a block ends and after a hint, which may name the loop ahead
+    static bool precedesBlock(uint32_t instr) {
+        SPUOp op = spuDecode(instr);
+        return leavesBlock(op) || isBranch(op) || op == SPUOp::HBRA || op == SPUOp::HBRR;
+    }
+    // The target of a PC-relative or absolute branch at pc, or ~0u for an
+    // indirect one. Masked by lsSize.
+    static uint32_t branchTarget(uint32_t instr, uint32_t pc, uint32_t lsSize);
+    // A block of code at pc that loops: it ends in a branch back to pc
+    static bool isLoop(const std::vector<uint32_t>& code, uint32_t pc, uint32_t lsSize);
+
+    // Runs one instruction through the interpreter for compiled code
+    static void interpret(SPUInterpreter* spu, uint32_t instr, uint32_t pc);
+    // A compiled store hit a granule holding compiled code
+    static void codeWritten(SPUInterpreter* spu, uint32_t addr);
+
+private:
+    struct Block {
+        const SPUCodeCacheEntry* entry = nullptr;
+        uint32_t entries = 0;
+        bool failed = false;  // nothing compilable at this PC
+        bool written = false;  // its code may have changed since it was compiled
+        bool loopHead = false;  // a backward branch targets it
+    };
+
+    SPUInterpreter* spu_;
+    std::shared_ptr<SPUCodeCache> cache_;
+    SPURecompilerConfig config_;
+    SPURecompilerStats stats_;
+    SPUJITContext context_;
+    std::unordered_map<uint32_t, Block> blocks_;
+    std::vector<uint8_t> codeMap_;  // per granule; written by the SPU thread only
+    std::unique_ptr<std::atomic<uint8_t>[]> writtenGranules_;
+    std::atomic<bool> codeWritten_;
+
+    bool compile(Block& block, uint32_t pc);
+    void noteLoop(uint32_t head, uint32_t branchPC);
+    bool codeMatches(const Block& block, uint32_t pc);
+    void markWrittenBlocks();
+    void drop(Block& block);
+};
+
+} // namespace pxs3c
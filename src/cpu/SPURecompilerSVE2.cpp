@@ -1,28 +1,32 @@
 #include "cpu/SPURecompilerSVE2.h"
+#if defined(__aarch64__) && defined(__linux__)
 #include <sys/auxv.h>
 #include <asm/hwcap.h>
+#endif
 #include <cstring>
-#include <sys/mman.h>
 
 namespace PXS3C {
 
 SPURecompilerSVE2::SPURecompilerSVE2() 
-    : sve2_available_(false), vector_length_(0) {
+    : sve2_available_(false), vector_length_(0), arena_(pxs3c::CodeArena::shared()) {
 }
 
 SPURecompilerSVE2::~SPURecompilerSVE2() {
     // Free all compiled code blocks
     for (auto& block : code_cache_) {
-        if (block.code) {
-            munmap(block.code, block.size);
-        }
+        arena_->free(block.code);
     }
 }
 
 bool SPURecompilerSVE2::initialize() {
+#if defined(__aarch64__) && defined(__linux__)
     // Runtime detection of SVE2 support on ARM64
     unsigned long hwcaps = getauxval(AT_HWCAP2);
     sve2_available_ = (hwcaps & HWCAP2_SVE2) != 0;
+#else
+    // Other hosts use the portable recompiler (SPURecompiler)
+    sve2_available_ = false;
+#endif
     
     if (sve2_available_) {
         // Get SVE vector length (hardware-dependent: 128-2048 bits)
@@ -41,14 +45,14 @@ void* SPURecompilerSVE2::compileBlock(uint32_t spu_pc, const uint32_t* instructi
         return nullptr;
     }
 
-    // Allocate executable memory for compiled code
-    size_t code_size = count * 64; // Estimate ~64 ARM64 instructions per SPU instruction
-    void* code_mem = mmap(nullptr, code_size, PROT_READ | PROT_WRITE | PROT_EXEC,
-                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-    
-    if (code_mem == MAP_FAILED) {
+    // Allocate code space: written through the arena's RW view, run from
+    // its RX view
+    size_t code_size = count * 64 + 12; // ~64 bytes per SPU instruction, plus prologue/epilogue
+    pxs3c::CodeSpan span = arena_->allocate(code_size);
+    if (!span) {
         return nullptr;
     }
+    void* code_mem = span.exec;
 
     // TODO: Implement actual JIT compilation
     // For now, this is a stub that demonstrates the architecture
@@ -58,7 +62,7 @@ void* SPURecompilerSVE2::compileBlock(uint32_t spu_pc, const uint32_t* instructi
     // 2. Use SVE2 vector instructions (fadda, fmul, etc.) with 2-4x throughput
     // 3. Store results back to SPU register file
     
-    uint8_t* code_ptr = static_cast<uint8_t*>(code_mem);
+    uint8_t* code_ptr = span.write;
     
     // Emit ARM64 prologue
     // stp x29, x30, [sp, #-16]!
@@ -92,9 +96,8 @@ void* SPURecompilerSVE2::compileBlock(uint32_t spu_pc, const uint32_t* instructi
     code_ptr[0] = 0xC0; code_ptr[1] = 0x03; code_ptr[2] = 0x5F; code_ptr[3] = 0xD6;
     code_ptr += 4;
     
-    // Make code executable
-    __builtin___clear_cache(static_cast<char*>(code_mem), 
-                           static_cast<char*>(code_mem) + code_size);
+    // Make the code visible to instruction fetch
+    pxs3c::CodeArena::flush(span);
     
     // Cache the compiled block
     CodeBlock block;
@@ -117,6 +120,7 @@ void SPURecompilerSVE2::executeBlock(void* block_ptr, void* spu_context) {
     func(spu_context);
 }
 
+#if defined(__ARM_FEATURE_SVE)
 void SPURecompilerSVE2::emitSPUVectorOp(uint32_t opcode, svfloat32_t* regs) {
     // SVE2 vector operation emitter (stub)
     // Real implementation would emit optimized SVE2 instructions
@@ -131,5 +135,6 @@ void SPURecompilerSVE2::emitSPUArithmeticOp(uint32_t opcode, svint32_t* regs) {
     // SVE2 arithmetic operation emitter (stub)
     // Leverages SVE2's predicated operations for conditional execution
 }
+#endif
 
 } // namespace PXS3C
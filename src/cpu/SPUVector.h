@@ -0,0 +1,988 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+// Host vector ISA for the SPU kernels. x86-64 always has SSE2; SSSE3 and
+// AVX2 paths are used only when the build enables them (no -march is
+// forced, see CMakeLists.txt). arm64 always has NEON.
+#if defined(__SSE2__) || defined(_M_X64)
+#define PXS3C_SPU_SSE2 1
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(__AVX2__) || defined(__FMA__)
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__)
+#define PXS3C_SPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace pxs3c {
+
+// A 128-bit SPU register or local store quadword. The guest quadword is
+// kept byte-reversed, so the whole register is one little-endian 128-bit
+// integer: element i of any width counts from the high end, and the
+// preferred slot (word element 0) is u32[3]. Use the element accessors
+// for guest-ordered lanes; lane-wise operations can ignore the order.
+union alignas(16) SPUVector {
+    uint64_t u64[2];
+    uint32_t u32[4];
+    uint16_t u16[8];
+    uint8_t u8[16];
+    float f32[4];
+    double f64[2];
+#if defined(PXS3C_SPU_SSE2)
+    __m128i vi;
+    __m128 vf;
+    __m128d vd;
+#elif defined(PXS3C_SPU_NEON)
+    uint8x16_t vb;
+    uint16x8_t vh;
+    uint32x4_t vw;
+    uint64x2_t vq;
+    float32x4_t vf;
+    float64x2_t vd;
+#endif
+
+    SPUVector() { u64[0] = 0; u64[1] = 0; }
+
+    uint64_t& d(int i) { return u64[1 - i]; }
+    uint32_t& w(int i) { return u32[3 - i]; }
+    uint16_t& h(int i) { return u16[7 - i]; }
+    uint8_t& b(int i) { return u8[15 - i]; }
+    float& f(int i) { return f32[3 - i]; }
+    double& df(int i) { return f64[1 - i]; }
+    uint64_t d(int i) const { return u64[1 - i]; }
+    uint32_t w(int i) const { return u32[3 - i]; }
+    uint16_t h(int i) const { return u16[7 - i]; }
+    uint8_t b(int i) const { return u8[15 - i]; }
+    float f(int i) const { return f32[3 - i]; }
+    double df(int i) const { return f64[1 - i]; }
+};
+
+static_assert(sizeof(SPUVector) == 16 && alignof(SPUVector) == 16, "SPUVector must be one aligned quadword");
+
+// Lane-parallel SPU operations, one host vector instruction (or a short
+// sequence) each. The scalar versions are the reference and the fallback
+// for hosts without SSE2 or NEON.
+namespace spu {
+
+#if defined(PXS3C_SPU_SSE2)
+inline SPUVector make(__m128i v) { SPUVector r; r.vi = v; return r; }
+inline SPUVector make(__m128 v) { SPUVector r; r.vf = v; return r; }
+inline SPUVector make(__m128d v) { SPUVector r; r.vd = v; return r; }
+#elif defined(PXS3C_SPU_NEON)
+inline SPUVector make(uint8x16_t v) { SPUVector r; r.vb = v; return r; }
+inline SPUVector make(uint16x8_t v) { SPUVector r; r.vh = v; return r; }
+inline SPUVector make(uint32x4_t v) { SPUVector r; r.vw = v; return r; }
+inline SPUVector make(uint64x2_t v) { SPUVector r; r.vq = v; return r; }
+inline SPUVector make(float32x4_t v) { SPUVector r; r.vf = v; return r; }
+inline SPUVector make(float64x2_t v) { SPUVector r; r.vd = v; return r; }
+#endif
+
+template <typename F>
+inline SPUVector mapWords(const SPUVector& a, const SPUVector& b, F f) {
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.u32[i] = static_cast<uint32_t>(f(a.u32[i], b.u32[i]));
+    return r;
+}
+
+template <typename F>
+inline SPUVector mapHalves(const SPUVector& a, const SPUVector& b, F f) {
+    SPUVector r;
+    for (int i = 0; i < 8; ++i) r.u16[i] = static_cast<uint16_t>(f(a.u16[i], b.u16[i]));
+    return r;
+}
+
+template <typename F>
+inline SPUVector mapBytes(const SPUVector& a, const SPUVector& b, F f) {
+    SPUVector r;
+    for (int i = 0; i < 16; ++i) r.u8[i] = static_cast<uint8_t>(f(a.u8[i], b.u8[i]));
+    return r;
+}
+
+// ---- Constants --------------------------------------------------------
+
+inline SPUVector splat32(uint32_t x) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_set1_epi32(static_cast<int>(x)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vdupq_n_u32(x));
+#else
+    SPUVector r;
+    for (auto& lane : r.u32) lane = x;
+    return r;
+#endif
+}
+
+inline SPUVector splat16(uint16_t x) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_set1_epi16(static_cast<short>(x)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vdupq_n_u16(x));
+#else
+    SPUVector r;
+    for (auto& lane : r.u16) lane = x;
+    return r;
+#endif
+}
+
+inline SPUVector splat8(uint8_t x) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_set1_epi8(static_cast<char>(x)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vdupq_n_u8(x));
+#else
+    SPUVector r;
+    for (auto& lane : r.u8) lane = x;
+    return r;
+#endif
+}
+
+// ---- Bitwise ----------------------------------------------------------
+
+inline SPUVector and_(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_and_si128(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vandq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x & y; });
+#endif
+}
+
+inline SPUVector or_(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_or_si128(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vorrq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x | y; });
+#endif
+}
+
+inline SPUVector xor_(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_xor_si128(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(veorq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x ^ y; });
+#endif
+}
+
+// a & ~b
+inline SPUVector andc(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_andnot_si128(b.vi, a.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vbicq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x & ~y; });
+#endif
+}
+
+// a | ~b
+inline SPUVector orc(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_NEON)
+    return make(vornq_u32(a.vw, b.vw));
+#else
+    return or_(a, xor_(b, splat32(0xFFFFFFFF)));
+#endif
+}
+
+inline SPUVector not_(const SPUVector& a) {
+#if defined(PXS3C_SPU_NEON)
+    return make(vmvnq_u32(a.vw));
+#else
+    return xor_(a, splat32(0xFFFFFFFF));
+#endif
+}
+
+// (b & c) | (a & ~c)
+inline SPUVector select(const SPUVector& a, const SPUVector& b, const SPUVector& c) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_or_si128(_mm_and_si128(c.vi, b.vi), _mm_andnot_si128(c.vi, a.vi)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vbslq_u32(c.vw, b.vw, a.vw));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.u64[i] = (b.u64[i] & c.u64[i]) | (a.u64[i] & ~c.u64[i]);
+    return r;
+#endif
+}
+
+// ---- Integer arithmetic -----------------------------------------------
+
+inline SPUVector add32(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_add_epi32(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vaddq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x + y; });
+#endif
+}
+
+inline SPUVector add16(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_add_epi16(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vaddq_u16(a.vh, b.vh));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) { return x + y; });
+#endif
+}
+
+// a - b
+inline SPUVector sub32(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sub_epi32(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vsubq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x - y; });
+#endif
+}
+
+inline SPUVector sub16(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sub_epi16(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vsubq_u16(a.vh, b.vh));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) { return x - y; });
+#endif
+}
+
+// (a + b + 1) >> 1 per unsigned byte
+inline SPUVector avgu8(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_avg_epu8(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vrhaddq_u8(a.vb, b.vb));
+#else
+    return mapBytes(a, b, [](uint8_t x, uint8_t y) { return (x + y + 1) >> 1; });
+#endif
+}
+
+// |a - b| per unsigned byte
+inline SPUVector absdiffu8(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sub_epi8(_mm_max_epu8(a.vi, b.vi), _mm_min_epu8(a.vi, b.vi)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vabdq_u8(a.vb, b.vb));
+#else
+    return mapBytes(a, b, [](uint8_t x, uint8_t y) { return x > y ? x - y : y - x; });
+#endif
+}
+
+// Sign-extend the low byte of each halfword / low halfword of each word
+inline SPUVector extendByteToHalf(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_srai_epi16(_mm_slli_epi16(a.vi, 8), 8));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vreinterpretq_u16_s16(vshrq_n_s16(vshlq_n_s16(vreinterpretq_s16_u16(a.vh), 8), 8)));
+#else
+    SPUVector r;
+    for (int i = 0; i < 8; ++i) r.u16[i] = static_cast<uint16_t>(static_cast<int8_t>(a.u16[i]));
+    return r;
+#endif
+}
+
+inline SPUVector extendHalfToWord(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_srai_epi32(_mm_slli_epi32(a.vi, 16), 16));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vreinterpretq_u32_s32(vshrq_n_s32(vshlq_n_s32(vreinterpretq_s32_u32(a.vw), 16), 16)));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.u32[i] = static_cast<uint32_t>(static_cast<int16_t>(a.u32[i]));
+    return r;
+#endif
+}
+
+// ---- Multiplies: 16x16 -> 32 within each word -------------------------
+
+// Signed low halfwords (mpy)
+inline SPUVector mulLowSigned(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    // pmaddwd sums lo*lo + hi*hi; clearing b's high halves leaves lo*lo
+    return make(_mm_madd_epi16(a.vi, _mm_and_si128(b.vi, _mm_set1_epi32(0xFFFF))));
+#elif defined(PXS3C_SPU_NEON)
+    int32x4_t x = vshrq_n_s32(vshlq_n_s32(vreinterpretq_s32_u32(a.vw), 16), 16);
+    int32x4_t y = vshrq_n_s32(vshlq_n_s32(vreinterpretq_s32_u32(b.vw), 16), 16);
+    return make(vreinterpretq_u32_s32(vmulq_s32(x, y)));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) {
+        return static_cast<uint32_t>(static_cast<int16_t>(x) * static_cast<int16_t>(y));
+    });
+#endif
+}
+
+// Unsigned low halfwords (mpyu)
+inline SPUVector mulLowUnsigned(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    __m128i lo = _mm_mullo_epi16(a.vi, b.vi);
+    __m128i hi = _mm_mulhi_epu16(a.vi, b.vi);
+    return make(_mm_or_si128(_mm_and_si128(lo, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(hi, 16)));
+#elif defined(PXS3C_SPU_NEON)
+    uint32x4_t m = vdupq_n_u32(0xFFFF);
+    return make(vmulq_u32(vandq_u32(a.vw, m), vandq_u32(b.vw, m)));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return (x & 0xFFFF) * (y & 0xFFFF); });
+#endif
+}
+
+// Signed high halfwords (mpyhh)
+inline SPUVector mulHighSigned(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_madd_epi16(a.vi, _mm_andnot_si128(_mm_set1_epi32(0xFFFF), b.vi)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vreinterpretq_u32_s32(vmulq_s32(vshrq_n_s32(vreinterpretq_s32_u32(a.vw), 16),
+                                                vshrq_n_s32(vreinterpretq_s32_u32(b.vw), 16))));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) {
+        return static_cast<uint32_t>(static_cast<int16_t>(x >> 16) * static_cast<int16_t>(y >> 16));
+    });
+#endif
+}
+
+// Unsigned high halfwords (mpyhhu)
+inline SPUVector mulHighUnsigned(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    __m128i x = _mm_srli_epi32(a.vi, 16);
+    __m128i y = _mm_srli_epi32(b.vi, 16);
+    __m128i lo = _mm_mullo_epi16(x, y);
+    __m128i hi = _mm_mulhi_epu16(x, y);
+    return make(_mm_or_si128(_mm_and_si128(lo, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(hi, 16)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vmulq_u32(vshrq_n_u32(a.vw, 16), vshrq_n_u32(b.vw, 16)));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return (x >> 16) * (y >> 16); });
+#endif
+}
+
+// (a.hi * b.lo) << 16 (mpyh): only the low 16 bits of the product survive
+inline SPUVector mulHighLowShifted(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_slli_epi32(_mm_mullo_epi16(_mm_srli_epi32(a.vi, 16), b.vi), 16));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vshlq_n_u32(vmulq_u32(vshrq_n_u32(a.vw, 16), b.vw), 16));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return ((x >> 16) * (y & 0xFFFF)) << 16; });
+#endif
+}
+
+// ---- Compares (all-ones lanes where true) -----------------------------
+
+inline SPUVector cmpeq32(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpeq_epi32(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vceqq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x == y ? 0xFFFFFFFFu : 0u; });
+#endif
+}
+
+inline SPUVector cmpeq16(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpeq_epi16(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vceqq_u16(a.vh, b.vh));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) { return x == y ? 0xFFFF : 0; });
+#endif
+}
+
+inline SPUVector cmpeq8(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpeq_epi8(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vceqq_u8(a.vb, b.vb));
+#else
+    return mapBytes(a, b, [](uint8_t x, uint8_t y) { return x == y ? 0xFF : 0; });
+#endif
+}
+
+inline SPUVector cmpgt32(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpgt_epi32(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_s32(vreinterpretq_s32_u32(a.vw), vreinterpretq_s32_u32(b.vw)));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) {
+        return static_cast<int32_t>(x) > static_cast<int32_t>(y) ? 0xFFFFFFFFu : 0u;
+    });
+#endif
+}
+
+inline SPUVector cmpgt16(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpgt_epi16(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_s16(vreinterpretq_s16_u16(a.vh), vreinterpretq_s16_u16(b.vh)));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) {
+        return static_cast<int16_t>(x) > static_cast<int16_t>(y) ? 0xFFFF : 0;
+    });
+#endif
+}
+
+inline SPUVector cmpgt8(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpgt_epi8(a.vi, b.vi));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_s8(vreinterpretq_s8_u8(a.vb), vreinterpretq_s8_u8(b.vb)));
+#else
+    return mapBytes(a, b, [](uint8_t x, uint8_t y) {
+        return static_cast<int8_t>(x) > static_cast<int8_t>(y) ? 0xFF : 0;
+    });
+#endif
+}
+
+// Unsigned compares; SSE2 has only signed ones, so flip the sign bits
+inline SPUVector cmpgtu32(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000u));
+    return make(_mm_cmpgt_epi32(_mm_xor_si128(a.vi, bias), _mm_xor_si128(b.vi, bias)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_u32(a.vw, b.vw));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { return x > y ? 0xFFFFFFFFu : 0u; });
+#endif
+}
+
+inline SPUVector cmpgtu16(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    __m128i bias = _mm_set1_epi16(static_cast<short>(0x8000));
+    return make(_mm_cmpgt_epi16(_mm_xor_si128(a.vi, bias), _mm_xor_si128(b.vi, bias)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_u16(a.vh, b.vh));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) { return x > y ? 0xFFFF : 0; });
+#endif
+}
+
+inline SPUVector cmpgtu8(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    __m128i bias = _mm_set1_epi8(static_cast<char>(0x80));
+    return make(_mm_cmpgt_epi8(_mm_xor_si128(a.vi, bias), _mm_xor_si128(b.vi, bias)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_u8(a.vb, b.vb));
+#else
+    return mapBytes(a, b, [](uint8_t x, uint8_t y) { return x > y ? 0xFF : 0; });
+#endif
+}
+
+// ---- Shifts by a uniform count ----------------------------------------
+
+// Counts past the lane width give zero (or the sign, for arithmetic)
+inline SPUVector shl32(const SPUVector& a, uint32_t n) {
+    if (n > 31) return SPUVector();
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sll_epi32(a.vi, _mm_cvtsi32_si128(static_cast<int>(n))));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vshlq_u32(a.vw, vdupq_n_s32(static_cast<int32_t>(n))));
+#else
+    return mapWords(a, a, [n](uint32_t x, uint32_t) { return x << n; });
+#endif
+}
+
+inline SPUVector shl16(const SPUVector& a, uint32_t n) {
+    if (n > 15) return SPUVector();
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sll_epi16(a.vi, _mm_cvtsi32_si128(static_cast<int>(n))));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vshlq_u16(a.vh, vdupq_n_s16(static_cast<int16_t>(n))));
+#else
+    return mapHalves(a, a, [n](uint16_t x, uint16_t) { return x << n; });
+#endif
+}
+
+inline SPUVector shr32(const SPUVector& a, uint32_t n) {
+    if (n > 31) return SPUVector();
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_srl_epi32(a.vi, _mm_cvtsi32_si128(static_cast<int>(n))));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vshlq_u32(a.vw, vdupq_n_s32(-static_cast<int32_t>(n))));
+#else
+    return mapWords(a, a, [n](uint32_t x, uint32_t) { return x >> n; });
+#endif
+}
+
+inline SPUVector shr16(const SPUVector& a, uint32_t n) {
+    if (n > 15) return SPUVector();
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_srl_epi16(a.vi, _mm_cvtsi32_si128(static_cast<int>(n))));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vshlq_u16(a.vh, vdupq_n_s16(-static_cast<int16_t>(n))));
+#else
+    return mapHalves(a, a, [n](uint16_t x, uint16_t) { return x >> n; });
+#endif
+}
+
+inline SPUVector sra32(const SPUVector& a, uint32_t n) {
+    if (n > 31) n = 31;
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sra_epi32(a.vi, _mm_cvtsi32_si128(static_cast<int>(n))));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vreinterpretq_u32_s32(vshlq_s32(vreinterpretq_s32_u32(a.vw), vdupq_n_s32(-static_cast<int32_t>(n)))));
+#else
+    return mapWords(a, a, [n](uint32_t x, uint32_t) { return static_cast<uint32_t>(static_cast<int32_t>(x) >> n); });
+#endif
+}
+
+inline SPUVector sra16(const SPUVector& a, uint32_t n) {
+    if (n > 15) n = 15;
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sra_epi16(a.vi, _mm_cvtsi32_si128(static_cast<int>(n))));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vreinterpretq_u16_s16(vshlq_s16(vreinterpretq_s16_u16(a.vh), vdupq_n_s16(-static_cast<int16_t>(n)))));
+#else
+    return mapHalves(a, a, [n](uint16_t x, uint16_t) { return static_cast<uint16_t>(static_cast<int16_t>(x) >> n); });
+#endif
+}
+
+inline SPUVector rotl32(const SPUVector& a, uint32_t n) {
+    n &= 31;
+    return n ? or_(shl32(a, n), shr32(a, 32 - n)) : a;
+}
+
+inline SPUVector rotl16(const SPUVector& a, uint32_t n) {
+    n &= 15;
+    return n ? or_(shl16(a, n), shr16(a, 16 - n)) : a;
+}
+
+// ---- Shifts by per-lane counts ----------------------------------------
+
+// Word shifts take the count from the low 6 bits of each lane of b
+inline SPUVector shl32v(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2) && defined(__AVX2__)
+    return make(_mm_sllv_epi32(a.vi, _mm_and_si128(b.vi, _mm_set1_epi32(0x3F))));
+#elif defined(PXS3C_SPU_NEON)
+    uint32x4_t n = vandq_u32(b.vw, vdupq_n_u32(0x3F));
+    return make(vshlq_u32(a.vw, vreinterpretq_s32_u32(n)));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { uint32_t n = y & 0x3F; return n > 31 ? 0u : x << n; });
+#endif
+}
+
+// Logical right shift by the low 6 bits of each lane of b (counts > 31 clear)
+inline SPUVector shr32v(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2) && defined(__AVX2__)
+    return make(_mm_srlv_epi32(a.vi, _mm_and_si128(b.vi, _mm_set1_epi32(0x3F))));
+#elif defined(PXS3C_SPU_NEON)
+    int32x4_t n = vreinterpretq_s32_u32(vandq_u32(b.vw, vdupq_n_u32(0x3F)));
+    return make(vshlq_u32(a.vw, vnegq_s32(n)));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) { uint32_t n = y & 0x3F; return n > 31 ? 0u : x >> n; });
+#endif
+}
+
+inline SPUVector sra32v(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2) && defined(__AVX2__)
+    return make(_mm_srav_epi32(a.vi, _mm_and_si128(b.vi, _mm_set1_epi32(0x3F))));
+#elif defined(PXS3C_SPU_NEON)
+    int32x4_t n = vreinterpretq_s32_u32(vminq_u32(vandq_u32(b.vw, vdupq_n_u32(0x3F)), vdupq_n_u32(31)));
+    return make(vreinterpretq_u32_s32(vshlq_s32(vreinterpretq_s32_u32(a.vw), vnegq_s32(n))));
+#else
+    return mapWords(a, b, [](uint32_t x, uint32_t y) {
+        uint32_t n = y & 0x3F;
+        return static_cast<uint32_t>(static_cast<int32_t>(x) >> (n > 31 ? 31 : n));
+    });
+#endif
+}
+
+inline SPUVector rotl32v(const SPUVector& a, const SPUVector& b) {
+    SPUVector n = and_(b, splat32(31));
+    return or_(shl32v(a, n), shr32v(a, sub32(splat32(32), n)));
+}
+
+// Halfword shifts take the count from the low 5 bits of each lane of b
+inline SPUVector shl16v(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_NEON)
+    uint16x8_t n = vandq_u16(b.vh, vdupq_n_u16(0x1F));
+    return make(vshlq_u16(a.vh, vreinterpretq_s16_u16(n)));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) { uint32_t n = y & 0x1F; return n > 15 ? 0u : (uint32_t)x << n; });
+#endif
+}
+
+inline SPUVector shr16v(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_NEON)
+    int16x8_t n = vreinterpretq_s16_u16(vandq_u16(b.vh, vdupq_n_u16(0x1F)));
+    return make(vshlq_u16(a.vh, vnegq_s16(n)));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) { uint32_t n = y & 0x1F; return n > 15 ? 0u : (uint32_t)x >> n; });
+#endif
+}
+
+inline SPUVector sra16v(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_NEON)
+    int16x8_t n = vreinterpretq_s16_u16(vminq_u16(vandq_u16(b.vh, vdupq_n_u16(0x1F)), vdupq_n_u16(15)));
+    return make(vreinterpretq_u16_s16(vshlq_s16(vreinterpretq_s16_u16(a.vh), vnegq_s16(n))));
+#else
+    return mapHalves(a, b, [](uint16_t x, uint16_t y) {
+        uint32_t n = y & 0x1F;
+        return static_cast<uint16_t>(static_cast<int16_t>(x) >> (n > 15 ? 15 : n));
+    });
+#endif
+}
+
+inline SPUVector rotl16v(const SPUVector& a, const SPUVector& b) {
+    SPUVector n = and_(b, splat16(15));
+    return or_(shl16v(a, n), shr16v(a, sub16(splat16(16), n)));
+}
+
+// ---- Byte permutes ----------------------------------------------------
+
+// Reverse all 16 bytes: converts between guest (big-endian) quadword order
+// and the register layout
+inline SPUVector byteReverse(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2) && defined(__SSSE3__)
+    return make(_mm_shuffle_epi8(a.vi, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)));
+#elif defined(PXS3C_SPU_SSE2)
+    __m128i x = _mm_shuffle_epi32(a.vi, _MM_SHUFFLE(0, 1, 2, 3));
+    x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+    return make(_mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8)));
+#elif defined(PXS3C_SPU_NEON)
+    uint8x16_t x = vrev64q_u8(a.vb);
+    return make(vextq_u8(x, x, 8));
+#else
+    SPUVector r;
+    for (int i = 0; i < 16; ++i) r.u8[i] = a.u8[15 - i];
+    return r;
+#endif
+}
+
+// shufb: each control byte selects a byte of a:b (0x00-0x1F) or, with its
+// top bits set, a constant (10xxxxxx: 0x00, 110xxxxx: 0xFF, 111xxxxx: 0x80)
+inline SPUVector shuffleBytes(const SPUVector& a, const SPUVector& b, const SPUVector& c) {
+#if (defined(PXS3C_SPU_SSE2) && defined(__SSSE3__)) || defined(PXS3C_SPU_NEON)
+    // Guest byte s lives at u8[15 - s], so the host index is ~s & 0xF
+#if defined(PXS3C_SPU_SSE2)
+    __m128i idx = _mm_andnot_si128(c.vi, _mm_set1_epi8(0x0F));
+    __m128i fromA = _mm_shuffle_epi8(a.vi, idx);
+    __m128i fromB = _mm_shuffle_epi8(b.vi, idx);
+    __m128i useB = _mm_cmpeq_epi8(_mm_and_si128(c.vi, _mm_set1_epi8(0x10)), _mm_set1_epi8(0x10));
+    __m128i picked = _mm_or_si128(_mm_and_si128(useB, fromB), _mm_andnot_si128(useB, fromA));
+    __m128i special = _mm_cmplt_epi8(c.vi, _mm_setzero_si128());
+    __m128i m40 = _mm_cmpeq_epi8(_mm_and_si128(c.vi, _mm_set1_epi8(0x40)), _mm_set1_epi8(0x40));
+    __m128i m20 = _mm_cmpeq_epi8(_mm_and_si128(c.vi, _mm_set1_epi8(0x20)), _mm_set1_epi8(0x20));
+    __m128i constant = _mm_and_si128(m40, _mm_xor_si128(_mm_set1_epi8(static_cast<char>(0xFF)),
+                                                        _mm_and_si128(m20, _mm_set1_epi8(0x7F))));
+    return make(_mm_or_si128(_mm_and_si128(special, constant), _mm_andnot_si128(special, picked)));
+#else
+    uint8x16_t idx = vbicq_u8(vdupq_n_u8(0x0F), c.vb);
+    uint8x16_t picked = vbslq_u8(vtstq_u8(c.vb, vdupq_n_u8(0x10)), vqtbl1q_u8(b.vb, idx), vqtbl1q_u8(a.vb, idx));
+    uint8x16_t special = vtstq_u8(c.vb, vdupq_n_u8(0x80));
+    uint8x16_t m40 = vtstq_u8(c.vb, vdupq_n_u8(0x40));
+    uint8x16_t m20 = vtstq_u8(c.vb, vdupq_n_u8(0x20));
+    uint8x16_t constant = vandq_u8(m40, veorq_u8(vdupq_n_u8(0xFF), vandq_u8(m20, vdupq_n_u8(0x7F))));
+    return make(vbslq_u8(special, constant, picked));
+#endif
+#else
+    SPUVector r;
+    for (int i = 0; i < 16; ++i) {
+        uint8_t sel = c.b(i);
+        if ((sel & 0xC0) == 0x80) {
+            r.b(i) = 0x00;
+        } else if ((sel & 0xE0) == 0xC0) {
+            r.b(i) = 0xFF;
+        } else if ((sel & 0xE0) == 0xE0) {
+            r.b(i) = 0x80;
+        } else {
+            r.b(i) = (sel & 0x10) ? b.b(sel & 0xF) : a.b(sel & 0xF);
+        }
+    }
+    return r;
+#endif
+}
+
+// ---- Bit gathers and masks --------------------------------------------
+
+// gb/gbh/gbb: the low bit of each element, element 0 as the most
+// significant bit. With the byte-reversed layout that is exactly the host
+// lane order, so a movemask does the whole gather.
+inline uint32_t gatherBits32(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2)
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(a.vi, 31))));
+#elif defined(PXS3C_SPU_NEON)
+    const int32_t shifts[4] = {0, 1, 2, 3};
+    return vaddvq_u32(vshlq_u32(vandq_u32(a.vw, vdupq_n_u32(1)), vld1q_s32(shifts)));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 4; ++i) bits |= (a.u32[i] & 1) << i;
+    return bits;
+#endif
+}
+
+inline uint32_t gatherBits16(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2)
+    __m128i x = _mm_slli_epi16(a.vi, 15);
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(x, _mm_setzero_si128())));
+#elif defined(PXS3C_SPU_NEON)
+    const int16_t shifts[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    return vaddvq_u16(vshlq_u16(vandq_u16(a.vh, vdupq_n_u16(1)), vld1q_s16(shifts)));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 8; ++i) bits |= (a.u16[i] & 1u) << i;
+    return bits;
+#endif
+}
+
+inline uint32_t gatherBits8(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2)
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_slli_epi16(a.vi, 7)));
+#elif defined(PXS3C_SPU_NEON)
+    const int8_t shifts[16] = {0, 1, 2, 3, 4, 5, 6, 7, 0, 1, 2, 3, 4, 5, 6, 7};
+    uint8x16_t x = vshlq_u8(vandq_u8(a.vb, vdupq_n_u8(1)), vld1q_s8(shifts));
+    return vaddv_u8(vget_low_u8(x)) | (static_cast<uint32_t>(vaddv_u8(vget_high_u8(x))) << 8);
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= (a.u8[i] & 1u) << i;
+    return bits;
+#endif
+}
+
+// fsm/fsmh/fsmb: the inverse, one all-ones element per set bit. Each lane
+// tests its own bit of the splatted mask.
+inline SPUVector expandBits32(uint32_t bits) {
+    SPUVector select;
+    for (int i = 0; i < 4; ++i) select.u32[i] = 1u << i;
+    return cmpeq32(and_(splat32(bits), select), select);
+}
+
+inline SPUVector expandBits16(uint32_t bits) {
+    SPUVector select;
+    for (int i = 0; i < 8; ++i) select.u16[i] = static_cast<uint16_t>(1u << i);
+    return cmpeq16(and_(splat16(static_cast<uint16_t>(bits)), select), select);
+}
+
+inline SPUVector expandBits8(uint32_t bits) {
+    SPUVector select;
+    for (int i = 0; i < 16; ++i) select.u8[i] = static_cast<uint8_t>(1u << (i & 7));
+    SPUVector source = splat8(static_cast<uint8_t>(bits));
+    source.u64[1] = splat8(static_cast<uint8_t>(bits >> 8)).u64[1];
+    return cmpeq8(and_(source, select), select);
+}
+
+// ---- Single precision -------------------------------------------------
+
+// SPU singles have no denormals, infinities or NaNs: denormals are zero
+// and overflow saturates (approximated by FLT_MAX). Done on the exponent
+// bits so it is exact on every host.
+inline SPUVector normalizeFloat(const SPUVector& a) {
+    SPUVector exponent = and_(a, splat32(0x7F800000));
+    SPUVector sign = and_(a, splat32(0x80000000));
+    SPUVector r = select(a, or_(sign, splat32(0x7F7FFFFF)), cmpeq32(exponent, splat32(0x7F800000)));
+    return select(r, sign, cmpeq32(exponent, SPUVector()));
+}
+
+inline SPUVector fadd(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_add_ps(a.vf, b.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vaddq_f32(a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = a.f32[i] + b.f32[i];
+    return r;
+#endif
+}
+
+inline SPUVector fsub(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sub_ps(a.vf, b.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vsubq_f32(a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = a.f32[i] - b.f32[i];
+    return r;
+#endif
+}
+
+inline SPUVector fmul(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_mul_ps(a.vf, b.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vmulq_f32(a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = a.f32[i] * b.f32[i];
+    return r;
+#endif
+}
+
+// a * b + c with a single rounding. Without FMA the product is formed
+// exactly in double precision and only the sum rounds (twice, to double
+// and then to single), which matches the fused result in all but
+// pathological ties.
+inline SPUVector fmadd(const SPUVector& a, const SPUVector& b, const SPUVector& c) {
+#if defined(PXS3C_SPU_SSE2) && defined(__FMA__)
+    return make(_mm_fmadd_ps(a.vf, b.vf, c.vf));
+#elif defined(PXS3C_SPU_SSE2)
+    __m128d lo = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(a.vf), _mm_cvtps_pd(b.vf)), _mm_cvtps_pd(c.vf));
+    __m128d hi = _mm_add_pd(_mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(a.vf, a.vf)), _mm_cvtps_pd(_mm_movehl_ps(b.vf, b.vf))),
+                            _mm_cvtps_pd(_mm_movehl_ps(c.vf, c.vf)));
+    return make(_mm_movelh_ps(_mm_cvtpd_ps(lo), _mm_cvtpd_ps(hi)));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vfmaq_f32(c.vf, a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = std::fma(a.f32[i], b.f32[i], c.f32[i]);
+    return r;
+#endif
+}
+
+inline SPUVector fneg(const SPUVector& a) {
+    return xor_(a, splat32(0x80000000));
+}
+
+inline SPUVector fabs(const SPUVector& a) {
+    return and_(a, splat32(0x7FFFFFFF));
+}
+
+inline SPUVector fcmpeq(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpeq_ps(a.vf, b.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vceqq_f32(a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.u32[i] = a.f32[i] == b.f32[i] ? 0xFFFFFFFFu : 0u;
+    return r;
+#endif
+}
+
+inline SPUVector fcmpgt(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpgt_ps(a.vf, b.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_f32(a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.u32[i] = a.f32[i] > b.f32[i] ? 0xFFFFFFFFu : 0u;
+    return r;
+#endif
+}
+
+inline SPUVector fdiv(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_div_ps(a.vf, b.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vdivq_f32(a.vf, b.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = a.f32[i] / b.f32[i];
+    return r;
+#endif
+}
+
+inline SPUVector fsqrt(const SPUVector& a) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sqrt_ps(a.vf));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vsqrtq_f32(a.vf));
+#else
+    SPUVector r;
+    for (int i = 0; i < 4; ++i) r.f32[i] = std::sqrt(a.f32[i]);
+    return r;
+#endif
+}
+
+// ---- Double precision -------------------------------------------------
+
+inline SPUVector dadd(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_add_pd(a.vd, b.vd));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vaddq_f64(a.vd, b.vd));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.f64[i] = a.f64[i] + b.f64[i];
+    return r;
+#endif
+}
+
+inline SPUVector dsub(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_sub_pd(a.vd, b.vd));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vsubq_f64(a.vd, b.vd));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.f64[i] = a.f64[i] - b.f64[i];
+    return r;
+#endif
+}
+
+inline SPUVector dmul(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_mul_pd(a.vd, b.vd));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vmulq_f64(a.vd, b.vd));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.f64[i] = a.f64[i] * b.f64[i];
+    return r;
+#endif
+}
+
+inline SPUVector dfmadd(const SPUVector& a, const SPUVector& b, const SPUVector& c) {
+#if defined(PXS3C_SPU_SSE2) && defined(__FMA__)
+    return make(_mm_fmadd_pd(a.vd, b.vd, c.vd));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vfmaq_f64(c.vd, a.vd, b.vd));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.f64[i] = std::fma(a.f64[i], b.f64[i], c.f64[i]);
+    return r;
+#endif
+}
+
+inline SPUVector dneg(const SPUVector& a) {
+    SPUVector sign;
+    sign.u64[0] = sign.u64[1] = 0x8000000000000000ULL;
+    return xor_(a, sign);
+}
+
+inline SPUVector dabs(const SPUVector& a) {
+    SPUVector mask;
+    mask.u64[0] = mask.u64[1] = 0x7FFFFFFFFFFFFFFFULL;
+    return and_(a, mask);
+}
+
+inline SPUVector dcmpeq(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpeq_pd(a.vd, b.vd));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vceqq_f64(a.vd, b.vd));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.u64[i] = a.f64[i] == b.f64[i] ? ~0ULL : 0;
+    return r;
+#endif
+}
+
+inline SPUVector dcmpgt(const SPUVector& a, const SPUVector& b) {
+#if defined(PXS3C_SPU_SSE2)
+    return make(_mm_cmpgt_pd(a.vd, b.vd));
+#elif defined(PXS3C_SPU_NEON)
+    return make(vcgtq_f64(a.vd, b.vd));
+#else
+    SPUVector r;
+    for (int i = 0; i < 2; ++i) r.u64[i] = a.f64[i] > b.f64[i] ? ~0ULL : 0;
+    return r;
+#endif
+}
+
+} // namespace spu
+
+} // namespace pxs3c
@@ -0,0 +1,166 @@
+#include "cpu/SPUWorkerPool.h"
+#include "cpu/SPUInterpreter.h"
+#include <algorithm>
+#include <iostream>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace pxs3c {
+
+SPUWorkerPool::SPUWorkerPool()
+    : running_(false), dispatches_(0), parkedSkips_(0), contextRuns_(0), next_(0), outstanding_(0) {}
+
+SPUWorkerPool::~SPUWorkerPool() {
+    stop();
+}
+
+int SPUWorkerPool::defaultWorkerCount() {
+    // One host CPU stays with the PPU thread
+    unsigned int cpus = std::thread::hardware_concurrency();
+    return cpus > 1 ? static_cast<int>(cpus - 1) : 1;
+}
+
+bool SPUWorkerPool::start(const SPUWorkerConfig& config) {
+    if (running_) return true;
+    config_ = config;
+    int count = config_.workers > 0 ? config_.workers : defaultWorkerCount();
+    workers_.clear();
+    for (int i = 0; i < count; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    try {
+        for (int i = 0; i < count; ++i) {
+            workers_[i]->thread = std::thread(&SPUWorkerPool::workerLoop, this, i);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to start SPU worker threads: " << e.what() << std::endl;
+        running_ = true;  // let stop() join whatever did start
+        stop();
+        return false;
+    }
+    running_ = true;
+    std::cout << "SPU worker pool started (" << count << " threads"
+              << (config_.pinThreads ? ", pinned" : "") << ")" << std::endl;
+    return true;
+}
+
+void SPUWorkerPool::stop() {
+    if (!running_) return;
+    for (auto& w : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(w->mutex);
+            w->command = Command::Exit;
+        }
+        w->cv.notify_one();
+    }
+    for (auto& w : workers_) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+    workers_.clear();
+    running_ = false;
+}
+
+void SPUWorkerPool::runUntil(const std::vector<SPUInterpreter*>& spus, uint64_t targetCycles) {
+    dispatch(spus, Command::RunUntil, targetCycles);
+}
+
+void SPUWorkerPool::runBlock(const std::vector<SPUInterpreter*>& spus, int maxInstructions) {
+    dispatch(spus, Command::RunBlock, static_cast<uint64_t>(maxInstructions));
+}
+
+void SPUWorkerPool::dispatch(const std::vector<SPUInterpreter*>& spus, Command command, uint64_t argument) {
+    if (!running_) return;
+    // A parked SPU waits on the PPU (mailbox, signal), which is not running
+    // now, or on the DMA thread, which only costs it the rest of a slice
+    runList_.clear();
+    for (SPUInterpreter* spu : spus) {
+        if (!spu->isParked()) {
+            runList_.push_back(spu);
+        } else if (command == Command::RunUntil) {
+            spu->idleUntil(argument);
+        }
+    }
+    parkedSkips_ += spus.size() - runList_.size();
+    contextRuns_ += runList_.size();
+    if (runList_.empty()) {
+        dispatches_++;
+        return;
+    }
+
+    int count = static_cast<int>(std::min(runList_.size(), workers_.size()));
+    next_.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        outstanding_ = count;
+    }
+    for (int i = 0; i < count; ++i) {
+        Worker& w = *workers_[i];
+        {
+            std::lock_guard<std::mutex> lock(w.mutex);
+            w.command = command;
+            w.argument = argument;
+        }
+        w.cv.notify_one();
+    }
+    std::unique_lock<std::mutex> lock(doneMutex_);
+    doneCv_.wait(lock, [this] { return outstanding_ == 0; });
+    dispatches_++;
+}
+
+void SPUWorkerPool::workerLoop(int id) {
+    if (config_.pinThreads) {
+        pinCurrentThread(id);
+    }
+    Worker& w = *workers_[id];
+    for (;;) {
+        Command command;
+        uint64_t argument;
+        {
+            // Park until the PPU hands out something to do
+            std::unique_lock<std::mutex> lock(w.mutex);
+            w.cv.wait(lock, [&w] { return w.command != Command::None; });
+            if (w.command == Command::Exit) return;
+            command = w.command;
+            argument = w.argument;
+            w.command = Command::None;
+        }
+
+        // Take contexts until the list is drained; dispatch does not touch
+        // it again before every woken worker is back
+        for (size_t i = next_.fetch_add(1, std::memory_order_relaxed); i < runList_.size();
+             i = next_.fetch_add(1, std::memory_order_relaxed)) {
+            SPUInterpreter* spu = runList_[i];
+            if (command == Command::RunUntil) {
+                spu->runUntil(argument);
+            } else if (!spu->isParked()) {
+                spu->executeBlock(static_cast<int>(argument));
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(doneMutex_);
+        if (--outstanding_ == 0) {
+            doneCv_.notify_one();
+        }
+    }
+}
+
+void SPUWorkerPool::pinCurrentThread(int id) {
+#ifdef __linux__
+    unsigned int cpus = std::thread::hardware_concurrency();
+    if (cpus == 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((config_.firstCpu + id) % cpus, &set);
+    // pid 0 is the calling thread
+    if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+        std::cerr << "SPU worker " << id << ": failed to set CPU affinity" << std::endl;
+    }
+#else
+    (void)id;
+#endif
+}
+
+} // namespace pxs3c
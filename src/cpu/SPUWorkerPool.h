@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pxs3c {
+
+class SPUInterpreter;
+
+struct SPUWorkerConfig {
+    int workers = 0;          // host threads; 0 leaves one host CPU for the PPU
+    bool pinThreads = false;  // pin each worker to one host CPU
+    int firstCpu = 1;         // worker n runs on CPU (firstCpu + n) % host CPUs
+    bool asyncDMA = false;    // run MFC transfers on their own thread
+    uint32_t channelWaitUs = 0;  // how long a stalled SPU sleeps on its channel
+};
+
+// Persistent host threads running guest SPU contexts. There is no fixed
+// mapping between the two: a run command gets a list of contexts, the ones
+// that are parked (stopped, or stalled on a channel nobody has fed yet) are
+// moved forward in time on the caller, and the rest go into a run list that
+// the workers drain, each taking the next context as soon as it is done
+// with the last. More contexts than workers simply take turns within the
+// command; fewer leave the extra workers asleep. Dispatch blocks until the
+// run list is empty and every worker that was woken has parked again.
+//
+// Threads are created once, so a frame only pays for two wakeups per busy
+// worker instead of a thread spawn and join.
+class SPUWorkerPool {
+public:
+    SPUWorkerPool();
+    ~SPUWorkerPool();
+
+    bool start(const SPUWorkerConfig& config);
+    void stop();
+    bool isRunning() const { return running_; }
+    int getWorkerCount() const { return static_cast<int>(workers_.size()); }
+
+    // Run commands: every context to targetCycles, or maxInstructions each.
+    // Both return once all workers have parked again.
+    void runUntil(const std::vector<SPUInterpreter*>& spus, uint64_t targetCycles);
+    void runBlock(const std::vector<SPUInterpreter*>& spus, int maxInstructions);
+
+    // Workers the host gets when the config leaves it to us
+    static int defaultWorkerCount();
+
+    uint64_t getDispatches() const { return dispatches_; }
+    uint64_t getParkedSkips() const { return parkedSkips_; }
+    uint64_t getContextRuns() const { return contextRuns_; }
+
+private:
+    enum class Command { None, RunUntil, RunBlock, Exit };
+
+    struct Worker {
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        Command command = Command::None;
+        uint64_t argument = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    SPUWorkerConfig config_;
+    bool running_;
+    uint64_t dispatches_;
+    uint64_t parkedSkips_;  // context runs saved by parked SPUs
+    uint64_t contextRuns_;
+
+    // The current command's contexts, claimed through next_
+    std::vector<SPUInterpreter*> runList_;
+    std::atomic<size_t> next_;
+
+    // Completion: workers still executing the current command
+    std::mutex doneMutex_;
+    std::condition_variable doneCv_;
+    int outstanding_;
+
+    void dispatch(const std::vector<SPUInterpreter*>& spus, Command command, uint64_t argument);
+    void workerLoop(int id);
+    void pinCurrentThread(int id);
+};
+
+} // namespace pxs3c
@@ -2,10 +2,14 @@
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace pxs3c {
 
-MemoryManager::MemoryManager() : initialized_(false) {}
+MemoryManager::MemoryManager()
+    : initialized_(false), fastmemBase_(nullptr),
+      pageFlags_(new uint8_t[FASTMEM_PAGE_COUNT]()) {}
 
 MemoryManager::~MemoryManager() {
     shutdown();
@@ -18,6 +22,18 @@ bool MemoryManager::init() {
     // Memory will be allocated on-demand when accessed
     std::cout << "Initializing PS3 memory map (lazy allocation)..." << std::endl;
 
+    // Reserve the whole 32-bit guest address space up front. Nothing is
+    // committed until a region is mapped, and mapped pages are only backed
+    // by host memory once touched.
+    void* reservation = mmap(nullptr, FASTMEM_SIZE, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reservation != MAP_FAILED) {
+        fastmemBase_ = static_cast<uint8_t*>(reservation);
+        std::cout << "Fastmem reserved at " << static_cast<void*>(fastmemBase_) << std::endl;
+    } else {
+        std::cout << "Fastmem reservation failed, using per-region buffers" << std::endl;
+    }
+
     try {
         // Only create the region metadata, don't allocate actual memory yet
         MemoryRegion mainRam;
@@ -26,6 +42,7 @@ bool MemoryManager::init() {
         mainRam.flags = MEM_PROT_READ | MEM_PROT_WRITE;
         // Data is null - will be allocated on-demand
         mainRam.data = nullptr;
+        backRegion(mainRam);
         
         // Insert safely with exception handling
         try {
@@ -50,9 +67,87 @@ bool MemoryManager::init() {
 void MemoryManager::shutdown() {
     if (!initialized_) return;
     regions_.clear();
+    if (fastmemBase_) {
+        munmap(fastmemBase_, FASTMEM_SIZE);
+        fastmemBase_ = nullptr;
+    }
+    std::memset(pageFlags_.get(), 0, FASTMEM_PAGE_COUNT);
     initialized_ = false;
 }
 
+bool MemoryManager::commitFastmem(uint64_t vaddr, uint64_t size, uint32_t flags) {
+    if (!fastmemBase_ || size == 0 || vaddr + size > FASTMEM_SIZE) return false;
+    // MMIO always goes through the slow path
+    if (vaddr < MMIO_BASE + MMIO_SIZE && vaddr + size > MMIO_BASE) return false;
+
+    const uint64_t hostPage = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = vaddr & ~(hostPage - 1);
+    uint64_t end = (vaddr + size + hostPage - 1) & ~(hostPage - 1);
+    if (mprotect(fastmemBase_ + start, end - start, PROT_READ | PROT_WRITE) != 0) {
+        return false;
+    }
+
+    // Only pages entirely inside the region may be accessed inline
+    uint8_t pageFlags = ((flags & MEM_PROT_READ) ? FASTMEM_READ : 0) |
+                        ((flags & MEM_PROT_WRITE) ? FASTMEM_WRITE : 0);
+    uint64_t first = (vaddr + FASTMEM_PAGE_SIZE - 1) >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = (vaddr + size) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = first; page < last; ++page) {
+        // A page the JIT still has code from keeps reporting stores
+        bool code = pageFlags_[page] & FASTMEM_CODE;
+        pageFlags_[page] = code ? (pageFlags & ~FASTMEM_WRITE) | FASTMEM_CODE : pageFlags;
+    }
+    return true;
+}
+
+void MemoryManager::releaseFastmem(uint64_t vaddr, uint64_t size) {
+    uint64_t first = vaddr >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = (vaddr + size + FASTMEM_PAGE_SIZE - 1) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = first; page < last && page < FASTMEM_PAGE_COUNT; ++page) {
+        pageFlags_[page] &= FASTMEM_CODE;  // until the JIT has dropped its code
+    }
+
+    // Drop the backing store of whole host pages; partial ones may belong
+    // to a neighbouring region
+    const uint64_t hostPage = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = (vaddr + hostPage - 1) & ~(hostPage - 1);
+    uint64_t end = (vaddr + size) & ~(hostPage - 1);
+    if (end > start) {
+        madvise(fastmemBase_ + start, end - start, MADV_DONTNEED);
+        mprotect(fastmemBase_ + start, end - start, PROT_NONE);
+    }
+}
+
+void MemoryManager::backRegion(MemoryRegion& region) {
+    region.fastmem = commitFastmem(region.base, region.size, region.flags);
+    if (region.fastmem) {
+        region.data = nullptr;
+    }
+}
+
+uint8_t* MemoryManager::hostPointer(MemoryRegion& region, uint64_t vaddr, size_t size) {
+    if (region.fastmem) {
+        return fastmemBase_ + vaddr;
+    }
+
+    // Ensure data is allocated for this region
+    if (!region.data) {
+        try {
+            region.data = std::make_shared<std::vector<uint8_t>>();
+            region.data->resize(std::min(region.size, (uint64_t)1024 * 1024), 0); // 1MB default
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    // The lazily allocated buffer may be smaller than the region
+    uint64_t offset = vaddr - region.base;
+    if (offset + size > region.data->size()) {
+        return nullptr;
+    }
+    return region.data->data() + offset;
+}
+
 bool MemoryManager::mapRegion(uint64_t vaddr, uint64_t size, uint32_t flags) {
     // Check for overlaps
     for (const auto& [base, region] : regions_) {
@@ -69,8 +164,11 @@ bool MemoryManager::mapRegion(uint64_t vaddr, uint64_t size, uint32_t flags) {
     region.base = vaddr;
     region.size = size;
     region.flags = flags;
-    region.data = std::make_shared<std::vector<uint8_t>>();
-    region.data->resize(size, 0);
+    backRegion(region);
+    if (!region.fastmem) {
+        region.data = std::make_shared<std::vector<uint8_t>>();
+        region.data->resize(size, 0);
+    }
     
     regions_[vaddr] = std::move(region);
     
@@ -85,6 +183,12 @@ bool MemoryManager::unmapRegion(uint64_t vaddr) {
     if (it == regions_.end()) {
         return false;
     }
+    if (codeWriteHandler_ && touchesCode(it->second.base, it->second.size)) {
+        codeWriteHandler_(it->second.base, it->second.size);
+    }
+    if (it->second.fastmem) {
+        releaseFastmem(it->second.base, it->second.size);
+    }
     regions_.erase(it);
     return true;
 }
@@ -99,6 +203,11 @@ MemoryRegion* MemoryManager::getRegion(uint64_t vaddr) {
 }
 
 bool MemoryManager::read(uint64_t vaddr, void* dst, size_t size) {
+    if (fastAccess(vaddr, size, FASTMEM_READ)) {
+        std::memcpy(dst, fastmemBase_ + vaddr, size);
+        return true;
+    }
+
     MemoryRegion* region = getRegion(vaddr);
     if (!region) {
         // Lazy allocation: allocate region on first access
@@ -109,16 +218,6 @@ bool MemoryManager::read(uint64_t vaddr, void* dst, size_t size) {
         region = getRegion(vaddr);
         if (!region) return false;
     }
-    
-    // Ensure data is allocated for this region
-    if (!region->data) {
-        try {
-            region->data = std::make_shared<std::vector<uint8_t>>();
-            region->data->resize(std::min(region->size, (uint64_t)1024 * 1024), 0); // 1MB default
-        } catch (...) {
-            return false;
-        }
-    }
 
     if (!(region->flags & MEM_PROT_READ)) {
         std::cerr << "Read from non-readable memory: 0x" << std::hex << vaddr << std::dec << std::endl;
@@ -126,16 +225,22 @@ bool MemoryManager::read(uint64_t vaddr, void* dst, size_t size) {
     }
 
     uint64_t offset = vaddr - region->base;
-    if (offset + size > region->size) {
+    uint8_t* host = offset + size <= region->size ? hostPointer(*region, vaddr, size) : nullptr;
+    if (!host) {
         std::cerr << "Read out of bounds: 0x" << std::hex << vaddr << std::dec << std::endl;
         return false;
     }
 
-    std::memcpy(dst, region->data->data() + offset, size);
+    std::memcpy(dst, host, size);
     return true;
 }
 
 bool MemoryManager::write(uint64_t vaddr, const void* src, size_t size) {
+    if (fastAccess(vaddr, size, FASTMEM_WRITE)) {
+        std::memcpy(fastmemBase_ + vaddr, src, size);
+        return true;
+    }
+
     MemoryRegion* region = getRegion(vaddr);
     if (!region) {
         std::cerr << "Write to unmapped memory: 0x" << std::hex << vaddr << std::dec << std::endl;
@@ -148,23 +253,54 @@ bool MemoryManager::write(uint64_t vaddr, const void* src, size_t size) {
     }
 
     uint64_t offset = vaddr - region->base;
-    if (offset + size > region->size) {
+    uint8_t* host = offset + size <= region->size ? hostPointer(*region, vaddr, size) : nullptr;
+    if (!host) {
         std::cerr << "Write out of bounds: 0x" << std::hex << vaddr << std::dec << std::endl;
         return false;
     }
 
-    // Ensure data is allocated
-    if (!region->data) {
-        try {
-            region->data = std::make_shared<std::vector<uint8_t>>();
-            region->data->resize(std::min(region->size, (uint64_t)1024 * 1024), 0);
-        } catch (...) {
-            return false;
+    std::memcpy(host, src, size);
+    if (codeWriteHandler_ && touchesCode(vaddr, size)) {
+        codeWriteHandler_(vaddr, size);
+    }
+    return true;
+}
+
+bool MemoryManager::touchesCode(uint64_t vaddr, uint64_t size) const {
+    if (size == 0) return false;
+    uint64_t first = vaddr >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = std::min((vaddr + size - 1) >> FASTMEM_PAGE_SHIFT, FASTMEM_PAGE_COUNT - 1);
+    for (uint64_t page = first; page <= last; ++page) {
+        if (pageFlags_[page] & FASTMEM_CODE) {
+            return true;
         }
     }
+    return false;
+}
 
-    std::memcpy(region->data->data() + offset, src, size);
-    return true;
+void MemoryManager::markCode(uint64_t vaddr, uint64_t size) {
+    uint64_t first = vaddr >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = (vaddr + size + FASTMEM_PAGE_SIZE - 1) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = first; page < last && page < FASTMEM_PAGE_COUNT; ++page) {
+        pageFlags_[page] = (pageFlags_[page] & ~FASTMEM_WRITE) | FASTMEM_CODE;
+    }
+}
+
+void MemoryManager::unmarkCode(uint64_t vaddr, uint64_t size) {
+    uint64_t first = vaddr >> FASTMEM_PAGE_SHIFT;
+    uint64_t last = (vaddr + size + FASTMEM_PAGE_SIZE - 1) >> FASTMEM_PAGE_SHIFT;
+    for (uint64_t page = first; page < last && page < FASTMEM_PAGE_COUNT; ++page) {
+        if (!(pageFlags_[page] & FASTMEM_CODE)) {
+            continue;
+        }
+        // Inline stores again if the page is wholly inside a writable
+        // fastmem region, as commitFastmem() would have set it up
+        uint64_t base = page << FASTMEM_PAGE_SHIFT;
+        MemoryRegion* region = getRegion(base);
+        bool writable = region && region->fastmem && (region->flags & MEM_PROT_WRITE) &&
+                        base + FASTMEM_PAGE_SIZE <= region->base + region->size;
+        pageFlags_[page] = (pageFlags_[page] & ~FASTMEM_CODE) | (writable ? FASTMEM_WRITE : 0);
+    }
 }
 
 uint16_t MemoryManager::swapEndian16(uint16_t val) {
@@ -234,10 +370,8 @@ void MemoryManager::write64(uint64_t vaddr, uint64_t value) {
 
 uint8_t* MemoryManager::getPointer(uint64_t vaddr) {
     MemoryRegion* region = getRegion(vaddr);
-    if (!region || !region->data) return nullptr;
-    
-    uint64_t offset = vaddr - region->base;
-    return region->data->data() + offset;
+    if (!region || (!region->fastmem && !region->data)) return nullptr;
+    return hostPointer(*region, vaddr, 1);
 }
 
 bool MemoryManager::allocateOnDemand(uint64_t vaddr) {
@@ -255,8 +389,11 @@ bool MemoryManager::allocateOnDemand(uint64_t vaddr) {
     newRegion.flags = MEM_PROT_READ | MEM_PROT_WRITE;
     
     try {
-        newRegion.data = std::make_shared<std::vector<uint8_t>>();
-        newRegion.data->resize(newRegion.size, 0);
+        backRegion(newRegion);
+        if (!newRegion.fastmem) {
+            newRegion.data = std::make_shared<std::vector<uint8_t>>();
+            newRegion.data->resize(newRegion.size, 0);
+        }
         regions_[newRegion.base] = std::move(newRegion);
         return true;
     } catch (const std::exception& e) {
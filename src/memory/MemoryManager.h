@@ -1,9 +1,11 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <vector>
 #include <map>
 #include <memory>
+#include <utility>
 
 namespace pxs3c {
 
@@ -20,16 +22,32 @@ constexpr uint64_t USER_MEMORY_SIZE = 0x10000000; // 256MB
 constexpr uint64_t RSX_MEMORY_BASE = 0xC0000000;
 constexpr uint64_t RSX_MEMORY_SIZE = 0x10000000; // 256MB
 
+constexpr uint64_t MMIO_BASE = 0xD0000000;
+constexpr uint64_t MMIO_SIZE = 0x10000000;
+
 // Memory protection flags (matches ELF p_flags)
 constexpr uint32_t MEM_PROT_EXEC = 0x1;
 constexpr uint32_t MEM_PROT_WRITE = 0x2;
 constexpr uint32_t MEM_PROT_READ = 0x4;
 
+// Fast memory: the 32-bit guest address space is reserved as one block of
+// host address space, so guest address A lives at fastmemBase + A. A flag
+// per 64KB page says whether plain loads/stores may go straight to it;
+// everything else (MMIO, unmapped or protected pages) takes the slow path.
+constexpr uint64_t FASTMEM_SIZE = 0x100000000ULL;  // 4GB
+constexpr int FASTMEM_PAGE_SHIFT = 16;
+constexpr uint64_t FASTMEM_PAGE_SIZE = 1ULL << FASTMEM_PAGE_SHIFT;
+constexpr size_t FASTMEM_PAGE_COUNT = FASTMEM_SIZE >> FASTMEM_PAGE_SHIFT;
+constexpr uint8_t FASTMEM_READ = 0x1;
+constexpr uint8_t FASTMEM_WRITE = 0x2;
+constexpr uint8_t FASTMEM_CODE = 0x4;  // holds JIT code, see markCode()
+
 struct MemoryRegion {
     uint64_t base;
     uint64_t size;
     uint32_t flags;
     std::shared_ptr<std::vector<uint8_t>> data;  // Use shared_ptr for lazy allocation
+    bool fastmem = false;                        // backed by the fastmem reservation instead
 };
 
 class MemoryManager {
@@ -64,6 +82,22 @@ public:
     // Direct pointer access (unsafe, for performance)
     uint8_t* getPointer(uint64_t vaddr);
 
+    // Fast memory, for code that accesses guest memory inline (the JIT).
+    // getFastmemBase() is null if the reservation failed; the page flag
+    // table always exists and is all zero in that case.
+    uint8_t* getFastmemBase() const { return fastmemBase_; }
+    const uint8_t* getPageFlags() const { return pageFlags_.get(); }
+
+    // Pages the JIT has translated code from. Stores to them never go
+    // inline (FASTMEM_WRITE is off while FASTMEM_CODE is on): they take the
+    // slow path, which reports each one to the code write handler, as does
+    // unmapping a region that holds code. The handler may be called from
+    // any thread that writes guest memory.
+    using CodeWriteHandler = std::function<void(uint64_t vaddr, uint64_t size)>;
+    void setCodeWriteHandler(CodeWriteHandler handler) { codeWriteHandler_ = std::move(handler); }
+    void markCode(uint64_t vaddr, uint64_t size);
+    void unmarkCode(uint64_t vaddr, uint64_t size);
+
     // Stats
     size_t getTotalMapped() const;
     void dumpRegions() const;
@@ -71,10 +105,27 @@ public:
 private:
     std::map<uint64_t, MemoryRegion> regions_;
     bool initialized_;
+    uint8_t* fastmemBase_;
+    std::unique_ptr<uint8_t[]> pageFlags_;
+    CodeWriteHandler codeWriteHandler_;
     
     // Lazy allocation helper
     bool allocateOnDemand(uint64_t vaddr);
 
+    // Back [vaddr, vaddr + size) with fastmem pages and publish their flags.
+    // Returns false if the range does not fit in the reservation.
+    bool commitFastmem(uint64_t vaddr, uint64_t size, uint32_t flags);
+    void releaseFastmem(uint64_t vaddr, uint64_t size);
+    bool fastAccess(uint64_t vaddr, size_t size, uint8_t need) const {
+        uint64_t page = vaddr >> FASTMEM_PAGE_SHIFT;
+        return page < FASTMEM_PAGE_COUNT &&
+               ((vaddr + size - 1) >> FASTMEM_PAGE_SHIFT) == page &&
+               (pageFlags_[page] & need);
+    }
+    bool touchesCode(uint64_t vaddr, uint64_t size) const;
+    void backRegion(MemoryRegion& region);
+    uint8_t* hostPointer(MemoryRegion& region, uint64_t vaddr, size_t size);
+
     uint16_t swapEndian16(uint16_t val);
     uint32_t swapEndian32(uint32_t val);
     uint64_t swapEndian64(uint64_t val);
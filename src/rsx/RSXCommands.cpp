@@ -5,12 +5,12 @@
 namespace pxs3c {
 
 RSXCommandBuffer::RSXCommandBuffer(uint32_t capacity)
-    : buffer_(), capacity_(capacity), currentPos_(0), readPos_(0) {
+    : buffer_(), capacity_(capacity / 4), writePos_(0), readPos_(0) {
     // Lazy allocation: avoid heap allocation in constructor on Android
     // Buffer will be allocated on first write/read.
 }
 
-static bool ensureBufferAllocated(std::vector<uint8_t>& buffer, uint32_t capacity) {
+static bool ensureBufferAllocated(std::vector<uint32_t>& buffer, uint32_t capacity) {
     if (!buffer.empty()) return true;
     if (capacity == 0) return false;
     try {
@@ -21,98 +21,54 @@ static bool ensureBufferAllocated(std::vector<uint8_t>& buffer, uint32_t capacit
     }
 }
 
-void RSXCommandBuffer::writeCommand(uint32_t method, const std::vector<uint32_t>& data) {
+void RSXCommandBuffer::writeCommand(uint32_t method, const uint32_t* data, uint32_t count) {
     if (!ensureBufferAllocated(buffer_, capacity_)) {
         std::cerr << "RSX command buffer allocation failed" << std::endl;
         return;
     }
 
-    // Write method header (upper 16 bits = method, lower 16 bits = count)
-    if (currentPos_ + 4 + data.size() * 4 >= buffer_.size()) {
+    // Everything written has been read: reuse the space
+    if (readPos_ == writePos_) {
+        readPos_ = writePos_ = 0;
+    }
+    if (count > 0xFFFF || writePos_ + 1 + count >= buffer_.size()) {
         std::cerr << "RSX command buffer overflow" << std::endl;
         return;
     }
-    
-    uint32_t count = data.size();
-    uint32_t header = (method << 16) | count;
-    std::memcpy(buffer_.data() + currentPos_, &header, 4);
-    currentPos_ += 4;
-    
-    // Write data
-    for (uint32_t value : data) {
-        std::memcpy(buffer_.data() + currentPos_, &value, 4);
-        currentPos_ += 4;
-    }
-}
 
-void RSXCommandBuffer::writeCommand(uint32_t method, uint32_t value) {
-    std::vector<uint32_t> data = {value};
-    writeCommand(method, data);
+    // Write method header (upper 16 bits = method, lower 16 bits = count)
+    buffer_[writePos_] = (method << 16) | count;
+    if (count) {
+        std::memcpy(buffer_.data() + writePos_ + 1, data, count * sizeof(uint32_t));
+    }
+    writePos_ += 1 + count;
 }
 
 bool RSXCommandBuffer::readCommand(RSXCommand& cmd) {
-    if (!ensureBufferAllocated(buffer_, capacity_)) {
+    RSXCommandView view;
+    if (!readCommand(view)) {
         return false;
     }
-    if (readPos_ >= currentPos_) {
-        return false;  // No more commands
-    }
-    
-    // Read header
-    uint32_t header;
-    std::memcpy(&header, buffer_.data() + readPos_, 4);
-    readPos_ += 4;
-    
-    cmd.method = header >> 16;
-    cmd.count = header & 0xFFFF;
-    cmd.data.clear();
-    cmd.data.resize(cmd.count);
-    
-    // Read data
-    for (uint32_t i = 0; i < cmd.count; ++i) {
-        uint32_t value;
-        std::memcpy(&value, buffer_.data() + readPos_, 4);
-        readPos_ += 4;
-        cmd.data[i] = value;
-    }
-    
+    cmd.method = view.method;
+    cmd.count = view.count;
+    cmd.data.assign(view.args, view.args + view.count);
     return true;
 }
 
 bool RSXCommandBuffer::peekCommand(RSXCommand& cmd) const {
-    // const method: if buffer isn't allocated, it's effectively empty.
-    if (buffer_.empty()) {
-        return false;
-    }
-    if (readPos_ >= currentPos_) {
+    if (readPos_ >= writePos_) {
         return false;
     }
-    
-    uint32_t header;
-    std::memcpy(&header, buffer_.data() + readPos_, 4);
-    
-    cmd.method = header >> 16;
-    cmd.count = header & 0xFFFF;
-    cmd.data.clear();
-    cmd.data.resize(cmd.count);
-    
-    // Peek data
-    uint32_t pos = readPos_ + 4;
-    for (uint32_t i = 0; i < cmd.count && pos < currentPos_; ++i) {
-        uint32_t value;
-        std::memcpy(&value, buffer_.data() + pos, 4);
-        pos += 4;
-        cmd.data[i] = value;
-    }
-    
+    RSXCommandView view = *begin();
+    cmd.method = view.method;
+    cmd.count = view.count;
+    cmd.data.assign(view.args, view.args + view.count);
     return true;
 }
 
 void RSXCommandBuffer::clear() {
-    if (!buffer_.empty()) {
-        // Keep allocated buffer to avoid re-allocations.
-    }
-    currentPos_ = 0;
+    // Keep allocated buffer to avoid re-allocations.
+    writePos_ = 0;
     readPos_ = 0;
 }
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 #include <vector>
 #include <cstring>
@@ -15,57 +16,115 @@ struct RSXCommand {
     std::vector<uint32_t> data;  // Command data
 };
 
-// RSX Method IDs (subset)
+// A command read in place: args points at its count words inside the
+// command buffer and stays valid until the buffer is next written or
+// cleared. Decoding one copies and allocates nothing. The arguments go to
+// consecutive methods from method on, or with nonIncrement all to method.
+struct RSXCommandView {
+    uint32_t method;
+    uint32_t count;
+    const uint32_t* args;
+    bool nonIncrement;
+
+    uint32_t arg(uint32_t i) const { return i < count ? args[i] : 0; }
+};
+
+// Walks the commands in a run of command words, yielding views
+class RSXCommandIterator {
+public:
+    RSXCommandIterator(const uint32_t* pos, const uint32_t* end) : pos_(pos), end_(end) {}
+
+    RSXCommandView operator*() const {
+        uint32_t header = *pos_;
+        return {header >> 16, count(header), pos_ + 1, false};
+    }
+    RSXCommandIterator& operator++() {
+        pos_ += 1 + count(*pos_);
+        return *this;
+    }
+    bool operator==(const RSXCommandIterator& other) const { return pos_ == other.pos_; }
+    bool operator!=(const RSXCommandIterator& other) const { return pos_ != other.pos_; }
+
+private:
+    const uint32_t* pos_;
+    const uint32_t* end_;
+
+    // A header never claims more words than there are
+    uint32_t count(uint32_t header) const {
+        return std::min<uint32_t>(header & 0xFFFF, static_cast<uint32_t>(end_ - pos_ - 1));
+    }
+};
+
+// RSX methods (subset), by byte offset into the 3D object (NV4097) or, for
+// NV406E, the FIFO channel. The method field of a FIFO header is such an
+// offset, and the register file holds the last word written to each one.
 enum RSXMethod : uint32_t {
-    // Viewport/Scissor
-    NV30_VIEWPORT_HORIZONTAL = 0x0A20,
-    NV30_VIEWPORT_VERTICAL = 0x0A24,
-    NV30_SCISSOR_HORIZONTAL = 0x0C90,
-    NV30_SCISSOR_VERTICAL = 0x0C94,
-    
-    // Matrix operations
-    NV30_MATRIX_MODE = 0x0D60,
-    NV30_MATRIX_PUSH = 0x0D68,
-    NV30_MATRIX_POP = 0x0D6C,
-    NV30_MATRIX_DATA = 0x0D70,
-    
-    // Drawing
-    NV30_BLEND_FUNC = 0x0B04,
-    NV30_BLEND_EQUATION = 0x0B0C,
-    NV30_CLEAR_COLOR = 0x0A0C,
-    NV30_CLEAR_VALUE = 0x0A0C,
-    
-    // Rasterization
-    NV30_CULL_FACE = 0x0B44,
-    NV30_FRONT_FACE = 0x0B46,
-    NV30_POLYGON_MODE = 0x0A20,
-    
-    // Texture/Sampling
-    NV30_TEX_ADDR = 0x1400,
-    NV30_TEX_WRAP_S = 0x1408,
-    NV30_TEX_WRAP_T = 0x1409,
-    NV30_TEX_FORMAT = 0x140C,
-    NV30_TEX_FILTER = 0x140F,
-    
-    // Primitive drawing
-    NV30_BEGIN_END = 0x0ABC,
-    
-    // Vertex data
-    NV30_VERTEX_ARRAY_POINTER_X = 0x1700,
-    NV30_VERTEX_ARRAY_POINTER_Y = 0x1704,
-    NV30_VERTEX_ARRAY_POINTER_Z = 0x1708,
-    NV30_VERTEX_ARRAY_POINTER_W = 0x170C,
-    
-    // Framebuffer
-    NV30_SURFACE_FORMAT = 0x0A20,
-    NV30_SURFACE_PITCH = 0x0A24,
-    NV30_SURFACE_OFFSET_ZETA = 0x0A20,
-    
-    // Synchronization
-    NV30_NOTIFY = 0x0104,
-    NV30_WAIT_FOR_IDLE = 0x1DFC,
+    // Channel and synchronisation
+    NV406E_SET_REFERENCE = 0x0050,
+    NV406E_SEMAPHORE_OFFSET = 0x0064,
+    NV406E_SEMAPHORE_ACQUIRE = 0x0068,
+    NV406E_SEMAPHORE_RELEASE = 0x006C,
+    NV4097_NO_OPERATION = 0x0100,
+    NV4097_NOTIFY = 0x0104,
+    NV4097_WAIT_FOR_IDLE = 0x0110,
+    
+    // Surfaces
+    NV4097_SET_SURFACE_FORMAT = 0x0208,
+    NV4097_SET_SURFACE_PITCH_A = 0x020C,
+    NV4097_SET_SURFACE_COLOR_AOFFSET = 0x0210,
+    NV4097_SET_SURFACE_ZETA_OFFSET = 0x0214,
+    NV4097_SET_SURFACE_PITCH_Z = 0x022C,
+    
+    // Blending; each register holds the RGB setting in its low half and
+    // the alpha one in its high half
+    NV4097_SET_BLEND_ENABLE = 0x0310,
+    NV4097_SET_BLEND_FUNC_SFACTOR = 0x0314,
+    NV4097_SET_BLEND_FUNC_DFACTOR = 0x0318,
+    NV4097_SET_BLEND_EQUATION = 0x0320,
+    
+    // Viewport/Scissor: origin in the low half, size in the high half
+    NV4097_SET_SCISSOR_HORIZONTAL = 0x08C0,
+    NV4097_SET_SCISSOR_VERTICAL = 0x08C4,
+    NV4097_SET_VIEWPORT_HORIZONTAL = 0x0A00,
+    NV4097_SET_VIEWPORT_VERTICAL = 0x0A04,
+    NV4097_SET_DEPTH_TEST_ENABLE = 0x0A74,
+    
+    // Vertex data, one register for each of 16 arrays
+    NV4097_SET_VERTEX_DATA_ARRAY_OFFSET = 0x1680,
+    NV4097_SET_VERTEX_DATA_ARRAY_FORMAT = 0x1740,
+    
+    // Primitives and rasterization
+    NV4097_SET_BEGIN_END = 0x1808,
+    NV4097_SET_FRONT_POLYGON_MODE = 0x1828,
+    NV4097_SET_BACK_POLYGON_MODE = 0x182C,
+    NV4097_SET_CULL_FACE = 0x1830,
+    NV4097_SET_FRONT_FACE = 0x1834,
+    NV4097_SET_CULL_FACE_ENABLE = 0x183C,
+    
+    // Textures, 0x20 apart for each of 16 units
+    NV4097_SET_TEXTURE_OFFSET = 0x1A00,
+    NV4097_SET_TEXTURE_FORMAT = 0x1A04,
+    NV4097_SET_TEXTURE_ADDRESS = 0x1A08,
+    NV4097_SET_TEXTURE_CONTROL0 = 0x1A0C,
+    NV4097_SET_TEXTURE_FILTER = 0x1A14,
+    
+    // Labels
+    NV4097_SET_SEMAPHORE_OFFSET = 0x1D6C,
+    NV4097_BACK_END_WRITE_SEMAPHORE_RELEASE = 0x1D70,
+    NV4097_TEXTURE_READ_SEMAPHORE_RELEASE = 0x1D74,
+    
+    // Clears
+    NV4097_SET_ZSTENCIL_CLEAR_VALUE = 0x1D8C,
+    NV4097_SET_COLOR_CLEAR_VALUE = 0x1D90,
+    NV4097_CLEAR_SURFACE = 0x1D94,
+    
+    // Display: libgcm's flip, 0xFEAC on subchannel 7
+    GCM_FLIP_COMMAND = 0x1EAC,
 };
 
+// Methods are word offsets below 0x2000: one register each
+constexpr uint32_t RSX_METHOD_COUNT = 2048;
+
 // RSX Primitive types
 enum class RSXPrimitive : uint32_t {
     POINTS = 0,
@@ -120,37 +179,57 @@ struct RSXDrawState {
     uint32_t clearColor;
     RSXPrimitive primitive;
     bool cullingEnabled;
+    uint32_t cullFace;  // GL_FRONT, GL_BACK or GL_FRONT_AND_BACK
     bool depthTestEnabled;
 };
 
-// Simple command buffer for RSX
+// Simple command buffer for RSX. Commands are a header word (method in the
+// upper 16 bits, argument count in the lower 16) followed by the
+// arguments, stored as words so they can be read in place. Once everything
+// written has been read, the next write starts over at the beginning.
 class RSXCommandBuffer {
 public:
-    RSXCommandBuffer(uint32_t capacity = 65536);
+    RSXCommandBuffer(uint32_t capacity = 65536);  // in bytes
     ~RSXCommandBuffer() = default;
     
     // Write command to buffer
-    void writeCommand(uint32_t method, const std::vector<uint32_t>& data);
-    void writeCommand(uint32_t method, uint32_t value);
+    void writeCommand(uint32_t method, const uint32_t* data, uint32_t count);
+    void writeCommand(uint32_t method, const std::vector<uint32_t>& data) {
+        writeCommand(method, data.data(), static_cast<uint32_t>(data.size()));
+    }
+    void writeCommand(uint32_t method, uint32_t value) { writeCommand(method, &value, 1); }
     
-    // Read commands
+    // Read the next command in place
+    bool readCommand(RSXCommandView& cmd) {
+        if (readPos_ >= writePos_) {
+            return false;
+        }
+        cmd = *RSXCommandIterator(buffer_.data() + readPos_, buffer_.data() + writePos_);
+        readPos_ += 1 + cmd.count;
+        return true;
+    }
+    // Read commands into an owned copy
     bool readCommand(RSXCommand& cmd);
     
     // Peek next command without consuming
     bool peekCommand(RSXCommand& cmd) const;
     
+    // The unread commands, without consuming them
+    RSXCommandIterator begin() const { return {buffer_.data() + readPos_, buffer_.data() + writePos_}; }
+    RSXCommandIterator end() const { return {buffer_.data() + writePos_, buffer_.data() + writePos_}; }
+    
     // Buffer management
     void clear();
-    uint32_t getSize() const { return currentPos_; }
-    bool isEmpty() const { return currentPos_ == 0; }
+    uint32_t getSize() const { return writePos_ * 4; }
+    bool isEmpty() const { return writePos_ == 0; }
     
     // Direct access
-    const uint8_t* getBuffer() const { return buffer_.data(); }
+    const uint8_t* getBuffer() const { return reinterpret_cast<const uint8_t*>(buffer_.data()); }
     
 private:
-    std::vector<uint8_t> buffer_;
-    uint32_t capacity_ = 0;
-    uint32_t currentPos_ = 0;
+    std::vector<uint32_t> buffer_;
+    uint32_t capacity_ = 0;  // in words
+    uint32_t writePos_ = 0;  // in words
     uint32_t readPos_ = 0;
 };
 
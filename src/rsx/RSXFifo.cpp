@@ -0,0 +1,157 @@
+#include "rsx/RSXFifo.h"
+#include "core/SPSCQueue.h"
+#include <chrono>
+#include <iostream>
+
+namespace pxs3c {
+
+uint8_t* rsxMapGuestRange(MemoryManager* memory, uint32_t address, uint32_t size) {
+    MemoryRegion* region = memory->getRegion(address);
+    if (!region) {
+        if (!memory->mapRegion(address, size, MEM_PROT_READ | MEM_PROT_WRITE)) {
+            return nullptr;
+        }
+        region = memory->getRegion(address);
+    }
+    if (!region || uint64_t(address) + size > region->base + region->size) {
+        return nullptr;
+    }
+    return memory->getPointer(address);
+}
+
+RSXFifo::RSXFifo()
+    : words_(nullptr), control_(unmapped_), unmapped_{}, address_(0), size_(0), controlAddress_(0),
+      writePos_(0), putSignal_(0), getSignal_(0), waiters_(0) {}
+
+bool RSXFifo::init(MemoryManager* memory, uint32_t address, uint32_t size, uint32_t controlAddress) {
+    if (!memory || (address & 3) || (controlAddress & 3) || size < 16 || (size & 3)) {
+        return false;
+    }
+    uint8_t* ring = rsxMapGuestRange(memory, address, size);
+    uint8_t* control = rsxMapGuestRange(memory, controlAddress & ~0xFFFu, 0x1000);
+    if (!ring || !control) {
+        std::cerr << "RSX FIFO: cannot map 0x" << std::hex << address << " / 0x" << controlAddress
+                  << std::dec << std::endl;
+        return false;
+    }
+    words_ = reinterpret_cast<uint32_t*>(ring);
+    control_ = reinterpret_cast<uint32_t*>(memory->getPointer(controlAddress));
+    address_ = address;
+    size_ = size;
+    controlAddress_ = controlAddress;
+    reset();
+    return true;
+}
+
+void RSXFifo::reset() {
+    writePos_ = 0;
+    storeControl(PUT, 0);
+    storeControl(GET, 0);
+    storeControl(REF, 0);
+}
+
+void RSXFifo::signal(std::atomic<uint32_t>& word) {
+    word.fetch_add(1, std::memory_order_release);
+    // Without this the waiters_ load could be satisfied before the bump is
+    // visible, missing a waiter that registered in between
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) != 0) {
+        futexWakeAll(word);
+    }
+}
+
+void RSXFifo::setPut(uint32_t put) {
+    writePos_ = put;
+    storeControl(PUT, put);
+    signal(putSignal_);
+}
+
+void RSXFifo::setGet(uint32_t get) {
+    storeControl(GET, get);
+    signal(getSignal_);
+}
+
+void RSXFifo::wakeConsumer() {
+    signal(putSignal_);
+}
+
+template <typename Ready>
+bool RSXFifo::waitFor(std::atomic<uint32_t>& word, uint64_t timeoutNs, Ready ready) {
+    if (ready()) return true;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeoutNs);
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    for (;;) {
+        uint32_t seen = word.load(std::memory_order_seq_cst);
+        if (ready()) break;
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) break;
+        futexWait(word, seen, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+    }
+    waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    return ready();
+}
+
+void RSXFifo::waitForCommands(uint64_t timeoutNs) {
+    // One sleep: a wakeConsumer() with nothing to do must still return
+    uint32_t signals = putSignal_.load(std::memory_order_seq_cst);
+    waitFor(putSignal_, timeoutNs, [&] {
+        return !isEmpty() || putSignal_.load(std::memory_order_seq_cst) != signals;
+    });
+}
+
+bool RSXFifo::waitIdle(uint64_t timeoutNs) {
+    return waitFor(getSignal_, timeoutNs, [this] { return isEmpty(); });
+}
+
+bool RSXFifo::reserve(uint32_t bytes) {
+    // Commands never straddle the end of the ring, and there is always room
+    // left for the jump back to the start
+    if (writePos_ + bytes + 4 > size_) {
+        // GET must be in this pass (behind us) and off the start: PUT going
+        // back to where GET still is would make the ring look empty
+        flush();
+        auto canWrap = [this] {
+            uint32_t get = getGet();
+            return get != 0 && get <= writePos_;
+        };
+        if (!waitFor(getSignal_, WAIT_TIMEOUT_NS, canWrap)) {
+            std::cerr << "RSX FIFO full: GET stuck at 0x" << std::hex << getGet() << std::dec << std::endl;
+            return false;
+        }
+        words_[writePos_ / 4] = __builtin_bswap32(RSX_FIFO_JUMP);
+        writePos_ = 0;
+        // The consumer has to see the jump to ever come round
+        flush();
+    }
+
+    // [writePos_, writePos_ + bytes) is free if GET is behind it in the same
+    // pass, or still far enough ahead in the previous one. Writing up to GET
+    // itself would make a full ring look empty.
+    auto fits = [&] {
+        uint32_t get = getGet();
+        return get <= writePos_ || writePos_ + bytes < get;
+    };
+    if (fits()) return true;
+    flush();
+    if (!waitFor(getSignal_, WAIT_TIMEOUT_NS, fits)) {
+        std::cerr << "RSX FIFO full: GET stuck at 0x" << std::hex << getGet() << std::dec << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool RSXFifo::push(uint32_t method, const uint32_t* args, uint32_t count, bool nonIncrement) {
+    uint32_t bytes = 4 + count * 4;
+    if (!words_ || count > RSX_FIFO_COUNT_MASK || bytes + 4 > size_ || !reserve(bytes)) {
+        return false;
+    }
+    uint32_t* out = words_ + writePos_ / 4;
+    out[0] = __builtin_bswap32(rsxFifoMethod(method, count, nonIncrement));
+    for (uint32_t i = 0; i < count; ++i) {
+        out[1 + i] = __builtin_bswap32(args[i]);
+    }
+    writePos_ += bytes;
+    return true;
+}
+
+} // namespace pxs3c
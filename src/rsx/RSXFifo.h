@@ -0,0 +1,130 @@
+#pragma once
+
+#include "memory/MemoryManager.h"
+#include <atomic>
+#include <cstdint>
+
+namespace pxs3c {
+
+// Default placement in RSX memory: the DMA control registers (put, get and
+// ref, laid out as libgcm's CellGcmControl) at the start of the first page,
+// the command FIFO from 1MB on
+constexpr uint32_t RSX_CONTROL_ADDRESS = static_cast<uint32_t>(RSX_MEMORY_BASE) + 0x40;
+constexpr uint32_t RSX_FIFO_ADDRESS = static_cast<uint32_t>(RSX_MEMORY_BASE) + 0x100000;
+constexpr uint32_t RSX_FIFO_SIZE = 0x100000;
+// Semaphores and labels the RSX acquires and releases, by byte offset
+constexpr uint32_t RSX_SEMAPHORE_ADDRESS = static_cast<uint32_t>(RSX_MEMORY_BASE) + 0x10000;
+constexpr uint32_t RSX_SEMAPHORE_SIZE = 0x1000;
+
+// FIFO command words. A method header carries the method offset, the
+// argument count and whether consecutive arguments go to consecutive
+// methods (the default) or all to the same one; the other forms move GET.
+constexpr uint32_t RSX_FIFO_METHOD_MASK = 0x00001FFC;
+constexpr uint32_t RSX_FIFO_COUNT_SHIFT = 18;
+constexpr uint32_t RSX_FIFO_COUNT_MASK = 0x7FF;
+constexpr uint32_t RSX_FIFO_NON_INCREMENT = 0x40000000;
+constexpr uint32_t RSX_FIFO_OLD_JUMP_MASK = 0xE0000003;
+constexpr uint32_t RSX_FIFO_OLD_JUMP = 0x20000000;
+constexpr uint32_t RSX_FIFO_OLD_JUMP_OFFSET = 0x1FFFFFFC;
+constexpr uint32_t RSX_FIFO_JUMP = 0x00000001;   // offset | 1
+constexpr uint32_t RSX_FIFO_CALL = 0x00000002;   // offset | 2
+constexpr uint32_t RSX_FIFO_RETURN = 0x00020000;
+
+inline uint32_t rsxFifoMethod(uint32_t method, uint32_t count, bool nonIncrement = false) {
+    return (nonIncrement ? RSX_FIFO_NON_INCREMENT : 0) | (count << RSX_FIFO_COUNT_SHIFT) |
+           (method & RSX_FIFO_METHOD_MASK);
+}
+
+// Host pointer to [address, address + size) of guest memory, mapping it
+// first if nothing is there; null unless it is one contiguous region
+uint8_t* rsxMapGuestRange(MemoryManager* memory, uint32_t address, uint32_t size);
+
+// The RSX command FIFO: a ring of big-endian command words in guest memory
+// with the PUT/GET/REF control registers next to it, also in guest memory.
+// PUT and GET are byte offsets into the ring. The producer (the PPU, or HLE
+// code on its behalf) writes commands at PUT and then moves PUT past them;
+// the consumer (the RSX thread) executes from GET up to PUT and moves GET
+// along. Each side only ever stores its own register, with release
+// ordering, and loads the other's with acquire, so neither takes a lock.
+//
+// Like the real hardware the ring does not wrap by itself: when a command
+// would not fit before the end, push() writes a jump back to the start and
+// waits for GET to leave the space it needs. Guest code that builds its
+// own command stream and stores PUT directly works the same way; the
+// consumer polls for that, while push()/flush() also wake it.
+class RSXFifo {
+public:
+    RSXFifo();
+    ~RSXFifo() = default;
+
+    // Maps the ring and the control registers if nothing is mapped there
+    // yet and resets PUT, GET and REF to zero
+    bool init(MemoryManager* memory, uint32_t address = RSX_FIFO_ADDRESS, uint32_t size = RSX_FIFO_SIZE,
+              uint32_t controlAddress = RSX_CONTROL_ADDRESS);
+
+    uint32_t getAddress() const { return address_; }
+    uint32_t getSize() const { return size_; }
+    uint32_t getControlAddress() const { return controlAddress_; }
+
+    // Control registers
+    uint32_t getPut() const { return loadControl(PUT); }
+    uint32_t getGet() const { return loadControl(GET); }
+    uint32_t getRef() const { return loadControl(REF); }
+    bool isEmpty() const { return getGet() == getPut(); }
+
+    // Producer. push() appends one method run at the write position (which
+    // is PUT unless commands are pending) and returns false if it can never
+    // fit or the consumer did not make room in time. Commands become
+    // visible to the consumer at flush(). setPut() publishes a PUT written
+    // some other way.
+    bool push(uint32_t method, const uint32_t* args, uint32_t count, bool nonIncrement = false);
+    bool push(uint32_t method, uint32_t value) { return push(method, &value, 1); }
+    void flush() { setPut(writePos_); }
+    void setPut(uint32_t put);
+    // Wait until the consumer has caught up with PUT
+    bool waitIdle(uint64_t timeoutNs = WAIT_TIMEOUT_NS);
+
+    // Consumer. words() is the ring as host memory; the consumer loads
+    // words from it between GET and an acquired PUT only.
+    const uint32_t* words() const { return words_; }
+    void setGet(uint32_t get);
+    void setRef(uint32_t ref) { storeControl(REF, ref); }
+    // Sleep until PUT moves (or at most timeoutNs, to notice a PUT stored by
+    // guest code), or until wakeConsumer()
+    void waitForCommands(uint64_t timeoutNs);
+    void wakeConsumer();
+
+    // Back to empty; only while nothing is producing or consuming
+    void reset();
+
+    static constexpr uint64_t WAIT_TIMEOUT_NS = 1000000000ULL;
+
+private:
+    enum Register { PUT = 0, GET = 1, REF = 2 };
+
+    uint32_t* words_;    // the ring, big-endian
+    uint32_t* control_;  // put, get, ref, big-endian
+    uint32_t unmapped_[3];  // control_ until init()
+    uint32_t address_;
+    uint32_t size_;
+    uint32_t controlAddress_;
+    uint32_t writePos_;  // producer only: the end of the pushed commands
+
+    // Futex words, bumped whenever the matching register is published
+    alignas(64) std::atomic<uint32_t> putSignal_;
+    alignas(64) std::atomic<uint32_t> getSignal_;
+    std::atomic<uint32_t> waiters_;
+
+    uint32_t loadControl(Register reg) const {
+        return __builtin_bswap32(std::atomic_ref<uint32_t>(control_[reg]).load(std::memory_order_acquire));
+    }
+    void storeControl(Register reg, uint32_t value) {
+        std::atomic_ref<uint32_t>(control_[reg]).store(__builtin_bswap32(value), std::memory_order_release);
+    }
+    void signal(std::atomic<uint32_t>& word);
+    template <typename Ready>
+    bool waitFor(std::atomic<uint32_t>& word, uint64_t timeoutNs, Ready ready);
+    bool reserve(uint32_t bytes);
+};
+
+} // namespace pxs3c
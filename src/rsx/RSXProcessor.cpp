@@ -1,12 +1,34 @@
 #include "rsx/RSXProcessor.h"
 #include "rsx/VulkanRenderer.h"
+#include "core/SPSCQueue.h"
+#include <chrono>
 #include <iostream>
 #include <cmath>
 
 namespace pxs3c {
 
+namespace {
+
+// Consumer-side poll for a PUT that guest code stored without waking us
+constexpr uint64_t FIFO_POLL_NS = 1000000;
+// Back-to-back jumps before the consumer gives other work a look in; the
+// guest may be spinning the RSX on a jump to itself
+constexpr uint32_t FIFO_MAX_JUMPS = 1024;
+// Commands between GET updates while more are pending
+constexpr uint32_t FIFO_GET_INTERVAL = 64;
+// How often a FIFO stopped at a semaphore looks at it again; the CPU
+// releases it with a plain store to guest memory
+constexpr auto SEMAPHORE_POLL = std::chrono::microseconds(20);
+
+uint32_t semaphoreIndex(uint32_t offset) {
+    return (offset & (RSX_SEMAPHORE_SIZE - 1)) / 4;
+}
+
+} // namespace
+
 RSXProcessor::RSXProcessor()
-    : renderer_(nullptr) {
+    : renderer_(nullptr), registers_{}, fifo_(nullptr), fifoReturn_(0), fifoArgs_{}, fifoRunning_(false),
+      fifoStalled_(false), semaphores_(nullptr), flips_(0) {
     state_.width = 1920;
     state_.height = 1080;
     state_.blendSrcFactor = RSXBlendFactor::SRC_ALPHA;
@@ -15,101 +37,243 @@ RSXProcessor::RSXProcessor()
     state_.clearColor = 0x000000FF;
     state_.primitive = RSXPrimitive::TRIANGLES;
     state_.cullingEnabled = true;
+    state_.cullFace = 0x0405;  // GL_BACK
     state_.depthTestEnabled = true;
 }
 
-RSXProcessor::~RSXProcessor() {}
+RSXProcessor::~RSXProcessor() {
+    stopFifoThread();
+}
 
 bool RSXProcessor::init(VulkanRenderer* renderer) {
     if (!renderer) return false;
+    std::lock_guard<std::mutex> lock(rendererMutex_);
     renderer_ = renderer;
     std::cout << "RSX Processor initialized" << std::endl;
     return true;
 }
 
 void RSXProcessor::shutdown() {
+    stopFifoThread();
+    std::lock_guard<std::mutex> lock(rendererMutex_);
     renderer_ = nullptr;
 }
 
 void RSXProcessor::processCommands(RSXCommandBuffer& cmdBuffer) {
-    RSXCommand cmd;
-    
+    auto start = std::chrono::steady_clock::now();
+    uint64_t methods = 0;
+    RSXCommandView cmd;
     while (cmdBuffer.readCommand(cmd)) {
-        std::cout << "RSX command: method=0x" << std::hex << cmd.method 
-                  << " count=" << std::dec << cmd.count << std::endl;
-        
-        switch (cmd.method) {
-            case NV30_CLEAR_COLOR:
-                handleClearColor(cmd.data.empty() ? 0 : cmd.data[0]);
-                break;
-                
-            case NV30_VIEWPORT_HORIZONTAL:
-            case NV30_VIEWPORT_VERTICAL:
-                if (!cmd.data.empty()) {
-                    handleViewport(cmd.method, cmd.data[0]);
-                }
-                break;
-                
-            case NV30_SCISSOR_HORIZONTAL:
-            case NV30_SCISSOR_VERTICAL:
-                if (!cmd.data.empty()) {
-                    handleScissor(cmd.method, cmd.data[0]);
-                }
-                break;
-                
-            case NV30_BLEND_FUNC:
-                if (cmd.data.size() >= 2) {
-                    handleBlendFunc(cmd.data[0], cmd.data[1]);
-                }
-                break;
-                
-            case NV30_BLEND_EQUATION:
-                if (!cmd.data.empty()) {
-                    handleBlendEquation(cmd.data[0]);
-                }
-                break;
-                
-            case NV30_CULL_FACE:
-                if (!cmd.data.empty()) {
-                    handleCullFace(cmd.data[0]);
-                }
-                break;
-                
-            case NV30_BEGIN_END:
-                if (!cmd.data.empty()) {
-                    handleBeginEnd(cmd.data[0]);
-                }
-                break;
-                
-            case NV30_WAIT_FOR_IDLE:
-                handleWaitForIdle();
-                break;
-                
-            case NV30_NOTIFY:
-                if (!cmd.data.empty()) {
-                    handleNotify(cmd.data[0]);
-                }
+        methods++;
+        stats_.words += cmd.count;
+        // Nothing comes back to a command here: a semaphore acquire that
+        // would stall the FIFO just moves on
+        if (!executeCommand(cmd)) {
+            fifoStalled_ = false;
+        }
+    }
+    if (methods) {
+        stats_.batches++;
+        stats_.methods += methods;
+        stats_.processNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+uint32_t RSXProcessor::processFifo(RSXFifo& fifo) {
+    const uint32_t* words = fifo.words();
+    uint32_t get = fifo.getGet();
+    uint32_t put = fifo.getPut();
+    if (!words || get == put) {
+        return 0;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    fifo_ = &fifo;
+    fifoStalled_ = false;
+    const uint32_t size = fifo.getSize();
+    uint32_t methods = 0;
+    uint32_t jumps = 0;
+    uint32_t sinceGet = 0;
+    while (get != put) {
+        if (get >= size) {
+            std::cerr << "RSX FIFO fault: GET 0x" << std::hex << get << " outside the ring" << std::dec << std::endl;
+            stats_.faults++;
+            get = put;
+            break;
+        }
+        uint32_t header = __builtin_bswap32(words[get / 4]);
+        if ((header & RSX_FIFO_OLD_JUMP_MASK) == RSX_FIFO_OLD_JUMP) {
+            get = header & RSX_FIFO_OLD_JUMP_OFFSET;
+        } else if ((header & 3) == RSX_FIFO_JUMP) {
+            get = header & ~3u;
+        } else if ((header & 3) == RSX_FIFO_CALL) {
+            fifoReturn_ = get + 4;
+            get = header & ~3u;
+        } else if (header == RSX_FIFO_RETURN) {
+            get = fifoReturn_;
+        } else {
+            uint32_t count = (header >> RSX_FIFO_COUNT_SHIFT) & RSX_FIFO_COUNT_MASK;
+            uint32_t next = get + 4 + count * 4;
+            if (next > size) {
+                std::cerr << "RSX FIFO fault: method 0x" << std::hex << header << " at 0x" << get
+                          << " runs past the ring" << std::dec << std::endl;
+                stats_.faults++;
+                get = put;
                 break;
-                
-            default:
-                std::cout << "  Unhandled RSX method: 0x" << std::hex << cmd.method << std::dec << std::endl;
+            }
+            const uint32_t* in = words + get / 4 + 1;
+            for (uint32_t i = 0; i < count; ++i) {
+                fifoArgs_[i] = __builtin_bswap32(in[i]);
+            }
+            uint32_t method = header & RSX_FIFO_METHOD_MASK;
+            if (!executeCommand({method, count, fifoArgs_.data(), (header & RSX_FIFO_NON_INCREMENT) != 0})) {
+                // Try again from here next time
+                stats_.semaphoreStalls++;
+                fifoStalled_ = true;
                 break;
+            }
+            methods++;
+            stats_.methods++;
+            stats_.words += count;
+            jumps = 0;
+            get = next;
+            
+            // Let a producer waiting for room see progress, and one waiting
+            // for the RSX to go idle see it straight away
+            if (method == NV4097_WAIT_FOR_IDLE) {
+                fifo.setGet(get);
+                sinceGet = 0;
+            } else if (get != put && ++sinceGet == FIFO_GET_INTERVAL) {
+                fifo.setGet(get);
+                sinceGet = 0;
+            }
+            if (get == put) {
+                put = fifo.getPut();
+            }
+            continue;
+        }
+        stats_.jumps++;
+        if (++jumps == FIFO_MAX_JUMPS) {
+            break;
+        }
+        if (get == put) {
+            put = fifo.getPut();
+        }
+    }
+    
+    if (methods) {
+        stats_.batches++;
+    }
+    stats_.processNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count();
+    fifo.setGet(get);
+    return methods;
+}
+
+bool RSXProcessor::startFifoThread(RSXFifo* fifo) {
+    if (!fifo || fifoThread_.joinable()) {
+        return false;
+    }
+    fifo_ = fifo;
+    fifoRunning_.store(true, std::memory_order_release);
+    fifoThread_ = std::thread([this, fifo] { fifoLoop(*fifo); });
+    return true;
+}
+
+void RSXProcessor::stopFifoThread() {
+    if (!fifoThread_.joinable()) {
+        return;
+    }
+    fifoRunning_.store(false, std::memory_order_release);
+    fifo_->wakeConsumer();
+    fifoThread_.join();
+}
+
+void RSXProcessor::fifoLoop(RSXFifo& fifo) {
+    while (fifoRunning_.load(std::memory_order_acquire)) {
+        if (processFifo(fifo) == 0 && fifo.isEmpty()) {
+            fifo.waitForCommands(FIFO_POLL_NS);
+        } else if (fifoStalled_) {
+            std::this_thread::sleep_for(SEMAPHORE_POLL);
+        }
+    }
+}
+
+bool RSXProcessor::mapSemaphores(MemoryManager* memory, uint32_t address) {
+    uint8_t* semaphores = memory && !(address & 3) ? rsxMapGuestRange(memory, address, RSX_SEMAPHORE_SIZE) : nullptr;
+    if (!semaphores) {
+        return false;
+    }
+    semaphores_ = reinterpret_cast<uint32_t*>(semaphores);
+    return true;
+}
+
+bool RSXProcessor::waitForFlips(uint32_t count, uint64_t timeoutNs) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(timeoutNs);
+    for (;;) {
+        uint32_t flips = getFlips();
+        if (static_cast<int32_t>(flips - count) >= 0) {
+            return true;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        futexWait(flips_, flips, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now).count());
+    }
+}
+
+const std::array<RSXProcessor::MethodHandler, RSX_METHOD_COUNT>& RSXProcessor::methodHandlers() {
+    static const std::array<MethodHandler, RSX_METHOD_COUNT> handlers = [] {
+        std::array<MethodHandler, RSX_METHOD_COUNT> table{};
+        auto set = [&](uint32_t method, MethodHandler handler) { table[method / 4] = handler; };
+        set(NV406E_SET_REFERENCE, &RSXProcessor::handleSetReference);
+        set(NV406E_SEMAPHORE_ACQUIRE, &RSXProcessor::handleSemaphoreAcquire);
+        set(NV406E_SEMAPHORE_RELEASE, &RSXProcessor::handleSemaphoreRelease);
+        set(NV4097_SET_BLEND_FUNC_SFACTOR, &RSXProcessor::handleBlendFunc);
+        set(NV4097_SET_BLEND_FUNC_DFACTOR, &RSXProcessor::handleBlendFunc);
+        set(NV4097_SET_BLEND_EQUATION, &RSXProcessor::handleBlendEquation);
+        set(NV4097_SET_CULL_FACE, &RSXProcessor::handleCullFace);
+        set(NV4097_SET_CULL_FACE_ENABLE, &RSXProcessor::handleCullFaceEnable);
+        set(NV4097_BACK_END_WRITE_SEMAPHORE_RELEASE, &RSXProcessor::handleBackEndRelease);
+        set(NV4097_TEXTURE_READ_SEMAPHORE_RELEASE, &RSXProcessor::handleTextureReadRelease);
+        set(NV4097_SET_COLOR_CLEAR_VALUE, &RSXProcessor::handleClearColor);
+        set(GCM_FLIP_COMMAND, &RSXProcessor::handleFlip);
+        return table;
+    }();
+    return handlers;
+}
+
+bool RSXProcessor::executeCommand(const RSXCommandView& cmd) {
+    const auto& handlers = methodHandlers();
+    // The words go to consecutive methods, or all to the same one
+    const uint32_t step = cmd.nonIncrement ? 0 : 1;
+    uint32_t index = cmd.method / 4;
+    for (uint32_t i = 0; i < cmd.count; ++i, index += step) {
+        index &= RSX_METHOD_COUNT - 1;
+        registers_[index] = cmd.args[i];
+        MethodHandler handler = handlers[index];
+        if (!handler) {
+            stats_.unhandled++;
+            continue;
+        }
+        (this->*handler)(cmd.args[i]);
+        if (fifoStalled_) {
+            return false;
         }
     }
+    return true;
 }
 
 void RSXProcessor::submitCommand(uint32_t method, uint32_t value) {
-    std::vector<uint32_t> data = {value};
-    submitCommand(method, data);
+    cmdBuffer_.writeCommand(method, value);
+    processCommands(cmdBuffer_);
 }
 
 void RSXProcessor::submitCommand(uint32_t method, const std::vector<uint32_t>& values) {
     cmdBuffer_.writeCommand(method, values);
-    RSXCommand cmd;
-    if (cmdBuffer_.readCommand(cmd)) {
-        // Process immediately
-        std::cout << "RSX submit: method=0x" << std::hex << method << std::dec << std::endl;
-    }
+    processCommands(cmdBuffer_);
 }
 
 void RSXProcessor::drawRectangle(float x, float y, float width, float height, uint32_t color) {
@@ -134,60 +298,83 @@ void RSXProcessor::drawTriangle(float x1, float y1, float x2, float y2, float x3
 
 void RSXProcessor::drawClearScreen(uint32_t color) {
     std::cout << "RSX clear screen: color=0x" << std::hex << color << std::dec << std::endl;
-    if (renderer_) {
-        float r = ((color >> 24) & 0xFF) / 255.0f;
-        float g = ((color >> 16) & 0xFF) / 255.0f;
-        float b = ((color >> 8) & 0xFF) / 255.0f;
-        renderer_->setClearColor(r, g, b);
-    }
+    applyClearColor(color);
 }
 
 void RSXProcessor::handleClearColor(uint32_t value) {
     state_.clearColor = value;
-    std::cout << "  Set clear color: 0x" << std::hex << value << std::dec << std::endl;
-    drawClearScreen(value);
+    applyClearColor(value);
 }
 
-void RSXProcessor::handleViewport(uint32_t method, uint32_t value) {
-    std::cout << "  Set viewport (method=0x" << std::hex << method << "): 0x" << value << std::dec << std::endl;
+void RSXProcessor::handleBlendFunc(uint32_t) {
+    // Both factors, whichever was written; RGB is the low half
+    state_.blendSrcFactor = static_cast<RSXBlendFactor>(getRegister(NV4097_SET_BLEND_FUNC_SFACTOR) & 0xFFFF);
+    state_.blendDstFactor = static_cast<RSXBlendFactor>(getRegister(NV4097_SET_BLEND_FUNC_DFACTOR) & 0xFFFF);
 }
 
-void RSXProcessor::handleScissor(uint32_t method, uint32_t value) {
-    std::cout << "  Set scissor (method=0x" << std::hex << method << "): 0x" << value << std::dec << std::endl;
+void RSXProcessor::handleBlendEquation(uint32_t value) {
+    state_.blendEquation = static_cast<RSXBlendEquation>(value & 0xFFFF);
 }
 
-void RSXProcessor::handleBlendFunc(uint32_t srcFactor, uint32_t dstFactor) {
-    state_.blendSrcFactor = static_cast<RSXBlendFactor>(srcFactor);
-    state_.blendDstFactor = static_cast<RSXBlendFactor>(dstFactor);
-    std::cout << "  Set blend func: src=0x" << std::hex << srcFactor 
-              << " dst=0x" << dstFactor << std::dec << std::endl;
+void RSXProcessor::handleCullFace(uint32_t value) {
+    // Which faces to cull; whether to cull at all is a register of its own
+    state_.cullFace = value;
 }
 
-void RSXProcessor::handleBlendEquation(uint32_t equation) {
-    state_.blendEquation = static_cast<RSXBlendEquation>(equation);
-    std::cout << "  Set blend equation: 0x" << std::hex << equation << std::dec << std::endl;
+void RSXProcessor::handleCullFaceEnable(uint32_t value) {
+    state_.cullingEnabled = value != 0;
 }
 
-void RSXProcessor::handleCullFace(uint32_t mode) {
-    state_.cullingEnabled = (mode != 0x0404);  // GL_FRONT_AND_BACK
-    std::cout << "  Set cull face: " << (state_.cullingEnabled ? "enabled" : "disabled") << std::endl;
+void RSXProcessor::handleSetReference(uint32_t value) {
+    // Everything before this command has executed: publish REF
+    if (fifo_) {
+        fifo_->setRef(value);
+    }
 }
 
-void RSXProcessor::handlePrimitive(uint32_t mode, uint32_t count) {
-    state_.primitive = static_cast<RSXPrimitive>(mode);
-    std::cout << "  Draw primitive type=" << mode << " count=" << count << std::endl;
+void RSXProcessor::handleSemaphoreAcquire(uint32_t value) {
+    // Nothing to wait on without semaphore memory
+    if (!semaphores_) {
+        return;
+    }
+    uint32_t* word = &semaphores_[semaphoreIndex(getRegister(NV406E_SEMAPHORE_OFFSET))];
+    if (__builtin_bswap32(std::atomic_ref<uint32_t>(*word).load(std::memory_order_acquire)) != value) {
+        fifoStalled_ = true;
+    }
+}
+
+void RSXProcessor::handleSemaphoreRelease(uint32_t value) {
+    writeSemaphore(getRegister(NV406E_SEMAPHORE_OFFSET), value);
+}
+
+void RSXProcessor::handleBackEndRelease(uint32_t value) {
+    // The back end writes the value with its red and blue bytes swapped
+    writeSemaphore(getRegister(NV4097_SET_SEMAPHORE_OFFSET),
+                   (value & 0xFF00FF00) | ((value & 0xFF) << 16) | ((value >> 16) & 0xFF));
+}
+
+void RSXProcessor::handleTextureReadRelease(uint32_t value) {
+    writeSemaphore(getRegister(NV4097_SET_SEMAPHORE_OFFSET), value);
 }
 
-void RSXProcessor::handleBeginEnd(uint32_t primitive) {
-    std::cout << "  Begin/end primitive: " << primitive << std::endl;
+void RSXProcessor::handleFlip(uint32_t) {
+    withRenderer([](VulkanRenderer& renderer) { renderer.drawFrame(); });
+    flips_.fetch_add(1, std::memory_order_release);
+    futexWakeAll(flips_);
 }
 
-void RSXProcessor::handleWaitForIdle() {
-    std::cout << "  Wait for RSX idle" << std::endl;
+void RSXProcessor::writeSemaphore(uint32_t offset, uint32_t value) {
+    // Everything before has executed; the CPU may go on once it sees value
+    if (semaphores_) {
+        std::atomic_ref<uint32_t>(semaphores_[semaphoreIndex(offset)]).store(__builtin_bswap32(value), std::memory_order_release);
+    }
 }
 
-void RSXProcessor::handleNotify(uint32_t value) {
-    std::cout << "  RSX notify: 0x" << std::hex << value << std::dec << std::endl;
+void RSXProcessor::applyClearColor(uint32_t color) {
+    float r = ((color >> 24) & 0xFF) / 255.0f;
+    float g = ((color >> 16) & 0xFF) / 255.0f;
+    float b = ((color >> 8) & 0xFF) / 255.0f;
+    withRenderer([&](VulkanRenderer& renderer) { renderer.setClearColor(r, g, b); });
 }
 
 } // namespace pxs3c
@@ -1,15 +1,42 @@
 #pragma once
 
 #include "rsx/RSXCommands.h"
+#include "rsx/RSXFifo.h"
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <cstdint>
+#include <thread>
 #include <vector>
 
 namespace pxs3c {
 
 class VulkanRenderer;
 
-// RSX Processor - translates PS3 RSX commands to Vulkan draw calls
+struct RSXProcessorStats {
+    uint64_t batches = 0;    // processCommands() calls that found commands
+    uint64_t methods = 0;    // method headers, each starting a run of words
+    uint64_t words = 0;      // argument words consumed, one register write each
+    uint64_t unhandled = 0;  // register writes without a handler, only recorded
+    uint64_t jumps = 0;      // FIFO jumps, calls and returns
+    uint64_t faults = 0;     // FIFO commands pointing outside the ring
+    uint64_t semaphoreStalls = 0;  // times the FIFO stopped at an unreleased semaphore
+    uint64_t processNs = 0;  // host time spent decoding and executing
+};
+
+// RSX Processor - translates PS3 RSX commands to Vulkan draw calls.
+//
+// In the emulator it runs on a thread of its own, executing the command
+// FIFO as the PPU fills it and presenting a frame at each flip. The CPU
+// side only synchronises with it where the guest would: semaphores the RSX
+// acquires (it stops at one until the CPU has written the value) or
+// releases, labels, NV4097_WAIT_FOR_IDLE and the flip count.
+//
+// Every argument word is a write to one method register: it is recorded
+// in a flat register file and, if the method has a handler, dispatched
+// through a table indexed by method / 4. Handlers read whatever other
+// registers they need from the file.
 class RSXProcessor {
 public:
     RSXProcessor();
@@ -18,10 +45,45 @@ public:
     bool init(VulkanRenderer* renderer);
     void shutdown();
     
-    // Process command buffer
+    // Run func on the renderer under the lock the RSX thread presents with,
+    // so other threads (window, clear colour and present mode changes from
+    // the UI) never call into it at the same time. Returns false if there
+    // is no renderer.
+    template <typename Func>
+    bool withRenderer(Func&& func) {
+        std::lock_guard<std::mutex> lock(rendererMutex_);
+        if (!renderer_) return false;
+        func(*renderer_);
+        return true;
+    }
+    
+    // Process command buffer. Commands are executed in place, straight
+    // from the buffer; a semaphore acquire does not wait here.
     void processCommands(RSXCommandBuffer& cmdBuffer);
     
-    // Direct command submission
+    // Execute the FIFO from GET up to PUT on the calling thread, following
+    // jumps, calls and returns, and move GET along; returns the number of
+    // methods executed. Arguments are byte-swapped into a scratch run, the
+    // headers decoded in place.
+    uint32_t processFifo(RSXFifo& fifo);
+    
+    // Or keep executing it on a thread of our own as the producer moves
+    // PUT. While that runs, the draw state and stats belong to the thread:
+    // read them once RSXFifo::waitIdle() has returned.
+    bool startFifoThread(RSXFifo* fifo);
+    void stopFifoThread();
+    bool isFifoThreadRunning() const { return fifoThread_.joinable(); }
+    
+    // Semaphore and label memory, RSX_SEMAPHORE_SIZE bytes of guest memory
+    // that the semaphore offsets index; mapped if nothing is there yet
+    bool mapSemaphores(MemoryManager* memory, uint32_t address = RSX_SEMAPHORE_ADDRESS);
+    
+    // Flips executed so far; waitForFlips() blocks until there have been
+    // count of them or the timeout passes
+    uint32_t getFlips() const { return flips_.load(std::memory_order_acquire); }
+    bool waitForFlips(uint32_t count, uint64_t timeoutNs);
+    
+    // Direct command submission: executed immediately
     void submitCommand(uint32_t method, uint32_t value);
     void submitCommand(uint32_t method, const std::vector<uint32_t>& values);
     
@@ -33,23 +95,53 @@ public:
     // Get state
     const RSXDrawState& getDrawState() const { return state_; }
     void setDrawState(const RSXDrawState& state) { state_ = state; }
+    const RSXProcessorStats& getStats() const { return stats_; }
+    uint32_t getRegister(uint32_t method) const { return registers_[(method / 4) & (RSX_METHOD_COUNT - 1)]; }
     
 private:
-    VulkanRenderer* renderer_;
+    using MethodHandler = void (RSXProcessor::*)(uint32_t value);
+    static const std::array<MethodHandler, RSX_METHOD_COUNT>& methodHandlers();
+    
+    VulkanRenderer* renderer_;  // guarded by rendererMutex_
+    std::mutex rendererMutex_;
     RSXDrawState state_;
     RSXCommandBuffer cmdBuffer_;
+    RSXProcessorStats stats_;
+    std::array<uint32_t, RSX_METHOD_COUNT> registers_;
+    
+    // FIFO consumer
+    RSXFifo* fifo_;          // the FIFO being executed
+    uint32_t fifoReturn_;    // return offset of the last call
+    std::array<uint32_t, RSX_FIFO_COUNT_MASK + 1> fifoArgs_;
+    std::thread fifoThread_;
+    std::atomic<bool> fifoRunning_;
+    bool fifoStalled_;       // a semaphore stopped the current command
+    
+    // Synchronisation
+    uint32_t* semaphores_;   // big-endian, RSX_SEMAPHORE_SIZE bytes
+    std::atomic<uint32_t> flips_;
+    
+    // Returns false if the command cannot execute yet and has to be
+    // retried later, FIFO position unchanged. The retry writes the whole
+    // run again, which is harmless as long as only register writes come
+    // before an acquire in its run (libgcm puts just the offset there).
+    bool executeCommand(const RSXCommandView& cmd);
+    void fifoLoop(RSXFifo& fifo);
     
-    // Command handlers
+    // Method handlers, called after the register is written
     void handleClearColor(uint32_t value);
-    void handleViewport(uint32_t method, uint32_t value);
-    void handleScissor(uint32_t method, uint32_t value);
-    void handleBlendFunc(uint32_t srcFactor, uint32_t dstFactor);
-    void handleBlendEquation(uint32_t equation);
-    void handleCullFace(uint32_t mode);
-    void handlePrimitive(uint32_t mode, uint32_t count);
-    void handleBeginEnd(uint32_t primitive);
-    void handleWaitForIdle();
-    void handleNotify(uint32_t value);
+    void handleBlendFunc(uint32_t value);
+    void handleBlendEquation(uint32_t value);
+    void handleCullFace(uint32_t value);
+    void handleCullFaceEnable(uint32_t value);
+    void handleSetReference(uint32_t value);
+    void handleSemaphoreAcquire(uint32_t value);
+    void handleSemaphoreRelease(uint32_t value);
+    void handleBackEndRelease(uint32_t value);
+    void handleTextureReadRelease(uint32_t value);
+    void handleFlip(uint32_t value);
+    void writeSemaphore(uint32_t offset, uint32_t value);
+    void applyClearColor(uint32_t color);
 };
 
 } // namespace pxs3c
@@ -14,8 +14,8 @@ bool VulkanRenderer::init() {
     return true;
 }
 
-bool VulkanRenderer::attachAndroidWindow(ANativeWindow* window) {
 #ifdef __ANDROID__
+bool VulkanRenderer::attachAndroidWindow(ANativeWindow* window) {
     if (!window) {
         std::cerr << "attachAndroidWindow: null window" << std::endl;
         return false;
@@ -32,12 +32,8 @@ bool VulkanRenderer::attachAndroidWindow(ANativeWindow* window) {
     if (!createSyncObjects()) return false;
     std::cout << "Android Vulkan init complete (Adreno-targeted, swapchain ready)" << std::endl;
     return true;
-#else
-    (void)window;
-    std::cerr << "attachAndroidWindow called on non-Android build" << std::endl;
-    return false;
-#endif
 }
+#endif
 
 void VulkanRenderer::drawFrame() {
     std::cout << "Drawing frame (stub)" << std::endl;
@@ -530,6 +526,8 @@ void VulkanRenderer::cleanupSwapchain() {
     }
 }
 
+#endif // __ANDROID__
+
 bool VulkanRenderer::resize(uint32_t width, uint32_t height) {
 #ifdef __ANDROID__
     if (!device_ || !surface_) return false;
@@ -547,8 +545,6 @@ bool VulkanRenderer::resize(uint32_t width, uint32_t height) {
 #endif
 }
 
-#endif // __ANDROID__
-
 void VulkanRenderer::setClearColor(float r, float g, float b) {
 #ifdef __ANDROID__
     clearR_ = r; clearG_ = g; clearB_ = b;
@@ -0,0 +1,303 @@
+// Differential fuzzer for the PPU JIT: runs random integer instruction
+// sequences through the interpreter and through compiled code and compares
+// the resulting register file and data memory.
+//
+// Usage: pxs3c_ppu_jit_fuzz [iterations] [seed]
+
+#include "memory/MemoryManager.h"
+#include "cpu/PPUInterpreter.h"
+#include "cpu/PPUJIT.h"
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace pxs3c;
+
+namespace {
+
+constexpr uint64_t CODE_BASE = 0x00040000;
+constexpr uint64_t DATA_BASE = 0x00080000;
+constexpr uint64_t DATA_SIZE = 0x00020000;
+constexpr int SEQUENCE_LENGTH = 32;
+
+// r1 is the base and r2 the index of every generated load and store, and
+// no other instruction writes them. r1 starts just below a 64KB boundary so
+// some accesses straddle it and take the JIT's slow path.
+constexpr uint32_t BASE_REG = 1;
+constexpr uint32_t INDEX_REG = 2;
+
+class Generator {
+public:
+    explicit Generator(uint64_t seed) : rng_(seed) {}
+
+    uint64_t next() { return rng_(); }
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>(rng_() % n); }
+
+    uint32_t dest() { return 3 + below(29); }
+    uint32_t src() { return below(32); }
+
+    uint32_t instruction() {
+        switch (below(10)) {
+            case 0: case 1: return dForm();
+            case 2: case 3: return xoForm();
+            case 4: case 5: return xForm();
+            case 6: return rotate();
+            case 7: return conditionRegister();
+            default: return loadStore();
+        }
+    }
+
+private:
+    std::mt19937_64 rng_;
+
+    static uint32_t D(uint32_t op, uint32_t d, uint32_t a, uint32_t imm) {
+        return (op << 26) | (d << 21) | (a << 16) | (imm & 0xFFFF);
+    }
+    static uint32_t X(uint32_t d, uint32_t a, uint32_t b, uint32_t xop, uint32_t rc) {
+        return (31u << 26) | (d << 21) | (a << 16) | (b << 11) | (xop << 1) | rc;
+    }
+
+    uint32_t dForm() {
+        static const uint32_t ops[] = {7, 8, 10, 11, 12, 13, 14, 15, 24, 25, 26, 27, 28, 29};
+        uint32_t op = ops[below(sizeof(ops) / sizeof(ops[0]))];
+        uint32_t imm = static_cast<uint32_t>(next());
+        if (op == 10 || op == 11) {
+            // crfD, L
+            return D(op, (below(8) << 2) | below(2), src(), imm);
+        }
+        if (op >= 24) {
+            return D(op, src(), dest(), imm);  // rA is the destination
+        }
+        return D(op, dest(), src(), imm);
+    }
+
+    uint32_t xoForm() {
+        static const uint32_t xops[] = {8, 9, 10, 11, 40, 73, 75, 104, 136, 138, 200, 202,
+                                        232, 233, 234, 235, 266, 457, 459, 489, 491};
+        uint32_t xop = xops[below(sizeof(xops) / sizeof(xops[0]))];
+        bool hasOE = xop != 9 && xop != 11 && xop != 73 && xop != 75;
+        uint32_t oe = hasOE ? below(2) : 0;
+        return X(dest(), src(), src(), (oe << 9) | xop, below(2));
+    }
+
+    uint32_t xForm() {
+        static const uint32_t xops[] = {0, 32, 19, 144, 24, 26, 27, 28, 58, 60, 122, 124, 284,
+                                        316, 339, 412, 444, 467, 476, 536, 539, 792, 794, 824,
+                                        826, 922, 954, 986, 278, 598};
+        uint32_t xop = xops[below(sizeof(xops) / sizeof(xops[0]))];
+        uint32_t rc = below(2);
+        switch (xop) {
+            case 0: case 32: // cmp, cmpl
+                return X((below(8) << 2) | below(2), src(), src(), xop, 0);
+            case 19: // mfcr
+                return X(dest(), 0, 0, xop, 0);
+            case 144: // mtcrf
+                return (31u << 26) | (src() << 21) | (below(256) << 12) | (144 << 1);
+            case 339: case 467: { // mfspr/mtspr XER, CTR (LR is left alone)
+                uint32_t spr = below(2) ? 1 : 9;
+                return X(xop == 339 ? dest() : src(), spr & 0x1F, spr >> 5, xop, 0);
+            }
+            case 826: // sradi, sh bit 5 random
+                return X(src(), dest(), below(32), xop | below(2), rc);
+            case 122: case 278: case 598: // popcntb, dcbt, sync
+                return X(src(), dest(), src(), xop, 0);
+            default: // rA = rS op rB
+                return X(src(), dest(), below(32), xop, rc);
+        }
+    }
+
+    uint32_t rotate() {
+        uint32_t rc = below(2);
+        switch (below(4)) {
+            case 0: case 1: { // rlwimi, rlwinm, rlwnm
+                static const uint32_t ops[] = {20, 21, 23};
+                uint32_t op = ops[below(3)];
+                return (op << 26) | (src() << 21) | (dest() << 16) | (below(32) << 11) |
+                       (below(32) << 6) | (below(32) << 1) | rc;
+            }
+            case 2: { // rldicl, rldicr, rldic, rldimi
+                return (30u << 26) | (src() << 21) | (dest() << 16) | (below(32) << 11) |
+                       (below(64) << 5) | (below(4) << 2) | (below(2) << 1) | rc;
+            }
+            default: { // rldcl, rldcr
+                return (30u << 26) | (src() << 21) | (dest() << 16) | (src() << 11) |
+                       (below(64) << 5) | (8u << 1) | (below(2) << 1) | rc;
+            }
+        }
+    }
+
+    uint32_t conditionRegister() {
+        static const uint32_t xops[] = {0, 33, 129, 193, 225, 257, 289, 417, 449, 150};
+        uint32_t xop = xops[below(sizeof(xops) / sizeof(xops[0]))];
+        if (xop == 0) { // mcrf
+            return (19u << 26) | (below(8) << 23) | (below(8) << 18);
+        }
+        return (19u << 26) | (below(32) << 21) | (below(32) << 16) | (below(32) << 11) | (xop << 1);
+    }
+
+    uint32_t loadStore() {
+        int32_t disp = static_cast<int32_t>(below(1024)) - 512;
+        if (below(4) == 0) { // indexed
+            static const uint32_t xops[] = {21, 23, 87, 279, 341, 343, 53, 55, 119, 311, 373,
+                                            375, 532, 534, 790, 149, 151, 215, 407, 181, 183,
+                                            247, 439, 660, 662, 918};
+            uint32_t xop = xops[below(sizeof(xops) / sizeof(xops[0]))];
+            return X(dest(), BASE_REG, INDEX_REG, xop, 0);
+        }
+        switch (below(4)) {
+            case 0: { // ld, ldu, lwa / std, stdu
+                bool isStore = below(2);
+                uint32_t xo = isStore ? below(2) : below(3);
+                return D(isStore ? 62 : 58, dest(), BASE_REG,
+                         (static_cast<uint32_t>(disp) & 0xFFFC) | xo);
+            }
+            case 1: // lmw, stmw
+                return D(46 + below(2), 24 + below(8), BASE_REG, static_cast<uint32_t>(disp));
+            default: {
+                uint32_t op = 32 + below(14);
+                return D(op, dest(), BASE_REG, static_cast<uint32_t>(disp));
+            }
+        }
+    }
+};
+
+struct Machine {
+    MemoryManager memory;
+    PPUInterpreter ppu;
+
+    bool init() {
+        return memory.init() && ppu.init(&memory);
+    }
+};
+
+void loadState(Machine& m, const std::vector<uint32_t>& program, const PPURegisters& regs,
+               const std::vector<uint8_t>& data) {
+    for (size_t i = 0; i < program.size(); ++i) {
+        m.memory.write32(CODE_BASE + i * 4, program[i]);
+    }
+    m.memory.write(DATA_BASE, data.data(), data.size());
+    m.ppu.getRegisters() = regs;
+}
+
+bool compare(const PPURegisters& a, const PPURegisters& b) {
+    bool same = true;
+    auto check = [&](const std::string& name, uint64_t x, uint64_t y) {
+        if (x == y) return;
+        std::cout << "  " << name << ": interpreter=0x" << std::hex << x
+                  << " jit=0x" << y << std::dec << std::endl;
+        same = false;
+    };
+    for (int i = 0; i < 32; ++i) {
+        check("r" + std::to_string(i), a.gpr[i], b.gpr[i]);
+    }
+    check("pc", a.pc, b.pc);
+    check("lr", a.lr, b.lr);
+    check("ctr", a.ctr, b.ctr);
+    check("cr", a.cr, b.cr);
+    check("xer", a.xer, b.xer);
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : std::random_device{}();
+
+    std::cout << "=== PPU JIT differential fuzz (" << iterations << " sequences, seed "
+              << seed << ") ===" << std::endl;
+
+    Machine reference;
+    Machine jitted;
+    if (!reference.init() || !jitted.init()) {
+        std::cerr << "Failed to init machines" << std::endl;
+        return 1;
+    }
+    PPUJIT* jit = jitted.ppu.getJIT();
+    if (!jit) {
+        std::cout << "PPU JIT not available, skipping" << std::endl;
+        return 0;
+    }
+    // Only run what the fuzzer compiles explicitly
+    PPUJITConfig config = jit->getConfig();
+    config.baselineThreshold = ~0ULL;
+    config.optimizeThreshold = ~0ULL;
+    jit->setConfig(config);
+
+    Generator gen(seed);
+    uint64_t totalInstructions = 0;
+    for (int iter = 0; iter < iterations; ++iter) {
+        // Random straight-line code, then a branch to a self-loop
+        std::vector<uint32_t> program;
+        for (int i = 0; i < SEQUENCE_LENGTH; ++i) {
+            program.push_back(gen.instruction());
+        }
+        program.push_back((18u << 26) | 4);  // b +4
+        program.push_back(18u << 26);        // b .
+        const int steps = SEQUENCE_LENGTH + 1;
+
+        PPURegisters regs;
+        for (auto& r : regs.gpr) {
+            switch (gen.below(4)) {
+                case 0: r = gen.below(64); break;
+                case 1: r = static_cast<uint64_t>(-static_cast<int64_t>(gen.below(64))); break;
+                case 2: r = static_cast<int64_t>(static_cast<int32_t>(gen.next())); break;
+                default: r = gen.next(); break;
+            }
+        }
+        regs.gpr[BASE_REG] = DATA_BASE + 0xFF00 + gen.below(0x200);
+        regs.gpr[INDEX_REG] = gen.below(64);
+        regs.cr = static_cast<uint32_t>(gen.next());
+        regs.xer = static_cast<uint32_t>(gen.next()) & (XER_SO | XER_OV | XER_CA);
+        regs.lr = gen.next();
+        regs.ctr = gen.next();
+        regs.pc = CODE_BASE;
+
+        std::vector<uint8_t> data(DATA_SIZE);
+        for (auto& byte : data) byte = static_cast<uint8_t>(gen.next());
+
+        loadState(reference, program, regs, data);
+        for (int i = 0; i < steps; ++i) {
+            reference.ppu.executeInstruction();
+        }
+
+        loadState(jitted, program, regs, data);
+        jit->invalidateRange(CODE_BASE, program.size() * 4);
+        PPUJITTier tier = (iter & 1) ? PPUJITTier::Optimized : PPUJITTier::Baseline;
+        jit->compileBlock(CODE_BASE, tier, steps);
+        jitted.ppu.executeBlock(steps);
+
+        bool same = compare(reference.ppu.getRegisters(), jitted.ppu.getRegisters());
+        for (uint64_t off = 0; off < DATA_SIZE; off += 8) {
+            uint64_t x = reference.memory.read64(DATA_BASE + off);
+            uint64_t y = jitted.memory.read64(DATA_BASE + off);
+            if (x != y) {
+                std::cout << "  mem[0x" << std::hex << DATA_BASE + off << "]: interpreter=0x"
+                          << x << " jit=0x" << y << std::dec << std::endl;
+                same = false;
+            }
+        }
+        if (!same) {
+            std::cout << "Mismatch in sequence " << iter << " (" << (iter & 1 ? "optimized" : "baseline")
+                      << "), program:" << std::endl;
+            for (size_t i = 0; i < program.size(); ++i) {
+                std::cout << "  0x" << std::hex << CODE_BASE + i * 4 << ": 0x" << std::setw(8)
+                          << std::setfill('0') << program[i] << std::setfill(' ') << std::dec
+                          << std::endl;
+            }
+            std::cout << "✗ PPU JIT differential fuzz FAILED (rerun with seed " << seed << ")"
+                      << std::endl;
+            return 1;
+        }
+        totalInstructions += steps;
+    }
+
+    uint64_t compiled = jit->getTierStats(PPUJITTier::Baseline).instructions +
+                        jit->getTierStats(PPUJITTier::Optimized).instructions;
+    std::cout << "Compiled code retired " << compiled << " of " << totalInstructions
+              << " instructions" << std::endl;
+    std::cout << "✓ PPU JIT differential fuzz PASSED" << std::endl;
+    return 0;
+}
@@ -2,16 +2,27 @@
 #include "core/SyscallHandler.h"
 #include "rsx/RSXProcessor.h"
 #include "rsx/RSXCommands.h"
+#include "rsx/RSXFifo.h"
 #include "loader/SELFLoader.h"
 #include "memory/MemoryManager.h"
 #include "cpu/PPUInterpreter.h"
+#include "cpu/PPUJIT.h"
+#include "cpu/PPUJITObjectCache.h"
+#include "cpu/CodeArena.h"
 #include "cpu/SPUInterpreter.h"
 #include "cpu/SPUManager.h"
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <utility>
 
 int main(int argc, char** argv) {
     pxs3c::Emulator emu;
+    int failures = 0;  // sections that printed FAILED
     
     std::cout << "=== PXS3C Emulator Test ===" << std::endl;
     
@@ -40,6 +51,7 @@ int main(int argc, char** argv) {
                 std::cout << "✓ Memory test PASSED" << std::endl;
             } else {
                 std::cout << "✗ Memory test FAILED" << std::endl;
+                failures++;
             }
         }
         
@@ -55,6 +67,239 @@ int main(int argc, char** argv) {
             std::cout << "GPR2: 0x" << std::hex << ppu->getGPR(2) << std::dec << std::endl;
             std::cout << "✓ PPU basic test PASSED" << std::endl;
         }
+        
+        std::cout << "\n=== Testing PPU JIT tiers ===" << std::endl;
+        if (memory && ppu && ppu->getJIT()) {
+            auto* jit = ppu->getJIT();
+            pxs3c::PPUJITConfig config = jit->getConfig();
+            config.baselineThreshold = 2;
+            config.optimizeThreshold = 8;
+            jit->setConfig(config);
+            
+            // li r3,0; li r4,64; loop: addi r3,r3,1; cmp r3,r4; blt loop
+            const uint64_t base = 0x00020000;
+            const uint32_t program[] = {
+                0x38600000, 0x38800040, 0x38630001, 0x7C032000, 0x4180FFF8,
+            };
+            for (int i = 0; i < 5; ++i) {
+                memory->write32(base + i * 4, program[i]);
+            }
+            ppu->setPC(base);
+            ppu->executeBlock(2 + 64 * 3);
+            
+            jit->dumpStats();
+            // The loop runs long enough to reach both compiled tiers
+            bool promoted = !jit->isAvailable() ||
+                            (jit->getTierStats(pxs3c::PPUJITTier::Baseline).compilations > 0 &&
+                             jit->getTierStats(pxs3c::PPUJITTier::Optimized).compilations > 0);
+            if (ppu->getGPR(3) == 64 && ppu->getPC() == base + 20 && promoted) {
+                std::cout << "✓ PPU JIT tier test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ PPU JIT tier test FAILED (r3=" << ppu->getGPR(3) << ")" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing PPU JIT block chaining ===" << std::endl;
+        if (memory && ppu && ppu->getJIT()) {
+            auto* jit = ppu->getJIT();
+            pxs3c::PPUJITConfig saved = jit->getConfig();
+            pxs3c::PPUJITConfig config = saved;
+            config.chaining = true;
+            config.baselineThreshold = 1;
+            config.optimizeThreshold = 1000000;  // stay baseline, one block each
+            jit->setConfig(config);
+
+            // a: addi r3,r3,1; b b_; b_: addi r4,r4,1; b a
+            const uint64_t base = 0x00021000;
+            const uint32_t program[] = {0x38630001, 0x48000004, 0x38840001, 0x4BFFFFF4};
+            for (int i = 0; i < 4; ++i) {
+                memory->write32(base + i * 4, program[i]);
+            }
+            uint64_t linksBefore = jit->getLinksPatched();
+            uint64_t invalidatedBefore = jit->getInvalidatedBlocks();
+            ppu->setGPR(3, 0);
+            ppu->setGPR(4, 0);
+            ppu->setPC(base);
+            for (int i = 0; i < 10; ++i) {
+                ppu->executeBlock(1000);
+            }
+            uint64_t linked = jit->getLinksPatched() - linksBefore;
+            // Without a JIT backend nothing compiles, so there is nothing to link
+            bool compiled = jit->isAvailable();
+            bool chained = (!compiled || linked > 0) && ppu->getGPR(3) > 0 &&
+                           ppu->getGPR(4) + 1 >= ppu->getGPR(3) && ppu->getGPR(4) <= ppu->getGPR(3);
+            // The page holding the blocks sends stores through MemoryManager
+            uint8_t flags = memory->getPageFlags()[base >> pxs3c::FASTMEM_PAGE_SHIFT];
+            bool guarded = (flags & pxs3c::FASTMEM_CODE) && !(flags & pxs3c::FASTMEM_WRITE);
+
+            // b_: addi r4,r4,2. The jump from a into b_ is linked; the store
+            // alone must drop the old block so the link reaches the new code.
+            memory->write32(base + 8, 0x38840002);
+            ppu->setGPR(3, 0);
+            ppu->setGPR(4, 0);
+            for (int i = 0; i < 10; ++i) {
+                ppu->executeBlock(1000);
+            }
+            uint64_t r3 = ppu->getGPR(3);
+            uint64_t r4 = ppu->getGPR(4);
+            bool rewritten = r3 > 0 && (r4 == 2 * r3 || r4 + 2 == 2 * r3) &&
+                             jit->getInvalidatedBlocks() > invalidatedBefore;
+            jit->setConfig(saved);
+
+            std::cout << "Links patched: " << linked << ", after rewrite r3=" << r3 << " r4=" << r4 << std::endl;
+            if (chained && guarded && rewritten) {
+                std::cout << "✓ PPU JIT chaining test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ PPU JIT chaining test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing PPU JIT object cache ===" << std::endl;
+        if (ppu && ppu->getJIT()) {
+            namespace fs = std::filesystem;
+            const fs::path cacheDir = fs::temp_directory_path() /
+                ("pxs3c_objcache_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+            fs::remove_all(cacheDir);
+
+            // Each run is a fresh PPU and JIT over the same code, as on the
+            // next launch of a game: compile the loop, then run it
+            const uint64_t base = 0x00020000;
+            const uint32_t program[] = {
+                0x38600000, 0x38800040, 0x38630001, 0x7C032000, 0x4180FFF8,
+            };
+            auto run = [&](pxs3c::PPUJITObjectCacheStats& stats) {
+                pxs3c::MemoryManager runMemory;
+                pxs3c::PPUInterpreter runPPU;
+                if (!runMemory.init() || !runPPU.init(&runMemory) || !runPPU.getJIT() ||
+                    !runPPU.getJIT()->setCacheDirectory(cacheDir.string())) {
+                    return false;
+                }
+                for (int i = 0; i < 5; ++i) {
+                    runMemory.write32(base + i * 4, program[i]);
+                }
+                bool compiled = runPPU.getJIT()->compileBlock(base + 8, pxs3c::PPUJITTier::Baseline);
+                runPPU.setPC(base);
+                runPPU.executeBlock(2 + 64 * 3);
+                stats = runPPU.getJIT()->getObjectCacheStats();
+                return compiled && runPPU.getGPR(3) == 64;
+            };
+            auto objects = [&]() {
+                std::vector<fs::path> paths;
+                for (const auto& file : fs::directory_iterator(cacheDir)) {
+                    paths.push_back(file.path());
+                }
+                return paths;
+            };
+
+            bool ok = true;
+            if (ppu->getJIT()->isAvailable()) {
+                // First run stores the object, written to a temporary file
+                // and renamed into place
+                pxs3c::PPUJITObjectCacheStats first, second, third;
+                ok = run(first) && first.stores > 0 && first.hits == 0;
+                for (const fs::path& path : objects()) {
+                    ok = ok && path.extension() == ".obj";
+                }
+                // Second run loads it instead of compiling
+                ok = ok && run(second) && second.hits > 0 && second.stores == 0;
+
+                // An object from another cache version is ignored and
+                // replaced, never loaded
+                for (const fs::path& path : objects()) {
+                    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+                    uint32_t version = pxs3c::PPU_JIT_CACHE_VERSION + 1;
+                    file.seekp(offsetof(pxs3c::PPUJITCacheHeader, version));
+                    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+                }
+                ok = ok && run(third) && third.hits == 0 && third.misses > 0 && third.stores > 0;
+                std::cout << "Object cache: stored " << first.stores << ", reloaded " << second.hits
+                          << ", after a version change hits=" << third.hits << " stores=" << third.stores
+                          << std::endl;
+            } else {
+                std::cout << "No JIT backend, nothing to cache" << std::endl;
+            }
+            fs::remove_all(cacheDir);
+
+            if (ok) {
+                std::cout << "✓ PPU JIT object cache test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ PPU JIT object cache test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing guest timebase ===" << std::endl;
+        if (memory && ppu) {
+            // li r5,0; li r6,1000; mftb r3; loop: addi r5,r5,1; cmp r5,r6;
+            // blt loop; mftb r4
+            const uint64_t base = 0x00030000;
+            const uint32_t program[] = {
+                0x38A00000, 0x38C003E8, 0x7C6C42E6, 0x38A50001, 0x7C053000,
+                0x4180FFF8, 0x7C8C42E6,
+            };
+            for (int i = 0; i < 7; ++i) {
+                memory->write32(base + i * 4, program[i]);
+            }
+            ppu->setPC(base);
+            ppu->executeBlock(3 + 1000 * 3 + 1);
+
+            // 3001 instructions at 40 cycles per tick, +1 for where the
+            // tick boundaries fall
+            uint64_t elapsed = ppu->getGPR(4) - ppu->getGPR(3);
+            pxs3c::SyscallHandler syscalls;
+            syscalls.init(ppu, memory);
+            pxs3c::SyscallContext ctx = {};
+            syscalls.handleSyscall(147, ctx);
+            std::cout << "mftb delta: " << elapsed << " ticks, frequency: "
+                      << ctx.returnValue << " Hz" << std::endl;
+            uint64_t expected = 3001 / pxs3c::CYCLES_PER_TICK;
+            if ((elapsed == expected || elapsed == expected + 1) &&
+                ctx.returnValue == pxs3c::TIMEBASE_FREQUENCY) {
+                std::cout << "✓ Guest timebase test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ Guest timebase test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing JIT code arena ===" << std::endl;
+        {
+            pxs3c::CodeArena arena(64 * 1024);
+            pxs3c::CodeSpan a = arena.allocate(100);
+            pxs3c::CodeSpan b = arena.allocate(5000, 64);
+            bool ok = a && b && (reinterpret_cast<uintptr_t>(b.exec) & 63) == 0 &&
+                      (!arena.isDualMapped() || a.write != a.exec);
+#if defined(__x86_64__) || defined(__aarch64__)
+            // Written through one view, run through the other
+#if defined(__x86_64__)
+            const uint8_t code[] = {0xB8, 0x2A, 0x00, 0x00, 0x00, 0xC3};  // mov eax,42; ret
+#else
+            const uint8_t code[] = {0x40, 0x05, 0x80, 0x52, 0xC0, 0x03, 0x5F, 0xD6};  // mov w0,#42; ret
+#endif
+            std::memcpy(a.write, code, sizeof(code));
+            pxs3c::CodeArena::flush(a);
+            ok = ok && reinterpret_cast<int (*)()>(a.exec)() == 42;
+#endif
+            // Freed space is reused; a region with nothing live is unmapped
+            arena.free(a.exec);
+            pxs3c::CodeSpan c = arena.allocate(64);
+            pxs3c::CodeSpan big = arena.allocate(128 * 1024);
+            ok = ok && c.exec == a.exec && big && arena.getStats().regions == 2;
+            arena.free(b.exec);
+            arena.free(c.exec);
+            arena.compact();
+            pxs3c::CodeArenaStats stats = arena.getStats();
+            ok = ok && stats.regions == 1 && stats.regionsReleased == 1 && stats.reused == 1 &&
+                 stats.bytesLive == 128 * 1024;
+            if (ok) {
+                std::cout << "✓ JIT code arena test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ JIT code arena test FAILED" << std::endl;
+                failures++;
+            }
+        }
     } else {
         // Load and run game
         std::cout << "\n=== Loading Game ===" << std::endl;
@@ -86,8 +331,456 @@ int main(int argc, char** argv) {
             }
         }
         std::cout << "✓ SPU test PASSED" << std::endl;
+
+        std::cout << "\n=== Testing SPU decoder ===" << std::endl;
+        auto* spu = spuMgr->getSPU(0);
+        if (spu) {
+            // il r3,0; il r4,100; loop: a r3,r3,r4; ai r4,r4,-1;
+            // brnz r4,loop; stop 0x2000
+            const uint32_t program[] = {
+                0x40800003, 0x40803204, 0x18010183, 0x1CFFC204, 0x217FFF04, 0x00002000,
+            };
+            auto& ls = spu->getLocalStore();
+            for (int i = 0; i < 6; ++i) {
+                for (int b = 0; b < 4; ++b) {
+                    ls[i * 4 + b] = static_cast<uint8_t>(program[i] >> (24 - 8 * b));
+                }
+            }
+            spu->setPC(0);
+            spu->executeBlock(1000);
+
+            uint32_t sum = spu->getRegister(3).w(0);
+            std::cout << "SPU0 sum: " << sum << " stop: 0x" << std::hex
+                      << spu->getStopCode() << std::dec << std::endl;
+            bool programOk = spu->isHalted() && sum == 5050 && spu->getStopCode() == 0x2000;
+
+            // Code stored as data must be fetched in guest word order
+            pxs3c::SPUVector code = spu->loadQuad(0);
+            code.w(0) = 0x00001234;  // stop 0x1234
+            spu->reset();
+            spu->storeQuad(0x100, code);
+            spu->setPC(0x100);
+            spu->executeBlock(10);
+            bool shadowOk = spu->getStopCode() == 0x1234 && spu->getLocalStore()[0x103] == 0x34 &&
+                            spu->loadQuad(0x100).w(0) == 0x00001234;
+            if (programOk && shadowOk) {
+                std::cout << "✓ SPU decoder test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU decoder test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing SPU vector ops ===" << std::endl;
+        {
+            pxs3c::SPUVector a, b, control;
+            for (int i = 0; i < 16; ++i) {
+                a.b(i) = static_cast<uint8_t>(i);
+                b.b(i) = static_cast<uint8_t>(0x10 + i);
+                control.b(i) = static_cast<uint8_t>(31 - i);  // reverse a:b
+            }
+            control.b(0) = 0x80;  // constant 0x00
+            control.b(1) = 0xC0;  // constant 0xFF
+            control.b(2) = 0xE0;  // constant 0x80
+            pxs3c::SPUVector shuffled = pxs3c::spu::shuffleBytes(a, b, control);
+            bool shufOk = shuffled.b(0) == 0x00 && shuffled.b(1) == 0xFF && shuffled.b(2) == 0x80 &&
+                          shuffled.b(3) == 0x1C && shuffled.b(15) == 0x10;
+
+            uint32_t mask = pxs3c::spu::gatherBits8(pxs3c::spu::expandBits8(0xA5C3));
+            pxs3c::SPUVector x = pxs3c::spu::splat32(0xFFFE0003);  // lo -> 3, hi -> -2
+            pxs3c::SPUVector product = pxs3c::spu::mulLowSigned(x, pxs3c::spu::splat32(0x0001FFF9));  // lo -> -7
+            pxs3c::SPUVector high = pxs3c::spu::mulHighSigned(x, x);
+
+            std::cout << "shufb: " << (shufOk ? "ok" : "bad") << " fsmb/gbb: 0x" << std::hex << mask
+                      << " mpy: 0x" << product.w(0) << " mpyhh: 0x" << high.w(3) << std::dec << std::endl;
+            if (shufOk && mask == 0xA5C3 && product.w(0) == 0xFFFFFFEB && high.w(3) == 4) {
+                std::cout << "✓ SPU vector ops test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU vector ops test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing MFC DMA ===" << std::endl;
+        auto* memory = emu.getMemory();
+        auto* dmaSpu = spuMgr->getSPU(1);
+        if (memory && dmaSpu) {
+            const uint64_t source = 0x00040000;
+            for (uint32_t i = 0; i < 0x4000; ++i) {
+                memory->write8(source + i, static_cast<uint8_t>(i * 7));
+            }
+            auto& mfc = dmaSpu->getMFC();
+            uint8_t* ls = dmaSpu->getLocalStorePointer();
+
+            // get 64 bytes, then put them back elsewhere
+            bool ok = mfc.enqueue({0x1000, source, 64, 3, pxs3c::MFC_GET_CMD}) == pxs3c::MFCStatus::Ok &&
+                      mfc.enqueue({0x1000, source + 0x1000, 64, 3, pxs3c::MFC_PUTF_CMD}) == pxs3c::MFCStatus::Ok;
+            mfc.waitForTags(1u << 3, true);
+            ok = ok && ls[0x1000 + 63] == static_cast<uint8_t>(63 * 7) &&
+                 memory->read32(source + 0x1000 + 60) == memory->read32(source + 60);
+
+            // getl: two elements of 16 and 32 bytes from list at LS 0x2000
+            const uint8_t list[16] = {0, 0, 0, 16, 0, 0x04, 0x00, 0x10, 0, 0, 0, 32, 0, 0x04, 0x00, 0x40};
+            std::memcpy(ls + 0x2000, list, sizeof(list));
+            ok = ok && mfc.enqueue({0x3000, 0x2000, 16, 4, pxs3c::MFC_GETL_CMD}) == pxs3c::MFCStatus::Ok;
+            mfc.waitForTags(1u << 4, true);
+            ok = ok && ls[0x3000] == static_cast<uint8_t>(0x10 * 7) && ls[0x3010] == static_cast<uint8_t>(0x40 * 7);
+
+            // 16KB on the DMA thread, completed through the tag group
+            pxs3c::SPUWorkerConfig config = spuMgr->getWorkerConfig();
+            pxs3c::SPUWorkerConfig asyncConfig = config;
+            asyncConfig.asyncDMA = true;
+            spuMgr->setWorkerConfig(asyncConfig);
+            ok = ok && mfc.isAsync() &&
+                 mfc.enqueue({0x8000, source, pxs3c::MFC_MAX_TRANSFER, 5, pxs3c::MFC_GET_CMD}) == pxs3c::MFCStatus::Ok;
+            uint32_t tags = mfc.waitForTags(1u << 5, true);
+            ok = ok && tags == (1u << 5) && ls[0x8000 + 0x3FFF] == static_cast<uint8_t>(0x3FFF * 7);
+            bool badSize = mfc.enqueue({0, source, 24, 0, pxs3c::MFC_GET_CMD}) == pxs3c::MFCStatus::InvalidSize;
+            spuMgr->setWorkerConfig(config);
+
+            std::cout << "MFC: " << mfc.getCommandsCompleted() << " commands, "
+                      << mfc.getBytesTransferred() << " bytes" << std::endl;
+            if (ok && badSize && !mfc.isAsync()) {
+                std::cout << "✓ MFC DMA test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ MFC DMA test FAILED" << std::endl;
+                failures++;
+            }
+        }
     }
-    
+
+    if (spuMgr) {
+        std::cout << "\n=== Testing SPU channels ===" << std::endl;
+        auto* spu = spuMgr->getSPU(2);
+        if (spu) {
+            // rchcnt r5,ch29; rdch r3,ch29; a r3,r3,r3; wrch ch28,r3;
+            // wrch ch28,r3; stop 0x2001
+            const uint32_t program[] = {
+                0x01E00E85, 0x01A00E83, 0x1800C183, 0x21A00E03, 0x21A00E03, 0x00002001,
+            };
+            spu->reset();
+            for (int i = 0; i < 6; ++i) {
+                pxs3c::SPUVector quad = spu->loadQuad(i * 4);
+                quad.w(i & 3) = program[i];
+                spu->storeQuad(i * 4, quad);
+            }
+            auto& channels = spu->getChannels();
+            spu->setPC(0);
+
+            // Empty inbound mailbox: the SPU stalls on rdch and is left parked
+            uint64_t skips = spuMgr->getWorkerPool().getParkedSkips();
+            spuMgr->runUntil(spu->getCycles() + 1000);
+            spuMgr->runUntil(spu->getCycles() + 1000);
+            bool stalled = spu->isParked() && spu->getPC() == 4 && spu->getRegister(5).w(0) == 0;
+            bool skipped = !spuMgr->getWorkerPool().isRunning() ||
+                           spuMgr->getWorkerPool().getParkedSkips() > skips;
+
+            // Mail from the PPU resumes it; the second write finds the
+            // outbound mailbox full until the other thread drains it
+            bool mailOk = channels.writeInboundMailbox(21) &&
+                          (channels.getMailboxStatus() & 0xFF00) == 0x0300;
+            pxs3c::SPUWorkerConfig config = spuMgr->getWorkerConfig();
+            pxs3c::SPUWorkerConfig waitConfig = config;
+            waitConfig.channelWaitUs = 5000000;
+            spuMgr->setWorkerConfig(waitConfig);
+            uint32_t first = 0, second = 0;
+            std::thread ppu([&] {
+                while (!channels.readOutboundMailbox(first)) std::this_thread::yield();
+                while (!channels.readOutboundMailbox(second)) std::this_thread::yield();
+            });
+            spu->runUntil(spu->getCycles() + 1000);
+            ppu.join();
+            spuMgr->setWorkerConfig(config);
+            mailOk = mailOk && first == 42 && second == 42 && spu->isHalted() &&
+                     spu->getStopCode() == 0x2001 && channels.getMailboxStatus() == 0x0400;
+
+            // Signal notification in OR mode accumulates until read
+            uint32_t signal = 0;
+            channels.setSignalOrMode(1, true);
+            channels.writeSignal(1, 0x10);
+            channels.writeSignal(1, 0x01);
+            bool signalOk = channels.count(pxs3c::SPU_RdSigNotify1) == 1 &&
+                            channels.read(pxs3c::SPU_RdSigNotify1, signal) == pxs3c::ChannelStatus::Ok &&
+                            signal == 0x11 &&
+                            channels.read(pxs3c::SPU_RdSigNotify1, signal) == pxs3c::ChannelStatus::WouldBlock;
+
+            if (stalled && skipped && mailOk && signalOk) {
+                std::cout << "✓ SPU channels test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU channels test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing SPU recompiler ===" << std::endl;
+        spu = spuMgr->getSPU(3);
+        if (spu) {
+            // il r3,0; il r4,100; loop: a r3,r3,r4; ai r4,r4,-1;
+            // brnz r4,loop; stop 0x2000
+            const uint32_t program[] = {
+                0x40800003, 0x40803204, 0x18010183, 0x1CFFC204, 0x217FFF04, 0x00002000,
+            };
+            spu->reset();
+            for (int i = 0; i < 6; ++i) {
+                pxs3c::SPUVector quad = spu->loadQuad(i * 4);
+                quad.w(i & 3) = program[i];
+                spu->storeQuad(i * 4, quad);
+            }
+            pxs3c::SPURecompilerConfig config;
+            config.enabled = true;
+            spu->setRecompilerConfig(config);
+            spu->setPC(0);
+            uint64_t start = spu->getCycles();
+            spu->executeBlock(1000);
+
+            // Same result and cycle count as the interpreter; the loop body
+            // runs compiled where there is a backend
+            pxs3c::SPURecompiler* jit = spu->getRecompiler();
+            bool ok = spu->isHalted() && spu->getRegister(3).w(0) == 5050 &&
+                      spu->getCycles() - start == 303 &&
+                      (!jit || jit->getStats().instructions > 0);
+            spu->setRecompilerConfig(pxs3c::SPURecompilerConfig());
+            if (ok) {
+                std::cout << "✓ SPU recompiler test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU recompiler test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing SPU code cache ===" << std::endl;
+        spu = spuMgr->getSPU(4);
+        if (spu) {
+            // The program SPU3 just ran: SPU4 finds its loop already compiled
+            const uint32_t program[] = {
+                0x40800003, 0x40803204, 0x18010183, 0x1CFFC204, 0x217FFF04, 0x00002000,
+            };
+            auto upload = [&]() {
+                spu->reset();
+                for (int i = 0; i < 6; ++i) {
+                    pxs3c::SPUVector quad = spu->loadQuad(i * 4);
+                    quad.w(i & 3) = program[i];
+                    spu->storeQuad(i * 4, quad);
+                }
+                spu->setPC(0);
+            };
+            pxs3c::SPURecompilerConfig config;
+            config.enabled = true;
+            spu->setRecompilerConfig(config);
+            upload();
+            spu->executeBlock(1000);
+            pxs3c::SPURecompiler* jit = spu->getRecompiler();
+            bool shared = spu->isHalted() && spu->getRegister(3).w(0) == 5050 &&
+                          (!jit || (jit->getStats().cacheHits > 0 && jit->getStats().compilations == 0));
+
+            // Ten iterations in, patch the loop to count down by two: the
+            // store lands in compiled code, so the loop is recompiled
+            upload();
+            spu->executeBlock(32);
+            pxs3c::SPUVector quad = spu->loadQuad(0);
+            quad.w(3) = 0x1CFF8204;  // ai r4,r4,-2
+            spu->storeQuad(0, quad);
+            spu->executeBlock(1000);
+            bool patched = spu->isHalted() && spu->getRegister(3).w(0) == 955 + 2070 &&
+                           (!jit || jit->getStats().invalidations > 0);
+            spu->setRecompilerConfig(pxs3c::SPURecompilerConfig());
+            if (shared && patched) {
+                std::cout << "✓ SPU code cache test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU code cache test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing SPU thread groups ===" << std::endl;
+        {
+            // Eight contexts on two host workers: each sums 1..10*(n+1)
+            pxs3c::SPUWorkerConfig config = spuMgr->getWorkerConfig();
+            pxs3c::SPUWorkerConfig twoWorkers = config;
+            twoWorkers.workers = 2;
+            spuMgr->setWorkerConfig(twoWorkers);
+            int raw = spuMgr->getContextCount();
+            int group = spuMgr->createThreadGroup("smoke", 8);
+            const pxs3c::SPUThreadGroup* threads = spuMgr->getThreadGroup(group);
+            bool ok = threads && threads->threads.size() == 8 && spuMgr->getContextCount() == raw + 8;
+            for (size_t n = 0; ok && n < threads->threads.size(); ++n) {
+                pxs3c::SPUInterpreter* context = spuMgr->getSPU(threads->threads[n]);
+                const uint32_t program[] = {
+                    0x40800003, 0x40800004 | (uint32_t(10 * (n + 1)) << 7), 0x18010183, 0x1CFFC204,
+                    0x217FFF04, 0x00002000,
+                };
+                pxs3c::SPUVector quad[2];
+                for (int i = 0; i < 6; ++i) {
+                    quad[i / 4].w(i & 3) = program[i];
+                }
+                context->storeQuad(0, quad[0]);
+                context->storeQuad(16, quad[1]);
+                context->setPC(0);
+            }
+
+            // Nothing runs until the group is started
+            uint64_t runs = spuMgr->getWorkerPool().getContextRuns();
+            spuMgr->runUntil(1000);
+            ok = ok && spuMgr->getSPU(threads->threads[0])->getPC() == 0;
+            ok = ok && spuMgr->startThreadGroup(group);
+            spuMgr->runUntil(4000);
+            for (size_t n = 0; ok && n < threads->threads.size(); ++n) {
+                pxs3c::SPUInterpreter* context = spuMgr->getSPU(threads->threads[n]);
+                uint32_t top = 10 * (n + 1);
+                ok = context->isHalted() && context->getRegister(3).w(0) == top * (top + 1) / 2;
+            }
+            bool pooled = !spuMgr->getWorkerPool().isRunning() ||
+                          (spuMgr->getWorkerPool().getWorkerCount() == 2 &&
+                           spuMgr->getWorkerPool().getContextRuns() >= runs + 8);
+            int first = threads ? threads->threads[0] : -1;
+            ok = ok && spuMgr->destroyThreadGroup(group) && !spuMgr->getThreadGroup(group) &&
+                 spuMgr->getContextCount() == raw && !spuMgr->getSPU(first);
+            spuMgr->setWorkerConfig(config);
+            if (ok && pooled) {
+                std::cout << "✓ SPU thread group test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU thread group test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing SPU local store ===" << std::endl;
+        {
+            // A new context holds no memory until its local store is used,
+            // and a reset gives the pages back
+            int group = spuMgr->createThreadGroup("lazy", 1);
+            const pxs3c::SPUThreadGroup* threads = spuMgr->getThreadGroup(group);
+            pxs3c::SPUInterpreter* context = threads ? spuMgr->getSPU(threads->threads[0]) : nullptr;
+            if (context) {
+                const pxs3c::SPULocalStore& store = std::as_const(*context).getLocalStore();
+                size_t idle = store.getResidentBytes();
+                pxs3c::SPUVector quad;
+                quad.w(0) = 0x12345678;
+                context->storeQuad(0x20000, quad);
+                size_t used = store.getResidentBytes();
+                bool stored = context->loadQuad(0x20000).w(0) == 0x12345678 &&
+                              context->fetchInstruction(0x20000) == 0x12345678;
+                context->reset();
+                size_t discarded = store.getResidentBytes();
+                bool zeroed = context->loadQuad(0x20000).w(0) == 0 && context->fetchInstruction(0x20000) == 0;
+                std::cout << "Local store resident: " << idle << " idle, " << used << " used, "
+                          << discarded << " after reset" << std::endl;
+                spuMgr->destroyThreadGroup(group);
+                if (idle == 0 && used > 0 && stored && discarded == 0 && zeroed) {
+                    std::cout << "✓ SPU local store test PASSED" << std::endl;
+                } else {
+                    std::cout << "✗ SPU local store test FAILED" << std::endl;
+                    failures++;
+                }
+            }
+        }
+
+        std::cout << "\n=== Testing SPU profiler ===" << std::endl;
+        spu = spuMgr->getSPU(5);
+        if (spu) {
+            // The sum loop, then rdch r5,ch29 on an empty inbound mailbox
+            const uint32_t program[] = {
+                0x40800003, 0x40803204, 0x18010183, 0x1CFFC204, 0x217FFF04, 0x01A00E85, 0x00002000,
+            };
+            spu->reset();
+            for (int i = 0; i < 7; ++i) {
+                pxs3c::SPUVector quad = spu->loadQuad(i * 4);
+                quad.w(i & 3) = program[i];
+                spu->storeQuad(i * 4, quad);
+            }
+            pxs3c::SPURecompilerConfig jitConfig;
+            jitConfig.enabled = true;
+            spu->setRecompilerConfig(jitConfig);
+            pxs3c::SPUProfilerConfig config;
+            config.enabled = true;
+            spu->setProfilerConfig(config);
+            pxs3c::SPUProfiler* profiler = spu->getProfiler();
+            profiler->addSymbol("main", 0, 8);
+            profiler->addSymbol("sum_loop", 8, 12);
+            spu->setPC(0);
+            spu->runUntil(spu->getCycles() + 1000);
+            spu->getChannels().writeInboundMailbox(1);
+            spu->runUntil(spu->getCycles() + 1000);
+
+            // Counts are exact whether the loop ran interpreted or compiled
+            const pxs3c::SPUStallProfile& mailbox = profiler->getStalls(pxs3c::SPUStallReason::InMailbox);
+            bool ok = spu->isHalted() && profiler->getCount(8) == 100 && profiler->getCount(0) == 1 &&
+                      profiler->getBranch(16).executed == 100 && profiler->getBranch(16).taken == 99 &&
+                      profiler->getSamples() == 2 + 300 + 2 && mailbox.events == 1 && mailbox.cycles > 0 &&
+                      profiler->symbolize(12) == "sum_loop+0x4" && profiler->symbolize(0x40) == "0x00040";
+            profiler->report(std::cout, spu->getId(), 4);
+            spu->setProfilerConfig(pxs3c::SPUProfilerConfig());
+            spu->setRecompilerConfig(pxs3c::SPURecompilerConfig());
+            if (ok) {
+                std::cout << "✓ SPU profiler test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU profiler test FAILED" << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "\n=== Testing SPU loop regions ===" << std::endl;
+        {
+            // il r3,0; il r4,100; hbrr loop_end,loop; loop: a r3,r3,r4;
+            // ai r4,r4,-1; loop_end: brnz r4,loop; stop 0x2000
+            const uint32_t program[] = {
+                0x40800003, 0x40803204, 0x12000083, 0x18010183, 0x1CFFC204, 0x217FFF04, 0x00002000,
+            };
+            int group = spuMgr->createThreadGroup("loops", 3);
+            const pxs3c::SPUThreadGroup* threads = spuMgr->getThreadGroup(group);
+            bool ok = threads != nullptr;
+            std::vector<pxs3c::SPUInterpreter*> contexts;
+            for (size_t n = 0; ok && n < threads->threads.size(); ++n) {
+                pxs3c::SPUInterpreter* context = spuMgr->getSPU(threads->threads[n]);
+                pxs3c::SPUVector quad[2];
+                for (int i = 0; i < 7; ++i) {
+                    quad[i / 4].w(i & 3) = program[i];
+                }
+                context->storeQuad(0, quad[0]);
+                context->storeQuad(16, quad[1]);
+                contexts.push_back(context);
+            }
+            if (ok) {
+                // One context steps, one loops pre-decoded, one compiled;
+                // all three stop at the same instruction mid-loop
+                pxs3c::SPURecompilerConfig config;
+                config.enabled = true;
+                contexts[2]->setRecompilerConfig(config);
+                for (int i = 0; i < 150; ++i) {
+                    contexts[0]->executeInstruction();
+                }
+                contexts[1]->runUntil(150);
+                contexts[2]->runUntil(150);
+                for (pxs3c::SPUInterpreter* context : contexts) {
+                    ok = ok && context->getPC() == contexts[0]->getPC() &&
+                         context->getRegister(3).w(0) == contexts[0]->getRegister(3).w(0) &&
+                         context->getRegister(4).w(0) == contexts[0]->getRegister(4).w(0);
+                }
+                contexts[1]->runUntil(1000);
+                contexts[2]->runUntil(1000);
+
+                // The hint makes the loop its own region, compiled on first
+                // entry: each runUntil() runs it in one call
+                pxs3c::SPURecompiler* jit = contexts[2]->getRecompiler();
+                for (size_t n = 1; n < contexts.size(); ++n) {
+                    ok = ok && contexts[n]->isHalted() && contexts[n]->getRegister(3).w(0) == 5050;
+                }
+                ok = ok && contexts[1]->getLoopIterations() > 90 &&
+                     (!jit || (jit->getStats().iterations == 98 && jit->getStats().executions == 2));
+                std::cout << "Loop passes: " << contexts[1]->getLoopIterations() << " pre-decoded, "
+                          << (jit ? jit->getStats().iterations : 0) << " compiled" << std::endl;
+                contexts[2]->setRecompilerConfig(pxs3c::SPURecompilerConfig());
+            }
+            spuMgr->destroyThreadGroup(group);
+            if (ok) {
+                std::cout << "✓ SPU loop region test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ SPU loop region test FAILED" << std::endl;
+                failures++;
+            }
+        }
+    }
+
     std::cout << "\n=== Testing Syscall Handler ===" << std::endl;
     {
         pxs3c::SyscallContext ctx;
@@ -138,15 +831,182 @@ int main(int argc, char** argv) {
             
             // Test command buffer
             pxs3c::RSXCommandBuffer cmdBuf(1024);
-            cmdBuf.writeCommand(0x0A0C, 0xFF0000FF);  // Clear color red
-            cmdBuf.writeCommand(0x0ABC, std::vector<uint32_t>{0x4});  // Begin triangles
+            cmdBuf.writeCommand(pxs3c::NV4097_SET_COLOR_CLEAR_VALUE, 0xFF0000FF);  // Clear color red
+            cmdBuf.writeCommand(pxs3c::NV4097_SET_BEGIN_END, std::vector<uint32_t>{0x5});  // Begin triangles
             
             std::cout << "  Buffer size: " << cmdBuf.getSize() << " bytes" << std::endl;
             
             // Process commands
             rsx->processCommands(cmdBuf);
+            bool ok = rsx->getDrawState().clearColor == 0xFF0000FF;
+            
+            // Commands are read in place, straight out of the buffer
+            cmdBuf.writeCommand(pxs3c::NV4097_SET_BLEND_FUNC_SFACTOR, std::vector<uint32_t>{0x0302, 0x0303});  // Blend func
+            pxs3c::RSXCommandView view;
+            ok = ok && cmdBuf.readCommand(view) && view.method == pxs3c::NV4097_SET_BLEND_FUNC_SFACTOR && view.count == 2 &&
+                 view.args == reinterpret_cast<const uint32_t*>(cmdBuf.getBuffer()) + 1 && view.arg(1) == 0x0303;
+            rsx->submitCommand(pxs3c::NV4097_SET_BLEND_EQUATION, 0x800A);  // Blend equation subtract
+            ok = ok && rsx->getDrawState().blendEquation == pxs3c::RSXBlendEquation::SUBTRACT;
+            
+            // The words of a run go to consecutive method registers, and
+            // handlers read the rest of the register file
+            rsx->submitCommand(pxs3c::NV4097_SET_BLEND_FUNC_SFACTOR, std::vector<uint32_t>{0x03000300, 0x03060306});
+            ok = ok && rsx->getDrawState().blendSrcFactor == pxs3c::RSXBlendFactor::SRC_COLOR &&
+                 rsx->getDrawState().blendDstFactor == pxs3c::RSXBlendFactor::DST_COLOR &&
+                 rsx->getRegister(pxs3c::NV4097_SET_BLEND_FUNC_DFACTOR) == 0x03060306;
+            
+            // The cull mode and culling on/off are separate registers
+            rsx->submitCommand(pxs3c::NV4097_SET_CULL_FACE_ENABLE, 0);
+            rsx->submitCommand(pxs3c::NV4097_SET_CULL_FACE, 0x0404);  // GL_FRONT_AND_BACK
+            ok = ok && !rsx->getDrawState().cullingEnabled && rsx->getDrawState().cullFace == 0x0404;
+            rsx->submitCommand(pxs3c::NV4097_SET_CULL_FACE_ENABLE, 1);
+            ok = ok && rsx->getDrawState().cullingEnabled && rsx->getDrawState().cullFace == 0x0404;
+            
+            // Decode throughput over a stream of vertex array methods
+            pxs3c::RSXCommandBuffer stream(4 * 1024 * 1024);
+            const uint32_t args[4] = {1, 2, 3, 4};
+            const int batches = 20;
+            const int perBatch = 100000;
+            pxs3c::RSXProcessorStats before = rsx->getStats();
+            for (int batch = 0; batch < batches; ++batch) {
+                for (int i = 0; i < perBatch; ++i) {
+                    stream.writeCommand(pxs3c::NV4097_SET_VERTEX_DATA_ARRAY_OFFSET + (i & 3) * 4, args, 1 + (i & 3));
+                }
+                rsx->processCommands(stream);
+            }
+            const pxs3c::RSXProcessorStats& stats = rsx->getStats();
+            uint64_t methods = stats.methods - before.methods;
+            double seconds = (stats.processNs - before.processNs) / 1e9;
+            std::cout << "  Decoded " << methods << " methods (" << (stats.words - before.words)
+                      << " words) at " << (seconds > 0 ? methods / seconds / 1e6 : 0.0)
+                      << "M methods/s" << std::endl;
+            ok = ok && methods == uint64_t(batches) * perBatch &&
+                 stats.words - before.words == uint64_t(batches) * perBatch * 5 / 2 &&
+                 stats.unhandled - before.unhandled == stats.words - before.words &&
+                 rsx->getRegister(pxs3c::NV4097_SET_VERTEX_DATA_ARRAY_OFFSET + 24) == 4;
             
-            std::cout << "✓ RSX processor test PASSED" << std::endl;
+            if (ok) {
+                std::cout << "✓ RSX processor test PASSED" << std::endl;
+            } else {
+                std::cout << "✗ RSX processor test FAILED" << std::endl;
+                failures++;
+            }
+        }
+    }
+    
+    std::cout << "\n=== Testing RSX FIFO ===" << std::endl;
+    {
+        auto* memory = emu.getMemory();
+        const uint32_t ring = pxs3c::RSX_MEMORY_BASE + 0x200000;
+        const uint32_t control = pxs3c::RSX_MEMORY_BASE + 0x1040;
+        pxs3c::RSXFifo fifo;
+        pxs3c::RSXProcessor consumer;
+        bool ok = fifo.init(memory, ring, 0x10000, control);
+        
+        // Commands and the control registers are big-endian guest words;
+        // nothing is visible to the consumer before PUT moves
+        ok = ok && fifo.push(pxs3c::NV4097_SET_COLOR_CLEAR_VALUE, 0x11223344);
+        ok = ok && memory->read32(ring) == pxs3c::rsxFifoMethod(pxs3c::NV4097_SET_COLOR_CLEAR_VALUE, 1) &&
+             memory->read32(ring + 4) == 0x11223344 && consumer.processFifo(fifo) == 0;
+        fifo.flush();
+        ok = ok && memory->read32(control) == 8 && consumer.processFifo(fifo) == 1 &&
+             memory->read32(control + 4) == 8 && consumer.getDrawState().clearColor == 0x11223344;
+        
+        // A stream built by the guest: call a subroutine, return, jump,
+        // then set REF
+        memory->write32(ring + 0x008, 0x100 | pxs3c::RSX_FIFO_CALL);
+        memory->write32(ring + 0x100, pxs3c::rsxFifoMethod(pxs3c::NV4097_SET_BLEND_EQUATION, 1));
+        memory->write32(ring + 0x104, 0x800A);
+        memory->write32(ring + 0x108, pxs3c::RSX_FIFO_RETURN);
+        memory->write32(ring + 0x00C, 0x200 | pxs3c::RSX_FIFO_JUMP);
+        memory->write32(ring + 0x200, pxs3c::rsxFifoMethod(pxs3c::NV406E_SET_REFERENCE, 1));
+        memory->write32(ring + 0x204, 7);
+        fifo.setPut(0x208);
+        uint64_t jumps = consumer.getStats().jumps;
+        ok = ok && consumer.processFifo(fifo) == 2 && fifo.getGet() == 0x208 && fifo.getRef() == 7 &&
+             memory->read32(control + 8) == 7 && consumer.getStats().jumps - jumps == 3 &&
+             consumer.getDrawState().blendEquation == pxs3c::RSXBlendEquation::SUBTRACT;
+        
+        // A non-incrementing run writes all its words to one register
+        const uint32_t offsets[3] = {0x100, 0x200, 0x300};
+        ok = ok && fifo.push(pxs3c::NV4097_SET_TEXTURE_OFFSET, offsets, 3, true);
+        fifo.flush();
+        ok = ok && consumer.processFifo(fifo) == 1 && consumer.getRegister(pxs3c::NV4097_SET_TEXTURE_OFFSET) == 0x300 &&
+             consumer.getRegister(pxs3c::NV4097_SET_TEXTURE_FORMAT) == 0;
+        
+        // A producer thread streaming through the 64KB ring many times over
+        // while the consumer thread executes behind it
+        ok = ok && consumer.startFifoThread(&fifo);
+        const uint32_t total = 1000000;
+        const uint32_t args[4] = {1, 2, 3, 4};
+        pxs3c::RSXProcessorStats before = consumer.getStats();
+        auto start = std::chrono::steady_clock::now();
+        bool pushed = true;
+        std::thread producer([&] {
+            for (uint32_t i = 0; i < total && pushed; ++i) {
+                pushed = fifo.push(0x1700 + (i & 3) * 4, args, 1 + (i & 3));
+                if ((i & 255) == 255) fifo.flush();
+            }
+            pushed = pushed && fifo.push(pxs3c::NV406E_SET_REFERENCE, total);
+            fifo.flush();
+        });
+        producer.join();
+        ok = ok && pushed && fifo.waitIdle();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        consumer.stopFifoThread();
+        const pxs3c::RSXProcessorStats& stats = consumer.getStats();
+        std::cout << "  Streamed " << (stats.methods - before.methods) << " methods through "
+                  << (stats.jumps - before.jumps) << " wraps at " << (stats.methods - before.methods) / seconds / 1e6
+                  << "M methods/s" << std::endl;
+        ok = ok && fifo.getRef() == total && stats.methods - before.methods == total + 1 &&
+             stats.words - before.words == uint64_t(total) * 5 / 2 + 1 &&
+             stats.jumps - before.jumps >= uint64_t(total) * 14 / 0x10000 && stats.faults == 0;
+        
+        if (ok) {
+            std::cout << "✓ RSX FIFO test PASSED" << std::endl;
+        } else {
+            std::cout << "✗ RSX FIFO test FAILED" << std::endl;
+            failures++;
+        }
+    }
+    
+    std::cout << "\n=== Testing RSX thread ===" << std::endl;
+    {
+        auto* memory = emu.getMemory();
+        auto* rsx = emu.getRSX();
+        auto* fifo = emu.getRSXFifo();
+        bool ok = rsx && fifo && rsx->isFifoThreadRunning();
+        const uint32_t semaphores = pxs3c::RSX_SEMAPHORE_ADDRESS;
+        
+        // The RSX stops at the semaphore until the CPU writes 1 to it, then
+        // carries on and releases two labels
+        const uint32_t acquire[2] = {0x10, 1};
+        const uint32_t backEnd[2] = {0x30, 0x00AA00BB};
+        ok = ok && fifo->push(pxs3c::NV406E_SEMAPHORE_OFFSET, acquire, 2) &&
+             fifo->push(pxs3c::NV4097_SET_COLOR_CLEAR_VALUE, 0x55667788) &&
+             fifo->push(pxs3c::NV4097_SET_SEMAPHORE_OFFSET, 0x20) &&
+             fifo->push(pxs3c::NV4097_TEXTURE_READ_SEMAPHORE_RELEASE, 5) &&
+             fifo->push(pxs3c::NV4097_SET_SEMAPHORE_OFFSET, backEnd, 2) &&
+             fifo->push(pxs3c::NV4097_WAIT_FOR_IDLE, 0);
+        fifo->flush();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        ok = ok && !fifo->isEmpty() && memory->read32(semaphores + 0x20) != 5;
+        memory->write32(semaphores + 0x10, 1);
+        ok = ok && fifo->waitIdle() && memory->read32(semaphores + 0x20) == 5 &&
+             memory->read32(semaphores + 0x30) == 0x00BB00AA &&
+             rsx->getDrawState().clearColor == 0x55667788 && rsx->getStats().semaphoreStalls > 0;
+        std::cout << "  Semaphore stalls: " << (rsx ? rsx->getStats().semaphoreStalls : 0) << std::endl;
+        
+        // Frames are presented by the RSX thread, at the flip runFrame queues
+        uint32_t flips = rsx ? rsx->getFlips() : 0;
+        emu.runFrame();
+        ok = ok && rsx->waitForFlips(flips + 1, 1000000000ULL) && fifo->waitIdle();
+        
+        if (ok) {
+            std::cout << "✓ RSX thread test PASSED" << std::endl;
+        } else {
+            std::cout << "✗ RSX thread test FAILED" << std::endl;
+            failures++;
         }
     }
     
@@ -205,6 +1065,7 @@ int main(int argc, char** argv) {
                 std::cout << "✓ SELF loader test PASSED" << std::endl;
             } else {
                 std::cout << "✗ SELF loader test FAILED" << std::endl;
+                failures++;
             }
             
             // Cleanup
@@ -218,5 +1079,9 @@ int main(int argc, char** argv) {
     
     emu.shutdown();
     std::cout << "\n=== Test Complete ===" << std::endl;
+    if (failures > 0) {
+        std::cout << failures << " test(s) FAILED" << std::endl;
+        return 1;
+    }
     return 0;
 }
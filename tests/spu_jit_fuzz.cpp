@@ -0,0 +1,231 @@
+// Differential fuzzer for the SPU recompiler: runs random instruction
+// sequences through the interpreter and through compiled code and compares
+// the resulting register file, PC and local store.
+//
+// Usage: pxs3c_spu_jit_fuzz [iterations] [seed]
+
+#include "cpu/SPUInterpreter.h"
+#include "cpu/SPURecompiler.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace pxs3c;
+
+namespace {
+
+constexpr uint32_t CODE_BASE = 0x30000;
+constexpr uint32_t DATA_BASE = 0x10000;
+constexpr int SEQUENCE_LENGTH = 32;
+
+// r1 is the base and r2 the index of every generated load and store, and
+// no other instruction writes them. Displacements reach 8KB either side of
+// the base, which stays well clear of the code.
+constexpr uint32_t BASE_REG = 1;
+constexpr uint32_t INDEX_REG = 2;
+
+class Generator {
+public:
+    explicit Generator(uint64_t seed) : rng_(seed) {
+        for (int op = 1; op < SPU_OP_COUNT; ++op) {
+            SPUOp spuOp = static_cast<SPUOp>(op);
+            // Straight-line code only; absolute and PC-relative stores
+            // could rewrite the block while it runs
+            if (SPURecompiler::endsBlock(encode(spuOp, 0)) || spuOp == SPUOp::STQA ||
+                spuOp == SPUOp::STQR) {
+                continue;
+            }
+            ops_.push_back(spuOp);
+        }
+    }
+
+    uint64_t next() { return rng_(); }
+    uint32_t below(uint32_t n) { return static_cast<uint32_t>(rng_() % n); }
+
+    uint32_t dest() { return 3 + below(125); }
+
+    uint32_t instruction() {
+        SPUOp op = ops_[below(static_cast<uint32_t>(ops_.size()))];
+        uint32_t instr = encode(op, static_cast<uint32_t>(next()));
+        if (SPU_OP_INFO[static_cast<int>(op)].form == SPUForm::RRR) {
+            return (instr & ~(0x7Fu << 21)) | (dest() << 21);
+        }
+        instr = (instr & ~0x7Fu) | dest();
+        switch (op) {
+            case SPUOp::LQD: case SPUOp::STQD:
+                return (instr & ~(0x7Fu << 7)) | (BASE_REG << 7);
+            case SPUOp::LQX: case SPUOp::STQX:
+                return (instr & ~(0x3FFFu << 7)) | (INDEX_REG << 14) | (BASE_REG << 7);
+            default:
+                return instr;
+        }
+    }
+
+    // A branch of any kind to end the block
+    uint32_t branch() {
+        static const SPUOp branches[] = {
+            SPUOp::BR, SPUOp::BRA, SPUOp::BRSL, SPUOp::BRASL, SPUOp::BRZ, SPUOp::BRNZ,
+            SPUOp::BRHZ, SPUOp::BRHNZ, SPUOp::BI, SPUOp::BISL, SPUOp::BIZ, SPUOp::BINZ,
+            SPUOp::BIHZ, SPUOp::BIHNZ};
+        SPUOp op = branches[below(sizeof(branches) / sizeof(branches[0]))];
+        uint32_t instr = encode(op, static_cast<uint32_t>(next()));
+        if (op == SPUOp::BRSL || op == SPUOp::BRASL || op == SPUOp::BISL) {
+            instr = (instr & ~0x7Fu) | dest();
+        }
+        return instr;
+    }
+
+private:
+    std::mt19937_64 rng_;
+    std::vector<SPUOp> ops_;
+
+    // The opcode of op with random operand bits below it
+    static uint32_t encode(SPUOp op, uint32_t operands) {
+        const SPUOpInfo& info = SPU_OP_INFO[static_cast<int>(op)];
+        uint32_t shift = 32 - info.bits;
+        return (static_cast<uint32_t>(info.opcode) << shift) | (operands & ((1u << shift) - 1));
+    }
+};
+
+void writeWord(SPULocalStore& ls, uint32_t addr, uint32_t value) {
+    ls[addr] = static_cast<uint8_t>(value >> 24);
+    ls[addr + 1] = static_cast<uint8_t>(value >> 16);
+    ls[addr + 2] = static_cast<uint8_t>(value >> 8);
+    ls[addr + 3] = static_cast<uint8_t>(value);
+}
+
+void loadState(SPUInterpreter& spu, const std::vector<uint32_t>& program,
+               const std::vector<SPUVector>& regs, const std::vector<uint8_t>& data) {
+    spu.reset();
+    SPULocalStore& ls = spu.getLocalStore();
+    std::memcpy(ls.data() + DATA_BASE, data.data(), data.size());
+    for (size_t i = 0; i < program.size(); ++i) {
+        writeWord(ls, CODE_BASE + static_cast<uint32_t>(i) * 4, program[i]);
+    }
+    for (int i = 0; i < 128; ++i) {
+        spu.setRegister(i, regs[i]);
+    }
+    spu.setPC(CODE_BASE);
+}
+
+bool compare(const SPUInterpreter& a, const SPUInterpreter& b) {
+    bool same = true;
+    for (int i = 0; i < 128; ++i) {
+        SPUVector x = a.getRegister(i);
+        SPUVector y = b.getRegister(i);
+        if (std::memcmp(&x, &y, sizeof(x)) == 0) continue;
+        std::cout << "  r" << i << ": interpreter=" << std::hex;
+        for (int w = 0; w < 4; ++w) std::cout << std::setw(8) << std::setfill('0') << x.w(w);
+        std::cout << " jit=";
+        for (int w = 0; w < 4; ++w) std::cout << std::setw(8) << std::setfill('0') << y.w(w);
+        std::cout << std::setfill(' ') << std::dec << std::endl;
+        same = false;
+    }
+    if (a.getPC() != b.getPC()) {
+        std::cout << "  pc: interpreter=0x" << std::hex << a.getPC() << " jit=0x" << b.getPC()
+                  << std::dec << std::endl;
+        same = false;
+    }
+    const SPULocalStore& x = a.getLocalStore();
+    const SPULocalStore& y = b.getLocalStore();
+    for (size_t off = 0; off < x.size(); off += 16) {
+        if (std::memcmp(x.data() + off, y.data() + off, 16) != 0) {
+            std::cout << "  ls[0x" << std::hex << off << "] differs" << std::dec << std::endl;
+            same = false;
+        }
+    }
+    return same;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? std::atoi(argv[1]) : 1000;
+    uint64_t seed = argc > 2 ? std::strtoull(argv[2], nullptr, 0) : std::random_device{}();
+
+    std::cout << "=== SPU JIT differential fuzz (" << iterations << " sequences, seed "
+              << seed << ") ===" << std::endl;
+
+    SPUInterpreter reference(0);
+    SPUInterpreter jitted(1);
+    if (!reference.init(nullptr) || !jitted.init(nullptr)) {
+        std::cerr << "Failed to init SPUs" << std::endl;
+        return 1;
+    }
+    // Only run what the fuzzer compiles explicitly
+    SPURecompilerConfig config;
+    config.enabled = true;
+    config.threshold = ~0u;
+    jitted.setRecompilerConfig(config);
+    SPURecompiler* jit = jitted.getRecompiler();
+    if (!jit) {
+        std::cout << "SPU recompiler not available, skipping" << std::endl;
+        return 0;
+    }
+
+    Generator gen(seed);
+    uint64_t totalInstructions = 0;
+    for (int iter = 0; iter < iterations; ++iter) {
+        std::vector<uint32_t> program;
+        for (int i = 0; i < SEQUENCE_LENGTH; ++i) {
+            program.push_back(gen.instruction());
+        }
+        program.push_back(gen.branch());
+        const int steps = static_cast<int>(program.size());
+
+        std::vector<SPUVector> regs(128);
+        for (auto& r : regs) {
+            for (int w = 0; w < 4; ++w) {
+                switch (gen.below(4)) {
+                    case 0: r.w(w) = gen.below(64); break;
+                    case 1: r.w(w) = 0u - gen.below(64); break;
+                    case 2: r.w(w) = 0; break;
+                    default: r.w(w) = static_cast<uint32_t>(gen.next()); break;
+                }
+            }
+        }
+        regs[BASE_REG].w(0) = DATA_BASE + 0x2000 + gen.below(0x1000);
+        regs[INDEX_REG].w(0) = gen.below(0x1000);
+
+        std::vector<uint8_t> data(0x6000);
+        for (auto& byte : data) byte = static_cast<uint8_t>(gen.next());
+
+        loadState(reference, program, regs, data);
+        for (int i = 0; i < steps; ++i) {
+            reference.executeInstruction();
+        }
+
+        loadState(jitted, program, regs, data);
+        uint64_t before = jit->getStats().instructions;
+        bool compiled = jit->compileBlock(CODE_BASE);
+        jitted.executeBlock(steps);
+
+        bool same = compare(reference, jitted);
+        if (compiled && jit->getStats().instructions - before != static_cast<uint64_t>(steps)) {
+            std::cout << "  compiled block did not run" << std::endl;
+            same = false;
+        }
+        if (!same) {
+            std::cout << "Mismatch in sequence " << iter << ", program:" << std::endl;
+            for (size_t i = 0; i < program.size(); ++i) {
+                std::cout << "  0x" << std::hex << CODE_BASE + i * 4 << ": 0x" << std::setw(8)
+                          << std::setfill('0') << program[i] << std::setfill(' ') << std::dec
+                          << " " << spuOpName(spuDecode(program[i])) << std::endl;
+            }
+            std::cout << "✗ SPU JIT differential fuzz FAILED (rerun with seed " << seed << ")"
+                      << std::endl;
+            return 1;
+        }
+        totalInstructions += steps;
+    }
+
+    const SPURecompilerStats& stats = jit->getStats();
+    std::cout << "Compiled code retired " << stats.instructions << " of " << totalInstructions
+              << " instructions (" << stats.native << " translated, " << stats.interpreted
+              << " through the interpreter)" << std::endl;
+    std::cout << "✓ SPU JIT differential fuzz PASSED" << std::endl;
+    return 0;
+}